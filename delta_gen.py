@@ -0,0 +1,139 @@
+import argparse
+import hashlib
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+
+# makes a patch that turns one firmware image into another, for ESPHelperDeltaOTA
+#
+#   python delta_gen.py old.bin new.bin update.patch
+#
+# old.bin has to be the image running on the device (the device checks its SHA-256 before it writes
+# anything). The patch is sent like an image: ESPHelperHttpOTA::begin(url, sha, true), or
+# mqtt_ota_sender.py (which spots the patch header by itself).
+#
+# --check applies the patch with ESPHelperDeltaOTA itself, built for the host (tests/delta_apply):
+#
+#   cmake -S tests -B build && cmake --build build
+#   python delta_gen.py old.bin new.bin update.patch --check build/delta_apply
+#
+# layout (little endian) - keep in step with ESPHelperDeltaOTA.h:
+#   "EHDP", version, 3 reserved bytes, uint32 source size, uint32 target size,
+#   sha256(source), sha256(target), then operations:
+#   0x01 COPY  uint32 source offset, uint32 length
+#   0x02 DATA  uint32 length, then the bytes
+
+MAGIC = b"EHDP"
+VERSION = 1
+OP_COPY = 0x01
+OP_DATA = 0x02
+
+BLOCK = 16      # bytes a match has to start with to be found
+STEP = 4        # source offsets indexed (every STEP bytes - matches are still found at any target offset)
+MIN_COPY = 24   # shorter matches cost more as a COPY (and the DATA split around it) than as data
+
+
+def find_ops(source, target):
+    # greedy match of target against source: every BLOCK bytes of the target are looked up in an
+    # index of the source, and a hit is grown backwards and forwards as far as the bytes agree
+    index = {}
+    for offset in range(0, len(source) - BLOCK + 1, STEP):
+        index.setdefault(source[offset:offset + BLOCK], offset)
+
+    ops = []
+    literal_start = 0
+    i = 0
+    while i + BLOCK <= len(target):
+        offset = index.get(target[i:i + BLOCK])
+        if offset is None:
+            i += 1
+            continue
+
+        # grow backwards into the pending literal data, then forwards
+        back = 0
+        while i - back > literal_start and offset - back > 0 and target[i - back - 1] == source[offset - back - 1]:
+            back += 1
+        start, offset = i - back, offset - back
+        length = BLOCK + back
+        while start + length < len(target) and offset + length < len(source) and target[start + length] == source[offset + length]:
+            length += 1
+
+        if length < MIN_COPY:
+            i += 1
+            continue
+
+        if start > literal_start:
+            ops.append((OP_DATA, target[literal_start:start]))
+        ops.append((OP_COPY, offset, length))
+        i = start + length
+        literal_start = i
+
+    if literal_start < len(target):
+        ops.append((OP_DATA, target[literal_start:]))
+    return ops
+
+
+def make_patch(source, target):
+    patch = [MAGIC, struct.pack("<B3xII", VERSION, len(source), len(target)),
+             hashlib.sha256(source).digest(), hashlib.sha256(target).digest()]
+    copied = 0
+    for op in find_ops(source, target):
+        if op[0] == OP_COPY:
+            patch.append(struct.pack("<BII", OP_COPY, op[1], op[2]))
+            copied += op[2]
+        else:
+            patch.append(struct.pack("<BI", OP_DATA, len(op[1])))
+            patch.append(op[1])
+    return b"".join(patch), copied
+
+
+def check_patch(applier, patch_path, source_path, target_path):
+    # apply with the device code (source file standing in for the running partition, a scratch
+    # file for the update partition) and compare the result with the real target
+    with tempfile.TemporaryDirectory() as scratch:
+        built_path = os.path.join(scratch, "built.bin")
+        result = subprocess.run([applier, source_path, patch_path, built_path], capture_output=True, text=True)
+        if result.returncode != 0:
+            raise ValueError(result.stdout.strip() or f"{applier} exited with {result.returncode}")
+        print(result.stdout.strip())
+        with open(built_path, "rb") as built_file, open(target_path, "rb") as target_file:
+            if built_file.read() != target_file.read():
+                raise ValueError("patched image differs from the target")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Make a delta patch for ESPHelperDeltaOTA")
+    parser.add_argument("source", help="image running on the device (.bin)")
+    parser.add_argument("target", help="new image (.bin)")
+    parser.add_argument("patch", help="patch file to write")
+    parser.add_argument("--check", metavar="DELTA_APPLY", help="apply the patch to the source file with delta_apply (built from tests/) and compare with the target")
+    args = parser.parse_args()
+
+    with open(args.source, "rb") as source_file:
+        source = source_file.read()
+    with open(args.target, "rb") as target_file:
+        target = target_file.read()
+
+    patch, copied = make_patch(source, target)
+    with open(args.patch, "wb") as patch_file:
+        patch_file.write(patch)
+
+    print(f"{args.patch}: {len(patch)} bytes for a {len(target)} byte image "
+          f"({100 * len(patch) / max(len(target), 1):.1f}%, {copied} bytes copied from the running image)")
+    print(f"patch sha256 {hashlib.sha256(patch).hexdigest()}")
+
+    if args.check:
+        try:
+            check_patch(args.check, args.patch, args.source, args.target)
+        except (ValueError, OSError) as error:
+            print(f"check failed: {error}")
+            return 1
+        print("check passed")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,169 @@
+import argparse
+import hashlib
+import json
+import struct
+import sys
+import threading
+import time
+
+import paho.mqtt.client as mqtt
+
+
+# sends a firmware image to a device running ESPHelperMqttOTA
+#
+#   python mqtt_ota_sender.py --host broker.lan --topic devices/kitchen/ota firmware.bin
+#
+# chunks are published on <topic>/data with a 4 byte big endian index in front of them. The device
+# acks on <topic>/ack with the next chunk it needs and a bitmap of the chunks after it that it
+# already holds, so a full window stays in flight and only the gaps are sent again.
+# A patch made by delta_gen.py can be sent in place of the firmware image.
+
+BEGIN_RETRY = 2.0       # seconds between begin messages until the device answers
+RESEND_TIMEOUT = 2.0    # seconds before a chunk that hasn't been acked is sent again
+GAP_RESEND = 0.2        # min seconds between resends of a chunk the device reported missing
+
+DELTA_MAGIC = b"EHDP"   # first bytes of a delta_gen.py patch
+
+
+class Sender:
+    def __init__(self, args, image):
+        self.args = args
+        self.image = image
+        self.count = (len(image) + args.chunk - 1) // args.chunk
+        self.cond = threading.Condition()
+        self.ack = None
+
+        try:
+            self.client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION1)  # paho-mqtt 2.x
+        except AttributeError:
+            self.client = mqtt.Client()
+        if args.user:
+            self.client.username_pw_set(args.user, args.password)
+        self.client.on_connect = self.on_connect
+        self.client.on_message = self.on_message
+
+    def on_connect(self, client, userdata, flags, rc):
+        client.subscribe(self.args.topic + "/ack", qos=0)
+
+    def on_message(self, client, userdata, message):
+        try:
+            ack = json.loads(message.payload)
+        except ValueError:
+            return
+        with self.cond:
+            self.ack = ack
+            self.cond.notify()
+
+    def wait_ack(self, timeout):
+        with self.cond:
+            if self.ack is None:
+                self.cond.wait(timeout)
+            ack, self.ack = self.ack, None
+            return ack
+
+    def chunk(self, index):
+        data = self.image[index * self.args.chunk:(index + 1) * self.args.chunk]
+        return struct.pack(">I", index) + data
+
+    def run(self):
+        self.client.connect(self.args.host, self.args.port)
+        self.client.loop_start()
+
+        begin = {
+            "size": len(self.image),
+            "chunk": self.args.chunk,
+            "window": self.args.window,
+            "sha256": hashlib.sha256(self.image).hexdigest(),
+        }
+        # patches from delta_gen.py are applied to the running image by the device
+        if self.image[:4] == DELTA_MAGIC:
+            begin["delta"] = True
+        begin = json.dumps(begin)
+
+        # start the update (the device answers with its first ack)
+        deadline = time.time() + self.args.timeout
+        ack = None
+        while ack is None or "next" not in ack:
+            if ack is not None and "error" in ack:
+                return self.failed(ack["error"])
+            if time.time() > deadline:
+                return self.failed("no answer from the device")
+            self.client.publish(self.args.topic + "/begin", begin, qos=1)
+            ack = self.wait_ack(BEGIN_RETRY)
+
+        start = time.time()
+        sent = {}
+        resends = 0
+        last_progress = time.time()
+        while True:
+            if "error" in ack:
+                return self.failed(ack["error"])
+            if ack.get("done"):
+                break
+
+            now = time.time()
+            next_chunk = ack["next"]
+            bitmap = ack.get("bitmap", 0)
+            window = ack.get("window", self.args.window)
+            highest_held = bitmap.bit_length() - 1
+
+            for offset in range(window):
+                index = next_chunk + offset
+                if index >= self.count:
+                    break
+                if bitmap & (1 << offset):
+                    continue
+
+                # a missing chunk with later ones already held was lost on the way
+                lost = offset < highest_held and now - sent.get(index, 0) > GAP_RESEND
+                if index not in sent or lost or now - sent[index] > RESEND_TIMEOUT:
+                    if index in sent:
+                        resends += 1
+                    self.client.publish(self.args.topic + "/data", self.chunk(index), qos=0)
+                    sent[index] = now
+
+            if now - last_progress > 1:
+                last_progress = now
+                done = min(next_chunk * self.args.chunk, len(self.image))
+                print(f"\r{done}/{len(self.image)} bytes ({done / max(now - start, 1e-3) / 1024:.1f} KiB/s)", end="")
+                sys.stdout.flush()
+
+            new_ack = self.wait_ack(RESEND_TIMEOUT)
+            if new_ack is not None:
+                ack = new_ack
+                deadline = time.time() + self.args.timeout
+            elif time.time() > deadline:
+                return self.failed("device stopped answering")
+
+        elapsed = time.time() - start
+        print(f"\rsent {len(self.image)} bytes in {elapsed:.1f} s ({len(self.image) / elapsed / 1024:.1f} KiB/s, "
+              f"{self.count} chunks, {resends} resent) - the device will restart to boot the new image")
+        self.client.loop_stop()
+        return 0
+
+    def failed(self, error):
+        print(f"\nupdate failed: {error}")
+        self.client.loop_stop()
+        return 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Send a firmware image to an ESPHelperMqttOTA device")
+    parser.add_argument("firmware", help="firmware image (.bin) or delta_gen.py patch")
+    parser.add_argument("--host", default="localhost")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--user")
+    parser.add_argument("--password")
+    parser.add_argument("--topic", required=True, help="OTA base topic of the device")
+    parser.add_argument("--chunk", type=int, default=1024, help="chunk size (the device MQTT buffer must fit it)")
+    parser.add_argument("--window", type=int, default=8, help="chunks in flight (the device may lower it)")
+    parser.add_argument("--timeout", type=float, default=30, help="seconds to wait for the device")
+    args = parser.parse_args()
+
+    with open(args.firmware, "rb") as firmware:
+        image = firmware.read()
+    return Sender(args, image).run()
+
+
+if __name__ == "__main__":
+    sys.exit(main())
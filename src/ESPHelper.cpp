@@ -24,6 +24,150 @@
 #include <WiFiClientSecure.h>
 
 
+#ifdef ESPHELPER_ALLOC_GUARD
+/*
+heap allocation counter used by the loop() allocation guard. This only counts anything when the
+sketch is linked with: -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc
+(operator new and String both end up in malloc/realloc)
+*/
+extern "C" {
+	void* __real_malloc(size_t size);
+	void* __real_calloc(size_t count, size_t size);
+	void* __real_realloc(void* ptr, size_t size);
+
+	volatile uint32_t espHelperAllocCount = 0;
+
+	void* __wrap_malloc(size_t size){
+		espHelperAllocCount++;
+		return __real_malloc(size);
+	}
+	void* __wrap_calloc(size_t count, size_t size){
+		espHelperAllocCount++;
+		return __real_calloc(count, size);
+	}
+	void* __wrap_realloc(void* ptr, size_t size){
+		espHelperAllocCount++;
+		return __real_realloc(ptr, size);
+	}
+}
+#endif
+
+
+/*
+Print adapter used by publishJson to move serialized data into the MQTT client in chunks
+rather than a byte at a time
+*/
+class publishWriter : public Print {
+public:
+	explicit publishWriter(PubSubClient& client) : _client(client) {}
+
+	size_t write(uint8_t c) override {
+		if(_len == sizeof(_buf) && !flushBuffer()){return 0;}
+		_buf[_len++] = c;
+		return 1;
+	}
+
+	size_t write(const uint8_t* data, size_t size) override {
+		size_t written = 0;
+		while(written < size){
+			if(_len == sizeof(_buf) && !flushBuffer()){break;}
+			size_t chunk = min(size - written, sizeof(_buf) - _len);
+			memcpy(_buf + _len, data + written, chunk);
+			_len += chunk;
+			written += chunk;
+		}
+		return written;
+	}
+
+	bool flushBuffer(){
+		if(_len > 0 && !_failed){
+			if(_client.write(_buf, _len) != _len){_failed = true;}
+		}
+		_len = 0;
+		return !_failed;
+	}
+
+private:
+	PubSubClient& _client;
+	uint8_t _buf[128];
+	size_t _len = 0;
+	bool _failed = false;
+};
+
+
+/*
+Print adapter that only counts bytes (for sizing a streamed publish before starting it)
+*/
+class lengthCounter : public Print {
+public:
+	size_t write(uint8_t c) override {
+		_length++;
+		return 1;
+	}
+
+	size_t write(const uint8_t* data, size_t size) override {
+		_length += size;
+		return size;
+	}
+
+	size_t length() const {return _length;}
+
+private:
+	size_t _length = 0;
+};
+
+
+
+
+/*
+Print adapter that writes into a fixed buffer (for streaming a publish into the network task ring)
+*/
+class bufferWriter : public Print {
+public:
+	bufferWriter(uint8_t* buf, size_t size) : _buf(buf), _size(size) {}
+
+	size_t write(uint8_t c) override {
+		if(_len == _size){return 0;}
+		_buf[_len++] = c;
+		return 1;
+	}
+
+	size_t write(const uint8_t* data, size_t size) override {
+		size_t count = min(size, _size - _len);
+		memcpy(_buf + _len, data, count);
+		_len += count;
+		return count;
+	}
+
+private:
+	uint8_t* _buf;
+	size_t _size;
+	size_t _len = 0;
+};
+
+
+#ifdef ESP32
+/*
+holds the network task lock for a scope (see enableNetworkTask). Calls that use the MQTT client or
+change the network settings take it so they never run in the middle of a network task step. The
+lock is recursive and doesn't exist until the task is first enabled
+*/
+class networkGuard {
+public:
+	explicit networkGuard(SemaphoreHandle_t lock) : _lock(lock) {
+		if(_lock != nullptr){xSemaphoreTakeRecursive(_lock, portMAX_DELAY);}
+	}
+	~networkGuard(){
+		if(_lock != nullptr){xSemaphoreGiveRecursive(_lock);}
+	}
+private:
+	SemaphoreHandle_t _lock;
+};
+
+#define NETWORK_GUARD() networkGuard netGuard(_netLock)
+#else
+#define NETWORK_GUARD()
+#endif
 
 
 void printNetInfo(const NetInfo *net, const char* header, bool printMQTT, bool printWill){
@@ -152,8 +296,8 @@ void ESPHelper::validateConfig(){
 	if(_currentNet.getSsid()[0] == '\0'){_ssidSet = false;}
 	else{_ssidSet = true;}
 
-	//mqtt host
-	if(_currentNet.getMqttHost()[0] == '\0'){_mqttSet = false;}
+	//mqtt host (not needed when the broker is found with mDNS)
+	if(_currentNet.getMqttHost()[0] == '\0' && !_brokerDiscovery){_mqttSet = false;}
 	else{_mqttSet = true;}
 
 	//mqtt port
@@ -217,13 +361,15 @@ bool ESPHelper::begin(){
 
 	// Generate client name based on MAC address and last 8 bits of microsecond counter
 	#ifdef ESP8266
-	_clientName = "esp8266-";
+	const char* clientPrefix = "esp8266-";
 	#else
-	_clientName = "esp32-";
+	const char* clientPrefix = "esp32-";
 	#endif
 	uint8_t mac[6];
 	WiFi.macAddress(mac);
-	_clientName += macToStr(mac);
+	char macStr[18];
+	macToStr(mac, macStr, sizeof(macStr));
+	snprintf(_clientName, sizeof(_clientName), "%s%s", clientPrefix, macStr);
 
 	//set the wifi mode to station
 	WiFi.mode(WIFI_STA);
@@ -243,8 +389,8 @@ bool ESPHelper::begin(){
 		if(_mqttSet){
 			client.setServer(_currentNet.getMqttHost(), _currentNet.getMqttPort());
 
-			//set the mqtt message callback if needed
-			if(_mqttCallbackSet){client.setCallback(_mqttCallback);}
+			//install the internal message handler (topic handlers and the user callback)
+			attachMQTTCallback();
 		}
 
 		//define a dummy instance of mqtt so that it is instantiated if no mqtt ip is set
@@ -260,18 +406,10 @@ bool ESPHelper::begin(){
 
 		//ota event handlers
 		ArduinoOTA.onStart([]() {/* ota start code */});
-		ArduinoOTA.onEnd([]() {
-			//give the arduino a bit of time to finish up any remaining network activity
-			delay(500);
-			//on ota end we disconnect from wifi cleanly before restarting.
-			WiFi.softAPdisconnect();
-			WiFi.disconnect();
-			int timeout = 0;
-			//max timeout of 2seconds before just dropping out and restarting
-			while(WiFi.status() != WL_DISCONNECTED && timeout < 200){
-				delay(10);
-				timeout++;
-			}
+		//on ota end loop() takes the connections down cleanly and then restarts (instead of ArduinoOTA restarting right away)
+		ArduinoOTA.setRebootOnSuccess(false);
+		ArduinoOTA.onEnd([this]() {
+			requestRestart();
 		});
 		ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {/* ota progress code */});
 		ArduinoOTA.onError([](ota_error_t error) {/* ota error code */});
@@ -289,6 +427,9 @@ bool ESPHelper::begin(){
 		//attempt to start ota if needed
 		OTA_begin();
 
+		//remember what the network was started with so later updates only restart what changed
+		_currentNet.cloneTo(_appliedNet, true);
+
 		//mark the system as started and return
 		_hasBegun = true;
 		return true;
@@ -306,18 +447,15 @@ input: NA
 output: NA
 */
 void ESPHelper::end(){
+	#ifdef ESP32
+	disableNetworkTask();
+	#endif
+
 	OTA_disable();
-	client.disconnect();
-	delay(20);
+	closeMqtt();
 	WiFi.softAPdisconnect();
 	WiFi.disconnect();
 
-	int timeout = 0;
-	while(WiFi.status() != WL_DISCONNECTED && timeout < 200){
-		delay(10);
-		timeout++;
-	}
-
 	_connectionStatus = NO_CONNECTION;
 
 }
@@ -329,12 +467,25 @@ void ESPHelper::end(){
 enables the use of a secure (SSL) connection to an MQTT broker.
 (Make sure your mqtt port is set to one expecting a secure connection)
 
-input: char ptr string for SSL fingerprint
+input: char ptr string for SSL fingerprint (SHA-1 on the ESP8266, SHA-256 on the ESP32. nullptr to accept any certificate)
 output: NA
 */
 void ESPHelper::useSecureClient(const char* fingerprint){
+	NETWORK_GUARD();
 	_fingerprint = fingerprint;
 
+	#ifdef ESP8266
+	//BearSSL checks the fingerprint during the handshake, and resumes the cached session on reconnects
+	if(fingerprint != nullptr){wifiClientSecure.setFingerprint(fingerprint);}
+	else{wifiClientSecure.setInsecure();}
+	wifiClientSecure.setSession(&_tlsSession);
+	#endif
+
+	#ifdef ESP32
+	//there is no CA to check against - the fingerprint is checked once connected (see connectSecure)
+	wifiClientSecure.setInsecure();
+	#endif
+
 	//fall back to wifi only connection if it was previously at full connection
 	//(because we just changed how the device is going to connect to the mqtt broker)
 	if(setConnectionStatus() == FULL_CONNECTION){
@@ -353,6 +504,178 @@ void ESPHelper::useSecureClient(const char* fingerprint){
 }
 
 
+/*
+keep the TLS session in RTC user memory so it can be resumed after a restart or deep sleep,
+not just after a reconnect (ESP8266 only - the ESP32 client can't resume sessions)
+
+input:
+	uint32_t first RTC user memory block (4 bytes each) to use - about 25 blocks are needed
+output: NA
+*/
+void ESPHelper::enableTlsSessionPersistence(uint32_t rtcBlock){
+	NETWORK_GUARD();
+	_tlsPersist = true;
+	_tlsRtcBlock = rtcBlock;
+}
+
+
+/*
+get the handshake timing and the full/resumed handshake counters of the secure client
+
+input: NA
+output:
+	tlsStats reference
+*/
+const tlsStats& ESPHelper::getTlsStats(){
+	return _tlsStats;
+}
+
+
+/*
+open the TLS connection to the broker (PubSubClient then reuses it for the MQTT connection)
+
+input: NA
+output:
+	true on: connected and the server certificate was accepted
+	false on: connection, handshake or fingerprint check failed
+*/
+bool ESPHelper::connectSecure(){
+	#ifdef ESP8266
+	if(_tlsPersist && !_tlsSessionLoaded){loadTlsSession();}
+
+	//remember the session offered to the server - it echoes the id back when it resumes it
+	br_ssl_session_parameters* session = _tlsSession.getSession();
+	uint8_t offeredLength = session->session_id_len;
+	uint8_t offered[sizeof(session->session_id)];
+	memcpy(offered, session->session_id, sizeof(offered));
+	#endif
+
+	unsigned long start = millis();
+	int connected;
+	if(_brokerResolved){connected = wifiClientSecure.connect(_brokerIP, _brokerPort);}
+	else{connected = wifiClientSecure.connect(_currentNet.getMqttHost(), _currentNet.getMqttPort());}
+	uint32_t elapsed = millis() - start;
+
+	if(!connected){
+		_tlsStats.failed++;
+		return false;
+	}
+
+	#ifdef ESP32
+	//the handshake accepted any certificate - check the fingerprint (and the name, unless the host is an IP address)
+	if(_fingerprint != nullptr){
+		IPAddress ip;
+		const char* host = _currentNet.getMqttHost();
+		if(!wifiClientSecure.verify(_fingerprint, ip.fromString(host) ? nullptr : host)){
+			debugPrintln("Certificate Doesn't Match - FAIL");
+			wifiClientSecure.stop();
+			_tlsStats.failed++;
+			return false;
+		}
+	}
+	bool resumed = false;
+	#else
+	bool resumed = offeredLength > 0 && session->session_id_len == offeredLength
+		&& memcmp(session->session_id, offered, offeredLength) == 0;
+	if(!resumed && _tlsPersist){saveTlsSession();}
+	#endif
+
+	_tlsStats.lastHandshakeMs = elapsed;
+	if(resumed){
+		_tlsStats.resumed++;
+		_tlsStats.lastResumedMs = elapsed;
+	}
+	else{
+		_tlsStats.full++;
+		_tlsStats.lastFullMs = elapsed;
+	}
+	debugPrint("TLS handshake (ms): "); debugPrint(elapsed); debugPrintln(resumed ? " (resumed)" : " (full)");
+	return true;
+}
+
+
+#ifdef ESP8266
+//TLS session as it is kept in RTC user memory
+struct tlsRtcRecord {
+	uint32_t magic;
+	uint32_t broker;
+	br_ssl_session_parameters session;
+	uint32_t check;
+};
+
+#define TLS_RTC_MAGIC 0x544c5331		//"TLS1"
+
+
+/*
+simple checksum of an RTC record (everything before the check field)
+
+input:
+	tlsRtcRecord reference
+output:
+	uint32_t checksum
+*/
+static uint32_t tlsRecordCheck(const tlsRtcRecord& record){
+	const uint8_t* data = (const uint8_t*)&record;
+	uint32_t hash = 2166136261UL;
+	for(size_t i = 0; i < offsetof(tlsRtcRecord, check); i++){hash = (hash ^ data[i]) * 16777619UL;}
+	return hash;
+}
+
+
+/*
+id of the broker a session belongs to (host or cached address, plus port), so a session saved
+for one broker is never offered to another
+
+input: NA
+output:
+	uint32_t id
+*/
+uint32_t ESPHelper::tlsBrokerId(){
+	uint32_t hash = 2166136261UL;
+	if(_brokerResolved){hash = (hash ^ (uint32_t)_brokerIP) * 16777619UL;}
+	else{
+		for(const char* c = _currentNet.getMqttHost(); *c != '\0'; c++){hash = (hash ^ (uint8_t)*c) * 16777619UL;}
+	}
+	return (hash ^ _currentNet.getMqttPort()) * 16777619UL;
+}
+
+
+/*
+pick up a session saved in RTC memory before the last restart (once per boot)
+
+input: NA
+output: NA
+*/
+void ESPHelper::loadTlsSession(){
+	_tlsSessionLoaded = true;
+
+	tlsRtcRecord record;
+	if(!ESP.rtcUserMemoryRead(_tlsRtcBlock, (uint32_t*)&record, sizeof(record))){return;}
+	if(record.magic != TLS_RTC_MAGIC || record.broker != tlsBrokerId() || record.check != tlsRecordCheck(record)){return;}
+
+	memcpy(_tlsSession.getSession(), &record.session, sizeof(record.session));
+}
+
+
+/*
+save the session negotiated by the last full handshake to RTC memory
+
+input: NA
+output: NA
+*/
+void ESPHelper::saveTlsSession(){
+	tlsRtcRecord record;
+	memset(&record, 0, sizeof(record));
+	record.magic = TLS_RTC_MAGIC;
+	record.broker = tlsBrokerId();
+	memcpy(&record.session, _tlsSession.getSession(), sizeof(record.session));
+	record.check = tlsRecordCheck(record);
+
+	ESP.rtcUserMemoryWrite(_tlsRtcBlock, (uint32_t*)&record, sizeof(record));
+}
+#endif
+
+
 /*
 enables and sets up broadcast mode rather than station mode. This allows users to create a network from the ESP
 and upload using OTA even if there is no network already present. This disables all MQTT connections
@@ -365,14 +688,13 @@ input:
 output: NA
 */
 void ESPHelper::broadcastMode(const char* ssid, const char* password, const IPAddress ip){
-	//disconnect from any previous wifi networks (max timeout of 2 seconds)
+	NETWORK_GUARD();
+	//leave the broker cleanly and disconnect from any previous wifi networks
+	//(switching the mode below takes the station down, so there is no need to wait for it)
+	closeMqtt();
 	WiFi.softAPdisconnect();
 	WiFi.disconnect();
-	int timeout = 0;
-	while(WiFi.status() != WL_DISCONNECTED && timeout < 200){
-		delay(10);
-		timeout++;
-	}
+
 	//set the mode for access point
 	WiFi.mode(WIFI_AP);
 	//config the AP
@@ -404,14 +726,10 @@ input: NA
 output: NA
 */
 void ESPHelper::disableBroadcast(){
-	//disconnect from any previous wifi networks (max timeout of 2 seconds)
+	NETWORK_GUARD();
+	//shut down the access point (begin() switches back to station mode)
 	WiFi.softAPdisconnect();
 	WiFi.disconnect();
-	int timeout = 0;
-	while(WiFi.status() != WL_DISCONNECTED && timeout < 200){
-		delay(10);
-		timeout++;
-	}
 	_connectionStatus = NO_CONNECTION;
 	begin();
 }
@@ -422,22 +740,132 @@ main loop - should be called as often as possible - handles wifi/mqtt connection
 
 input: NA
 output:
-	true on: network/server connected
-	false on: network or server disconnected
+	int connection status (connStatus) while connected to a network or broadcasting
+	-1 when there is no network info or the network is not connected
 */
 int ESPHelper::loop(){
+	loop(UINT32_MAX);
+
+	if(_shutdownPhase != SHUTDOWN_IDLE){return _connectionStatus;}
+
+	//return -1 for no connection because of bad network info
+	if(!_ssidSet || _connectionStatus < BROADCAST){return -1;}
+	return _connectionStatus;
+}
+
+
+/*
+main loop with a time budget - for sketches that have to get back to their own work on time.
+The work is split into steps that stop once the budget is spent and carry on in the next call:
+reading received packets, dispatching the inbound queue, sending the outbound queue, subscribing
+in batches after a reconnect and the stages of a reconnect attempt (broker lookup, TLS, CONNECT).
+Every step with work waiting does at least one unit of it per call, even once the budget is spent
+(a packet, a queued message each way, a subscription, the key store write, OTA and a due task), so
+the steps that come late in the call can't be starved - a call can overrun the budget by that much.
+A step that has started can't be cut short - a DNS lookup, TCP/TLS connect or an OTA upload
+blocks for as long as it takes. Use getStatus() for the connection status
+
+input:
+	uint32_t time budget in microseconds (UINT32_MAX for no limit, same as loop())
+output:
+	uint8_t LOOP_PENDING_* flags for the work left over (0 when there is nothing left to do)
+*/
+uint8_t ESPHelper::loop(uint32_t budgetUs){
+	#ifdef ESPHELPER_ALLOC_GUARD
+	uint32_t allocsBefore = espHelperAllocCount;
+	#endif
+
+	if(_memTelemetry){sampleMemory();}
+
+	#ifdef ESP32
+	//the network task does the connection and MQTT work - only the app side of it runs here
+	//(the budget is kept locally - the network task shares the steps that read _loopBudgetUs)
+	if(_netTaskRunning){
+		if(_shutdownPhase != SHUTDOWN_IDLE){return LOOP_PENDING_SHUTDOWN;}
+
+		unsigned long start = micros();
+
+		//received messages go to the topic handlers and user callback from this task, as they would without the network task
+		receiveQueued(min(budgetUs, (uint32_t)DEFAULT_MSG_QUEUE_BUDGET_US));
+		uint32_t used = micros() - start;
+		dispatchInbound(min(used < budgetUs ? budgetUs - used : 0, _inboundBudgetUs));
+
+		if(_keyStoreCommitPending){
+			_keyStore->commit();
+			_keyStoreCommitPending = false;
+		}
+
+		if(_memTelemetry && _connectionStatus == FULL_CONNECTION){publishMemory();}
+
+		used = micros() - start;
+		_scheduler.run(used < budgetUs ? budgetUs - used : 0);
+
+		uint8_t pending = 0;
+		if(!_fromNetwork.isEmpty() || !_inboundQueue.isEmpty()){pending |= LOOP_PENDING_INBOUND;}
+		if(!_toNetwork.isEmpty()){pending |= LOOP_PENDING_OUTBOUND;}
+		if(_scheduler.nextDue() == 0){pending |= LOOP_PENDING_TASKS;}
+
+		#ifdef ESPHELPER_ALLOC_GUARD
+		checkAllocGuard(allocsBefore);
+		#endif
+
+		return pending;
+	}
+	#endif
+
+	_loopStart = micros();
+	_loopBudgetUs = budgetUs;
+	uint8_t pending = 0;
+
+	//a requested restart takes over the loop until the device restarts
+	if(_shutdownPhase != SHUTDOWN_IDLE){
+		runShutdown();
+		_loopBudgetUs = UINT32_MAX;
+		return LOOP_PENDING_SHUTDOWN;
+	}
+
 	if(_ssidSet){
 
-		//check for good connections and attempt a reconnect if needed
-		if (((_mqttSet && !client.connected()) || setConnectionStatus() < WIFI_ONLY) && _connectionStatus != BROADCAST) {
+		//check for good connections and attempt a reconnect if needed (or carry on with an attempt a budgeted loop stopped part way)
+		if (_reconnectStage != RECONNECT_IDLE
+			|| (((_mqttSet && !client.connected()) || setConnectionStatus() < WIFI_ONLY) && _connectionStatus != BROADCAST)) {
 			reconnect();
 		}
 
+		//stop the outage timer once a restart from updateNetwork() has reconnected
+		checkOutage();
+
 		//run the wifi loop as long as the connection status is at a minimum of BROADCAST
 		if(_connectionStatus >= BROADCAST){
 
 			//run the MQTT loop if we have a full connection
-			if(_connectionStatus == FULL_CONNECTION){client.loop();}
+			if(_connectionStatus == FULL_CONNECTION){
+				//client.loop() reads one packet - a budgeted loop keeps reading while there is time
+				client.loop();
+				if(budgetUs != UINT32_MAX){
+					while(budgetLeft() && client.connected() && transportAvailable() > 0){client.loop();}
+				}
+
+				//carry on subscribing after a reconnect (each of these steps does at least one unit once the budget is spent)
+				resubscribeStep();
+
+				//send anything published while the broker was unreachable
+				flushOutbound(min(budgetRemaining(), (uint32_t)DEFAULT_MSG_QUEUE_BUDGET_US));
+
+				if(client.connected() && transportAvailable() > 0){pending |= LOOP_PENDING_INBOUND;}
+			}
+
+			//hand any queued messages to the user callback (bounded by the queue time budget)
+			dispatchInbound(min(budgetRemaining(), _inboundBudgetUs));
+
+			//write key store changes received over MQTT (kept out of the receive handler so a burst of sets is one flash write)
+			if(_keyStoreCommitPending){
+				_keyStore->commit();
+				_keyStoreCommitPending = false;
+			}
+
+			//publish memory telemetry if enabled
+			if(_memTelemetry && _connectionStatus == FULL_CONNECTION){publishMemory();}
 
 			//check for whether we want to use OTA and whether the system is running
 			if(_useOTA && _OTArunning) {ArduinoOTA.handle();}
@@ -447,16 +875,103 @@ int ESPHelper::loop(){
 				OTA_begin();
 				ArduinoOTA.handle();
 			}
-
-			return _connectionStatus;
 		}
+		else{yield();}
+	}
+
+	//run the scheduled tasks that are due (they keep running while the network is down, they just can't publish)
+	_scheduler.run(budgetRemaining());
+
+	if(_reconnectStage != RECONNECT_IDLE){pending |= LOOP_PENDING_CONNECT;}
+	if(_resubscribeNext >= 0){pending |= LOOP_PENDING_SUBSCRIBE;}
+	if(!_inboundQueue.isEmpty()){pending |= LOOP_PENDING_INBOUND;}
+	if(!_outboundQueue.isEmpty() && _connectionStatus == FULL_CONNECTION && client.connected()){pending |= LOOP_PENDING_OUTBOUND;}
+	if(_keyStoreCommitPending){pending |= LOOP_PENDING_STORE;}
+	if(_scheduler.nextDue() == 0){pending |= LOOP_PENDING_TASKS;}
+
+	//calls made from outside loop() are never cut short
+	_loopBudgetUs = UINT32_MAX;
+
+	//checked last so OTA and the scheduled tasks count as well
+	#ifdef ESPHELPER_ALLOC_GUARD
+	checkAllocGuard(allocsBefore);
+	#endif
+
+	return pending;
+}
+
+
+/*
+time left in the current loop(budgetUs) call
+
+input: NA
+output:
+	uint32_t microseconds left (UINT32_MAX outside a budgeted loop)
+*/
+uint32_t ESPHelper::budgetRemaining(){
+	if(_loopBudgetUs == UINT32_MAX){return UINT32_MAX;}
+
+	uint32_t used = micros() - _loopStart;
+	return used < _loopBudgetUs ? _loopBudgetUs - used : 0;
+}
+
+
+/*
+is there time left in the current loop(budgetUs) call
+
+input: NA
+output:
+	true on: time left (always outside a budgeted loop)
+	false on: budget spent
+*/
+bool ESPHelper::budgetLeft(){
+	return budgetRemaining() > 0;
+}
+
+
+/*
+bytes received from the broker that the MQTT client hasn't read yet
+
+input: NA
+output:
+	int bytes waiting on the connection
+*/
+int ESPHelper::transportAvailable(){
+	return _useSecureClient ? wifiClientSecure.available() : wifiClient.available();
+}
+
+
+#ifdef ESPHELPER_ALLOC_GUARD
+/*
+DEBUG ONLY - flag loop() calls that allocated heap memory while fully connected
+(the steady state of ESPHelper should never touch the heap)
 
-		yield();
+input:
+	uint32_t allocation count from the start of the loop() call
+output: NA
+*/
+void ESPHelper::checkAllocGuard(uint32_t allocsBefore){
+	uint32_t allocs = espHelperAllocCount - allocsBefore;
+	if(allocs > 0 && _connectionStatus == FULL_CONNECTION){
+		_allocGuardViolations++;
+		_lastLoopAllocs = allocs;
+		debugPrint("ALLOC GUARD: heap allocations during loop(): ");
+		debugPrintln(allocs);
 	}
+}
 
-	//return -1 for no connection because of bad network info
-	return -1;
+
+/*
+DEBUG ONLY - number of loop() calls that allocated heap memory while fully connected
+
+input: NA
+output:
+	uint32_t count of offending loop() calls
+*/
+uint32_t ESPHelper::getAllocGuardViolations(){
+	return _allocGuardViolations;
 }
+#endif
 
 
 /*
@@ -470,6 +985,7 @@ output:
 	false on: subscription failed (either from PubSub lib or network is disconnected)
 */
 bool ESPHelper::subscribe(const char* topic, int qos){
+	NETWORK_GUARD();
 	if(_connectionStatus == FULL_CONNECTION){
 		//set the return value to the output of subscribe
 		bool returnVal = client.subscribe(topic, qos);
@@ -493,6 +1009,7 @@ output:
 	false on: subscription not added to list
 */
 bool ESPHelper::addSubscription(const char* topic){
+	NETWORK_GUARD();
 	//default return value is false
 	bool subscribed = false;
 
@@ -520,14 +1037,43 @@ input: NA
 output: NA
 */
 void ESPHelper::resubscribe(){
+	NETWORK_GUARD();
 	debugPrintln("Resubscribing to all topics");
-	for(int i = 0; i < MAX_SUBSCRIPTIONS; i++){
+	_resubscribeNext = 0;
+	resubscribeStep();
+}
+
+
+/*
+subscribe to the topics in the subscription list from where the last call stopped, until the list
+is done or the loop(budgetUs) budget is spent (at least one topic per call)
+
+input: NA
+output:
+	true on: every topic has been subscribed to (or the connection dropped - reconnecting starts over)
+	false on: topics left for the next call
+*/
+bool ESPHelper::resubscribeStep(){
+	if(_resubscribeNext < 0){return true;}
+
+	while(_resubscribeNext < MAX_SUBSCRIPTIONS && _connectionStatus == FULL_CONNECTION){
+		int i = _resubscribeNext++;
 		if(_subscriptions[i].isUsed){
 			debugPrint("Topic: "); debugPrintln(_subscriptions[i].topic);
 			subscribe(_subscriptions[i].topic, _qos);
 			yield();
+
+			if(!budgetLeft()){break;}
 		}
 	}
+
+	//skip the free slots so the step is done as soon as the last subscription has gone out
+	while(_resubscribeNext < MAX_SUBSCRIPTIONS && !_subscriptions[_resubscribeNext].isUsed){_resubscribeNext++;}
+
+	if(_resubscribeNext < MAX_SUBSCRIPTIONS && _connectionStatus == FULL_CONNECTION){return false;}
+
+	_resubscribeNext = -1;
+	return true;
 }
 
 
@@ -541,8 +1087,10 @@ output:
 	false on: topic was not found in list and therefore cannot be removed
 */
 bool ESPHelper::removeSubscription(const char* topic){
+	NETWORK_GUARD();
 	bool returnVal = false;
 	createSafeString(topicStr, MAX_TOPIC_LENGTH);
+	topicStr = topic;
 
 	//loop through all subscriptions
 	for(int i = 0; i < MAX_SUBSCRIPTIONS; i++){
@@ -577,6 +1125,7 @@ output
 
 */
 bool ESPHelper::unsubscribe(const char* topic){
+	NETWORK_GUARD();
 	return client.unsubscribe(topic);
 }
 
@@ -604,92 +1153,1251 @@ input:
 output: NA
 */
 void ESPHelper::publish(const char* topic, const char* payload, bool retain){
-	client.publish(topic, payload, retain);
-}
+	#ifdef ESP32
+	//the network task sends it (a full ring drops the message, see getNetworkTaskStats)
+	{
+		networkGuard producer(_publishLock);
+		if(useNetworkQueue()){
+			_toNetwork.push(topic, (const uint8_t*)payload, strlen(payload), retain ? MSG_RETAIN : 0);
+			return;
+		}
+	}
+	#endif
 
+	publishNow(topic, (const uint8_t*)payload, strlen(payload), retain);
+}
 
 
-bool ESPHelper::publishJson(const char* topic, JsonDocument& doc, bool retain){
+/*
+send a message now, or keep it in the outbound queue (when enabled) while the broker is unreachable
 
-	const size_t MAX_CHUNK_SIZE = 128; // Define a suitable chunk size
-	
-	//figure out the correct size
+input:
+	char ptr to topic to publish to
+	uint8_t ptr to the payload
+	unsigned int payload length
+	bool whether the MQTT broker should retain the message
+output: NA
+*/
+void ESPHelper::publishNow(const char* topic, const uint8_t* payload, unsigned int length, bool retain){
+	//while the outbound queue has messages new ones go behind them so the order is kept
+	if(_outboundQueue.isEnabled() && (_connectionStatus != FULL_CONNECTION || !_outboundQueue.isEmpty())){
+		_outboundQueue.push(topic, payload, length, retain ? MSG_RETAIN : 0);
+		return;
+	}
+
+	//a write that failed because the connection dropped is kept for the next loop() when the queue is enabled
+	if(!client.publish(topic, payload, length, retain) && _outboundQueue.isEnabled() && !client.connected()){
+		_outboundQueue.push(topic, payload, length, retain ? MSG_RETAIN : 0);
+	}
+}
+
+
+
+/*
+publish a JSON document to a specified topic. The document is serialized straight into the
+MQTT client through a small stack buffer so no heap memory is used no matter how large it is
+
+input:
+	char ptr to topic to publish to
+	JsonDocument reference to the document to be published
+	bool whether the MQTT broker should retain the message
+output:
+	true on: document published
+	false on: could not start the publish or the write failed
+*/
+bool ESPHelper::publishJson(const char* topic, JsonDocument& doc, bool retain){
+
+	//figure out the correct size
 	size_t dataSize = measureJsonPretty(doc);
 
-	if(dataSize < 1023){
-		//create & fill
-		uint8_t* buf = new uint8_t[dataSize+1];
-		if (!buf) {
-			return false; // Handle memory allocation failure
-		}
-		size_t payloadLength = serializeJsonPretty(doc, buf, dataSize+1);
-		if (payloadLength == 0) {
-			delete[] buf;
-			return false; // Handle serialization failure
-		}
-		size_t bytesSent = 0;
+	#ifdef ESP32
+	//serialized straight into the ring to the network task (the ring keeps a spare byte for the null)
+	{
+		networkGuard producer(_publishLock);
+		if(useNetworkQueue()){
+			uint8_t* dest = _toNetwork.reserve(topic, dataSize, retain ? MSG_RETAIN : 0);
+			if(dest == nullptr){return false;}
+			serializeJsonPretty(doc, (char*)dest, dataSize + 1);
+			_toNetwork.commit();
+			return true;
+		}
+	}
+	#endif
+
+	// Start publishing
+	if (!client.beginPublish(topic, dataSize, retain)) {
+		return false;
+	}
+
+	publishWriter writer(client);
+	size_t payloadLength = serializeJsonPretty(doc, writer);
+	bool written = writer.flushBuffer();
+
+	//always end the publish so the client is left in a usable state
+	bool ended = client.endPublish();
+	return written && ended && payloadLength == dataSize;
+}
+
+
+
+/*
+set the callback function for MQTT
+
+input:
+	function ptr that matches the MQTT callback function signature in pubsubclient
+output: NA
+*/
+void ESPHelper::setMQTTCallback(MQTT_CALLBACK_SIGNATURE){
+	_mqttCallback = callback;
+
+	//only set the callback if using mqtt AND the system has already been started. Otherwise just save it for later
+	if(_hasBegun && _mqttSet) {
+		attachMQTTCallback();
+	}
+	_mqttCallbackSet = true;
+}
+
+
+/*
+legacy funtion - here for compatibility. Sets the callback function for MQTT (see function above)
+
+input:
+	function ptr that matches the MQTT callback function signature in pubsubclient
+output: 
+	true (always)
+*/
+bool ESPHelper::setCallback(MQTT_CALLBACK_SIGNATURE){
+	setMQTTCallback(callback);
+	return true;
+}
+
+
+/*
+installs the internal MQTT receive handler on the pubsub client. All messages go through
+mqttReceive() so they can either be handled on the spot or queued for later
+
+input: NA
+output: NA
+*/
+void ESPHelper::attachMQTTCallback(){
+	client.setCallback([this](char* topic, uint8_t* payload, unsigned int length){
+		mqttReceive(topic, payload, length);
+	});
+}
+
+
+/*
+internal MQTT receive handler (runs inside client.loop()). Messages on a topic with a registered
+topic handler go to that handler, everything else goes to the user callback directly or is copied
+into the inbound queue when it is enabled. With the network task running messages are passed to
+loop() first (see deliverMessage)
+
+input:
+	char ptr to the topic
+	uint8_t ptr to the payload
+	unsigned int payload length
+output: NA
+*/
+void ESPHelper::mqttReceive(char* topic, uint8_t* payload, unsigned int length){
+	#ifdef ESP32
+	//with the network task running this is on the network task - loop() delivers the message
+	if(_netTaskRunning){
+		if(!_fromNetwork.push(topic, payload, length)){
+			debugPrintln("Network task receive ring full - message dropped");
+		}
+		return;
+	}
+	#endif
+
+	deliverMessage(topic, payload, length);
+}
+
+
+/*
+hand a received message to its topic handler, the inbound queue or the user callback
+
+input:
+	char ptr to the topic
+	uint8_t ptr to the payload
+	unsigned int payload length
+output: NA
+*/
+void ESPHelper::deliverMessage(char* topic, uint8_t* payload, unsigned int length){
+	//internal handlers consume their messages before they reach the user
+	if(runTopicHandlers(topic, payload, length)){return;}
+
+	if(!_mqttCallbackSet){return;}
+
+	if(_inboundQueue.isEnabled()){
+		//if the queue is full the message is dropped and counted as an overflow
+		if(!_inboundQueue.push(topic, payload, length)){
+			debugPrintln("Inbound queue full - message dropped");
+		}
+		return;
+	}
+
+	_mqttCallback(topic, payload, length);
+}
+
+
+/*
+dispatch queued messages to the user callback until the queue is empty or the time budget is spent
+(at least one message is dispatched per call so the queue always makes progress)
+
+input:
+	uint32_t max time in microseconds to spend dispatching
+output: NA
+*/
+void ESPHelper::dispatchInbound(uint32_t budgetUs){
+	if(!_inboundQueue.isEnabled() || !_mqttCallbackSet){return;}
+
+	unsigned long start = micros();
+	char* topic;
+	uint8_t* payload;
+	unsigned int length;
+	while(_inboundQueue.peek(topic, payload, length)){
+		_mqttCallback(topic, payload, length);
+		_inboundQueue.pop();
+
+		if(micros() - start >= budgetUs){break;}
+	}
+}
+
+
+/*
+enable the inbound message queue. Received messages are copied into a fixed size ring and
+handed to the MQTT callback from loop() instead of from inside the pubsub client loop, so slow
+callbacks no longer hold up keepalives or other pending packets
+
+input:
+	size_t size of the ring in bytes (allocated once, here)
+	uint32_t max time in microseconds that loop() may spend dispatching queued messages
+output:
+	true on: queue enabled
+	false on: could not allocate the queue
+*/
+bool ESPHelper::enableInboundQueue(size_t size, uint32_t budgetUs){
+	_inboundBudgetUs = budgetUs;
+	return _inboundQueue.begin(size);
+}
+
+
+/*
+disable the inbound message queue (any messages still queued are dispatched first)
+
+input: NA
+output: NA
+*/
+void ESPHelper::disableInboundQueue(){
+	if(!_inboundQueue.isEnabled()){return;}
+
+	dispatchInbound(UINT32_MAX);
+	_inboundQueue.end();
+}
+
+
+/*
+get the counters for the inbound queue (depth, high-watermark, overflows, dispatched)
+
+input: NA
+output:
+	queueStats reference for the inbound queue
+*/
+const queueStats& ESPHelper::getInboundQueueStats(){
+	return _inboundQueue.getStats();
+}
+
+
+/*
+send messages waiting in the outbound queue, oldest first
+
+input:
+	uint32_t max time in microseconds to spend publishing
+output:
+	true on: the queue is empty (or disabled)
+	false on: messages are still waiting (out of time or the connection dropped)
+*/
+bool ESPHelper::flushOutbound(uint32_t budgetUs){
+	if(!_outboundQueue.isEnabled()){return true;}
+
+	unsigned long start = micros();
+	char* topic;
+	uint8_t* payload;
+	unsigned int length;
+	uint8_t flags;
+	while(_outboundQueue.peek(topic, payload, length, flags)){
+		if(!client.publish(topic, payload, length, flags & MSG_RETAIN)){
+			//the connection dropped - keep the message for the next connection
+			if(!client.connected()){return false;}
+
+			//anything else (ie too large for the MQTT buffer) would never go out so it is dropped
+		}
+		_outboundQueue.pop();
+
+		if(micros() - start >= budgetUs){break;}
+	}
+	return _outboundQueue.isEmpty();
+}
+
+
+/*
+enable the outbound message queue. Publishes made while the broker is unreachable are copied into
+a fixed size ring and sent in order from loop() once it is back (and before a restart, see requestRestart)
+
+input:
+	size_t size of the ring in bytes (allocated once, here)
+output:
+	true on: queue enabled
+	false on: could not allocate the queue
+*/
+bool ESPHelper::enableOutboundQueue(size_t size){
+	NETWORK_GUARD();
+	return _outboundQueue.begin(size);
+}
+
+
+/*
+disable the outbound message queue (messages still queued are sent first if the broker is connected)
+
+input: NA
+output: NA
+*/
+void ESPHelper::disableOutboundQueue(){
+	NETWORK_GUARD();
+	if(!_outboundQueue.isEnabled()){return;}
+
+	if(client.connected()){flushOutbound(UINT32_MAX);}
+	_outboundQueue.end();
+}
+
+
+/*
+get the counters for the outbound queue (depth, high-watermark, overflows, sent)
+
+input: NA
+output:
+	queueStats reference
+*/
+const queueStats& ESPHelper::getOutboundQueueStats(){
+	return _outboundQueue.getStats();
+}
+
+
+/*
+get the task scheduler run by loop() (tasks don't run while a restart is in progress)
+
+input: NA
+output:
+	ESPHelperScheduler reference
+*/
+ESPHelperScheduler& ESPHelper::getScheduler(){
+	return _scheduler;
+}
+
+
+
+#ifdef ESP32
+/*
+move the connection work (WiFi/MQTT reconnects, TLS handshakes, the MQTT client loop, the outbound
+queue, OTA and the restart sequence) into its own task pinned to the protocol core, so a blocking
+connect no longer stalls loop() on the app core. The existing calls keep working:
+	- publish()/publishJson() copy the message into a lock-free ring the network task sends from
+	  (messages over half the ring size are dropped). The ring takes one producer at a time, so
+	  publishers hold a lock of their own while they write into it - not _netLock, which the
+	  network task holds for a whole step (reconnects included)
+	- received messages come back through a second ring and loop() hands them to the topic
+	  handlers and MQTT callback, so callbacks still run on the loop task
+	- other calls that use the client or change the network settings (subscribe, applyNetwork,
+	  OTA_*, ...) wait for the network task to finish its current step
+WiFi, OTA and shutdown callbacks run on the network task. While it runs publishes may come from
+any task - publishes from the network task itself are sent directly.
+Call after begin()
+
+input:
+	size_t size in bytes of each ring (rounded down to a power of two)
+	uint8_t core to pin the task to
+	uint32_t task stack size in bytes
+	uint8_t task priority
+output:
+	true on: task started
+	false on: not begun yet, already running, or the rings/lock/task could not be created
+*/
+bool ESPHelper::enableNetworkTask(size_t queueSize, uint8_t core, uint32_t stackSize, uint8_t priority){
+	if(!_hasBegun || _netTaskRunning){return false;}
+
+	//the lock outlives the task so calls made while it starts or stops stay paired
+	if(_netLock == nullptr){_netLock = xSemaphoreCreateRecursiveMutex();}
+	if(_publishLock == nullptr){_publishLock = xSemaphoreCreateRecursiveMutex();}
+	if(_netLock == nullptr || _publishLock == nullptr || !_toNetwork.begin(queueSize) || !_fromNetwork.begin(queueSize)){
+		_toNetwork.end();
+		_fromNetwork.end();
+		return false;
+	}
+
+	_netTaskStats = netTaskStats();
+	_netTaskStop = false;
+	_netTaskDone = false;
+	_netTaskRunning = true;
+	if(xTaskCreatePinnedToCore(networkTask, "ESPHelperNet", stackSize, this, priority, &_netTask, core) != pdPASS){
+		_netTaskRunning = false;
+		_netTask = nullptr;
+		_toNetwork.end();
+		_fromNetwork.end();
+		return false;
+	}
+	return true;
+}
+
+
+/*
+stop the network task and go back to doing the connection work in loop(). Waits for the current
+step to finish, then sends anything still waiting to be published and delivers anything received.
+Must be called from the loop task
+
+input: NA
+output: NA
+*/
+void ESPHelper::disableNetworkTask(){
+	if(!_netTaskRunning || xTaskGetCurrentTaskHandle() == _netTask){return;}
+
+	_netTaskStop = true;
+	while(!_netTaskDone){delay(1);}
+
+	//publishes from other tasks stop going into the ring before it is emptied and freed
+	{
+		networkGuard producer(_publishLock);
+		_netTask = nullptr;
+		_netTaskRunning = false;
+	}
+
+	sendQueued();
+	receiveQueued(UINT32_MAX);
+	_toNetwork.end();
+	_fromNetwork.end();
+}
+
+
+/*
+is the connection work running on the network task
+
+input: NA
+output:
+	true on: network task running
+	false on: connection work runs in loop()
+*/
+bool ESPHelper::isNetworkTaskRunning(){
+	return _netTaskRunning;
+}
+
+
+/*
+get the network task counters (step times and the use of both rings)
+
+input: NA
+output:
+	netTaskStats snapshot
+*/
+netTaskStats ESPHelper::getNetworkTaskStats(){
+	netTaskStats stats = _netTaskStats;
+	queueStats tx = _toNetwork.getStats();
+	queueStats rx = _fromNetwork.getStats();
+	stats.txHighWatermark = tx.highWatermark;
+	stats.txOverflows = tx.overflows;
+	stats.rxHighWatermark = rx.highWatermark;
+	stats.rxOverflows = rx.overflows;
+	return stats;
+}
+
+
+/*
+network task body - runs steps until disableNetworkTask() asks it to stop
+
+input:
+	void ptr to the ESPHelper instance
+output: NA
+*/
+void ESPHelper::networkTask(void* arg){
+	ESPHelper* helper = (ESPHelper*)arg;
+
+	//set here too - the task can be running before xTaskCreatePinnedToCore() has stored the handle
+	helper->_netTask = xTaskGetCurrentTaskHandle();
+
+	while(!helper->_netTaskStop){
+		helper->networkStep();
+
+		//one tick between steps lets the idle task (and its watchdog) run on this core
+		vTaskDelay(1);
+	}
+	helper->_netTaskDone = true;
+	vTaskDelete(nullptr);
+}
+
+
+/*
+one pass of the connection work - the part of loop() that runs on the network task
+
+input: NA
+output: NA
+*/
+void ESPHelper::networkStep(){
+	uint32_t start = micros();
+	{
+		NETWORK_GUARD();
+
+		//publishes go out (or into the outbound queue) in order, whatever the connection state
+		sendQueued();
+
+		if(_shutdownPhase != SHUTDOWN_IDLE){runShutdown();}
+		else if(_ssidSet){
+			if (((_mqttSet && !client.connected()) || setConnectionStatus() < WIFI_ONLY) && _connectionStatus != BROADCAST) {
+				reconnect();
+			}
+			checkOutage();
+
+			if(_connectionStatus >= BROADCAST){
+				if(_connectionStatus == FULL_CONNECTION){
+					client.loop();
+					flushOutbound(DEFAULT_MSG_QUEUE_BUDGET_US);
+				}
+
+				if(_useOTA && !_OTArunning){OTA_begin();}
+				if(_useOTA){ArduinoOTA.handle();}
+			}
+		}
+	}
+
+	uint32_t elapsed = micros() - start;
+	_netTaskStats.steps++;
+	_netTaskStats.lastStepUs = elapsed;
+	if(elapsed > _netTaskStats.maxStepUs){_netTaskStats.maxStepUs = elapsed;}
+}
+
+
+/*
+publish everything waiting in the ring to the network task (runs on the network task)
+
+input: NA
+output:
+	true on: ring empty
+	false on: ring not enabled
+*/
+bool ESPHelper::sendQueued(){
+	if(!_toNetwork.isEnabled()){return false;}
+
+	char* topic;
+	uint8_t* payload;
+	unsigned int length;
+	uint8_t flags;
+	while(_toNetwork.peek(topic, payload, length, flags)){
+		publishNow(topic, payload, length, flags & MSG_RETAIN);
+		_toNetwork.pop();
+	}
+	return true;
+}
+
+
+/*
+deliver messages received by the network task (runs in loop()) until the ring is empty or the time
+budget is spent (at least one message is delivered per call)
+
+input:
+	uint32_t max time in microseconds
+output: NA
+*/
+void ESPHelper::receiveQueued(uint32_t budgetUs){
+	unsigned long start = micros();
+	char* topic;
+	uint8_t* payload;
+	unsigned int length;
+	uint8_t flags;
+	while(_fromNetwork.peek(topic, payload, length, flags)){
+		deliverMessage(topic, payload, length);
+		_fromNetwork.pop();
+
+		if(micros() - start >= budgetUs){break;}
+	}
+}
+
+
+/*
+should a publish go through the ring - true while the network task runs, unless the caller is the
+network task itself (ie a WiFi or OTA callback), which sends directly
+
+input: NA
+output:
+	true on: push to the network task ring
+	false on: publish directly
+*/
+bool ESPHelper::useNetworkQueue(){
+	return _netTaskRunning && xTaskGetCurrentTaskHandle() != _netTask;
+}
+#endif
+
+
+/*
+publish anything still queued and leave the broker cleanly (used when MQTT is stopped on purpose)
+
+input: NA
+output: NA
+*/
+void ESPHelper::closeMqtt(){
+	if(!client.connected()){return;}
+
+	flushOutbound(UINT32_MAX);
+	client.disconnect();
+}
+
+
+/*
+restart the device once the connections have been taken down cleanly. loop() flushes the outbound
+queue, publishes the status (retained, on the will topic) so it isn't replaced by the will, sends
+DISCONNECT, waits for the broker to close the connection, disconnects WiFi and then restarts.
+Every step has a deadline so a dead broker or network can't stop the restart. Called automatically
+when an OTA update finishes
+
+input:
+	char ptr to the status to publish (nullptr for none)
+output: NA
+*/
+void ESPHelper::requestRestart(const char* status){
+	NETWORK_GUARD();
+	if(_shutdownPhase != SHUTDOWN_IDLE){return;}
+
+	if(status == nullptr){_shutdownStatus[0] = '\0';}
+	else{
+		strncpy(_shutdownStatus, status, sizeof(_shutdownStatus) - 1);
+		_shutdownStatus[sizeof(_shutdownStatus) - 1] = '\0';
+	}
+
+	_shutdownStats = shutdownStats();
+	_shutdownFlushBase = _outboundQueue.getStats().dispatched;
+	_shutdownStart = millis();
+	_phaseStart = _shutdownStart;
+	_shutdownPhase = SHUTDOWN_FLUSH;
+}
+
+
+/*
+check whether a restart has been requested and the shutdown sequence is running
+
+input: NA
+output:
+	true on: shutting down
+	false on: running normally
+*/
+bool ESPHelper::isShuttingDown(){
+	return _shutdownPhase != SHUTDOWN_IDLE;
+}
+
+
+/*
+get the timing of the shutdown sequence (complete when the shutdown callback runs)
+
+input: NA
+output:
+	shutdownStats reference
+*/
+const shutdownStats& ESPHelper::getShutdownStats(){
+	return _shutdownStats;
+}
+
+
+/*
+set a function to be called with the shutdown timing right before the device restarts
+(ie to log it to serial or flash)
+
+input:
+	function taking a shutdownStats reference
+output: NA
+*/
+void ESPHelper::setShutdownCallback(std::function<void(const shutdownStats&)> callback){
+	_shutdownCallback = callback;
+}
+
+
+/*
+run one step of the shutdown sequence (called by loop() in place of the normal work)
+
+input: NA
+output: NA
+*/
+void ESPHelper::runShutdown(){
+	unsigned long now = millis();
+	Client& transport = _useSecureClient ? (Client&)wifiClientSecure : (Client&)wifiClient;
+
+	switch(_shutdownPhase){
+		case SHUTDOWN_FLUSH: {
+			//keep the client serviced while the queue drains
+			bool connected = client.connected();
+			if(connected){client.loop();}
+			bool drained = !connected || flushOutbound(DEFAULT_MSG_QUEUE_BUDGET_US);
+			if(!drained && now - _phaseStart < SHUTDOWN_FLUSH_TIMEOUT){return;}
+
+			_shutdownStats.flushMs = now - _phaseStart;
+			_shutdownStats.flushed = _outboundQueue.getStats().dispatched - _shutdownFlushBase;
+			_shutdownStats.dropped = _outboundQueue.getStats().depth;
+
+			if(connected && client.connected()){
+				if(_willTopicSet && _shutdownStatus[0] != '\0'){
+					client.publish(_currentNet.getMqttWillTopic(), _shutdownStatus, true);
+				}
+
+				//DISCONNECT is written straight to the connection (PubSubClient::disconnect() closes it right away).
+				//The broker closes the connection once it has read it, which means everything before it arrived
+				static const uint8_t disconnectPacket[2] = {0xE0, 0x00};
+				transport.write(disconnectPacket, sizeof(disconnectPacket));
+			}
+			_shutdownPhase = SHUTDOWN_CLOSE;
+			_phaseStart = now;
+			return;
+		}
+
+		case SHUTDOWN_CLOSE:
+			//drop anything the broker still sends (ie a ping response) so only the close is waited for
+			while(transport.available() > 0){transport.read();}
+			if(transport.connected() && now - _phaseStart < SHUTDOWN_CLOSE_TIMEOUT){return;}
+
+			_shutdownStats.closeMs = now - _phaseStart;
+			_shutdownStats.closeTimedOut = transport.connected();
+			transport.stop();
+
+			WiFi.softAPdisconnect();
+			WiFi.disconnect();
+			_connectionStatus = NO_CONNECTION;
+			_shutdownPhase = SHUTDOWN_WIFI;
+			_phaseStart = now;
+			return;
+
+		case SHUTDOWN_WIFI:
+			if(WiFi.status() != WL_DISCONNECTED && now - _phaseStart < SHUTDOWN_WIFI_TIMEOUT){return;}
+
+			_shutdownStats.wifiMs = now - _phaseStart;
+			_shutdownStats.wifiTimedOut = WiFi.status() != WL_DISCONNECTED;
+			_shutdownPhase = SHUTDOWN_RESTART;
+			return;
+
+		case SHUTDOWN_RESTART:
+			_shutdownStats.totalMs = now - _shutdownStart;
+			debugPrint("Shutdown took (ms): "); debugPrintln(_shutdownStats.totalMs);
+			debugPrint("\t flush: "); debugPrintln(_shutdownStats.flushMs);
+			debugPrint("\t close: "); debugPrintln(_shutdownStats.closeMs);
+			debugPrint("\t wifi: "); debugPrintln(_shutdownStats.wifiMs);
+
+			if(_shutdownCallback){_shutdownCallback(_shutdownStats);}
+			ESP.restart();
+			return;
+
+		default:
+			return;
+	}
+}
+
+
+
+/*
+register an internal handler for a topic (MQTT wildcards + and # are allowed). Messages on matching
+topics are handed to the handler and are NOT passed on to the MQTT callback. The topic is copied and
+added to the subscription list
+
+input:
+	char ptr to the topic filter
+	function ptr that matches the MQTT callback function signature in pubsubclient
+output:
+	true on: handler added (and subscribed to when connected)
+	false on: no free handler slot, topic too long or the subscription list is full
+*/
+bool ESPHelper::addTopicHandler(const char* topic, MQTT_CALLBACK_SIGNATURE){
+	if(topic == nullptr || strlen(topic) >= MAX_TOPIC_LENGTH){return false;}
+
+	for(int i = 0; i < MAX_TOPIC_HANDLERS; i++){
+		if(!_topicHandlers[i].isUsed){
+			strcpy(_topicHandlers[i].topic, topic);
+			_topicHandlers[i].callback = callback;
+			if(!addSubscription(_topicHandlers[i].topic)){return false;}
+			_topicHandlers[i].isUsed = true;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/*
+remove an internal topic handler (and its subscription)
+
+input:
+	char ptr to the topic filter the handler was registered with
+output:
+	true on: handler removed
+	false on: no handler registered for the topic
+*/
+bool ESPHelper::removeTopicHandler(const char* topic){
+	for(int i = 0; i < MAX_TOPIC_HANDLERS; i++){
+		if(_topicHandlers[i].isUsed && strcmp(_topicHandlers[i].topic, topic) == 0){
+			removeSubscription(_topicHandlers[i].topic);
+			_topicHandlers[i].isUsed = false;
+			_topicHandlers[i].callback = nullptr;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/*
+hand a message to the first topic handler whose filter matches the topic
+
+input:
+	char ptr to the topic
+	uint8_t ptr to the payload
+	unsigned int payload length
+output:
+	true on: a handler consumed the message
+	false on: no handler matched
+*/
+bool ESPHelper::runTopicHandlers(char* topic, uint8_t* payload, unsigned int length){
+	for(int i = 0; i < MAX_TOPIC_HANDLERS; i++){
+		if(_topicHandlers[i].isUsed && topicMatches(_topicHandlers[i].topic, topic)){
+			_topicHandlers[i].callback(topic, payload, length);
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/*
+check a topic against an MQTT topic filter ('+' matches one level, '#' matches the rest including the parent level)
+
+input:
+	char ptr to the topic filter
+	char ptr to the topic
+output:
+	true on: the topic matches the filter
+	false on: no match
+*/
+bool ESPHelper::topicMatches(const char* filter, const char* topic){
+	while(*filter != '\0'){
+		if(*filter == '#'){return true;}
+
+		if(*filter == '+'){
+			while(*topic != '\0' && *topic != '/'){topic++;}
+			filter++;
+			continue;
+		}
+
+		if(*filter != *topic){
+			//"a/#" also matches "a"
+			return *topic == '\0' && strcmp(filter, "/#") == 0;
+		}
+		filter++;
+		topic++;
+	}
+	return *topic == '\0';
+}
+
+
+/*
+expose a key/value store over MQTT. Publishing a value to <baseTopic>/set/<key> sets the key
+(existing keys keep their type, new keys are created as strings) and publishing anything to
+<baseTopic>/get/<key> requests it. The current value is answered on <baseTopic>/value/<key>,
+and <baseTopic>/get on its own answers with every key as JSON on <baseTopic>/value.
+Changes are committed to flash from loop()
+
+input:
+	ESPHelperKV reference to an already started store
+	char ptr to the base topic (ie "home/device/keys")
+output:
+	true on: handlers registered
+	false on: base topic too long or no free handler/subscription slots
+*/
+bool ESPHelper::useKeyStore(ESPHelperKV& store, const char* baseTopic){
+	//leave room for the /value/<key> suffix
+	if(strlen(baseTopic) + 7 + KV_MAX_KEY_LENGTH >= MAX_TOPIC_LENGTH){return false;}
+
+	_keyStore = &store;
+	strcpy(_keyStoreTopic, baseTopic);
+
+	char filter[MAX_TOPIC_LENGTH];
+	snprintf(filter, sizeof(filter), "%s/set/#", baseTopic);
+	bool added = addTopicHandler(filter, [this](char* topic, uint8_t* payload, unsigned int length){
+		keyStoreSet(topic, payload, length);
+	});
+
+	snprintf(filter, sizeof(filter), "%s/get/#", baseTopic);
+	added = added && addTopicHandler(filter, [this](char* topic, uint8_t* payload, unsigned int length){
+		keyStoreGet(topic, payload, length);
+	});
+
+	return added;
+}
+
+
+/*
+topic handler for <baseTopic>/set/<key>
+
+input:
+	char ptr to the topic
+	uint8_t ptr to the payload (the new value as text)
+	unsigned int payload length
+output: NA
+*/
+void ESPHelper::keyStoreSet(char* topic, uint8_t* payload, unsigned int length){
+	size_t baseLength = strlen(_keyStoreTopic) + 5;		//"<base>/set/"
+	if(strlen(topic) <= baseLength){return;}
+	const char* key = topic + baseLength;
+
+	char value[256];
+	if(length >= sizeof(value)){
+		debugPrintln("Key store value too long - ignored");
+		return;
+	}
+	memcpy(value, payload, length);
+	value[length] = '\0';
+
+	if(_keyStore->setFromString(key, value)){
+		_keyStoreCommitPending = true;
+	}
+	else{
+		debugPrint("Could not set key: "); debugPrintln(key);
+	}
+
+	//always answer with the value the store actually holds
+	publishKeyValue(key);
+}
+
+
+/*
+topic handler for <baseTopic>/get and <baseTopic>/get/<key>
+
+input:
+	char ptr to the topic
+	uint8_t ptr to the payload (ignored)
+	unsigned int payload length (ignored)
+output: NA
+*/
+void ESPHelper::keyStoreGet(char* topic, uint8_t* payload, unsigned int length){
+	size_t baseLength = strlen(_keyStoreTopic) + 5;		//"<base>/get/"
+	publishKeyValue(strlen(topic) > baseLength ? topic + baseLength : nullptr);
+}
+
+
+/*
+publish a key (or the whole store as JSON) to <baseTopic>/value[/<key>]. The value is streamed
+into the MQTT client so large strings and the full dump don't need a buffer
+
+input:
+	char ptr to the key (nullptr for every key as JSON, keys over KV_MAX_KEY_LENGTH are ignored)
+output: NA
+*/
+void ESPHelper::publishKeyValue(const char* key){
+	//the key usually points into the topic of the message being handled, which lives in the MQTT
+	//client's buffer - beginPublish() writes over that buffer, so work from a copy
+	char keyCopy[KV_MAX_KEY_LENGTH + 1];
+	if(key != nullptr){
+		if(strlen(key) > KV_MAX_KEY_LENGTH){return;}
+		strcpy(keyCopy, key);
+		key = keyCopy;
+	}
+
+	char topic[MAX_TOPIC_LENGTH];
+	if(key == nullptr){snprintf(topic, sizeof(topic), "%s/value", _keyStoreTopic);}
+	else{snprintf(topic, sizeof(topic), "%s/value/%s", _keyStoreTopic, key);}
+
+	//unknown keys are answered with an empty payload
+	lengthCounter counter;
+	if(key == nullptr){_keyStore->printJson(counter);}
+	else{_keyStore->printValue(key, counter);}
+
+	#ifdef ESP32
+	{
+		networkGuard producer(_publishLock);
+		if(useNetworkQueue()){
+			uint8_t* dest = _toNetwork.reserve(topic, counter.length(), 0);
+			if(dest == nullptr){return;}
+			bufferWriter writer(dest, counter.length());
+			if(key == nullptr){_keyStore->printJson(writer);}
+			else{_keyStore->printValue(key, writer);}
+			_toNetwork.commit();
+			return;
+		}
+	}
+	#endif
+
+	if(!client.beginPublish(topic, counter.length(), false)){return;}
+	publishWriter writer(client);
+	if(key == nullptr){_keyStore->printJson(writer);}
+	else{_keyStore->printValue(key, writer);}
+	writer.flushBuffer();
+	client.endPublish();
+}
+
+
+/*
+enable memory telemetry. Free heap is sampled on every loop() call, the largest free block,
+fragmentation and loop task stack high-watermark (which need a heap/stack walk) are sampled every
+DEFAULT_MEM_SAMPLE_INTERVAL ms. Minimums are tracked from the first time telemetry is enabled
+(the free heap minimum on the ESP32 and the stack high-watermark cover the time since boot) and
+optionally published
+
+input:
+	char ptr to the topic to publish the telemetry on (nullptr to only sample)
+	uint32_t interval in ms between publishes
+output: NA
+*/
+void ESPHelper::enableMemoryTelemetry(const char* topic, uint32_t publishInterval){
+	if(topic != nullptr){
+		strncpy(_memTopic, topic, sizeof(_memTopic) - 1);
+		_memTopic[sizeof(_memTopic) - 1] = '\0';
+	}
+	else{_memTopic[0] = '\0';}
+
+	_memPublishMetro.interval(publishInterval);
+	_memPublishMetro.reset();
+	_memTelemetry = true;
 
-		// Start publishing
-		if (!client.beginPublish(topic, dataSize, retain)) {
-			delete[] buf;
-			return false;
-		}
+	//take a sample right away (a full one the first time) so the stats are valid immediately.
+	//The minimums are kept if telemetry is enabled again
+	_memSampleMetro.reset();
+	sampleMemory();
+}
 
-		while (bytesSent < payloadLength) {
-			size_t chunkSize = min(payloadLength - bytesSent, MAX_CHUNK_SIZE);
-			size_t result = client.write((const uint8_t*)(buf + bytesSent), chunkSize);
-			if (result != chunkSize) {
-				delete[] buf;
-				client.endPublish(); // Ensure to end publish on error
-				return false; // Handle error
-			}
-			bytesSent += result;
-		}
 
-		//cleanup
-		delete[] buf;
-		buf = NULL;
+/*
+disable memory telemetry (the last sampled values are kept)
 
-		return client.endPublish();
-	}
-	
-	return false;
+input: NA
+output: NA
+*/
+void ESPHelper::disableMemoryTelemetry(){
+	_memTelemetry = false;
 }
 
 
+/*
+get the time the last MQTT connection took to establish (TCP connect plus the CONNECT/CONNACK
+round trip). PubSubClient doesn't expose its keepalive pings so this is the broker latency measure
+
+input: NA
+output:
+	uint32_t time in ms (0 if MQTT has not connected yet)
+*/
+uint32_t ESPHelper::getBrokerRtt(){
+	return _brokerRtt;
+}
+
 
 /*
-set the callback function for MQTT
+find the broker with mDNS (_mqtt._tcp) instead of (or before falling back to) the mqtt host.
+The address found is cached and only looked up again after resolveAfter connect failures in a
+row, so a broker can be replaced without reflashing devices. Call before begin()
 
 input:
-	function ptr that matches the MQTT callback function signature in pubsubclient
+	uint8_t connect failures in a row before the broker is looked up again
 output: NA
 */
-void ESPHelper::setMQTTCallback(MQTT_CALLBACK_SIGNATURE){
-	_mqttCallback = callback;
+void ESPHelper::enableBrokerDiscovery(uint8_t resolveAfter){
+	NETWORK_GUARD();
+	_brokerDiscovery = true;
+	_brokerResolveAfter = resolveAfter > 0 ? resolveAfter : 1;
+	_brokerResolved = false;
+	_mqttSet = true;
+}
 
-	//only set the callback if using mqtt AND the system has already been started. Otherwise just save it for later
-	if(_hasBegun && _mqttSet) {
-		client.setCallback(_mqttCallback);
+
+/*
+stop using mDNS to find the broker (the mqtt host is used from the next connect on)
+
+input: NA
+output: NA
+*/
+void ESPHelper::disableBrokerDiscovery(){
+	NETWORK_GUARD();
+	_brokerDiscovery = false;
+	_brokerResolved = false;
+	validateConfig();
+}
+
+
+/*
+get the cached broker address (what the last lookup or discovery found)
+
+input: NA
+output:
+	IPAddress of the broker (unset if it hasn't been looked up yet)
+*/
+IPAddress ESPHelper::getBrokerIP(){
+	return _brokerIP;
+}
+
+
+/*
+get the cached broker port
+
+input: NA
+output:
+	uint16_t port (0 if the broker hasn't been looked up yet)
+*/
+uint16_t ESPHelper::getBrokerPort(){
+	return _brokerPort;
+}
+
+
+/*
+look up the broker address and cache it - mDNS discovery first (if enabled), then the mqtt host.
+A host that is already an IP address needs no lookup. With the secure client a host name is
+left to the TLS client, which needs it to check the certificate
+
+input: NA
+output:
+	true on: address cached
+	false on: nothing found (connect by host name)
+*/
+bool ESPHelper::resolveBroker(){
+	if(_brokerDiscovery && discoverBroker()){
+		_brokerResolved = true;
+		return true;
 	}
-	_mqttCallbackSet = true;
+
+	const char* host = _currentNet.getMqttHost();
+	if(host[0] == '\0'){return false;}
+
+	IPAddress ip;
+	if(!ip.fromString(host)){
+		if(_useSecureClient || !WiFi.hostByName(host, ip)){return false;}
+	}
+
+	_brokerIP = ip;
+	_brokerPort = _currentNet.getMqttPort();
+	_brokerResolved = true;
+	return true;
 }
 
 
 /*
-legacy funtion - here for compatibility. Sets the callback function for MQTT (see function above)
+browse _mqtt._tcp and pick a broker: the lowest priority wins and brokers with the same priority
+are picked at random by weight. The Arduino mDNS APIs don't expose the SRV priority/weight, so
+they are read from "priority" and "weight" TXT records (ESP32 only - on the ESP8266 every broker
+counts the same). Blocks for the length of the mDNS query
 
-input:
-	function ptr that matches the MQTT callback function signature in pubsubclient
-output: 
-	true (always)
+input: NA
+output:
+	true on: a broker was found (cached in _brokerIP/_brokerPort)
+	false on: no broker answered
 */
-bool ESPHelper::setCallback(MQTT_CALLBACK_SIGNATURE){
-	setMQTTCallback(callback);
+bool ESPHelper::discoverBroker(){
+	//the responder has to be running to query (ArduinoOTA starts it later on otherwise)
+	if(!_OTArunning){MDNS.begin(_hostname);}
+
+	int count = MDNS.queryService("mqtt", "tcp");
+	int best = -1;
+	long bestPriority = 0;
+	uint32_t weightSum = 0;
+
+	for(int i = 0; i < count; i++){
+		long priority = 0;
+		long weight = 1;
+		#ifdef ESP32
+		if(MDNS.hasTxt(i, "priority")){priority = MDNS.txt(i, "priority").toInt();}
+		if(MDNS.hasTxt(i, "weight")){weight = max(MDNS.txt(i, "weight").toInt(), 0L);}
+		#endif
+
+		if(best < 0 || priority < bestPriority){
+			best = i;
+			bestPriority = priority;
+			weightSum = weight;
+		}
+		//same priority - each broker ends up picked with a chance of its share of the total weight
+		else if(priority == bestPriority){
+			weightSum += weight;
+			if(weightSum > 0 && (uint32_t)random(weightSum) < (uint32_t)weight){best = i;}
+		}
+	}
+
+	if(best < 0){return false;}
+
+	_brokerIP = MDNS.IP(best);
+	_brokerPort = MDNS.port(best);
+	debugPrint("Discovered MQTT broker: "); debugPrint(_brokerIP); debugPrint(":"); debugPrintln(_brokerPort);
 	return true;
 }
 
 
+/*
+get the current memory telemetry values
+
+input: NA
+output:
+	memStats reference with the latest sample and the minimums (see memStats for what they cover)
+*/
+const memStats& ESPHelper::getMemoryStats(){
+	return _memStats;
+}
+
+
+/*
+take a memory sample and update the minimums
+
+input: NA
+output: NA
+*/
+void ESPHelper::sampleMemory(){
+	bool fullSample = _memStats.samples == 0 || _memSampleMetro.check();
+	_memStats.samples++;
+
+	//free heap is cheap to read so it is sampled every time
+	_memStats.freeHeap = ESP.getFreeHeap();
+	#ifdef ESP32
+	//the heap keeps its own low water mark since boot, so dips between samples are caught as well
+	_memStats.minFreeHeap = ESP.getMinFreeHeap();
+	#else
+	if(_memStats.minFreeHeap == 0 || _memStats.freeHeap < _memStats.minFreeHeap){_memStats.minFreeHeap = _memStats.freeHeap;}
+	#endif
+
+	if(!fullSample){return;}
+	_memSampleMetro.reset();
+
+	#ifdef ESP8266
+	uint32_t freeHeap;
+	uint32_t largestBlock;
+	uint8_t fragmentation;
+	ESP.getHeapStats(&freeHeap, &largestBlock, &fragmentation);
+	_memStats.largestBlock = largestBlock;
+	_memStats.fragmentation = fragmentation;
+	_memStats.freeStack = ESP.getFreeContStack();
+	#else
+	_memStats.largestBlock = ESP.getMaxAllocHeap();
+	_memStats.fragmentation = _memStats.freeHeap > 0 ? 100 - (uint8_t)((uint64_t)_memStats.largestBlock * 100 / _memStats.freeHeap) : 0;
+	_memStats.freeStack = uxTaskGetStackHighWaterMark(NULL);
+	#endif
+
+	if(_memStats.minLargestBlock == 0 || _memStats.largestBlock < _memStats.minLargestBlock){_memStats.minLargestBlock = _memStats.largestBlock;}
+	if(_memStats.fragmentation > _memStats.maxFragmentation){_memStats.maxFragmentation = _memStats.fragmentation;}
+	if(_memStats.minFreeStack == 0 || _memStats.freeStack < _memStats.minFreeStack){_memStats.minFreeStack = _memStats.freeStack;}
+}
+
+
+/*
+publish the memory telemetry as a compact JSON object on the telemetry topic (if the interval has passed)
+
+input: NA
+output: NA
+*/
+void ESPHelper::publishMemory(){
+	if(_memTopic[0] == '\0' || !_memPublishMetro.check()){return;}
+	_memPublishMetro.reset();
+
+	char payload[160];
+	snprintf(payload, sizeof(payload),
+		"{\"h\":%u,\"hm\":%u,\"b\":%u,\"bm\":%u,\"f\":%u,\"fm\":%u,\"s\":%u,\"sm\":%u}",
+		(unsigned)_memStats.freeHeap, (unsigned)_memStats.minFreeHeap,
+		(unsigned)_memStats.largestBlock, (unsigned)_memStats.minLargestBlock,
+		(unsigned)_memStats.fragmentation, (unsigned)_memStats.maxFragmentation,
+		(unsigned)_memStats.freeStack, (unsigned)_memStats.minFreeStack);
+	publish(_memTopic, payload, false);
+}
+
+
 /*
 sets a custom function to run when connection to wifi is established
 
@@ -723,7 +2431,13 @@ input: NA
 output: NA
 */
 void ESPHelper::reconnect() {
+	NETWORK_GUARD();
 
+	//an MQTT attempt that loop(budgetUs) stopped part way carries on where it left off
+	if(_reconnectStage != RECONNECT_IDLE){
+		reconnectMqtt();
+		return;
+	}
 
 	if(reconnectMetro.check() && _connectionStatus != BROADCAST && setConnectionStatus() != FULL_CONNECTION){
 		debugPrintln("Attempting WiFi Connection...");
@@ -755,105 +2469,17 @@ void ESPHelper::reconnect() {
 			//attempt to connect to mqtt when we finally get connected to WiFi
 			if(_mqttSet){
 
-				static int timeout = 0;	//allow a max of 5 mqtt connection attempts before timing out
-				if (!client.connected() && timeout < 5) {
+				//allow a max of 5 mqtt connection attempts before timing out (reset when the broker settings change)
+				if (!client.connected() && _mqttConnectAttempts < 5) {
 					debugPrint("Attemping MQTT connection");
 					
 					client.disconnect();
-					client.setServer(_currentNet.getMqttHost(), _currentNet.getMqttPort());
-					
-					
-					if(_useSecureClient){client.setClient(wifiClientSecure);}
-					else{client.setClient(wifiClient);}
-
-
-					int connected = 0;
-
-					//connect to mqtt with user/pass
-					if (_mqttUserSet && _willMessageSet && _willTopicSet) {
-						debugPrintln(" - Using user & last will");
-						debugPrintln(String("\t Client Name: " + String(_clientName.c_str())));
-						debugPrintln(String("\t User Name: " + String(_currentNet.getMqttUser())));
-						debugPrintln(String("\t Password: " + String(_currentNet.getMqttPass())));
-						debugPrintln(String("\t Will Topic: " + String(_currentNet.getMqttWillTopic())));
-						debugPrintln(String("\t Will QOS: " + String(_currentNet.getMqttWillQoS())));
-						debugPrintln(String("\t Will Retain?: " + String(_currentNet.getMqttWillRetain())));
-						debugPrintln(String("\t Will Message: " + String(_currentNet.getMqttWillMessage())));
-						connected = client.connect(
-							(char*) _clientName.c_str(),
-							 _currentNet.getMqttUser(), 
-							 _currentNet.getMqttPass(), 
-							 _currentNet.getMqttWillTopic(), 
-							 _currentNet.getMqttWillQoS(), 
-							 _currentNet.getMqttWillRetain(), 
-							 _currentNet.getMqttWillMessage());
-					}
-
-					//connect to mqtt without credentials
-					else if (!_mqttUserSet && _willMessageSet && _willTopicSet) {
-						debugPrintln(" - Using last will");
-						debugPrintln(String("\t Client Name: " + String(_clientName.c_str())));
-						debugPrintln(String("\t Will Topic: " + String(_currentNet.getMqttWillTopic())));
-						debugPrintln(String("\t Will QOS: " + String(_currentNet.getMqttWillQoS())));
-						debugPrintln(String("\t Will Retain?: " + String(_currentNet.getMqttWillRetain())));
-						debugPrintln(String("\t Will Message: " + String(_currentNet.getMqttWillMessage())));
-						connected = client.connect(
-							(char*) _clientName.c_str(), 
-							_currentNet.getMqttWillTopic(), 
-							_currentNet.getMqttWillQoS(), 
-							_currentNet.getMqttWillRetain(), 
-							_currentNet.getMqttWillMessage()
-						);
-					} else if (_mqttUserSet && !_willMessageSet) {
-						debugPrintln(" - Using user");
-						debugPrintln(String("\t Client Name: " + String(_clientName.c_str())));
-						debugPrintln(String("\t User Name: " + String(_currentNet.getMqttUser())));
-						debugPrintln(String("\t Password: " + String(_currentNet.getMqttPass())));
-						connected = client.connect(
-							(char*) _clientName.c_str(), 
-							_currentNet.getMqttUser(), 
-							_currentNet.getMqttPass()
-						);
-					} else {
-						debugPrintln(" - Using default");
-						debugPrintln(String("\t Client Name: " + String(_clientName.c_str())));
-						connected = client.connect((char*) _clientName.c_str());
-					}
-
-					//if connected, subscribe to the topic(s) we want to be notified about
-					if (connected) {
-						debugPrintln(" -- Connected");
-
-						#if ESP_SDK_VERSION_MAJOR > 2
-						//if using https, verify the fingerprint of the server before setting full connection (return on fail)
-						if(_useSecureClient){
-							if (wifiClientSecure.verify(_fingerprint, _currentNet.mqttHost)) {
-								debugPrintln("Certificate Matches - SUCESS");
-							} else {
-								debugPrintln("Certificate Doesn't Match - FAIL");
-								return;
-							}
-						}
-						#else
-						if(_useSecureClient){debugPrintln("Certificate Not Supported on this SDK Version. Must use SDK 2.x.x");}
-						#endif
-
-						if(_mqttCallbackSet){
-							debugPrintln("Setting MQTT callback");
-							client.setCallback(_mqttCallback);
-						}
-
-						_connectionStatus = FULL_CONNECTION;
-						resubscribe();
-						timeout = 0;
-					}
-					else{
-						debugPrintln(" -- Failed");
-					}
-					timeout++;
 
+					//the blocking parts of the attempt run as stages (see reconnectMqtt)
+					_reconnectStage = RECONNECT_RESOLVE;
+					reconnectMqtt();
 				}
-				else if (timeout >= 5) {
+				else if (_mqttConnectAttempts >= 5) {
 					debugPrintln(" -- Failed to connect to MQTT after 5 attempts. Giving up.");
 					_connectionStatus = WIFI_ONLY;
 				}
@@ -868,6 +2494,146 @@ void ESPHelper::reconnect() {
 }
 
 
+/*
+MQTT part of a reconnect attempt, in stages that each block on the network: look up the broker,
+open the TLS connection (secure client only) and send CONNECT. A plain loop() runs them back to
+back. loop(budgetUs) stops between stages once its budget is spent and picks up at the same stage
+on the next call (a stage that has started always runs to the end)
+
+input: NA
+output: NA
+*/
+void ESPHelper::reconnectMqtt(){
+	if(_reconnectStage == RECONNECT_RESOLVE){
+		//connect to the cached address so there is no DNS lookup per attempt
+		if(!_brokerResolved){resolveBroker();}
+		if(_brokerResolved){client.setServer(_brokerIP, _brokerPort);}
+		else{client.setServer(_currentNet.getMqttHost(), _currentNet.getMqttPort());}
+
+		if(_useSecureClient){client.setClient(wifiClientSecure);}
+		else{client.setClient(wifiClient);}
+
+		_connectMs = 0;
+		_reconnectStage = _useSecureClient ? RECONNECT_TLS : RECONNECT_CONNECT;
+		if(!budgetLeft()){return;}
+	}
+
+	//open the TLS connection first, so the handshake can be timed and the server checked before credentials are sent
+	//(PubSubClient uses a connection that is already open)
+	if(_reconnectStage == RECONNECT_TLS){
+		unsigned long tlsStart = millis();
+		bool opened = connectSecure();
+		_connectMs = millis() - tlsStart;
+
+		if(!opened){
+			debugPrintln(" - TLS connection failed");
+			reconnectFailed();
+			return;
+		}
+
+		_reconnectStage = RECONNECT_CONNECT;
+		if(!budgetLeft()){return;}
+	}
+
+	_reconnectStage = RECONNECT_IDLE;
+	int connected = 0;
+	unsigned long connectStart = millis();
+
+	//connect to mqtt with user/pass
+	if (_mqttUserSet && _willMessageSet && _willTopicSet) {
+		debugPrintln(" - Using user & last will");
+		debugPrint("\t Client Name: "); debugPrintln(_clientName);
+		debugPrint("\t User Name: "); debugPrintln(_currentNet.getMqttUser());
+		debugPrint("\t Password: "); debugPrintln(_currentNet.getMqttPass());
+		debugPrint("\t Will Topic: "); debugPrintln(_currentNet.getMqttWillTopic());
+		debugPrint("\t Will QOS: "); debugPrintln(_currentNet.getMqttWillQoS());
+		debugPrint("\t Will Retain?: "); debugPrintln(_currentNet.getMqttWillRetain());
+		debugPrint("\t Will Message: "); debugPrintln(_currentNet.getMqttWillMessage());
+		connected = client.connect(
+			_clientName,
+			 _currentNet.getMqttUser(), 
+			 _currentNet.getMqttPass(), 
+			 _currentNet.getMqttWillTopic(), 
+			 _currentNet.getMqttWillQoS(), 
+			 _currentNet.getMqttWillRetain(), 
+			 _currentNet.getMqttWillMessage());
+	}
+
+	//connect to mqtt without credentials
+	else if (!_mqttUserSet && _willMessageSet && _willTopicSet) {
+		debugPrintln(" - Using last will");
+		debugPrint("\t Client Name: "); debugPrintln(_clientName);
+		debugPrint("\t Will Topic: "); debugPrintln(_currentNet.getMqttWillTopic());
+		debugPrint("\t Will QOS: "); debugPrintln(_currentNet.getMqttWillQoS());
+		debugPrint("\t Will Retain?: "); debugPrintln(_currentNet.getMqttWillRetain());
+		debugPrint("\t Will Message: "); debugPrintln(_currentNet.getMqttWillMessage());
+		connected = client.connect(
+			_clientName, 
+			_currentNet.getMqttWillTopic(), 
+			_currentNet.getMqttWillQoS(), 
+			_currentNet.getMqttWillRetain(), 
+			_currentNet.getMqttWillMessage()
+		);
+	} else if (_mqttUserSet && !_willMessageSet) {
+		debugPrintln(" - Using user");
+		debugPrint("\t Client Name: "); debugPrintln(_clientName);
+		debugPrint("\t User Name: "); debugPrintln(_currentNet.getMqttUser());
+		debugPrint("\t Password: "); debugPrintln(_currentNet.getMqttPass());
+		connected = client.connect(
+			_clientName, 
+			_currentNet.getMqttUser(), 
+			_currentNet.getMqttPass()
+		);
+	} else {
+		debugPrintln(" - Using default");
+		debugPrint("\t Client Name: "); debugPrintln(_clientName);
+		connected = client.connect(_clientName);
+	}
+
+	if (!connected) {
+		reconnectFailed();
+		return;
+	}
+
+	debugPrintln(" -- Connected");
+	_brokerRtt = _connectMs + (millis() - connectStart);
+
+	debugPrintln("Setting MQTT callback");
+	attachMQTTCallback();
+
+	_connectionStatus = FULL_CONNECTION;
+	_mqttConnectAttempts = 0;
+	_brokerFailures = 0;
+
+	//subscribe to the topic(s) we want to be notified about (in batches when loop() runs with a budget)
+	_resubscribeNext = 0;
+	resubscribeStep();
+}
+
+
+/*
+count a failed MQTT connection attempt. The broker may have moved, so its address is looked up
+again after a few failures in a row (a different broker gets a fresh set of attempts)
+
+input: NA
+output: NA
+*/
+void ESPHelper::reconnectFailed(){
+	debugPrintln(" -- Failed");
+	_reconnectStage = RECONNECT_IDLE;
+	_mqttConnectAttempts++;
+
+	if(++_brokerFailures >= _brokerResolveAfter){
+		_brokerFailures = 0;
+		IPAddress oldIP = _brokerIP;
+		uint16_t oldPort = _brokerPort;
+		_brokerResolved = false;
+
+		if(resolveBroker() && (!(_brokerIP == oldIP) || _brokerPort != oldPort)){_mqttConnectAttempts = 0;}
+	}
+}
+
+
 /*
 internal function used to set _connectionStatus based on the WiFi & MQTT status
 
@@ -915,37 +2681,188 @@ int ESPHelper::setConnectionStatus(){
 
 
 /*
-input:
-	
-output:
+apply the current network values. The values are compared to the ones the network was last
+started with and only the layers that changed are restarted:
+	ssid/password				-> WiFi re-associates (and MQTT reconnects on top of it)
+	mqtt host/port				-> MQTT client restarted on the new broker
+	mqtt user/pass/will			-> MQTT reconnect only
+	ota password				-> OTA reinitialized
+Anything else (or no change at all) leaves the connections alone.
+Use getLastRestartLayers() and getLastOutage() to see what was restarted and for how long.
+
+input: NA
+output: NA
 */
 void ESPHelper::updateNetwork(){
-	debugPrintln("\tDisconnecting from WiFi");
-	WiFi.disconnect();
-	debugPrintln("\tAttempting to begin on new network");
-	
-	//set the wifi mode
-	WiFi.mode(WIFI_STA);
+	NETWORK_GUARD();
+	validateConfig();
 
-	//connect to the network
-	if(_passSet && _ssidSet){WiFi.begin(_currentNet.getSsid(), _currentNet.getPass());}
-	else if(_ssidSet){WiFi.begin(_currentNet.getSsid());}
-	else{WiFi.begin("NO_SSID_SET");}
-	
-	WiFi.setSleep(false);
-	//#ifdef ESP32
-	WiFi.setAutoReconnect(true);
-	//#endif
+	//before begin() nothing has been started yet so there is nothing to compare against
+	uint8_t layers = _hasBegun ? diffNetwork(_appliedNet, _currentNet) : (NET_LAYER_WIFI | NET_LAYER_MQTT);
+	_lastRestartLayers = layers;
+
+	if(layers & NET_LAYER_WIFI){
+		debugPrintln("\tDisconnecting from WiFi");
+		WiFi.disconnect();
+		debugPrintln("\tAttempting to begin on new network");
+		
+		//set the wifi mode
+		WiFi.mode(WIFI_STA);
+
+		//connect to the network
+		if(_passSet && _ssidSet){WiFi.begin(_currentNet.getSsid(), _currentNet.getPass());}
+		else if(_ssidSet){WiFi.begin(_currentNet.getSsid());}
+		else{WiFi.begin("NO_SSID_SET");}
+		
+		WiFi.setSleep(false);
+		//#ifdef ESP32
+		WiFi.setAutoReconnect(true);
+		//#endif
+	}
+
+	if(layers & (NET_LAYER_WIFI | NET_LAYER_MQTT)){
+		debugPrintln("\tSetting new MQTT server");
+		client.disconnect();
+		_brokerResolved = false;
+
+		//setup the mqtt broker info
+		if(_mqttSet){client.setServer(_currentNet.getMqttHost(), _currentNet.getMqttPort());}
+		else{client.setServer("192.0.2.0", 1883);}
+	}
+	else if(layers & NET_LAYER_MQTT_SESSION){
+		//same broker - dropping the session is enough, reconnect() logs back in with the new credentials/will
+		debugPrintln("\tReconnecting to MQTT");
+		client.disconnect();
+	}
+
+	if(layers & (NET_LAYER_WIFI | NET_LAYER_MQTT | NET_LAYER_MQTT_SESSION)){
+		//give the new settings a fresh set of connection attempts (an attempt part way through was for the old ones)
+		_mqttConnectAttempts = 0;
+		_reconnectStage = RECONNECT_IDLE;
+
+		//drop the status to match what was just torn down (loop() would otherwise see a stale full connection)
+		if(_connectionStatus != BROADCAST){
+			if(layers & NET_LAYER_WIFI){_connectionStatus = NO_CONNECTION;}
+			else if(_connectionStatus > WIFI_ONLY){_connectionStatus = WIFI_ONLY;}
+		}
+
+		//time the outage until the connection is back (see checkOutage)
+		_outageStart = millis();
+		_measuringOutage = true;
+	}
 
-	debugPrintln("\tSetting new MQTT server");
-	//setup the mqtt broker info
-	if(_mqttSet){client.setServer(_currentNet.getMqttHost(), _currentNet.getMqttPort());}
-	else{client.setServer("192.0.2.0", 1883);}
+	if(layers & NET_LAYER_OTA){
+		//ArduinoOTA only takes a new password while stopped
+		debugPrintln("\tRestarting OTA");
+		if(_OTArunning){
+			ArduinoOTA.end();
+			_OTArunning = false;
+		}
+		ArduinoOTA.setPassword(_currentNet.getOtaPassword());
+		OTA_begin();
+	}
 
+	_currentNet.cloneTo(_appliedNet, true);
 	debugPrintln("\tDone - Ready for next reconnect attempt");
 }
 
 
+/*
+copy a new set of network values in and apply them (see updateNetwork)
+
+input:
+	NetInfo ptr to the new network values
+output: NA
+*/
+void ESPHelper::applyNetwork(const NetInfo *net){
+	NETWORK_GUARD();
+	if(net == nullptr){return;}
+	_currentNet.setConf(net->getConf());
+	updateNetwork();
+}
+
+
+/*
+get the layers restarted by the last updateNetwork() call
+
+input: NA
+output:
+	uint8_t NET_LAYER_* flags (0 if nothing needed restarting)
+*/
+uint8_t ESPHelper::getLastRestartLayers(){
+	return _lastRestartLayers;
+}
+
+
+/*
+get how long the connection was down after the last updateNetwork() call that restarted WiFi or
+MQTT - measured until the connection was fully back up
+
+input: NA
+output:
+	uint32_t outage in ms (0 if nothing was restarted, the running time while still reconnecting)
+*/
+uint32_t ESPHelper::getLastOutage(){
+	if(_measuringOutage){return millis() - _outageStart;}
+	return _lastOutage;
+}
+
+
+/*
+compare two sets of network values and work out which layers have to be restarted to go from one to the other
+
+input:
+	NetInfo reference to the values currently applied
+	NetInfo reference to the new values
+output:
+	uint8_t NET_LAYER_* flags
+*/
+uint8_t ESPHelper::diffNetwork(const NetInfo& from, const NetInfo& to){
+	uint8_t layers = 0;
+
+	if(strcmp(from.getSsid(), to.getSsid()) != 0
+		|| strcmp(from.getPass(), to.getPass()) != 0){
+		layers |= NET_LAYER_WIFI;
+	}
+
+	if(strcmp(from.getMqttHost(), to.getMqttHost()) != 0
+		|| from.getMqttPort() != to.getMqttPort()){
+		layers |= NET_LAYER_MQTT;
+	}
+
+	if(strcmp(from.getMqttUser(), to.getMqttUser()) != 0
+		|| strcmp(from.getMqttPass(), to.getMqttPass()) != 0
+		|| strcmp(from.getMqttWillTopic(), to.getMqttWillTopic()) != 0
+		|| strcmp(from.getMqttWillMessage(), to.getMqttWillMessage()) != 0
+		|| from.getMqttWillQoS() != to.getMqttWillQoS()
+		|| from.getMqttWillRetain() != to.getMqttWillRetain()){
+		layers |= NET_LAYER_MQTT_SESSION;
+	}
+
+	if(strcmp(from.getOtaPassword(), to.getOtaPassword()) != 0){
+		layers |= NET_LAYER_OTA;
+	}
+
+	return layers;
+}
+
+
+/*
+finish timing a restart outage once the connection is back (MQTT if used, otherwise WiFi)
+
+input: NA
+output: NA
+*/
+void ESPHelper::checkOutage(){
+	if(!_measuringOutage){return;}
+
+	if(_connectionStatus == FULL_CONNECTION || (!_mqttSet && _connectionStatus == WIFI_ONLY)){
+		_lastOutage = millis() - _outageStart;
+		_measuringOutage = false;
+	}
+}
+
+
 /*
 generate unique MQTT name from MAC addr
 
@@ -958,12 +2875,28 @@ output:
 String ESPHelper::macToStr(const uint8_t* mac){
 
   char buf[18];
-  snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X",
-		   mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  macToStr(mac, buf, sizeof(buf));
   return String(buf);
 }
 
 
+/*
+format a MAC addr into a caller provided buffer (allocation free version of the function above)
+
+input:
+	uint8* (array) representing the ESP mac address
+	char ptr to the output buffer (at least 18 bytes for the full address)
+	size_t size of the output buffer
+output:
+	char ptr to the output buffer
+*/
+char* ESPHelper::macToStr(const uint8_t* mac, char* buf, size_t len){
+  snprintf(buf, len, "%02X:%02X:%02X:%02X:%02X:%02X",
+		   mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  return buf;
+}
+
+
 
 /*
 return the current NetInfo state
@@ -999,6 +2932,7 @@ input:
 output: NA
 */
 void ESPHelper::setSSID(const char* ssid){
+	NETWORK_GUARD();
 	_currentNet.setSsid(ssid);
 	_ssidSet = true;
 }
@@ -1026,6 +2960,7 @@ input:
 output: NA
 */
 void ESPHelper::setPASS(const char* pass){
+	NETWORK_GUARD();
 	_currentNet.setPass(pass);
 	_passSet = true;
 }
@@ -1052,6 +2987,7 @@ input:
 output: NA
 */
 void ESPHelper::setMQTTIP(const char* mqttIP){
+	NETWORK_GUARD();
 	_currentNet.setMqttHost(mqttIP);
 	_mqttSet = true;
 }
@@ -1068,6 +3004,7 @@ input:
 output: NA
 */
 void ESPHelper::setMQTTIP(const char* mqttIP, const char* mqttUser, const char* mqttPass){
+	NETWORK_GUARD();
 	_currentNet.setMqttHost(mqttIP);
 	_currentNet.setMqttUser(mqttUser);
 	_currentNet.setMqttPass(mqttPass);
@@ -1085,6 +3022,7 @@ input:
 output: NA
 */	
 void ESPHelper::setWill(const char *willTopic, const char *willMessage){
+	NETWORK_GUARD();
 	_currentNet.setMqttWillTopic(willTopic);
 	_currentNet.setMqttWillMessage(willMessage);
 	_willTopicSet = true;
@@ -1103,6 +3041,7 @@ input:
 output: NA
 */
 void ESPHelper::setWill(const char *willTopic, const char *willMessage, const int willQoS, const bool willRetain){
+	NETWORK_GUARD();
 	_currentNet.setMqttWillTopic(willTopic);
 	_currentNet.setMqttWillMessage(willMessage);
 	_currentNet.setMqttWillQoS(willQoS);
@@ -1133,6 +3072,7 @@ input:
 output: NA
 */
 void ESPHelper::setMQTTQOS(int qos){
+	NETWORK_GUARD();
 	_qos = qos;
 }
 
@@ -1155,6 +3095,22 @@ String ESPHelper::getIP(){
 }
 
 
+/*
+write the local IP address of the ESP into a caller provided buffer (allocation free version of the function above)
+
+input:
+	char ptr to the output buffer (at least 16 bytes)
+	size_t size of the output buffer
+output:
+	char ptr to the output buffer
+*/
+char* ESPHelper::getIP(char* buf, size_t len){
+	IPAddress ip = getIPAddress();
+	snprintf(buf, len, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+	return buf;
+}
+
+
 /*
 return the local IP address of the ESP
 
@@ -1209,6 +3165,7 @@ input: NA
 output: NA
 */
 void ESPHelper::OTA_enable(){
+	NETWORK_GUARD();
 	_useOTA = true;
 	OTA_begin();
 }
@@ -1221,6 +3178,7 @@ input: NA
 output: NA
 */
 void ESPHelper::OTA_begin(){
+	NETWORK_GUARD();
 	if(_connectionStatus >= BROADCAST && _useOTA){
 		ArduinoOTA.begin();
 		_OTArunning = true;
@@ -1235,6 +3193,7 @@ input: NA
 output: NA
 */
 void ESPHelper::OTA_disable(){
+	NETWORK_GUARD();
 	_useOTA = false;
 	_OTArunning = false;
 }
@@ -1248,6 +3207,7 @@ input:
 output: NA
 */
 void ESPHelper::OTA_setPassword(const char* pass){
+	NETWORK_GUARD();
 	ArduinoOTA.setPassword(pass);
 }
 
@@ -1260,6 +3220,7 @@ input:
 output: NA
 */
 void ESPHelper::OTA_setHostname(const char* hostname){
+	NETWORK_GUARD();
 	strcpy(_hostname, hostname);
 	ArduinoOTA.setHostname(_hostname);
 }
@@ -1273,6 +3234,7 @@ input:
 output: NA
 */
 void ESPHelper::OTA_setHostnameWithVersion(const char* hostname){
+	NETWORK_GUARD();
 	strcpy(_hostname, hostname);
 	strcat(_hostname, "----");
 	strcat(_hostname, VERSION);
@@ -1314,6 +3276,7 @@ output:
 	false: failure
 */
 bool ESPHelper::setMQTTBuffer(int size){
+	NETWORK_GUARD();
 	#if PUB_SUB_VERSION >= 28
 		return client.setBufferSize(size);
 	#else
@@ -46,14 +46,67 @@
 #include <WiFiClientSecure.h>
 
 #include "sharedData.h"
+#include "ESPHelperQueue.h"
+#include "ESPHelperRing.h"
+#include "ESPHelperKV.h"
+#include "ESPHelperScheduler.h"
 #include "Metro.h"
 
 
 #define PUB_SUB_VERSION 28
 
+//how often (ms) the memory telemetry walks the heap for the largest block/fragmentation and stack
+#define DEFAULT_MEM_SAMPLE_INTERVAL 1000
+//default interval (ms) for publishing memory telemetry
+#define DEFAULT_MEM_PUBLISH_INTERVAL 60000
+
+
+//network layers restarted by updateNetwork() (see getLastRestartLayers)
+#define NET_LAYER_WIFI 0x01				//ssid/password changed - WiFi re-associates
+#define NET_LAYER_MQTT 0x02				//broker host/port changed - MQTT client restarted on the new server
+#define NET_LAYER_MQTT_SESSION 0x04		//credentials/will changed - MQTT reconnect only
+#define NET_LAYER_OTA 0x08				//OTA password changed - OTA reinitialized
+
+
+//MQTT connect failures in a row before the cached broker address is looked up again
+#define DEFAULT_BROKER_RESOLVE_FAILURES 3
+
+
+//RTC user memory block (4 byte units) the TLS session is kept in across restarts/deep sleep
+//(ESP8266 - the first 32 blocks are used by the OTA bootloader)
+#define DEFAULT_TLS_RTC_BLOCK 64
+
+
+//ESP32 network task (see enableNetworkTask)
+#define DEFAULT_NET_TASK_QUEUE_SIZE 4096	//bytes in each ring between loop() and the network task
+#define DEFAULT_NET_TASK_CORE 0				//PRO_CPU, the core the WiFi and lwIP tasks run on
+#define DEFAULT_NET_TASK_STACK 8192			//bytes (TLS handshakes need most of it)
+#define DEFAULT_NET_TASK_PRIORITY 2
+
+
+//work loop(budgetUs) left for a later call
+#define LOOP_PENDING_CONNECT 0x01		//a reconnect attempt stopped between stages
+#define LOOP_PENDING_INBOUND 0x02		//received data not read yet or queued messages not dispatched
+#define LOOP_PENDING_OUTBOUND 0x04		//queued publishes not sent yet
+#define LOOP_PENDING_SUBSCRIBE 0x08		//subscriptions left to send after a reconnect
+#define LOOP_PENDING_STORE 0x10			//key store changes not written yet
+#define LOOP_PENDING_TASKS 0x20			//scheduled tasks due but not run
+#define LOOP_PENDING_SHUTDOWN 0x40		//restart sequence in progress
+
+
+//deadlines (ms) for each step of the shutdown sequence run before a restart
+#define SHUTDOWN_FLUSH_TIMEOUT 1000		//publishing the outbound queue
+#define SHUTDOWN_CLOSE_TIMEOUT 500		//waiting for the broker to close the connection after DISCONNECT
+#define SHUTDOWN_WIFI_TIMEOUT 500		//waiting for WiFi to report disconnected
+//status published (retained, on the will topic) when the device restarts itself
+#define DEFAULT_SHUTDOWN_STATUS "updating"
+
 
 // #define DEBUG
 
+//enable to count heap allocations made during loop() once connected (see ESPHelper.cpp for the linker flags needed)
+// #define ESPHELPER_ALLOC_GUARD
+
 #ifdef DEBUG
 	#define debugPrint(x) Serial.print(x) //debug on
 	#define debugPrintln(x) Serial.println(x) //debug on
@@ -77,17 +130,23 @@ public:
 	void end();
 
 	void useSecureClient(const char* fingerprint);
+	void enableTlsSessionPersistence(uint32_t rtcBlock = DEFAULT_TLS_RTC_BLOCK);
+	const tlsStats& getTlsStats();
 
 	void broadcastMode(const char* ssid, const char* password, const IPAddress ip);
 	void disableBroadcast();
 
 	int loop();
+	uint8_t loop(uint32_t budgetUs);
 
 	bool subscribe(const char* topic, int qos);
 	bool addSubscription(const char* topic);
 	bool removeSubscription(const char* topic);
 	bool unsubscribe(const char* topic);
 
+	//publish from the loop task - or from any task while the ESP32 network task runs (the
+	//network task does the sending, see enableNetworkTask). Without it the MQTT client is used
+	//directly and isn't safe to share between tasks
 	void publish(const char* topic, const char* payload);
 	void publish(const char* topic, const char* payload, bool retain);
 	boolean publishJson(const char* topic, JsonDocument& doc, bool retain);
@@ -96,12 +155,53 @@ public:
 	bool setCallback(MQTT_CALLBACK_SIGNATURE);
 	void setMQTTCallback(MQTT_CALLBACK_SIGNATURE);
 
+	bool enableInboundQueue(size_t size = DEFAULT_MSG_QUEUE_SIZE, uint32_t budgetUs = DEFAULT_MSG_QUEUE_BUDGET_US);
+	void disableInboundQueue();
+	const queueStats& getInboundQueueStats();
+
+	bool enableOutboundQueue(size_t size = DEFAULT_MSG_QUEUE_SIZE);
+	void disableOutboundQueue();
+	const queueStats& getOutboundQueueStats();
+
+	void requestRestart(const char* status = DEFAULT_SHUTDOWN_STATUS);
+	bool isShuttingDown();
+	const shutdownStats& getShutdownStats();
+	void setShutdownCallback(std::function<void(const shutdownStats&)> callback);
+
+	ESPHelperScheduler& getScheduler();
+
+#ifdef ESP32
+	bool enableNetworkTask(size_t queueSize = DEFAULT_NET_TASK_QUEUE_SIZE, uint8_t core = DEFAULT_NET_TASK_CORE,
+		uint32_t stackSize = DEFAULT_NET_TASK_STACK, uint8_t priority = DEFAULT_NET_TASK_PRIORITY);
+	void disableNetworkTask();
+	bool isNetworkTaskRunning();
+	netTaskStats getNetworkTaskStats();
+#endif
+
+	bool addTopicHandler(const char* topic, MQTT_CALLBACK_SIGNATURE);
+	bool removeTopicHandler(const char* topic);
+
+	bool useKeyStore(ESPHelperKV& store, const char* baseTopic);
+
+	void enableMemoryTelemetry(const char* topic = nullptr, uint32_t publishInterval = DEFAULT_MEM_PUBLISH_INTERVAL);
+	void disableMemoryTelemetry();
+	const memStats& getMemoryStats();
+	uint32_t getBrokerRtt();
+
+	void enableBrokerDiscovery(uint8_t resolveAfter = DEFAULT_BROKER_RESOLVE_FAILURES);
+	void disableBrokerDiscovery();
+	IPAddress getBrokerIP();
+	uint16_t getBrokerPort();
+
 	void setWifiCallback(void (*callback)());
 	void setWifiLostCallback(void (*callback)());
 
 	void reconnect();
 
-	void updateNetwork();	//manually disconnect and reconnecting to network/mqtt using current values (generally called after setting new network values)
+	void updateNetwork();	//apply the current network values, restarting only the layers that changed (generally called after setting new network values)
+	void applyNetwork(const NetInfo *net);
+	uint8_t getLastRestartLayers();
+	uint32_t getLastOutage();
 
 	const char* getSSID();
 	void setSSID(const char *ssid);
@@ -120,6 +220,7 @@ public:
 	void setWill(const char *willTopic, const char *willMessage, const int willQoS, const bool willRetain);
 
 	String getIP();
+	char* getIP(char* buf, size_t len);
 	IPAddress getIPAddress();
 
 	int getStatus();
@@ -140,9 +241,14 @@ public:
 	bool setMQTTBuffer(int size);
 
 	String macToStr(const uint8_t* mac);
+	char* macToStr(const uint8_t* mac, char* buf, size_t len);
 
 	void resubscribe();
 
+#ifdef ESPHELPER_ALLOC_GUARD
+	uint32_t getAllocGuardViolations();
+#endif
+
 private:
 
 	void init();
@@ -152,19 +258,88 @@ private:
 
 	int setConnectionStatus();
 
+	static uint8_t diffNetwork(const NetInfo& from, const NetInfo& to);
+	void checkOutage();
+
+	void attachMQTTCallback();
+	void mqttReceive(char* topic, uint8_t* payload, unsigned int length);
+	void deliverMessage(char* topic, uint8_t* payload, unsigned int length);
+	void publishNow(const char* topic, const uint8_t* payload, unsigned int length, bool retain);
+	void dispatchInbound(uint32_t budgetUs);
+	bool flushOutbound(uint32_t budgetUs);
+	void closeMqtt();
+	void runShutdown();
+	bool runTopicHandlers(char* topic, uint8_t* payload, unsigned int length);
+	static bool topicMatches(const char* filter, const char* topic);
+
+	void keyStoreSet(char* topic, uint8_t* payload, unsigned int length);
+	void keyStoreGet(char* topic, uint8_t* payload, unsigned int length);
+	void publishKeyValue(const char* key);
+
+#ifdef ESPHELPER_ALLOC_GUARD
+	void checkAllocGuard(uint32_t allocsBefore);
+	uint32_t _allocGuardViolations = 0;
+	uint32_t _lastLoopAllocs = 0;
+#endif
+
 	NetInfo _currentNet;
 
+	//copy of the values the network was last started with (what updateNetwork() diffs against)
+	NetInfo _appliedNet;
+	uint8_t _lastRestartLayers = 0;
+	uint32_t _lastOutage = 0;
+	unsigned long _outageStart = 0;
+	bool _measuringOutage = false;
+
 	PubSubClient client;
 
 	Metro reconnectMetro = Metro(500);
+	int _mqttConnectAttempts = 0;
+	uint32_t _brokerRtt = 0;
+
+	//resumable work for loop(budgetUs) - reconnect stages and subscription batches
+	void reconnectMqtt();
+	void reconnectFailed();
+	bool resubscribeStep();
+	uint32_t budgetRemaining();
+	bool budgetLeft();
+	int transportAvailable();
+	reconnectStage _reconnectStage = RECONNECT_IDLE;
+	uint32_t _connectMs = 0;			//time spent in the TLS stage of the current attempt
+	int _resubscribeNext = -1;			//next subscription to send (-1 when done)
+	unsigned long _loopStart = 0;
+	uint32_t _loopBudgetUs = UINT32_MAX;
+
+	//broker address cache - looked up once (mDNS discovery or the mqtt host) instead of on every connect
+	bool resolveBroker();
+	bool discoverBroker();
+	IPAddress _brokerIP;
+	uint16_t _brokerPort = 0;
+	bool _brokerResolved = false;
+	bool _brokerDiscovery = false;
+	uint8_t _brokerResolveAfter = DEFAULT_BROKER_RESOLVE_FAILURES;
+	uint8_t _brokerFailures = 0;
 
 	WiFiClient wifiClient;
 	WiFiClientSecure wifiClientSecure;
-	const char* _fingerprint;
+	const char* _fingerprint = nullptr;
 	bool _useSecureClient = false;
 
+	//TLS handshake timing and session reuse (sessions are resumed on the ESP8266 only)
+	bool connectSecure();
+	tlsStats _tlsStats;
+	bool _tlsPersist = false;
+	uint32_t _tlsRtcBlock = DEFAULT_TLS_RTC_BLOCK;
+#ifdef ESP8266
+	void loadTlsSession();
+	void saveTlsSession();
+	uint32_t tlsBrokerId();
+	BearSSL::Session _tlsSession;
+	bool _tlsSessionLoaded = false;
+#endif
+
 
-	String _clientName;
+	char _clientName[32];
 
 	void (*_wifiCallback)();
 	bool _wifiCallbackSet = false;
@@ -182,6 +357,66 @@ private:
 
 	bool _mqttCallbackSet = false;
 
+	//optional inbound queue - messages are copied here and dispatched from loop()
+	MessageRing _inboundQueue;
+	uint32_t _inboundBudgetUs = DEFAULT_MSG_QUEUE_BUDGET_US;
+
+	//optional outbound queue - publishes made while the broker is unreachable wait here
+	MessageRing _outboundQueue;
+
+	//shutdown sequence driven by loop() (see requestRestart)
+	shutdownPhase _shutdownPhase = SHUTDOWN_IDLE;
+	shutdownStats _shutdownStats;
+	unsigned long _shutdownStart = 0;
+	unsigned long _phaseStart = 0;
+	uint32_t _shutdownFlushBase = 0;
+	char _shutdownStatus[32] = DEFAULT_SHUTDOWN_STATUS;
+	std::function<void(const shutdownStats&)> _shutdownCallback;
+
+	//app tasks run from loop() once the network work is done
+	ESPHelperScheduler _scheduler;
+
+#ifdef ESP32
+	//network task - runs the connection and MQTT I/O on its own core, publishes and received
+	//messages cross over through the rings, anything else that touches the client takes _netLock
+	static void networkTask(void* arg);
+	void networkStep();
+	bool sendQueued();
+	void receiveQueued(uint32_t budgetUs);
+	bool useNetworkQueue();
+	TaskHandle_t _netTask = nullptr;
+	SemaphoreHandle_t _netLock = nullptr;
+	SemaphoreHandle_t _publishLock = nullptr;		//one producer at a time on _toNetwork
+	volatile bool _netTaskRunning = false;
+	volatile bool _netTaskStop = false;
+	volatile bool _netTaskDone = false;
+	LockFreeRing _toNetwork;
+	LockFreeRing _fromNetwork;
+	netTaskStats _netTaskStats;
+#endif
+
+	//internal handlers that consume messages on matching topics before the user callback sees them
+	struct topicHandler {
+		bool isUsed = false;
+		char topic[MAX_TOPIC_LENGTH];
+		std::function<void(char*, uint8_t*, unsigned int)> callback;
+	};
+	topicHandler _topicHandlers[MAX_TOPIC_HANDLERS];
+
+	//key/value store exposed over MQTT (see useKeyStore)
+	ESPHelperKV* _keyStore = nullptr;
+	char _keyStoreTopic[MAX_TOPIC_LENGTH];
+	bool _keyStoreCommitPending = false;
+
+	//memory telemetry
+	void sampleMemory();
+	void publishMemory();
+	bool _memTelemetry = false;
+	memStats _memStats;
+	Metro _memSampleMetro = Metro(DEFAULT_MEM_SAMPLE_INTERVAL);
+	Metro _memPublishMetro = Metro(DEFAULT_MEM_PUBLISH_INTERVAL);
+	char _memTopic[MAX_TOPIC_LENGTH];
+
 	int _connectionStatus = NO_CONNECTION;
 
 	//AP mode variables
@@ -0,0 +1,276 @@
+/*
+    ESPHelperConfigFields.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "ESPHelperConfigFields.h"
+
+
+//in configFieldId order. String limits match the maxlength of the fields on the config page
+static const configField fieldTable[FIELD_COUNT] = {
+	{"hostname",		FIELD_TYPE_STRING,	FIELD_REQUIRED,						1, 32,		0},
+	{"ssid",			FIELD_TYPE_STRING,	FIELD_REQUIRED,						1, 32,		0},
+	{"netPass",			FIELD_TYPE_STRING,	FIELD_SECRET | FIELD_KEEP_IF_BLANK,	0, 63,		0},
+	{"otaPassword",		FIELD_TYPE_STRING,	FIELD_SECRET | FIELD_KEEP_IF_BLANK,	0, 32,		0},
+	{"mqttHost",		FIELD_TYPE_STRING,	0,									0, 64,		0},
+	{"mqttUser",		FIELD_TYPE_STRING,	0,									0, 32,		0},
+	{"mqttPort",		FIELD_TYPE_INT,		0,									1, 65535,	1883},
+	{"mqttPass",		FIELD_TYPE_STRING,	FIELD_SECRET | FIELD_KEEP_IF_BLANK,	0, 64,		0},
+	{"mqttWillTopic",	FIELD_TYPE_STRING,	0,									0, 128,		0},
+	{"mqttWillMessage",	FIELD_TYPE_STRING,	0,									0, 128,		0},
+	{"mqttWillQos",		FIELD_TYPE_INT,		0,									0, 2,		0},
+	{"mqttWillRetain",	FIELD_TYPE_BOOL,	0,									0, 1,		0},
+};
+
+
+const configField* ESPHelperConfigFields::get(configFieldId id){
+	if(id >= FIELD_COUNT){return nullptr;}
+	return &fieldTable[id];
+}
+
+
+/*
+look up a field by name
+
+input:
+	char ptr to the name
+	size_t length of the name (for names that are not null terminated, ie inside a request body)
+output:
+	int configFieldId of the field (-1 if there is no field with that name)
+*/
+int ESPHelperConfigFields::find(const char* name){
+	return find(name, strlen(name));
+}
+
+int ESPHelperConfigFields::find(const char* name, size_t length){
+	for(int i = 0; i < FIELD_COUNT; i++){
+		if(strncmp(fieldTable[i].name, name, length) == 0 && fieldTable[i].name[length] == '\0'){return i;}
+	}
+	return -1;
+}
+
+
+/*
+check a value against the limits of a field. String values given to int/bool fields are parsed
+
+input:
+	configFieldId of the field
+	char ptr to the value
+output:
+	true on: value is acceptable
+	false on: value is out of range, too long or not a number
+*/
+bool ESPHelperConfigFields::validate(configFieldId id, const char* value){
+	const configField* field = get(id);
+	if(field == nullptr || value == nullptr){return false;}
+
+	if(field->type == FIELD_TYPE_STRING){
+		size_t length = strlen(value);
+		return (int32_t)length >= field->min && (int32_t)length <= field->max;
+	}
+
+	if(field->type == FIELD_TYPE_BOOL && (strcasecmp(value, "true") == 0 || strcasecmp(value, "false") == 0)){return true;}
+
+	char* end = nullptr;
+	long parsed = strtol(value, &end, 10);
+	if(end == value || *end != '\0'){return false;}
+	return validate(id, (int32_t)parsed);
+}
+
+bool ESPHelperConfigFields::validate(configFieldId id, int32_t value){
+	const configField* field = get(id);
+	if(field == nullptr || field->type == FIELD_TYPE_STRING){return false;}
+	return value >= field->min && value <= field->max;
+}
+
+bool ESPHelperConfigFields::validate(configFieldId id, JsonVariantConst value){
+	const configField* field = get(id);
+	if(field == nullptr){return false;}
+
+	//JSON values have to have the right type - strings are not parsed as numbers here
+	if(field->type == FIELD_TYPE_STRING){return value.is<const char*>() && validate(id, value.as<const char*>());}
+	if(field->type == FIELD_TYPE_BOOL && value.is<bool>()){return true;}
+	return value.is<int32_t>() && validate(id, value.as<int32_t>());
+}
+
+
+/*
+set a field of a NetInfo from its text form (no validation - see validate())
+
+input:
+	NetInfo reference to change
+	configFieldId of the field
+	char ptr to the value
+output:
+	true on: value stored in full
+	false on: unknown field, unparsable number or the string did not fit the NetInfo
+*/
+bool ESPHelperConfigFields::set(NetInfo& config, configFieldId id, const char* value){
+	const configField* field = get(id);
+	if(field == nullptr || value == nullptr){return false;}
+
+	if(field->type != FIELD_TYPE_STRING){
+		if(field->type == FIELD_TYPE_BOOL && strcasecmp(value, "true") == 0){return set(config, id, (int32_t)1);}
+		if(field->type == FIELD_TYPE_BOOL && strcasecmp(value, "false") == 0){return set(config, id, (int32_t)0);}
+
+		char* end = nullptr;
+		long parsed = strtol(value, &end, 10);
+		if(end == value || *end != '\0'){return false;}
+		return set(config, id, (int32_t)parsed);
+	}
+
+	//checked set - a value that doesn't fit the arena is refused rather than cut short
+	switch(id){
+		case FIELD_HOSTNAME: return config.setString(CONF_HOSTNAME, value);
+		case FIELD_SSID: return config.setString(CONF_SSID, value);
+		case FIELD_NET_PASS: return config.setString(CONF_PASS, value);
+		case FIELD_OTA_PASSWORD: return config.setString(CONF_OTA_PASSWORD, value);
+		case FIELD_MQTT_HOST: return config.setString(CONF_MQTT_HOST, value);
+		case FIELD_MQTT_USER: return config.setString(CONF_MQTT_USER, value);
+		case FIELD_MQTT_PASS: return config.setString(CONF_MQTT_PASS, value);
+		case FIELD_WILL_TOPIC: return config.setString(CONF_WILL_TOPIC, value);
+		case FIELD_WILL_MESSAGE: return config.setString(CONF_WILL_MESSAGE, value);
+		default: return false;
+	}
+}
+
+bool ESPHelperConfigFields::set(NetInfo& config, configFieldId id, int32_t value){
+	switch(id){
+		case FIELD_MQTT_PORT: config.setMqttPort(value); return true;
+		case FIELD_WILL_QOS: config.setMqttWillQoS(value); return true;
+		case FIELD_WILL_RETAIN: config.setMqttWillRetain(value != 0); return true;
+		default: return false;
+	}
+}
+
+bool ESPHelperConfigFields::set(NetInfo& config, configFieldId id, JsonVariantConst value){
+	if(value.is<const char*>()){return set(config, id, value.as<const char*>());}
+	if(value.is<bool>()){return set(config, id, (int32_t)(value.as<bool>() ? 1 : 0));}
+	if(value.is<int32_t>()){return set(config, id, value.as<int32_t>());}
+	return false;
+}
+
+
+/*
+check the rules that involve more than one field of a complete config
+
+input:
+	NetInfo reference to check
+output:
+	int configFieldId of the field that breaks a rule (-1 if the config is fine):
+		a FIELD_REQUIRED field that is empty
+		FIELD_MQTT_HOST when an MQTT user or password is set without a host
+*/
+int ESPHelperConfigFields::checkRules(const NetInfo& config){
+	for(int i = 0; i < FIELD_COUNT; i++){
+		if((fieldTable[i].flags & FIELD_REQUIRED) && fieldTable[i].type == FIELD_TYPE_STRING && getString(config, (configFieldId)i)[0] == '\0'){return i;}
+	}
+
+	if(config.getMqttHost()[0] == '\0' && (config.getMqttUser()[0] != '\0' || config.getMqttPass()[0] != '\0')){return FIELD_MQTT_HOST;}
+	return -1;
+}
+
+
+/*
+compare two configs setting by setting (the raw ESPHelperConf also holds padding and whatever is
+left in the unused part of the string arena)
+
+input:
+	NetInfo reference of the first config
+	NetInfo reference of the second config
+output:
+	true on: every field has the same value
+	false on: at least one field differs
+*/
+bool ESPHelperConfigFields::equal(const NetInfo& a, const NetInfo& b){
+	for(int i = 0; i < FIELD_COUNT; i++){
+		configFieldId id = (configFieldId)i;
+		if(fieldTable[i].type == FIELD_TYPE_STRING){
+			if(strcmp(getString(a, id), getString(b, id)) != 0){return false;}
+		}
+		else if(getInt(a, id) != getInt(b, id)){return false;}
+	}
+	return true;
+}
+
+
+/*
+read a string field of a NetInfo
+
+input:
+	NetInfo reference to read
+	configFieldId of the field
+output:
+	char ptr to the value ("" for int/bool fields)
+*/
+const char* ESPHelperConfigFields::getString(const NetInfo& config, configFieldId id){
+	switch(id){
+		case FIELD_HOSTNAME: return config.getHostname();
+		case FIELD_SSID: return config.getSsid();
+		case FIELD_NET_PASS: return config.getPass();
+		case FIELD_OTA_PASSWORD: return config.getOtaPassword();
+		case FIELD_MQTT_HOST: return config.getMqttHost();
+		case FIELD_MQTT_USER: return config.getMqttUser();
+		case FIELD_MQTT_PASS: return config.getMqttPass();
+		case FIELD_WILL_TOPIC: return config.getMqttWillTopic();
+		case FIELD_WILL_MESSAGE: return config.getMqttWillMessage();
+		default: return "";
+	}
+}
+
+
+/*
+read an int/bool field of a NetInfo
+
+input:
+	NetInfo reference to read
+	configFieldId of the field
+output:
+	int32_t value (0 for string fields)
+*/
+int32_t ESPHelperConfigFields::getInt(const NetInfo& config, configFieldId id){
+	switch(id){
+		case FIELD_MQTT_PORT: return config.getMqttPort();
+		case FIELD_WILL_QOS: return config.getMqttWillQoS();
+		case FIELD_WILL_RETAIN: return config.getMqttWillRetain() ? 1 : 0;
+		default: return 0;
+	}
+}
+
+
+/*
+write every field of a NetInfo except the secrets into a JSON object (using the field names)
+
+input:
+	NetInfo reference to read
+	JsonObject to add the fields to
+output: NA
+*/
+void ESPHelperConfigFields::toJson(const NetInfo& config, JsonObject object){
+	for(int i = 0; i < FIELD_COUNT; i++){
+		configFieldId id = (configFieldId)i;
+		const configField* field = get(id);
+		if(field->flags & FIELD_SECRET){continue;}
+
+		if(field->type == FIELD_TYPE_STRING){object[field->name] = getString(config, id);}
+		else if(field->type == FIELD_TYPE_BOOL){object[field->name] = getInt(config, id) != 0;}
+		else{object[field->name] = getInt(config, id);}
+	}
+}
@@ -0,0 +1,95 @@
+/*
+    ESPHelperConfigFields.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef ESPHELPER_CONFIG_FIELDS_H
+#define ESPHELPER_CONFIG_FIELDS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "sharedData.h"
+
+
+//every NetInfo setting that can be changed from outside (web page, remote config, ...)
+enum configFieldId {
+	FIELD_HOSTNAME,
+	FIELD_SSID,
+	FIELD_NET_PASS,
+	FIELD_OTA_PASSWORD,
+	FIELD_MQTT_HOST,
+	FIELD_MQTT_USER,
+	FIELD_MQTT_PORT,
+	FIELD_MQTT_PASS,
+	FIELD_WILL_TOPIC,
+	FIELD_WILL_MESSAGE,
+	FIELD_WILL_QOS,
+	FIELD_WILL_RETAIN,
+	FIELD_COUNT
+};
+
+enum configFieldType {FIELD_TYPE_STRING, FIELD_TYPE_INT, FIELD_TYPE_BOOL};
+
+//configField flags
+#define FIELD_SECRET 0x01		//never sent back out (passwords)
+#define FIELD_REQUIRED 0x02		//must not be empty
+#define FIELD_KEEP_IF_BLANK 0x04	//a blank form value keeps the stored one (when the form is pre-filled)
+
+struct configField {
+	const char* name;			//name used by the web form and remote config documents
+	configFieldType type;
+	uint8_t flags;
+	int32_t min;				//min value (ints) or min length (strings)
+	int32_t max;				//max value (ints) or max length (strings)
+	int32_t blankValue;			//value an int/bool field gets when the form leaves it blank
+};
+
+
+/*
+Single description of the NetInfo settings (names, types and limits) shared by everything that
+reads or writes them by name, so the web page and remote config accept exactly the same values.
+*/
+class ESPHelperConfigFields {
+
+public:
+	static const configField* get(configFieldId id);
+	static int find(const char* name);
+	static int find(const char* name, size_t length);
+
+	static bool validate(configFieldId id, const char* value);
+	static bool validate(configFieldId id, int32_t value);
+	static bool validate(configFieldId id, JsonVariantConst value);
+
+	static bool set(NetInfo& config, configFieldId id, const char* value);
+	static bool set(NetInfo& config, configFieldId id, int32_t value);
+	static bool set(NetInfo& config, configFieldId id, JsonVariantConst value);
+
+	static const char* getString(const NetInfo& config, configFieldId id);
+	static int32_t getInt(const NetInfo& config, configFieldId id);
+
+	static int checkRules(const NetInfo& config);
+	static bool equal(const NetInfo& a, const NetInfo& b);
+
+	static void toJson(const NetInfo& config, JsonObject object);
+};
+
+#endif
@@ -0,0 +1,335 @@
+/*
+    ESPHelperConfigStore.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "ESPHelperConfigStore.h"
+#include <stddef.h>
+#include <new>
+
+
+//large enough to load a record written by this build with a single read
+#define CONFIG_RECORD_BUFFER (sizeof(configRecordHeader) + sizeof(ESPHelperConf))
+
+
+/*
+mount the filesystem used by the config store
+
+input: NA
+output:
+	true on: filesystem mounted
+	false on: mount failed
+*/
+bool ESPHelperConfigStore::begin(){
+	return LittleFS.begin();
+}
+
+
+/*
+load a config record into a NetInfo. If the main file is missing or corrupt the temporary file
+left by an interrupted save is tried as well
+
+input:
+	NetInfo reference to load the config into
+	char ptr to the path of the config record
+	uint32_t ptr filled with the stored config revision (can be nullptr)
+output:
+	true on: config loaded
+	false on: no valid config record found (the NetInfo is left untouched)
+*/
+bool ESPHelperConfigStore::load(NetInfo& config, const char* path, uint32_t* revision){
+	if(loadFile(config, path, revision)){return true;}
+
+	char tmpPath[64];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+	return loadFile(config, tmpPath, revision);
+}
+
+
+/*
+save a NetInfo as a binary config record (atomically replaces the old record)
+
+input:
+	NetInfo reference to save
+	char ptr to the path of the config record
+	uint32_t config revision to store alongside the config
+output:
+	true on: config saved
+	false on: write failed (the previous record is still intact)
+*/
+bool ESPHelperConfigStore::save(const NetInfo& config, const char* path, uint32_t revision){
+	const ESPHelperConf& conf = config.getConf();
+
+	configRecordHeader header;
+	header.magic = CONFIG_RECORD_MAGIC;
+	header.version = CONFIG_RECORD_VERSION;
+	header.length = sizeof(ESPHelperConf);
+	header.revision = revision;
+	header.crc = crc32(&conf, sizeof(ESPHelperConf));
+
+	return writeAtomic(path, &header, sizeof(header), &conf, sizeof(ESPHelperConf));
+}
+
+
+/*
+remove a config record (and any leftover temporary file)
+
+input:
+	char ptr to the path of the config record
+output:
+	true on: no record is left on flash
+	false on: the record could not be removed
+*/
+bool ESPHelperConfigStore::erase(const char* path){
+	char tmpPath[64];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+	if(LittleFS.exists(tmpPath)){LittleFS.remove(tmpPath);}
+
+	if(!LittleFS.exists(path)){return true;}
+	return LittleFS.remove(path);
+}
+
+
+/*
+write a file by writing a temporary copy and renaming it over the original. A power cut at any
+point leaves either the complete old file or the complete new one
+
+input:
+	char ptr to the destination path
+	void ptr to the first part of the data (ie a header)
+	size_t length of the first part
+	void ptr to the second part of the data (can be nullptr)
+	size_t length of the second part
+output:
+	true on: file replaced
+	false on: write or rename failed
+*/
+bool ESPHelperConfigStore::writeAtomic(const char* path, const void* head, size_t headLength, const void* body, size_t bodyLength){
+	char tmpPath[64];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+
+	File file = LittleFS.open(tmpPath, "w");
+	if(!file){return false;}
+
+	bool written = file.write((const uint8_t*)head, headLength) == headLength;
+	if(written && body != nullptr && bodyLength > 0){
+		written = file.write((const uint8_t*)body, bodyLength) == bodyLength;
+	}
+	file.close();
+
+	if(!written){
+		LittleFS.remove(tmpPath);
+		return false;
+	}
+
+	//littlefs renames atomically over an existing file. If the port in use refuses to replace the
+	//file, remove it first - load() falls back to the temp file if we lose power in between
+	if(LittleFS.rename(tmpPath, path)){return true;}
+	LittleFS.remove(path);
+	return LittleFS.rename(tmpPath, path);
+}
+
+
+/*
+standard CRC32 (IEEE 802.3, reflected) using a 16 entry table to keep flash use small
+
+input:
+	void ptr to the data
+	size_t length of the data
+	uint32_t crc to continue from (0 to start a new one)
+output:
+	uint32_t crc of the data
+*/
+uint32_t ESPHelperConfigStore::crc32(const void* data, size_t length, uint32_t crc){
+	static const uint32_t table[16] = {
+		0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+		0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+	};
+
+	const uint8_t* bytes = (const uint8_t*)data;
+	crc = ~crc;
+	for(size_t i = 0; i < length; i++){
+		crc = table[(crc ^ bytes[i]) & 0x0F] ^ (crc >> 4);
+		crc = table[(crc ^ (bytes[i] >> 4)) & 0x0F] ^ (crc >> 4);
+	}
+	return ~crc;
+}
+
+
+/*
+read and validate one config record file
+
+input:
+	NetInfo reference to load the config into
+	char ptr to the path of the file
+	uint32_t ptr filled with the stored config revision (can be nullptr)
+output:
+	true on: config loaded
+	false on: file missing or invalid
+*/
+bool ESPHelperConfigStore::loadFile(NetInfo& config, const char* path, uint32_t* revision){
+	if(!LittleFS.exists(path)){return false;}
+
+	File file = LittleFS.open(path, "r");
+	if(!file){return false;}
+
+	size_t size = file.size();
+	if(size < sizeof(configRecordHeader) || size > sizeof(configRecordHeader) + 0xFFFF){
+		file.close();
+		return false;
+	}
+
+	//the whole record is read in one go - onto the stack for any record this build can write
+	uint8_t stackBuf[CONFIG_RECORD_BUFFER];
+	uint8_t* record = stackBuf;
+	if(size > sizeof(stackBuf)){
+		//only records from a build with a bigger NETINFO_ARENA_SIZE end up here
+		record = new (std::nothrow) uint8_t[size];
+		if(record == nullptr){
+			file.close();
+			return false;
+		}
+	}
+
+	bool loaded = file.read(record, size) == size && parseRecord(config, record, size, revision);
+	file.close();
+
+	if(record != stackBuf){delete[] record;}
+	return loaded;
+}
+
+
+/*
+check a record header/CRC and load the payload into a NetInfo (migrating other arena sizes)
+
+input:
+	NetInfo reference to load the config into
+	uint8_t ptr to the full record (header + payload)
+	size_t length of the record
+	uint32_t ptr filled with the stored config revision (can be nullptr)
+output:
+	true on: config loaded
+	false on: record invalid
+*/
+bool ESPHelperConfigStore::parseRecord(NetInfo& config, const uint8_t* record, size_t length, uint32_t* revision){
+	configRecordHeader header;
+	memcpy(&header, record, sizeof(header));
+
+	if(header.magic != CONFIG_RECORD_MAGIC){return false;}
+	if(header.length != length - sizeof(header)){return false;}
+
+	const uint8_t* payload = record + sizeof(header);
+	if(crc32(payload, header.length) != header.crc){return false;}
+
+	bool loaded = false;
+	if(header.version == CONFIG_RECORD_VERSION && header.length == sizeof(ESPHelperConf)){
+		//current layout - straight copy
+		ESPHelperConf conf;
+		memcpy(&conf, payload, sizeof(conf));
+		loaded = validArena(conf.used, conf.offsets, conf.arena, NETINFO_ARENA_SIZE);
+		if(loaded){config.setConf(conf);}
+	}
+	else if(header.version == CONFIG_RECORD_V2){loaded = migrateV2(config, payload, header.length);}
+
+	if(loaded && revision != nullptr){*revision = header.revision;}
+	return loaded;
+}
+
+
+/*
+load a packed payload that was written with a different NETINFO_ARENA_SIZE. Each string is
+copied over individually. If the strings no longer fit this build's arena the record is refused
+rather than loaded with missing values
+
+input:
+	NetInfo reference to load the config into
+	uint8_t ptr to the payload
+	size_t length of the payload
+output:
+	true on: config loaded
+	false on: payload is malformed or too big for NETINFO_ARENA_SIZE (the NetInfo is left untouched)
+*/
+bool ESPHelperConfigStore::migrateV2(NetInfo& config, const uint8_t* payload, size_t length){
+	const size_t arenaStart = offsetof(ESPHelperConf, arena);
+	if(length < arenaStart){return false;}
+
+	uint16_t used;
+	uint16_t offsets[CONF_STRING_COUNT];
+	int mqttPort;
+	int willQoS;
+	bool willRetain;
+	memcpy(&used, payload + offsetof(ESPHelperConf, used), sizeof(used));
+	memcpy(offsets, payload + offsetof(ESPHelperConf, offsets), sizeof(offsets));
+	memcpy(&mqttPort, payload + offsetof(ESPHelperConf, mqttPort), sizeof(mqttPort));
+	memcpy(&willQoS, payload + offsetof(ESPHelperConf, willQoS), sizeof(willQoS));
+	memcpy(&willRetain, payload + offsetof(ESPHelperConf, willRetain), sizeof(willRetain));
+
+	//validate every string before touching the NetInfo
+	const char* arena = (const char*)payload + arenaStart;
+	if(!validArena(used, offsets, arena, length - arenaStart)){return false;}
+
+	//build the new layout on the side so a config that doesn't fit leaves the NetInfo alone
+	ESPHelperConf conf;
+	NetInfo migrated(conf);
+	migrated.reset();
+	bool fits = true;
+	if(used > 0){
+		for(int i = 0; i < CONF_STRING_COUNT && fits; i++){
+			fits = migrated.setString((confString)i, arena + offsets[i] + 1);
+		}
+	}
+	if(!fits){return false;}
+
+	migrated.setMqttPort(mqttPort);
+	migrated.setMqttWillQoS(willQoS);
+	migrated.setMqttWillRetain(willRetain);
+	config.setConf(conf);
+	return true;
+}
+
+
+/*
+check that a packed string arena is laid out the way NetInfo writes it: the strings follow each
+other from the start of the arena, each length prefix matches its null terminator and the last
+one ends at used (no string has a null inside it). A CRC only proves the record wasn't damaged, not that it was written right
+
+input:
+	uint16_t bytes of the arena in use (0 = never formatted, reads back as empty strings)
+	uint16_t ptr to the offset table (CONF_STRING_COUNT entries)
+	char ptr to the arena
+	size_t size of the arena
+output:
+	true on: every string can be read safely
+	false on: an offset or length points outside the used part of the arena
+*/
+bool ESPHelperConfigStore::validArena(uint16_t used, const uint16_t* offsets, const char* arena, size_t arenaSize){
+	if(used == 0){return true;}
+	if(used > arenaSize || used < 2 * CONF_STRING_COUNT){return false;}
+
+	size_t expected = 0;
+	for(int i = 0; i < CONF_STRING_COUNT; i++){
+		if(offsets[i] != expected){return false;}
+		size_t len = (uint8_t)arena[expected];
+		if(expected + len + 2 > used || arena[expected + 1 + len] != '\0'){return false;}
+		if(memchr(&arena[expected + 1], '\0', len) != nullptr){return false;}
+		expected += len + 2;
+	}
+	return expected == used;
+}
@@ -0,0 +1,80 @@
+/*
+    ESPHelperConfigStore.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef ESPHELPER_CONFIG_STORE_H
+#define ESPHELPER_CONFIG_STORE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include "sharedData.h"
+
+
+#define DEFAULT_CONFIG_PATH "/netConfig.bin"
+
+//"EHCF" - marks a file as an ESPHelper config record
+#define CONFIG_RECORD_MAGIC 0x46434845
+
+//record format version (1 was never written by a release)
+#define CONFIG_RECORD_V2 2			//packed string arena
+#define CONFIG_RECORD_VERSION CONFIG_RECORD_V2
+
+
+struct configRecordHeader {
+	uint32_t magic;
+	uint16_t version;		//layout of the payload that follows
+	uint16_t length;		//payload length in bytes
+	uint32_t revision;		//application defined config revision (ie for remote config)
+	uint32_t crc;			//CRC32 of the payload
+};
+
+
+/*
+Binary NetInfo storage on LittleFS.
+
+The config is stored as a small header followed by the raw ESPHelperConf so loading it is a single
+read and a CRC check - no parsing. Saves go to a temporary file which is then renamed over the
+old one, so a power cut during a save leaves either the old or the new config on flash, never a
+partial one. Records written with a different NETINFO_ARENA_SIZE are migrated on load, and every
+string offset and length is checked before a record is used.
+*/
+class ESPHelperConfigStore {
+
+public:
+	static bool begin();
+
+	static bool load(NetInfo& config, const char* path = DEFAULT_CONFIG_PATH, uint32_t* revision = nullptr);
+	static bool save(const NetInfo& config, const char* path = DEFAULT_CONFIG_PATH, uint32_t revision = 0);
+	static bool erase(const char* path = DEFAULT_CONFIG_PATH);
+
+	static bool writeAtomic(const char* path, const void* head, size_t headLength, const void* body, size_t bodyLength);
+	static uint32_t crc32(const void* data, size_t length, uint32_t crc = 0);
+
+private:
+	static bool loadFile(NetInfo& config, const char* path, uint32_t* revision);
+	static bool parseRecord(NetInfo& config, const uint8_t* record, size_t length, uint32_t* revision);
+	static bool migrateV2(NetInfo& config, const uint8_t* payload, size_t length);
+	static bool validArena(uint16_t used, const uint16_t* offsets, const char* arena, size_t arenaSize);
+};
+
+#endif
@@ -0,0 +1,362 @@
+/*
+    ESPHelperDeltaOTA.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "ESPHelperDeltaOTA.h"
+
+
+/*
+start writing an update
+
+input:
+	uint32_t size of what will be written (the patch, or the image itself)
+	bool the input is a patch made by delta_gen.py rather than an image
+output:
+	true on: ready for write()
+	false on: not enough flash for the image, or too small to be a patch
+*/
+bool ESPHelperDeltaOTA::begin(uint32_t size, bool delta){
+	abort();
+	_stats = deltaStats();
+	_lastError[0] = '\0';
+	_headerFill = 0;
+	_opFill = 0;
+
+	if(!delta){
+		if(!_partition->begin(size)){
+			fail("space");
+			return false;
+		}
+		_updateRunning = true;
+		_stats.targetSize = size;
+		_state = DELTA_PLAIN;
+		return true;
+	}
+
+	//the flash is only claimed once the header says how big the image will be
+	if(size < DELTA_HEADER_SIZE){
+		fail("size");
+		return false;
+	}
+	_state = DELTA_HEADER;
+	return true;
+}
+
+
+/*
+take the next bytes of the input. Stops early when the patch asks for work that is done in
+handle() (checking the running image, copying from it)
+
+input:
+	uint8_t ptr to the data
+	size_t number of bytes
+output:
+	size_t bytes used (the rest has to be passed again once handle() returns true).
+	On an error the update is discarded and hasError() is true
+*/
+size_t ESPHelperDeltaOTA::write(uint8_t* data, size_t length){
+	if(_state == DELTA_PLAIN){return writeTarget(data, length) ? length : 0;}
+
+	size_t used = 0;
+	while(used < length){
+		switch(_state){
+			case DELTA_HEADER: {
+				size_t count = min(length - used, (size_t)(DELTA_HEADER_SIZE - _headerFill));
+				memcpy(_header + _headerFill, data + used, count);
+				_headerFill += count;
+				used += count;
+				if(_headerFill == DELTA_HEADER_SIZE){parseHeader();}
+				break;
+			}
+
+			case DELTA_OP:
+				//nothing may follow the last operation
+				if(_stats.written == _stats.targetSize){
+					fail("trailing");
+					break;
+				}
+				_op[_opFill++] = data[used++];
+				if(_op[0] != DELTA_OP_COPY && _op[0] != DELTA_OP_DATA){
+					fail("opcode");
+					break;
+				}
+				if(_opFill == (_op[0] == DELTA_OP_COPY ? 9U : 5U)){startOp();}
+				break;
+
+			case DELTA_DATA: {
+				size_t count = min(length - used, (size_t)_remaining);
+				if(!writeTarget(data + used, count)){break;}
+				used += count;
+				_remaining -= count;
+				_stats.literal += count;
+				if(_remaining == 0){_state = DELTA_OP;}
+				break;
+			}
+
+			default:
+				//waiting for handle() (or failed)
+				return used;
+		}
+	}
+	return used;
+}
+
+
+/*
+do the work the patch is waiting on - checking the running image against the source hash and
+copying from it - one DELTA_STEP_SIZE step per call. Call this before every write()
+
+input: NA
+output:
+	true on: ready for more input
+	false on: still busy (call again on the next loop) or failed (see hasError)
+*/
+bool ESPHelperDeltaOTA::handle(){
+	if(_state != DELTA_CHECK_SOURCE && _state != DELTA_COPY){return _state != DELTA_FAILED;}
+
+	uint32_t step = min(_remaining, (uint32_t)DELTA_STEP_SIZE);
+	while(step > 0){
+		size_t count = min(step, (uint32_t)DELTA_WINDOW_SIZE);
+		if(!_partition->readRunning(_copyOffset, _window, count)){
+			fail("read");
+			return false;
+		}
+
+		if(_state == DELTA_CHECK_SOURCE){_hash.add(_window, count);}
+		else if(!writeTarget(_window, count)){return false;}
+		else{_stats.copied += count;}
+
+		_copyOffset += count;
+		_remaining -= count;
+		step -= count;
+	}
+	if(_remaining > 0){return false;}
+
+	if(_state == DELTA_CHECK_SOURCE){
+		//a patch made against a different build would produce garbage - refuse it before touching the flash
+		uint8_t digest[SHA256_SIZE];
+		_hash.finish(digest);
+		if(memcmp(digest, _header + 16, SHA256_SIZE) != 0){
+			fail("source");
+			return false;
+		}
+		if(!_partition->begin(_stats.targetSize)){
+			fail("space");
+			return false;
+		}
+		_updateRunning = true;
+
+		//from here on the hash is of the image being built
+		_hash.begin();
+	}
+
+	_state = DELTA_OP;
+	return true;
+}
+
+
+/*
+finish the update once all input has been written. A patched image is checked against the target
+hash before it is committed (plain images are checked by the caller)
+
+input: NA
+output:
+	true on: image committed (restart to boot it)
+	false on: incomplete, wrong hash or the commit failed (the update is discarded)
+*/
+bool ESPHelperDeltaOTA::end(){
+	if(_state == DELTA_FAILED){return false;}
+
+	if(_state != DELTA_PLAIN){
+		if(_state != DELTA_OP || _stats.written != _stats.targetSize){
+			fail("incomplete");
+			return false;
+		}
+
+		uint8_t digest[SHA256_SIZE];
+		_hash.finish(digest);
+		if(memcmp(digest, _header + 48, SHA256_SIZE) != 0){
+			fail("hash");
+			return false;
+		}
+	}
+
+	_updateRunning = false;
+	_state = DELTA_IDLE;
+	if(!_partition->end()){
+		fail("commit");
+		return false;
+	}
+	return true;
+}
+
+
+/*
+throw away a partly written image
+
+input: NA
+output: NA
+*/
+void ESPHelperDeltaOTA::abort(){
+	if(_updateRunning){
+		_partition->abort();
+		_updateRunning = false;
+	}
+	_state = DELTA_IDLE;
+}
+
+
+/*
+check the patch header and start hashing the running image
+
+input: NA
+output:
+	true on: header accepted
+	false on: not a patch this version understands
+*/
+bool ESPHelperDeltaOTA::parseHeader(){
+	if(memcmp(_header, DELTA_MAGIC, 4) != 0 || _header[4] != DELTA_VERSION){
+		fail("format");
+		return false;
+	}
+
+	_sourceSize = readLE(_header + 8);
+	_stats.targetSize = readLE(_header + 12);
+	if(_sourceSize == 0 || _stats.targetSize == 0){
+		fail("format");
+		return false;
+	}
+
+	_hash.begin();
+	_copyOffset = 0;
+	_remaining = _sourceSize;
+	_state = DELTA_CHECK_SOURCE;
+	return true;
+}
+
+
+/*
+check the arguments of a complete opcode and start it
+
+input: NA
+output:
+	true on: operation started
+	false on: it would write past the end of the image or read past the end of the source
+*/
+bool ESPHelperDeltaOTA::startOp(){
+	bool copy = _op[0] == DELTA_OP_COPY;
+	uint32_t length = readLE(_op + (copy ? 5 : 1));
+	_opFill = 0;
+
+	if(length == 0 || length > _stats.targetSize - _stats.written){
+		fail("length");
+		return false;
+	}
+	_stats.ops++;
+	_remaining = length;
+
+	if(!copy){
+		_state = DELTA_DATA;
+		return true;
+	}
+
+	_copyOffset = readLE(_op + 1);
+	if(_copyOffset > _sourceSize || length > _sourceSize - _copyOffset){
+		fail("offset");
+		return false;
+	}
+	_state = DELTA_COPY;
+	return true;
+}
+
+
+bool ESPHelperDeltaOTA::writeTarget(uint8_t* data, size_t length){
+	if(_partition->write(data, length) != length){
+		fail("write");
+		return false;
+	}
+	if(_state != DELTA_PLAIN){_hash.add(data, length);}
+	_stats.written += length;
+	return true;
+}
+
+
+void ESPHelperDeltaOTA::fail(const char* error){
+	abort();
+	strncpy(_lastError, error, sizeof(_lastError) - 1);
+	_lastError[sizeof(_lastError) - 1] = '\0';
+	_state = DELTA_FAILED;
+}
+
+
+uint32_t ESPHelperDeltaOTA::readLE(const uint8_t* data){
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+
+
+bool ESPHelperUpdatePartition::begin(uint32_t size){
+	return Update.begin(size);
+}
+
+
+size_t ESPHelperUpdatePartition::write(uint8_t* data, size_t length){
+	return Update.write(data, length);
+}
+
+
+bool ESPHelperUpdatePartition::end(){
+	return Update.end();
+}
+
+
+void ESPHelperUpdatePartition::abort(){
+	#ifdef ESP32
+	Update.abort();
+	#else
+	//ending an unfinished update (without evenIfRemaining) discards it
+	Update.end();
+	#endif
+}
+
+
+/*
+read part of the running image
+
+input:
+	uint32_t offset in the image
+	uint8_t ptr to the buffer
+	size_t number of bytes
+output:
+	true on: bytes read
+	false on: outside the flash/partition
+*/
+bool ESPHelperUpdatePartition::readRunning(uint32_t offset, uint8_t* data, size_t length){
+	#ifdef ESP32
+	const esp_partition_t* running = esp_ota_get_running_partition();
+	return running != nullptr && esp_partition_read(running, offset, data, length) == ESP_OK;
+	#else
+	//the running sketch is the image at the start of the flash (the updater copies new ones there)
+	return ESP.flashRead(offset, data, length);
+	#endif
+}
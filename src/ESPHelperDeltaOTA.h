@@ -0,0 +1,175 @@
+/*
+    ESPHelperDeltaOTA.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef ESPHELPER_DELTA_OTA_H
+#define ESPHELPER_DELTA_OTA_H
+
+#include <Arduino.h>
+#include "ESPHelperHash.h"
+
+#ifdef ESP8266
+#include <Updater.h>
+#endif
+
+#ifdef ESP32
+#include <Update.h>
+#include <esp_ota_ops.h>
+#endif
+
+
+#define DELTA_MAGIC "EHDP"				//first bytes of a patch (delta_gen.py)
+#define DELTA_VERSION 1
+#define DELTA_HEADER_SIZE 80
+#define DELTA_WINDOW_SIZE 1024			//bytes of the running image read per step of a copy
+#define DELTA_STEP_SIZE 4096			//max bytes copied (or hashed while checking the source) per handle() call
+
+//patch opcodes
+#define DELTA_OP_COPY 0x01				//uint32 source offset, uint32 length: copy from the running image
+#define DELTA_OP_DATA 0x02				//uint32 length, then the bytes: new data
+
+
+enum deltaState {
+	DELTA_IDLE,
+	DELTA_HEADER,			//reading the patch header
+	DELTA_CHECK_SOURCE,		//hashing the running image (handle())
+	DELTA_OP,				//reading the next opcode and its arguments
+	DELTA_DATA,				//passing new data through
+	DELTA_COPY,				//copying from the running image (handle())
+	DELTA_PLAIN,			//not a patch - the input is the image
+	DELTA_FAILED
+};
+
+struct deltaStats {
+	uint32_t targetSize = 0;		//size of the image being built
+	uint32_t written = 0;			//bytes of it written so far
+	uint32_t copied = 0;			//bytes taken from the running image
+	uint32_t literal = 0;			//bytes taken from the patch
+	uint32_t ops = 0;				//patch operations applied
+};
+
+
+/*
+Where an update is written and the running image is read from. ESPHelperUpdatePartition (the
+Update library and the flash) is used unless another one is passed to the constructor - the host
+tests use files
+*/
+class ESPHelperOTAPartition {
+
+public:
+	virtual ~ESPHelperOTAPartition(){}
+
+	virtual bool begin(uint32_t size) = 0;
+	virtual size_t write(uint8_t* data, size_t length) = 0;
+	virtual bool end() = 0;		//commit the image (fails if it is incomplete)
+	virtual void abort() = 0;	//discard a partly written image
+	virtual bool readRunning(uint32_t offset, uint8_t* data, size_t length) = 0;
+};
+
+class ESPHelperUpdatePartition : public ESPHelperOTAPartition {
+
+public:
+	bool begin(uint32_t size) override;
+	size_t write(uint8_t* data, size_t length) override;
+	bool end() override;
+	void abort() override;
+	bool readRunning(uint32_t offset, uint8_t* data, size_t length) override;
+};
+
+
+/*
+Writes an update image to the inactive partition, either exactly as it arrives or by applying a
+patch made by delta_gen.py to the running image, so only the changed parts of a release have to
+be transferred. Used by ESPHelperHttpOTA and ESPHelperMqttOTA.
+
+Patch layout (little endian):
+	"EHDP", version, 3 reserved bytes, uint32 source size, uint32 target size,
+	SHA-256 of the source image, SHA-256 of the target image, then a list of
+	COPY(offset, length) and DATA(length, bytes) operations
+
+The patch is applied as it streams in. The running image is read through a DELTA_WINDOW_SIZE
+window, so RAM use doesn't depend on the image size. The running image is checked against the
+source hash before anything is written and the result against the target hash before the update
+is committed.
+
+Work that isn't driven by input (checking the source, copies) is done in handle() in steps of
+DELTA_STEP_SIZE. write() stops taking input while it is pending:
+
+	while(bytes left){
+		if(!writer.handle()){break;}			//busy - try again on the next loop()
+		size_t used = writer.write(data, length);
+		if(writer.hasError()){...}
+		data += used; length -= used;
+	}
+*/
+class ESPHelperDeltaOTA {
+
+public:
+	ESPHelperDeltaOTA() : _partition(&_updatePartition) {}
+	explicit ESPHelperDeltaOTA(ESPHelperOTAPartition& partition) : _partition(&partition) {}
+
+	bool begin(uint32_t size, bool delta);
+	size_t write(uint8_t* data, size_t length);
+	bool handle();
+	bool end();
+	void abort();
+
+	bool isRunning() const { return _state != DELTA_IDLE && _state != DELTA_FAILED; }
+	bool isBusy() const { return _state == DELTA_CHECK_SOURCE || _state == DELTA_COPY; }
+	bool hasError() const { return _state == DELTA_FAILED; }
+	const char* getLastError() const { return _lastError; }
+	const deltaStats& getStats() const { return _stats; }
+
+private:
+	bool parseHeader();
+	bool startOp();
+	bool writeTarget(uint8_t* data, size_t length);
+	void fail(const char* error);
+
+	static uint32_t readLE(const uint8_t* data);
+
+	ESPHelperUpdatePartition _updatePartition;
+	ESPHelperOTAPartition* _partition;
+
+	deltaState _state = DELTA_IDLE;
+	bool _updateRunning = false;
+
+	uint32_t _sourceSize = 0;
+
+	//header, then the current opcode and its arguments
+	uint8_t _header[DELTA_HEADER_SIZE];
+	size_t _headerFill = 0;
+	uint8_t _op[9];
+	size_t _opFill = 0;
+
+	uint32_t _copyOffset = 0;		//next byte of the running image to copy (or hash)
+	uint32_t _remaining = 0;		//bytes left of the current COPY/DATA (or of the source check)
+
+	ESPHelperHash _hash;
+	uint8_t _window[DELTA_WINDOW_SIZE];
+
+	deltaStats _stats;
+	char _lastError[16];
+};
+
+#endif
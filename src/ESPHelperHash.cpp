@@ -0,0 +1,135 @@
+/*
+    ESPHelperHash.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "ESPHelperHash.h"
+
+
+ESPHelperHash::ESPHelperHash(){
+#ifdef ESP32
+	mbedtls_sha256_init(&_context);
+#endif
+	begin();
+}
+
+ESPHelperHash::~ESPHelperHash(){
+#ifdef ESP32
+	mbedtls_sha256_free(&_context);
+#endif
+}
+
+
+/*
+start a new hash (discards anything added so far)
+
+input: NA
+output: NA
+*/
+void ESPHelperHash::begin(){
+#ifdef ESP8266
+	br_sha256_init(&_context);
+#endif
+#ifdef ESP32
+	mbedtls_sha256_starts(&_context, 0);
+#endif
+}
+
+
+/*
+add data to the hash
+
+input:
+	uint8_t ptr to the data
+	size_t length of the data
+output: NA
+*/
+void ESPHelperHash::add(const uint8_t* data, size_t length){
+#ifdef ESP8266
+	br_sha256_update(&_context, data, length);
+#endif
+#ifdef ESP32
+	mbedtls_sha256_update(&_context, data, length);
+#endif
+}
+
+
+/*
+get the digest of everything added since begin()
+
+input:
+	uint8_t array to write the 32 byte digest to
+output: NA
+*/
+void ESPHelperHash::finish(uint8_t digest[SHA256_SIZE]){
+#ifdef ESP8266
+	br_sha256_out(&_context, digest);
+#endif
+#ifdef ESP32
+	mbedtls_sha256_finish(&_context, digest);
+#endif
+}
+
+
+/*
+convert a 64 character hex string (either case) to a digest
+
+input:
+	char ptr to the hex string
+	uint8_t array to write the digest to
+output:
+	true on: digest converted
+	false on: wrong length or not hex
+*/
+bool ESPHelperHash::parseHex(const char* hex, uint8_t digest[SHA256_SIZE]){
+	if(hex == nullptr || strlen(hex) != SHA256_SIZE * 2){return false;}
+
+	for(int i = 0; i < SHA256_SIZE * 2; i++){
+		char c = hex[i];
+		uint8_t nibble;
+		if(c >= '0' && c <= '9'){nibble = c - '0';}
+		else if(c >= 'a' && c <= 'f'){nibble = c - 'a' + 10;}
+		else if(c >= 'A' && c <= 'F'){nibble = c - 'A' + 10;}
+		else{return false;}
+
+		if(i % 2 == 0){digest[i / 2] = nibble << 4;}
+		else{digest[i / 2] |= nibble;}
+	}
+	return true;
+}
+
+
+/*
+convert a digest to a lowercase hex string
+
+input:
+	uint8_t array with the digest
+	char array to write the 64 characters (plus terminator) to
+output: NA
+*/
+void ESPHelperHash::toHex(const uint8_t digest[SHA256_SIZE], char hex[SHA256_SIZE * 2 + 1]){
+	static const char digits[] = "0123456789abcdef";
+	for(int i = 0; i < SHA256_SIZE; i++){
+		hex[i * 2] = digits[digest[i] >> 4];
+		hex[i * 2 + 1] = digits[digest[i] & 0x0F];
+	}
+	hex[SHA256_SIZE * 2] = '\0';
+}
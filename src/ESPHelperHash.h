@@ -0,0 +1,68 @@
+/*
+    ESPHelperHash.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef ESPHELPER_HASH_H
+#define ESPHELPER_HASH_H
+
+#include <Arduino.h>
+
+#ifdef ESP8266
+#include <bearssl/bearssl_hash.h>
+#endif
+
+#ifdef ESP32
+#include <mbedtls/sha256.h>
+#endif
+
+
+#define SHA256_SIZE 32
+
+
+/*
+Incremental SHA-256 on top of whatever the core ships (BearSSL on the ESP8266, mbedTLS on the
+ESP32), so data can be hashed as it streams past instead of in a second pass.
+*/
+class ESPHelperHash {
+
+public:
+	ESPHelperHash();
+	~ESPHelperHash();
+
+	void begin();
+	void add(const uint8_t* data, size_t length);
+	void finish(uint8_t digest[SHA256_SIZE]);
+
+	static bool parseHex(const char* hex, uint8_t digest[SHA256_SIZE]);
+	static void toHex(const uint8_t digest[SHA256_SIZE], char hex[SHA256_SIZE * 2 + 1]);
+
+private:
+#ifdef ESP8266
+	br_sha256_context _context;
+#endif
+#ifdef ESP32
+	mbedtls_sha256_context _context;
+#endif
+};
+
+#endif
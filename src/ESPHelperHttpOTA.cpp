@@ -0,0 +1,388 @@
+/*
+    ESPHelperHttpOTA.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "ESPHelperHttpOTA.h"
+
+
+/*
+start downloading an image. Nothing happens until handle() is called
+
+input:
+	WiFiClient reference to download with (ie a WiFiClientSecure for https, optional)
+	char ptr to the URL of the image
+	char ptr to the expected SHA-256 as 64 hex characters (nullptr to skip the check)
+	bool the URL is a patch made by delta_gen.py rather than an image
+output:
+	true on: download queued
+	false on: a download is already running, the URL is too long or the hash is not valid hex
+*/
+bool ESPHelperHttpOTA::begin(const char* url, const char* sha256, bool delta){
+	if(_stats.state == HTTP_OTA_CONNECTING || _stats.state == HTTP_OTA_TRANSFER || _stats.state == HTTP_OTA_RETRY_WAIT){return false;}
+	if(strlen(url) >= sizeof(_url)){return false;}
+
+	_verify = sha256 != nullptr;
+	if(_verify && !ESPHelperHash::parseHex(sha256, _expected)){return false;}
+
+	strcpy(_url, url);
+	_delta = delta;
+	_hash.begin();
+	_stats = httpOtaStats();
+	_stats.state = HTTP_OTA_CONNECTING;
+	_lastError[0] = '\0';
+	_retries = 0;
+	_transferTime = 0;
+	_doneReported = false;
+	return true;
+}
+
+bool ESPHelperHttpOTA::begin(WiFiClient& client, const char* url, const char* sha256, bool delta){
+	if(_stats.state == HTTP_OTA_CONNECTING || _stats.state == HTTP_OTA_TRANSFER || _stats.state == HTTP_OTA_RETRY_WAIT){return false;}
+	_httpSource.setClient(client);
+	return begin(url, sha256, delta);
+}
+
+
+/*
+stop a running download and discard what was written
+
+input: NA
+output: NA
+*/
+void ESPHelperHttpOTA::cancel(){
+	if(_stats.state == HTTP_OTA_IDLE || _stats.state == HTTP_OTA_DONE || _stats.state == HTTP_OTA_FAILED){return;}
+	dropConnection();
+	abortUpdate();
+	_stats.state = HTTP_OTA_IDLE;
+}
+
+
+/*
+run the download - call this from loop()
+
+input: NA
+output:
+	true on: the image was downloaded, verified and committed (restart to boot it)
+	false on: still running, idle or failed (see getState()/getLastError())
+*/
+bool ESPHelperHttpOTA::handle(){
+	switch(_stats.state){
+		case HTTP_OTA_CONNECTING:
+			connect();
+			break;
+
+		case HTTP_OTA_TRANSFER:
+			transfer();
+			break;
+
+		case HTTP_OTA_RETRY_WAIT:
+			if((long)(millis() - _retryAt) >= 0){
+				_stats.stallMs += millis() - _lastData;
+				_lastData = millis();
+				_stats.state = HTTP_OTA_CONNECTING;
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	//report success once
+	if(_stats.state == HTTP_OTA_DONE && !_doneReported){
+		_doneReported = true;
+		return true;
+	}
+	return false;
+}
+
+
+/*
+send the request for the rest of the image and check the response. This blocks until the
+response headers arrive (or HTTP_OTA_TIMEOUT)
+
+input: NA
+output: NA
+*/
+void ESPHelperHttpOTA::connect(){
+	int code = _source->request(_url, _stats.bytesDone);
+	if(code == HTTP_OTA_ERROR_URL){
+		dropConnection();
+		fail("url");
+		return;
+	}
+
+	if(code == HTTP_CODE_PARTIAL_CONTENT && _stats.bytesDone > 0){
+		uint32_t start;
+		uint32_t total;
+		if(!parseContentRange(_source->contentRange(), start, total) || start != _stats.bytesDone || total != _stats.totalBytes){
+			dropConnection();
+			abortUpdate();
+			fail("range");
+			return;
+		}
+		_stats.resumes++;
+	}
+
+	else if(code == HTTP_CODE_OK){
+		//a fresh download, or a server that ignored the Range header - either way start from the beginning
+		if(_writer.isRunning()){
+			abortUpdate();
+			_hash.begin();
+			_stats.bytesDone = 0;
+		}
+
+		int32_t size = _source->size();
+		if(size <= 0){
+			dropConnection();
+			fail("size");
+			return;
+		}
+		if(!_writer.begin(size, _delta)){
+			dropConnection();
+			fail(_writer.getLastError());
+			return;
+		}
+		_stats.totalBytes = size;
+	}
+
+	else{
+		//server or connection error - retry (connection errors are negative)
+		dropConnection();
+		if(code > 0 && code < 500){
+			abortUpdate();
+			snprintf(_lastError, sizeof(_lastError), "http %d", code);
+			_stats.state = HTTP_OTA_FAILED;
+			return;
+		}
+		if(++_retries > HTTP_OTA_MAX_RETRIES){
+			abortUpdate();
+			fail("connect");
+			return;
+		}
+		_retryAt = millis() + (HTTP_OTA_RETRY_DELAY << (_retries - 1));
+		_stats.state = HTTP_OTA_RETRY_WAIT;
+		return;
+	}
+
+	_lastData = millis();
+	_transferStart = millis();
+	_stats.state = HTTP_OTA_TRANSFER;
+}
+
+
+/*
+move up to one chunk from the connection to the writer (and the hash)
+
+input: NA
+output: NA
+*/
+void ESPHelperHttpOTA::transfer(){
+	unsigned long now = millis();
+
+	//a patch can keep the writer busy copying from the running image - the download waits for it
+	if(!feed()){
+		_lastData = now;
+		return;
+	}
+
+	if(_stats.bytesDone == _stats.totalBytes){
+		finish();
+		return;
+	}
+
+	int available = _source->available();
+
+	if(available <= 0){
+		//connection lost or stalled - resume from where it stopped
+		if(!_source->connected() || now - _lastData > HTTP_OTA_STALL_TIMEOUT){
+			_transferTime += now - _transferStart;
+			dropConnection();
+			if(++_retries > HTTP_OTA_MAX_RETRIES){
+				abortUpdate();
+				fail("stalled");
+				return;
+			}
+			_retryAt = now + (HTTP_OTA_RETRY_DELAY << (_retries - 1));
+			_stats.state = HTTP_OTA_RETRY_WAIT;
+		}
+		return;
+	}
+
+	size_t count = (size_t)available;
+	if(count > sizeof(_buffer)){count = sizeof(_buffer);}
+	if(count > _stats.totalBytes - _stats.bytesDone){count = _stats.totalBytes - _stats.bytesDone;}
+	count = _source->read(_buffer, count);
+	if(count == 0){return;}
+
+	_hash.add(_buffer, count);
+	_bufferFill = count;
+	_bufferPos = 0;
+
+	if(now - _lastData > HTTP_OTA_STALL_THRESHOLD){_stats.stallMs += now - _lastData;}
+	_lastData = now;
+	_retries = 0;
+	_stats.bytesDone += count;
+
+	uint32_t elapsed = _transferTime + (now - _transferStart);
+	if(elapsed > 0){_stats.bytesPerSecond = (uint64_t)_stats.bytesDone * 1000 / elapsed;}
+
+	feed();
+}
+
+
+/*
+pass the buffered part of the download on to the writer
+
+input: NA
+output:
+	true on: the buffer is empty and the writer is ready for more
+	false on: the writer is busy, or failed (the download is stopped)
+*/
+bool ESPHelperHttpOTA::feed(){
+	if(_writer.handle() && _bufferPos < _bufferFill){
+		_bufferPos += _writer.write(_buffer + _bufferPos, _bufferFill - _bufferPos);
+	}
+
+	if(_writer.hasError()){
+		dropConnection();
+		fail(_writer.getLastError());
+		return false;
+	}
+	return _bufferPos == _bufferFill && !_writer.isBusy();
+}
+
+
+/*
+check the whole download before it is allowed to boot and commit it
+
+input: NA
+output: NA
+*/
+void ESPHelperHttpOTA::finish(){
+	dropConnection();
+	if(_verify){
+		uint8_t digest[SHA256_SIZE];
+		_hash.finish(digest);
+		if(memcmp(digest, _expected, SHA256_SIZE) != 0){
+			abortUpdate();
+			fail("hash");
+			return;
+		}
+	}
+
+	if(!_writer.end()){
+		fail(_writer.getLastError());
+		return;
+	}
+	_stats.state = HTTP_OTA_DONE;
+}
+
+
+void ESPHelperHttpOTA::dropConnection(){
+	_source->stop();
+}
+
+
+void ESPHelperHttpOTA::fail(const char* error){
+	strncpy(_lastError, error, sizeof(_lastError) - 1);
+	_lastError[sizeof(_lastError) - 1] = '\0';
+	_stats.state = HTTP_OTA_FAILED;
+}
+
+
+/*
+throw away a partly written image
+
+input: NA
+output: NA
+*/
+void ESPHelperHttpOTA::abortUpdate(){
+	_writer.abort();
+	_bufferFill = 0;
+	_bufferPos = 0;
+}
+
+
+/*
+parse a "bytes <start>-<end>/<total>" Content-Range header
+
+input:
+	String with the header value
+	uint32_t reference for the first byte of the response
+	uint32_t reference for the size of the whole image
+output:
+	true on: header parsed
+	false on: missing or malformed header (or an unknown total)
+*/
+bool ESPHelperHttpOTA::parseContentRange(const String& header, uint32_t& start, uint32_t& total){
+	unsigned long first;
+	unsigned long last;
+	unsigned long size;
+	if(sscanf(header.c_str(), "bytes %lu-%lu/%lu", &first, &last, &size) != 3){return false;}
+	start = first;
+	total = size;
+	return true;
+}
+
+
+
+/*
+send a GET for the image with HTTPClient (Range from offset on) and wait for the response headers
+
+input:
+	char ptr to the URL
+	uint32_t first byte wanted
+output:
+	int HTTP status code, a negative HTTPClient error or HTTP_OTA_ERROR_URL
+*/
+int ESPHelperHttpClientSource::request(const char* url, uint32_t offset){
+	static const char* headers[] = {"Content-Range"};
+
+	_http.setTimeout(HTTP_OTA_TIMEOUT);
+	_http.setReuse(false);
+	if(!_http.begin(*_client, url)){return HTTP_OTA_ERROR_URL;}
+	_http.collectHeaders(headers, 1);
+
+	if(offset > 0){
+		char range[24];
+		snprintf(range, sizeof(range), "bytes=%lu-", (unsigned long)offset);
+		_http.addHeader("Range", range);
+	}
+	return _http.GET();
+}
+
+
+int ESPHelperHttpClientSource::available(){
+	WiFiClient* stream = _http.getStreamPtr();
+	return stream != nullptr ? stream->available() : 0;
+}
+
+
+size_t ESPHelperHttpClientSource::read(uint8_t* data, size_t length){
+	WiFiClient* stream = _http.getStreamPtr();
+	return stream != nullptr ? stream->readBytes(data, length) : 0;
+}
+
+
+bool ESPHelperHttpClientSource::connected(){
+	return _http.getStreamPtr() != nullptr && _http.connected();
+}
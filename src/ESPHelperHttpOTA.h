@@ -0,0 +1,181 @@
+/*
+    ESPHelperHttpOTA.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef ESPHELPER_HTTP_OTA_H
+#define ESPHELPER_HTTP_OTA_H
+
+#include <Arduino.h>
+
+#ifdef ESP8266
+#include <ESP8266WiFi.h>
+#include <ESP8266HTTPClient.h>
+#endif
+
+#ifdef ESP32
+#include <WiFi.h>
+#include <HTTPClient.h>
+#endif
+
+#include "ESPHelperHash.h"
+#include "ESPHelperDeltaOTA.h"
+
+
+#define HTTP_OTA_CHUNK_SIZE 1024		//bytes moved from the connection to flash per handle() call
+#define HTTP_OTA_STALL_THRESHOLD 250	//gap (ms) between chunks that counts as a stall
+#define HTTP_OTA_STALL_TIMEOUT 10000	//no data for this long (ms) drops the connection and resumes
+#define HTTP_OTA_MAX_RETRIES 5			//reconnects in a row without progress before giving up
+#define HTTP_OTA_RETRY_DELAY 1000		//delay (ms) before the first reconnect, doubled for each retry
+#define HTTP_OTA_TIMEOUT 5000			//connect/header timeout (ms) of each request
+#define HTTP_OTA_ERROR_URL -100			//ESPHelperOTASource::request(): the URL can't be used (not retried)
+
+enum httpOtaState {
+	HTTP_OTA_IDLE,
+	HTTP_OTA_CONNECTING,
+	HTTP_OTA_TRANSFER,
+	HTTP_OTA_RETRY_WAIT,
+	HTTP_OTA_DONE,
+	HTTP_OTA_FAILED
+};
+
+struct httpOtaStats {
+	uint32_t bytesDone = 0;			//bytes downloaded
+	uint32_t totalBytes = 0;		//image (or patch) size (0 until the server has answered)
+	uint32_t bytesPerSecond = 0;	//average over the time spent transferring
+	uint32_t stallMs = 0;			//time spent waiting for data (gaps over HTTP_OTA_STALL_THRESHOLD and reconnects)
+	uint16_t resumes = 0;			//times the download was resumed with a Range request
+	httpOtaState state = HTTP_OTA_IDLE;
+};
+
+
+/*
+Where ESPHelperHttpOTA downloads from. ESPHelperHttpClientSource (HTTPClient) is used unless
+another one is passed to the constructor - the host tests use plain sockets
+*/
+class ESPHelperOTASource {
+
+public:
+	virtual ~ESPHelperOTASource(){}
+
+	//send a GET for the URL from byte offset on (a Range request when offset > 0) and read the
+	//response headers. Returns the status code, or a negative value if the request failed
+	virtual int request(const char* url, uint32_t offset) = 0;
+	virtual int32_t size() = 0;				//Content-Length of the response (-1 if unknown)
+	virtual String contentRange() = 0;		//Content-Range header of the response ("" if missing)
+	virtual int available() = 0;
+	virtual size_t read(uint8_t* data, size_t length) = 0;
+	virtual bool connected() = 0;			//false once the connection is closed and nothing is left to read
+	virtual void stop() = 0;
+};
+
+class ESPHelperHttpClientSource : public ESPHelperOTASource {
+
+public:
+	void setClient(WiFiClient& client) { _client = &client; }
+
+	int request(const char* url, uint32_t offset) override;
+	int32_t size() override { return _http.getSize(); }
+	String contentRange() override { return _http.header("Content-Range"); }
+	int available() override;
+	size_t read(uint8_t* data, size_t length) override;
+	bool connected() override;
+	void stop() override { _http.end(); }
+
+private:
+	WiFiClient _defaultClient;
+	WiFiClient* _client = &_defaultClient;
+	HTTPClient _http;
+};
+
+
+/*
+Pull OTA: downloads a firmware image over HTTP straight into the update partition from loop().
+
+Every handle() call moves at most one chunk so the rest of the sketch (MQTT included) keeps
+running while the image streams in. Sending a request is the exception: HTTPClient connects and
+waits for the response headers synchronously, so the handle() call that starts the download (and
+each one that resumes it) can block loop() for up to HTTP_OTA_TIMEOUT. A dropped or stalled connection is resumed where it stopped with a Range request
+(servers that ignore Range make it start over). The image is hashed as it is written and
+checked against the expected SHA-256 before the update is committed. The download can't be
+resumed across a reboot - the update partition is only valid while the Update session is open.
+With delta set the download is a patch made by delta_gen.py and the sha256 is the patch's (the
+patched image is checked against the hash in the patch, see ESPHelperDeltaOTA).
+
+	ESPHelperHttpOTA ota;
+	ota.begin("http://server/firmware.bin", "9f86d081884c7d65...");
+	...
+	if(ota.handle()){myESP.requestRestart();}	//or ESP.restart() without ESPHelper
+*/
+class ESPHelperHttpOTA {
+
+public:
+	ESPHelperHttpOTA() : _source(&_httpSource) {}
+	ESPHelperHttpOTA(ESPHelperOTASource& source, ESPHelperOTAPartition& partition) : _source(&source), _writer(partition) {}
+
+	bool begin(const char* url, const char* sha256 = nullptr, bool delta = false);
+	bool begin(WiFiClient& client, const char* url, const char* sha256 = nullptr, bool delta = false);
+	void cancel();
+
+	bool handle();
+
+	httpOtaState getState() const { return _stats.state; }
+	const httpOtaStats& getStats() const { return _stats; }
+	const char* getLastError() const { return _lastError; }
+
+private:
+	void connect();
+	void transfer();
+	bool feed();
+	void finish();
+	void dropConnection();
+	void fail(const char* error);
+	void abortUpdate();
+	static bool parseContentRange(const String& header, uint32_t& start, uint32_t& total);
+
+	ESPHelperHttpClientSource _httpSource;
+	ESPHelperOTASource* _source;
+	ESPHelperHash _hash;
+
+	char _url[128];
+	uint8_t _expected[SHA256_SIZE];
+	bool _verify = false;
+	bool _delta = false;
+	ESPHelperDeltaOTA _writer;
+	bool _doneReported = false;
+
+	uint8_t _retries = 0;
+	unsigned long _retryAt = 0;
+	unsigned long _lastData = 0;
+	unsigned long _transferStart = 0;
+	unsigned long _transferTime = 0;
+
+	httpOtaStats _stats;
+	char _lastError[32];
+
+	//downloaded data the writer hasn't taken yet (a patch makes it wait while it copies)
+	uint8_t _buffer[HTTP_OTA_CHUNK_SIZE];
+	size_t _bufferFill = 0;
+	size_t _bufferPos = 0;
+};
+
+#endif
@@ -0,0 +1,682 @@
+/*
+    ESPHelperJournal.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "ESPHelperJournal.h"
+
+
+//journalEntry flags
+#define ENTRY_USED 0x01
+#define ENTRY_DELETED 0x02
+#define ENTRY_PENDING 0x04		//changed in RAM, not written yet
+
+//recordHeader flags
+#define RECORD_DELETED 0x01
+
+//journalEntry log value for keys that have never been written
+#define JOURNAL_NO_LOG 0xFF
+
+#define JOURNAL_MAX_RECORD (sizeof(recordHeader) + JOURNAL_KEY_LENGTH + JOURNAL_VALUE_SIZE + sizeof(uint32_t))
+
+//a log must at least be able to hold a copy of every key (twice so that compaction doesn't run back to back)
+#define JOURNAL_MIN_LOG_SIZE (2 * JOURNAL_MAX_KEYS * JOURNAL_MAX_RECORD)
+
+
+ESPHelperJournal::ESPHelperJournal(){
+	memset(_entries, 0, sizeof(_entries));
+	_path[0] = '\0';
+}
+
+ESPHelperJournal::~ESPHelperJournal(){
+	end();
+}
+
+
+/*
+load the journal from flash (the filesystem must already be mounted). Both logs are replayed and
+the newest record for each key is kept. A log with a torn or corrupt tail is rewritten and a
+compaction that was interrupted by a restart is picked up again
+
+input:
+	char ptr to the base path of the logs (<path>.0 and <path>.1 are used)
+	uint32_t time in ms that changes are held before they are written (0 writes on the next handle())
+	size_t size in bytes a log may grow to before switching logs
+output:
+	true on: journal ready
+	false on: the path is too long
+*/
+bool ESPHelperJournal::begin(const char* path, uint32_t window, size_t logSize){
+	end();
+
+	if(strlen(path) + 5 > sizeof(_path)){return false;}
+	strcpy(_path, path);
+
+	memset(_entries, 0, sizeof(_entries));
+	_stats = journalStats();
+	_window = window;
+	_logSize = logSize < JOURNAL_MIN_LOG_SIZE ? JOURNAL_MIN_LOG_SIZE : logSize;
+	_pending = false;
+
+#ifdef ESP8266
+	FSInfo info;
+	if(LittleFS.info(info) && info.blockSize > 0 && info.pageSize > 0){
+		_blockSize = info.blockSize;
+		_pageSize = info.pageSize;
+	}
+#endif
+
+	uint32_t maxSeq[2] = {0, 0};
+	size_t validLength[2] = {0, 0};
+	bool clean[2];
+	clean[0] = replay(0, maxSeq[0], validLength[0]);
+	clean[1] = replay(1, maxSeq[1], validLength[1]);
+
+	//the log holding the newest record is the one being appended to
+	_activeLog = maxSeq[1] > maxSeq[0] ? 1 : 0;
+	_seq = max(maxSeq[0], maxSeq[1]) + 1;
+	_activeSize = validLength[_activeLog];
+
+	//if the other log is still around we were restarted in the middle of a compaction
+	char otherPath[sizeof(_path)];
+	logPath(_activeLog ^ 1, otherPath, sizeof(otherPath));
+	_compacting = LittleFS.exists(otherPath);
+
+	_started = true;
+
+	//records appended after a torn one would never be read back, so start from a clean log
+	if(!clean[_activeLog]){rewriteLog();}
+
+	return true;
+}
+
+
+/*
+write any pending changes and stop the journal
+
+input: NA
+output: NA
+*/
+void ESPHelperJournal::end(){
+	if(!_started){return;}
+	flush();
+	_started = false;
+}
+
+
+/*
+run the journal - call this from loop(). Pending changes are written once the coalescing window
+has passed and a compaction in progress copies a few more keys to the new log
+
+input: NA
+output:
+	true on: something was written to flash
+	false on: nothing to do
+*/
+bool ESPHelperJournal::handle(){
+	if(!_started){return false;}
+
+	bool wrote = false;
+	if(_compacting){
+		compactStep(JOURNAL_COMPACT_STEP);
+		wrote = true;
+	}
+
+	if(_pending && millis() - _pendingSince >= _window){
+		appendPending();
+		wrote = true;
+	}
+
+	return wrote;
+}
+
+
+/*
+write pending changes now instead of waiting for the coalescing window (ie before a restart)
+
+input: NA
+output:
+	true on: nothing left to write
+	false on: the log could not be written
+*/
+bool ESPHelperJournal::flush(){
+	if(!_started){return false;}
+	return appendPending();
+}
+
+
+bool ESPHelperJournal::has(const char* key) const{
+	int index = findEntry(key);
+	return index >= 0 && !(_entries[index].flags & ENTRY_DELETED);
+}
+
+
+/*
+remove a key (a delete record is written with the next flush)
+
+input:
+	char ptr to the key
+output:
+	true on: key removed
+	false on: key not found
+*/
+bool ESPHelperJournal::remove(const char* key){
+	int index = findEntry(key);
+	if(index < 0 || (_entries[index].flags & ENTRY_DELETED)){return false;}
+
+	journalEntry& entry = _entries[index];
+
+	//never written - nothing on flash to cancel
+	if(entry.log == JOURNAL_NO_LOG){
+		entry.flags = 0;
+		return true;
+	}
+
+	entry.flags = ENTRY_USED | ENTRY_DELETED | ENTRY_PENDING;
+	entry.length = 0;
+	if(!_pending){
+		_pending = true;
+		_pendingSince = millis();
+	}
+	return true;
+}
+
+
+bool ESPHelperJournal::setInt(const char* key, int32_t value){
+	return setValue(key, &value, sizeof(value));
+}
+
+bool ESPHelperJournal::setFloat(const char* key, float value){
+	return setValue(key, &value, sizeof(value));
+}
+
+bool ESPHelperJournal::setBool(const char* key, bool value){
+	uint8_t stored = value ? 1 : 0;
+	return setValue(key, &stored, sizeof(stored));
+}
+
+bool ESPHelperJournal::setBlob(const char* key, const void* value, size_t length){
+	return setValue(key, value, length);
+}
+
+
+int32_t ESPHelperJournal::getInt(const char* key, int32_t defaultValue) const{
+	int32_t value;
+	return getValue(key, &value, sizeof(value)) ? value : defaultValue;
+}
+
+float ESPHelperJournal::getFloat(const char* key, float defaultValue) const{
+	float value;
+	return getValue(key, &value, sizeof(value)) ? value : defaultValue;
+}
+
+bool ESPHelperJournal::getBool(const char* key, bool defaultValue) const{
+	uint8_t value;
+	return getValue(key, &value, sizeof(value)) ? value != 0 : defaultValue;
+}
+
+const uint8_t* ESPHelperJournal::getBlob(const char* key, size_t* length) const{
+	int index = findEntry(key);
+	if(index < 0 || (_entries[index].flags & ENTRY_DELETED)){return nullptr;}
+
+	if(length != nullptr){*length = _entries[index].length;}
+	return _entries[index].value;
+}
+
+
+/*
+bytes programmed to flash per byte of value changed. Records carry a header, the key and a CRC
+and littlefs copies the partly filled last block of a log each time it is appended to, so this is
+well above 1 when every change is written and drops as the coalescing window absorbs changes
+
+input: NA
+output:
+	float write amplification (0 if nothing has been changed yet)
+*/
+float ESPHelperJournal::getWriteAmplification() const{
+	if(_stats.bytesRequested == 0){return 0;}
+	return (float)_stats.bytesProgrammed / _stats.bytesRequested;
+}
+
+
+int ESPHelperJournal::findEntry(const char* key) const{
+	for(int i = 0; i < JOURNAL_MAX_KEYS; i++){
+		if((_entries[i].flags & ENTRY_USED) && strcmp(_entries[i].key, key) == 0){return i;}
+	}
+	return -1;
+}
+
+
+/*
+change a value in RAM and mark it for the next flush. Setting a key to the value it already has
+costs nothing
+
+input:
+	char ptr to the key
+	void ptr to the value
+	size_t length of the value
+output:
+	true on: value stored
+	false on: journal not started, key/value too long or no free key slot
+*/
+bool ESPHelperJournal::setValue(const char* key, const void* value, size_t length){
+	size_t keyLength = strlen(key);
+	if(!_started || keyLength == 0 || keyLength >= JOURNAL_KEY_LENGTH || length > JOURNAL_VALUE_SIZE){return false;}
+
+	int index = findEntry(key);
+	if(index >= 0){
+		journalEntry& entry = _entries[index];
+		if(!(entry.flags & ENTRY_DELETED) && entry.length == length && memcmp(entry.value, value, length) == 0){return true;}
+	}
+	else{
+		//use a free slot or one holding a key whose delete record is already on flash
+		for(int i = 0; i < JOURNAL_MAX_KEYS; i++){
+			uint8_t flags = _entries[i].flags;
+			if(!(flags & ENTRY_USED) || ((flags & ENTRY_DELETED) && !(flags & ENTRY_PENDING))){
+				index = i;
+				break;
+			}
+		}
+		if(index < 0){return false;}
+
+		memset(&_entries[index], 0, sizeof(journalEntry));
+		strcpy(_entries[index].key, key);
+		_entries[index].log = JOURNAL_NO_LOG;
+	}
+
+	journalEntry& entry = _entries[index];
+	memcpy(entry.value, value, length);
+	entry.length = length;
+	entry.flags = ENTRY_USED | ENTRY_PENDING;
+
+	_stats.bytesRequested += length;
+	if(!_pending){
+		_pending = true;
+		_pendingSince = millis();
+	}
+	return true;
+}
+
+
+bool ESPHelperJournal::getValue(const char* key, void* value, size_t length) const{
+	int index = findEntry(key);
+	if(index < 0){return false;}
+
+	const journalEntry& entry = _entries[index];
+	if((entry.flags & ENTRY_DELETED) || entry.length != length){return false;}
+	memcpy(value, entry.value, length);
+	return true;
+}
+
+
+/*
+read every valid record of a log into the key table. Reading stops at the first record that is
+cut short or fails its CRC (a write interrupted by a power cut)
+
+input:
+	uint8_t log to replay (0 or 1)
+	uint32_t reference updated with the highest sequence number seen
+	size_t reference set to the length of the valid part of the log
+output:
+	true on: the whole log was valid (or there is no log)
+	false on: the log ends in a torn or corrupt record
+*/
+bool ESPHelperJournal::replay(uint8_t log, uint32_t& maxSeq, size_t& validLength){
+	char path[sizeof(_path)];
+	logPath(log, path, sizeof(path));
+
+	validLength = 0;
+	File file = LittleFS.open(path, "r");
+	if(!file){return true;}
+
+	size_t size = file.size();
+	size_t position = 0;
+	bool clean = true;
+	uint8_t buf[JOURNAL_MAX_RECORD];
+	recordHeader header;
+
+	while(position < size){
+		if(size - position < sizeof(header) || file.read(buf, sizeof(header)) != sizeof(header)){
+			clean = false;
+			break;
+		}
+		memcpy(&header, buf, sizeof(header));
+
+		if(header.magic != JOURNAL_RECORD_MAGIC || header.keyLength == 0
+			|| header.keyLength >= JOURNAL_KEY_LENGTH || header.valueLength > JOURNAL_VALUE_SIZE){
+			clean = false;
+			break;
+		}
+
+		size_t dataLength = header.keyLength + header.valueLength;
+		size_t rest = dataLength + sizeof(uint32_t);
+		if(size - position - sizeof(header) < rest || file.read(buf + sizeof(header), rest) != rest){
+			clean = false;
+			break;
+		}
+
+		uint32_t crc;
+		memcpy(&crc, buf + sizeof(header) + dataLength, sizeof(crc));
+		if(ESPHelperConfigStore::crc32(buf, sizeof(header) + dataLength) != crc){
+			clean = false;
+			break;
+		}
+
+		char key[JOURNAL_KEY_LENGTH];
+		memcpy(key, buf + sizeof(header), header.keyLength);
+		key[header.keyLength] = '\0';
+		applyRecord(header, key, buf + sizeof(header) + header.keyLength, log);
+
+		if(header.seq > maxSeq){maxSeq = header.seq;}
+		position += sizeof(header) + rest;
+	}
+
+	file.close();
+	validLength = position;
+	if(!clean){_stats.badRecords++;}
+	return clean;
+}
+
+
+/*
+apply a replayed record to the key table if it is newer than what the table holds
+
+input:
+	recordHeader reference of the record
+	char ptr to the (terminated) key
+	uint8_t ptr to the value
+	uint8_t log the record was read from
+output: NA
+*/
+void ESPHelperJournal::applyRecord(const recordHeader& header, const char* key, const uint8_t* value, uint8_t log){
+	int index = findEntry(key);
+	if(index < 0){
+		for(int i = 0; i < JOURNAL_MAX_KEYS; i++){
+			if(!(_entries[i].flags & ENTRY_USED)){
+				index = i;
+				break;
+			}
+		}
+
+		//more keys on flash than JOURNAL_MAX_KEYS (ie the limit was lowered) - drop it
+		if(index < 0){
+			_stats.badRecords++;
+			return;
+		}
+		memset(&_entries[index], 0, sizeof(journalEntry));
+		strcpy(_entries[index].key, key);
+	}
+
+	journalEntry& entry = _entries[index];
+	if(header.seq <= entry.seq){return;}
+
+	memcpy(entry.value, value, header.valueLength);
+	entry.length = header.valueLength;
+	entry.flags = ENTRY_USED | ((header.flags & RECORD_DELETED) ? ENTRY_DELETED : 0);
+	entry.log = log;
+	entry.seq = header.seq;
+}
+
+
+/*
+append a record for every pending key to the active log (one file open for all of them).
+Switches to the other log first if the records don't fit
+
+input: NA
+output:
+	true on: nothing left to write
+	false on: the log could not be written
+*/
+bool ESPHelperJournal::appendPending(){
+	size_t needed = 0;
+	for(int i = 0; i < JOURNAL_MAX_KEYS; i++){
+		if(_entries[i].flags & ENTRY_PENDING){
+			needed += sizeof(recordHeader) + strlen(_entries[i].key) + _entries[i].length + sizeof(uint32_t);
+		}
+	}
+
+	if(needed == 0){
+		_pending = false;
+		return true;
+	}
+
+	if(_activeSize + needed > _logSize){startCompaction();}
+
+	char path[sizeof(_path)];
+	logPath(_activeLog, path, sizeof(path));
+	File file = LittleFS.open(path, "a");
+	if(!file){return false;}
+
+	size_t startSize = _activeSize;
+
+	bool written = true;
+	for(int i = 0; i < JOURNAL_MAX_KEYS; i++){
+		if(_entries[i].flags & ENTRY_PENDING){
+			written = writeRecord(file, _entries[i], _activeLog) > 0 && written;
+		}
+	}
+	file.close();
+	countProgrammed(startSize, _activeSize - startSize);
+
+	_stats.flushes++;
+	_pending = !written;
+	return written;
+}
+
+
+/*
+copy up to maxEntries keys whose newest record is still in the old log to the active log. Once
+every key has been copied the old log is removed and the compaction is done
+
+input:
+	int max number of keys to copy
+output:
+	true on: compaction finished (or none was running)
+	false on: keys are left to copy
+*/
+bool ESPHelperJournal::compactStep(int maxEntries){
+	if(!_compacting){return true;}
+
+	char path[sizeof(_path)];
+	logPath(_activeLog, path, sizeof(path));
+	File file;
+	size_t startSize = _activeSize;
+
+	bool remaining = false;
+	int copied = 0;
+	for(int i = 0; i < JOURNAL_MAX_KEYS; i++){
+		journalEntry& entry = _entries[i];
+		if(!(entry.flags & ENTRY_USED) || entry.log == _activeLog){continue;}
+
+		//a delete record that is already in the old log goes away together with the value it deletes.
+		//A pending delete is written below like any other change - the old log still holds the value
+		//and a restart before it is removed would bring the key back
+		if((entry.flags & ENTRY_DELETED) && !(entry.flags & ENTRY_PENDING)){
+			entry.flags = 0;
+			continue;
+		}
+
+		if(copied == maxEntries){
+			remaining = true;
+			break;
+		}
+
+		if(!file){
+			file = LittleFS.open(path, "a");
+			if(!file){return false;}
+		}
+
+		//a pending change is copied with its new value, which also takes care of writing it
+		if(writeRecord(file, entry, _activeLog) == 0){remaining = true;}
+		copied++;
+	}
+	if(file){
+		file.close();
+		countProgrammed(startSize, _activeSize - startSize);
+	}
+
+	if(remaining){return false;}
+
+	logPath(_activeLog ^ 1, path, sizeof(path));
+	if(LittleFS.exists(path) && LittleFS.remove(path)){_stats.bytesProgrammed += _pageSize;}
+
+	_compacting = false;
+	_stats.compactions++;
+	return true;
+}
+
+
+/*
+write every live key to a fresh copy of the active log and replace the log (and the old log if a
+compaction was running) with it
+
+input: NA
+output:
+	true on: log rewritten
+	false on: the new log could not be written
+*/
+bool ESPHelperJournal::rewriteLog(){
+	char path[sizeof(_path)];
+	char tmpPath[sizeof(_path) + 4];
+	logPath(_activeLog, path, sizeof(path));
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", _path);
+
+	File file = LittleFS.open(tmpPath, "w");
+	if(!file){return false;}
+	_stats.bytesProgrammed += _pageSize;
+
+	//deleted keys are rewritten as delete records too: the old log is only removed after the
+	//rename and may still hold their values
+	size_t previousSize = _activeSize;
+	_activeSize = 0;
+	bool written = true;
+	for(int i = 0; i < JOURNAL_MAX_KEYS; i++){
+		journalEntry& entry = _entries[i];
+		if(!(entry.flags & ENTRY_USED)){continue;}
+		written = writeRecord(file, entry, _activeLog) > 0 && written;
+	}
+	file.close();
+	countProgrammed(0, _activeSize);
+
+	if(!written || (!LittleFS.rename(tmpPath, path) && !(LittleFS.remove(path) && LittleFS.rename(tmpPath, path)))){
+		LittleFS.remove(tmpPath);
+		_activeSize = previousSize;
+		return false;
+	}
+
+	_stats.bytesProgrammed += _pageSize;
+
+	//every live key is in the new log now
+	logPath(_activeLog ^ 1, path, sizeof(path));
+	if(LittleFS.exists(path) && LittleFS.remove(path)){_stats.bytesProgrammed += _pageSize;}
+	_compacting = false;
+	_stats.compactions++;
+	return true;
+}
+
+
+/*
+append a single record for an entry
+
+input:
+	File reference to the open log
+	journalEntry reference to write (its pending flag is cleared)
+	uint8_t log the file belongs to
+output:
+	size_t number of bytes written (0 on failure)
+*/
+size_t ESPHelperJournal::writeRecord(File& file, journalEntry& entry, uint8_t log){
+	uint8_t buf[JOURNAL_MAX_RECORD];
+
+	recordHeader header;
+	header.magic = JOURNAL_RECORD_MAGIC;
+	header.keyLength = strlen(entry.key);
+	header.valueLength = entry.length;
+	header.flags = (entry.flags & ENTRY_DELETED) ? RECORD_DELETED : 0;
+	header.seq = _seq;
+
+	size_t length = sizeof(header);
+	memcpy(buf, &header, sizeof(header));
+	memcpy(buf + length, entry.key, header.keyLength);
+	length += header.keyLength;
+	memcpy(buf + length, entry.value, header.valueLength);
+	length += header.valueLength;
+
+	uint32_t crc = ESPHelperConfigStore::crc32(buf, length);
+	memcpy(buf + length, &crc, sizeof(crc));
+	length += sizeof(crc);
+
+	if(file.write(buf, length) != length){return 0;}
+
+	_seq++;
+	entry.flags &= ~ENTRY_PENDING;
+	entry.log = log;
+	entry.seq = header.seq;
+
+	_activeSize += length;
+	_stats.bytesWritten += length;
+	_stats.records++;
+	return length;
+}
+
+
+/*
+switch appends to the other log. A compaction that is still running is finished first since the
+other log is the one it is copying from
+
+input: NA
+output: NA
+*/
+void ESPHelperJournal::startCompaction(){
+	//keep appending to the current log rather than lose keys still waiting to be copied
+	if(_compacting && !compactStep(JOURNAL_MAX_KEYS)){return;}
+
+	_activeLog ^= 1;
+	_activeSize = 0;
+
+	char path[sizeof(_path)];
+	logPath(_activeLog, path, sizeof(path));
+	if(LittleFS.exists(path) && LittleFS.remove(path)){_stats.bytesProgrammed += _pageSize;}
+
+	_compacting = true;
+}
+
+
+void ESPHelperJournal::logPath(uint8_t log, char* buf, size_t len) const{
+	snprintf(buf, len, "%s.%u", _path, log);
+}
+
+
+
+/*
+add what littlefs programs for one open/write/close of a log to the stats. Files are stored
+copy-on-write, so the first write after a file is opened copies its partly filled last block to a
+fresh block before the new data goes in, and the close commits the new file size and block list
+to the metadata (at least one page)
+
+input:
+	size_t size of the file when it was opened
+	size_t bytes written before it was closed
+output: NA
+*/
+void ESPHelperJournal::countProgrammed(size_t fileSize, size_t written){
+	if(written == 0){return;}
+	_stats.bytesProgrammed += fileSize % _blockSize + written + _pageSize;
+}
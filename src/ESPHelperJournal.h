@@ -0,0 +1,184 @@
+/*
+    ESPHelperJournal.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef ESPHELPER_JOURNAL_H
+#define ESPHELPER_JOURNAL_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include "ESPHelperConfigStore.h"
+
+
+//the two logs are stored as <path>.0 and <path>.1
+#define DEFAULT_JOURNAL_PATH "/state"
+
+//max number of keys tracked by a journal
+#ifndef JOURNAL_MAX_KEYS
+#define JOURNAL_MAX_KEYS 32
+#endif
+
+//max key length (including the terminator)
+#ifndef JOURNAL_KEY_LENGTH
+#define JOURNAL_KEY_LENGTH 16
+#endif
+
+//max value size in bytes
+#ifndef JOURNAL_VALUE_SIZE
+#define JOURNAL_VALUE_SIZE 16
+#endif
+
+//default time (ms) changes are held in RAM so that repeated changes to a key cost one record
+#define DEFAULT_JOURNAL_WINDOW 2000
+
+//default size (bytes) a log may grow to before the journal switches to the other log and compacts
+#define DEFAULT_JOURNAL_LOG_SIZE 4096
+
+//number of keys copied to the new log per handle() call while compacting
+#define JOURNAL_COMPACT_STEP 4
+
+#define JOURNAL_RECORD_MAGIC 0xA5
+
+//littlefs geometry used to estimate what a write costs on flash. ESP8266 reads it from
+//LittleFS.info() in begin(), these are the ESP32 defaults
+#ifndef JOURNAL_FLASH_BLOCK_SIZE
+#define JOURNAL_FLASH_BLOCK_SIZE 4096
+#endif
+#ifndef JOURNAL_FLASH_PAGE_SIZE
+#define JOURNAL_FLASH_PAGE_SIZE 256
+#endif
+
+static_assert(JOURNAL_KEY_LENGTH <= 256 && JOURNAL_VALUE_SIZE <= 255, "journal keys and values must fit the 8 bit record lengths");
+
+
+//journal counters. Write amplification is bytesProgrammed / bytesRequested
+struct journalStats {
+	uint32_t bytesRequested = 0;	//value bytes of every change made through set*()/remove()
+	uint32_t bytesWritten = 0;		//bytes appended to the logs (records, headers, CRCs and compaction copies)
+	uint32_t bytesProgrammed = 0;	//estimated bytes littlefs programs for those writes (see countProgrammed())
+	uint32_t records = 0;			//records appended
+	uint32_t flushes = 0;			//log appends (one file open per flush)
+	uint32_t compactions = 0;		//completed log switches
+	uint32_t badRecords = 0;		//corrupt or torn records skipped during recovery
+};
+
+
+/*
+Journaled storage for small, frequently changing state (relay positions, counters, ...).
+
+Changes are kept in RAM and appended to a log file as small delta records (sequence number, key,
+value and a CRC). Changes made within the coalescing window only cost one record per key, and
+the file is only opened once per flush. When the active log is full the journal switches to the
+other log and copies the live keys over a few at a time from handle(), then removes the old log.
+At boot both logs are replayed and the record with the highest sequence number wins for each
+key, so a power cut at any point (including mid record) only loses the changes that were still
+waiting for the window to close.
+*/
+class ESPHelperJournal {
+
+public:
+	ESPHelperJournal();
+	~ESPHelperJournal();
+
+	ESPHelperJournal(const ESPHelperJournal& other) = delete;
+	ESPHelperJournal& operator=(const ESPHelperJournal& other) = delete;
+
+	bool begin(const char* path = DEFAULT_JOURNAL_PATH, uint32_t window = DEFAULT_JOURNAL_WINDOW, size_t logSize = DEFAULT_JOURNAL_LOG_SIZE);
+	void end();
+
+	bool handle();
+	bool flush();
+
+	bool has(const char* key) const;
+	bool remove(const char* key);
+
+	bool setInt(const char* key, int32_t value);
+	bool setFloat(const char* key, float value);
+	bool setBool(const char* key, bool value);
+	bool setBlob(const char* key, const void* value, size_t length);
+
+	int32_t getInt(const char* key, int32_t defaultValue = 0) const;
+	float getFloat(const char* key, float defaultValue = 0) const;
+	bool getBool(const char* key, bool defaultValue = false) const;
+	const uint8_t* getBlob(const char* key, size_t* length) const;
+
+	bool isPending() const { return _pending; }
+	bool isCompacting() const { return _compacting; }
+
+	const journalStats& getStats() const { return _stats; }
+	float getWriteAmplification() const;
+
+private:
+
+	struct recordHeader {
+		uint8_t magic;
+		uint8_t keyLength;
+		uint8_t valueLength;
+		uint8_t flags;
+		uint32_t seq;
+	};	//followed by the key (no terminator), the value and a CRC32 of everything before it
+
+	struct journalEntry {
+		char key[JOURNAL_KEY_LENGTH];
+		uint8_t value[JOURNAL_VALUE_SIZE];
+		uint8_t length;
+		uint8_t flags;
+		uint8_t log;		//log holding the latest record for this key
+		uint32_t seq;		//sequence number of that record
+	};
+
+	int findEntry(const char* key) const;
+	bool setValue(const char* key, const void* value, size_t length);
+	bool getValue(const char* key, void* value, size_t length) const;
+
+	bool replay(uint8_t log, uint32_t& maxSeq, size_t& validLength);
+	void applyRecord(const recordHeader& header, const char* key, const uint8_t* value, uint8_t log);
+	bool appendPending();
+	bool compactStep(int maxEntries);
+	bool rewriteLog();
+	size_t writeRecord(File& file, journalEntry& entry, uint8_t log);
+	void startCompaction();
+	void logPath(uint8_t log, char* buf, size_t len) const;
+	void countProgrammed(size_t fileSize, size_t written);
+
+	journalEntry _entries[JOURNAL_MAX_KEYS];
+
+	char _path[32];
+	uint32_t _window = DEFAULT_JOURNAL_WINDOW;
+	size_t _logSize = DEFAULT_JOURNAL_LOG_SIZE;
+	size_t _blockSize = JOURNAL_FLASH_BLOCK_SIZE;
+	size_t _pageSize = JOURNAL_FLASH_PAGE_SIZE;
+
+	uint8_t _activeLog = 0;
+	size_t _activeSize = 0;
+	uint32_t _seq = 0;
+
+	bool _pending = false;
+	unsigned long _pendingSince = 0;
+	bool _compacting = false;
+	bool _started = false;
+
+	journalStats _stats;
+};
+
+#endif
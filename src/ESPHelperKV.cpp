@@ -0,0 +1,785 @@
+/*
+    ESPHelperKV.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "ESPHelperKV.h"
+#include <new>
+#include <math.h>
+
+
+//bytes a record takes in the data area besides the key and value themselves
+//(key length, key terminator, value length, value terminator)
+#define KV_RECORD_OVERHEAD 5
+
+//largest int/float/bool/blob value setFromString() parses (blobs are given as hex)
+#define KV_MAX_PARSED_LENGTH 128
+
+//slot offset used for removed keys
+#define KV_NO_OFFSET 0xFFFF
+
+
+ESPHelperKV::ESPHelperKV(){
+	_path[0] = '\0';
+}
+
+ESPHelperKV::~ESPHelperKV(){
+	end();
+}
+
+
+/*
+allocate the store and load it from flash (the filesystem must already be mounted)
+
+input:
+	char ptr to the path of the store file
+output:
+	true on: store ready (loaded from flash or, if there was no valid file, empty)
+	false on: could not allocate the store
+*/
+bool ESPHelperKV::begin(const char* path){
+	end();
+
+	_image = new (std::nothrow) kvImage;
+	if(_image == nullptr){return false;}
+
+	strncpy(_path, path, sizeof(_path) - 1);
+	_path[sizeof(_path) - 1] = '\0';
+
+	clear();
+	_dirty = false;
+
+	File file = LittleFS.open(_path, "r");
+	if(!file){return true;}
+
+	//the file is the in-memory image (minus the unused tail of the data area) so a single read loads it
+	size_t size = file.size();
+	bool loaded = size >= sizeof(kvHeader) + sizeof(_image->slots) && size <= sizeof(kvImage)
+		&& file.read((uint8_t*)_image, size) == size;
+	file.close();
+
+	const kvHeader& header = _image->header;
+	loaded = loaded
+		&& header.magic == KV_MAGIC
+		&& header.version == KV_VERSION
+		&& header.slots == KV_INDEX_SLOTS
+		&& sizeof(kvHeader) + sizeof(_image->slots) + header.dataUsed == size
+		&& ESPHelperConfigStore::crc32(_image->slots, sizeof(_image->slots) + header.dataUsed) == header.crc;
+
+	//missing, corrupt or from a build with a different layout - start with an empty store
+	if(!loaded){
+		clear();
+		_dirty = false;
+	}
+	return true;
+}
+
+
+/*
+release the store (uncommitted changes are lost)
+
+input: NA
+output: NA
+*/
+void ESPHelperKV::end(){
+	if(_image != nullptr){
+		delete _image;
+		_image = nullptr;
+	}
+	_dirty = false;
+}
+
+
+/*
+write the store to flash if anything changed (atomic - see ESPHelperConfigStore::writeAtomic)
+
+input: NA
+output:
+	true on: store saved (or nothing to save)
+	false on: write failed
+*/
+bool ESPHelperKV::commit(){
+	if(_image == nullptr){return false;}
+	if(!_dirty){return true;}
+
+	kvHeader& header = _image->header;
+	header.crc = ESPHelperConfigStore::crc32(_image->slots, sizeof(_image->slots) + header.dataUsed);
+
+	bool saved = ESPHelperConfigStore::writeAtomic(_path, _image, sizeof(kvHeader) + sizeof(_image->slots) + header.dataUsed, nullptr, 0);
+	if(saved){_dirty = false;}
+	return saved;
+}
+
+
+/*
+remove every key
+
+input: NA
+output: NA
+*/
+void ESPHelperKV::clear(){
+	if(_image == nullptr){return;}
+
+	memset(&_image->header, 0, sizeof(_image->header));
+	memset(_image->slots, 0, sizeof(_image->slots));
+	_image->header.magic = KV_MAGIC;
+	_image->header.version = KV_VERSION;
+	_image->header.slots = KV_INDEX_SLOTS;
+	_dirty = true;
+}
+
+
+/*
+check whether a key exists
+
+input:
+	char ptr to the key
+output:
+	true on: key exists
+	false on: key not found
+*/
+bool ESPHelperKV::has(const char* key) const{
+	return findSlot(key, hashKey(key)) >= 0;
+}
+
+
+/*
+get the type of the value stored under a key
+
+input:
+	char ptr to the key
+output:
+	kvType of the value (KV_NONE if the key does not exist)
+*/
+kvType ESPHelperKV::getType(const char* key) const{
+	int slot = findSlot(key, hashKey(key));
+	if(slot < 0){return KV_NONE;}
+	return (kvType)_image->slots[slot].type;
+}
+
+
+/*
+remove a key (the space it used is reclaimed the next time the data area is compacted)
+
+input:
+	char ptr to the key
+output:
+	true on: key removed
+	false on: key not found
+*/
+bool ESPHelperKV::remove(const char* key){
+	int slot = findSlot(key, hashKey(key));
+	if(slot < 0){return false;}
+
+	//leave the hash in place as a tombstone so that probing continues past this slot
+	_image->slots[slot].type = KV_NONE;
+	_image->slots[slot].offset = KV_NO_OFFSET;
+	_dirty = true;
+	return true;
+}
+
+
+bool ESPHelperKV::setInt(const char* key, int32_t value){
+	return setValue(key, KV_INT, &value, sizeof(value));
+}
+
+bool ESPHelperKV::setFloat(const char* key, float value){
+	return setValue(key, KV_FLOAT, &value, sizeof(value));
+}
+
+bool ESPHelperKV::setBool(const char* key, bool value){
+	uint8_t byteValue = value ? 1 : 0;
+	return setValue(key, KV_BOOL, &byteValue, sizeof(byteValue));
+}
+
+bool ESPHelperKV::setString(const char* key, const char* value){
+	if(value == nullptr){value = "";}
+	return setValue(key, KV_STRING, value, strlen(value));
+}
+
+bool ESPHelperKV::setBlob(const char* key, const void* value, size_t length){
+	return setValue(key, KV_BLOB, value, length);
+}
+
+
+int32_t ESPHelperKV::getInt(const char* key, int32_t defaultValue) const{
+	const uint8_t* value = getValue(key, KV_INT, nullptr);
+	if(value == nullptr){return defaultValue;}
+	int32_t result;
+	memcpy(&result, value, sizeof(result));
+	return result;
+}
+
+float ESPHelperKV::getFloat(const char* key, float defaultValue) const{
+	const uint8_t* value = getValue(key, KV_FLOAT, nullptr);
+	if(value == nullptr){return defaultValue;}
+	float result;
+	memcpy(&result, value, sizeof(result));
+	return result;
+}
+
+bool ESPHelperKV::getBool(const char* key, bool defaultValue) const{
+	const uint8_t* value = getValue(key, KV_BOOL, nullptr);
+	if(value == nullptr){return defaultValue;}
+	return value[0] != 0;
+}
+
+const char* ESPHelperKV::getString(const char* key, const char* defaultValue) const{
+	const uint8_t* value = getValue(key, KV_STRING, nullptr);
+	if(value == nullptr){return defaultValue;}
+	return (const char*)value;
+}
+
+const uint8_t* ESPHelperKV::getBlob(const char* key, size_t* length) const{
+	return getValue(key, KV_BLOB, length);
+}
+
+
+/*
+set a key from its text form (used by the web config page and MQTT). Existing keys keep their type,
+new keys are created with the given type
+
+input:
+	char ptr to the key
+	char ptr to the value as text (blobs as hex)
+	kvType type to use if the key does not exist yet
+output:
+	true on: value parsed and stored
+	false on: value could not be parsed as the key's type or the store is full
+*/
+bool ESPHelperKV::setFromString(const char* key, const char* value, kvType newType){
+	kvType type = getType(key);
+	if(type == KV_NONE){type = newType;}
+	if(type == KV_STRING || type == KV_NONE){return setString(key, value);}
+
+	uint8_t parsed[KV_MAX_PARSED_LENGTH];
+	size_t length;
+	if(!parseString(value, type, parsed, &length)){return false;}
+	return setValue(key, type, parsed, length);
+}
+
+
+/*
+check what setFromString() would do with a value without changing anything
+
+input:
+	char ptr to the key
+	char ptr to the value as text (blobs as hex)
+	kvType type to use if the key does not exist yet
+	size_t ptr set to the length the value would be stored with (nullptr if not needed)
+output:
+	true on: the value parses as the key's type
+	false on: it doesn't (or the key is empty or too long)
+*/
+bool ESPHelperKV::checkFromString(const char* key, const char* value, kvType newType, size_t* length) const{
+	size_t keyLength = strlen(key);
+	if(keyLength == 0 || keyLength > KV_MAX_KEY_LENGTH){return false;}
+
+	kvType type = getType(key);
+	if(type == KV_NONE){type = newType;}
+	if(type == KV_STRING || type == KV_NONE){
+		if(length != nullptr){*length = strlen(value);}
+		return strlen(value) <= 0xFFFF;
+	}
+
+	uint8_t parsed[KV_MAX_PARSED_LENGTH];
+	size_t parsedLength;
+	if(!parseString(value, type, parsed, &parsedLength)){return false;}
+	if(length != nullptr){*length = parsedLength;}
+	return true;
+}
+
+
+/*
+check whether more keys and values would fit in the store once its data area is compacted
+
+input:
+	size_t number of keys that don't exist yet
+	size_t bytes of the records that would be added (see recordLength())
+output:
+	true on: they fit
+	false on: the index or the data area would run out
+*/
+bool ESPHelperKV::fits(size_t newKeys, size_t recordBytes) const{
+	if(_image == nullptr){return false;}
+
+	//one index slot always stays empty so that probing ends
+	if(count() + newKeys > KV_INDEX_SLOTS - 1){return false;}
+
+	size_t live = 0;
+	for(int i = 0; i < KV_INDEX_SLOTS; i++){
+		if(_image->slots[i].hash != 0 && _image->slots[i].type != KV_NONE){live += recordSize(_image->slots[i].offset);}
+	}
+	return live + recordBytes <= KV_DATA_SIZE;
+}
+
+
+/*
+bytes a key/value record takes in the data area
+
+input:
+	char ptr to the key
+	size_t length of the value
+output:
+	size_t record length
+*/
+size_t ESPHelperKV::recordLength(const char* key, size_t valueLength){
+	return KV_RECORD_OVERHEAD + strlen(key) + valueLength;
+}
+
+
+/*
+print a single value as plain text
+
+input:
+	char ptr to the key
+	Print reference to write to
+output:
+	size_t number of bytes printed (0 if the key does not exist)
+*/
+size_t ESPHelperKV::printValue(const char* key, Print& out) const{
+	int slot = findSlot(key, hashKey(key));
+	if(slot < 0){return 0;}
+	return printRecordValue(slot, out);
+}
+
+
+/*
+print every key as a JSON object (keys and strings are escaped, blobs are printed as hex strings
+and floats that are NaN or infinite as null)
+
+input:
+	Print reference to write to
+output:
+	size_t number of bytes printed
+*/
+size_t ESPHelperKV::printJson(Print& out) const{
+	size_t printed = out.print("{");
+	if(_image == nullptr){return printed + out.print("}");}
+
+	bool first = true;
+	for(int i = 0; i < KV_INDEX_SLOTS; i++){
+		const kvSlot& slot = _image->slots[i];
+		if(slot.hash == 0 || slot.type == KV_NONE){continue;}
+
+		if(!first){printed += out.print(",");}
+		first = false;
+
+		//keys can hold anything a topic can (they arrive as <base>/set/<key>) so they are escaped too
+		const char* key = (const char*)&_image->data[slot.offset + 1];
+		printed += printJsonString(key, _image->data[slot.offset], out);
+		printed += out.print(":");
+
+		if(slot.type == KV_STRING){
+			size_t length;
+			const char* value = (const char*)getValue(key, KV_STRING, &length);
+			printed += printJsonString(value, length, out);
+		}
+		else if(slot.type == KV_BLOB){
+			printed += out.print("\"");
+			printed += printRecordValue(i, out);
+			printed += out.print("\"");
+		}
+		else if(slot.type == KV_FLOAT && !isfinite(getFloat(key))){
+			//JSON has no NaN or Infinity
+			printed += out.print("null");
+		}
+		else{printed += printRecordValue(i, out);}
+	}
+
+	return printed + out.print("}");
+}
+
+
+/*
+number of keys in the store
+
+input: NA
+output:
+	size_t key count
+*/
+size_t ESPHelperKV::count() const{
+	if(_image == nullptr){return 0;}
+	size_t keys = 0;
+	for(int i = 0; i < KV_INDEX_SLOTS; i++){
+		if(_image->slots[i].hash != 0 && _image->slots[i].type != KV_NONE){keys++;}
+	}
+	return keys;
+}
+
+
+/*
+bytes left in the data area (not counting space a compaction would reclaim)
+
+input: NA
+output:
+	size_t free bytes
+*/
+size_t ESPHelperKV::getFreeSpace() const{
+	if(_image == nullptr){return 0;}
+	return KV_DATA_SIZE - _image->header.dataUsed;
+}
+
+
+/*
+parse the text form of an int, float, bool or blob value into the bytes it is stored as
+
+input:
+	char ptr to the value as text (blobs as hex)
+	kvType to parse it as
+	uint8_t ptr to KV_MAX_PARSED_LENGTH bytes for the result
+	size_t ptr set to the length of the result
+output:
+	true on: value parsed
+	false on: the text is not a value of that type
+*/
+bool ESPHelperKV::parseString(const char* value, kvType type, uint8_t* parsed, size_t* length){
+	char* end = nullptr;
+	switch(type){
+		case KV_INT: {
+			int32_t result = strtol(value, &end, 0);
+			if(end == value || *end != '\0'){return false;}
+			memcpy(parsed, &result, sizeof(result));
+			*length = sizeof(result);
+			return true;
+		}
+		case KV_FLOAT: {
+			float result = strtof(value, &end);
+			if(end == value || *end != '\0'){return false;}
+			memcpy(parsed, &result, sizeof(result));
+			*length = sizeof(result);
+			return true;
+		}
+		case KV_BOOL:
+			if(strcmp(value, "1") == 0 || strcasecmp(value, "true") == 0 || strcasecmp(value, "on") == 0){parsed[0] = 1;}
+			else if(strcmp(value, "0") == 0 || strcasecmp(value, "false") == 0 || strcasecmp(value, "off") == 0){parsed[0] = 0;}
+			else{return false;}
+			*length = 1;
+			return true;
+		case KV_BLOB: {
+			size_t len = strlen(value);
+			if(len % 2 != 0 || len / 2 > KV_MAX_PARSED_LENGTH){return false;}
+			for(size_t i = 0; i < len / 2; i++){
+				char hex[3] = {value[i * 2], value[i * 2 + 1], '\0'};
+				parsed[i] = (uint8_t)strtoul(hex, &end, 16);
+				if(*end != '\0'){return false;}
+			}
+			*length = len / 2;
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
+
+/*
+32 bit FNV-1a hash of a key (0 is reserved for empty slots)
+
+input:
+	char ptr to the key
+output:
+	uint32_t hash
+*/
+uint32_t ESPHelperKV::hashKey(const char* key){
+	uint32_t hash = 2166136261UL;
+	while(*key){
+		hash ^= (uint8_t)*key++;
+		hash *= 16777619UL;
+	}
+	return hash == 0 ? 1 : hash;
+}
+
+
+/*
+find the index slot holding a key
+
+input:
+	char ptr to the key
+	uint32_t hash of the key
+output:
+	int slot index (-1 if the key does not exist)
+*/
+int ESPHelperKV::findSlot(const char* key, uint32_t hash) const{
+	if(_image == nullptr){return -1;}
+
+	for(int probe = 0; probe < KV_INDEX_SLOTS; probe++){
+		int i = (hash + probe) & (KV_INDEX_SLOTS - 1);
+		const kvSlot& slot = _image->slots[i];
+
+		if(slot.hash == 0){return -1;}
+		if(slot.hash == hash && slot.type != KV_NONE && recordKeyMatches(slot.offset, key)){return i;}
+	}
+	return -1;
+}
+
+
+/*
+find a slot a new key can be placed in (empty or removed). One slot is always kept empty so that
+lookups of missing keys terminate
+
+input:
+	uint32_t hash of the key
+output:
+	int slot index (-1 if the index is full)
+*/
+int ESPHelperKV::findFreeSlot(uint32_t hash) const{
+	int empty = 0;
+	for(int i = 0; i < KV_INDEX_SLOTS; i++){
+		if(_image->slots[i].hash == 0){empty++;}
+	}
+
+	for(int probe = 0; probe < KV_INDEX_SLOTS; probe++){
+		int i = (hash + probe) & (KV_INDEX_SLOTS - 1);
+		const kvSlot& slot = _image->slots[i];
+
+		if(slot.type == KV_NONE && slot.hash != 0){return i;}
+		if(slot.hash == 0){return empty > 1 ? i : -1;}
+	}
+	return -1;
+}
+
+
+bool ESPHelperKV::recordKeyMatches(uint16_t offset, const char* key) const{
+	return strcmp((const char*)&_image->data[offset + 1], key) == 0;
+}
+
+
+/*
+total size of the record at an offset in the data area
+
+input:
+	uint16_t offset of the record
+output:
+	size_t record size in bytes
+*/
+size_t ESPHelperKV::recordSize(uint16_t offset) const{
+	uint8_t keyLength = _image->data[offset];
+	uint16_t valueLength;
+	memcpy(&valueLength, &_image->data[offset + keyLength + 2], sizeof(valueLength));
+	return KV_RECORD_OVERHEAD + keyLength + valueLength;
+}
+
+
+/*
+locate the value of a key with the expected type
+
+input:
+	char ptr to the key
+	kvType expected type
+	size_t ptr filled with the value length (can be nullptr)
+output:
+	uint8_t ptr to the value (nullptr if the key does not exist or has another type)
+*/
+const uint8_t* ESPHelperKV::getValue(const char* key, kvType type, size_t* length) const{
+	int slot = findSlot(key, hashKey(key));
+	if(slot < 0 || _image->slots[slot].type != type){return nullptr;}
+
+	uint16_t offset = _image->slots[slot].offset;
+	uint8_t keyLength = _image->data[offset];
+	uint16_t valueLength;
+	memcpy(&valueLength, &_image->data[offset + keyLength + 2], sizeof(valueLength));
+
+	if(length != nullptr){*length = valueLength;}
+	return &_image->data[offset + keyLength + 4];
+}
+
+
+/*
+store a value under a key. Values that keep their size are overwritten in place, anything else is
+appended to the data area (compacting it first if it is full)
+
+input:
+	char ptr to the key
+	kvType type of the value
+	void ptr to the value
+	size_t length of the value
+output:
+	true on: value stored
+	false on: invalid key, index full or not enough space
+*/
+bool ESPHelperKV::setValue(const char* key, kvType type, const void* value, size_t length){
+	if(_image == nullptr || key == nullptr){return false;}
+
+	size_t keyLength = strlen(key);
+	if(keyLength == 0 || keyLength > KV_MAX_KEY_LENGTH || length > 0xFFFF){return false;}
+
+	uint32_t hash = hashKey(key);
+	int slot = findSlot(key, hash);
+	kvHeader& header = _image->header;
+
+	//same size as before - overwrite in place
+	if(slot >= 0){
+		uint16_t offset = _image->slots[slot].offset;
+		uint16_t oldLength;
+		memcpy(&oldLength, &_image->data[offset + keyLength + 2], sizeof(oldLength));
+		if(oldLength == length){
+			uint8_t* dest = &_image->data[offset + keyLength + 4];
+			if(_image->slots[slot].type == type && memcmp(dest, value, length) == 0){return true;}
+			memcpy(dest, value, length);
+			_image->slots[slot].type = type;
+			_dirty = true;
+			return true;
+		}
+	}
+	else{
+		slot = findFreeSlot(hash);
+		if(slot < 0){return false;}
+	}
+
+	size_t need = KV_RECORD_OVERHEAD + keyLength + length;
+	if(header.dataUsed + need > KV_DATA_SIZE){
+		compact();
+
+		if(header.dataUsed + need > KV_DATA_SIZE){
+			//the only other space to get back is the old copy of this value
+			bool existing = _image->slots[slot].type != KV_NONE && _image->slots[slot].hash == hash;
+			if(!existing || header.dataUsed - recordSize(_image->slots[slot].offset) + need > KV_DATA_SIZE){return false;}
+
+			_image->slots[slot].type = KV_NONE;
+			_image->slots[slot].offset = KV_NO_OFFSET;
+			compact();
+		}
+	}
+
+	//append the new record
+	uint16_t offset = header.dataUsed;
+	uint8_t* rec = &_image->data[offset];
+	uint16_t valueLength = length;
+	rec[0] = keyLength;
+	memcpy(rec + 1, key, keyLength + 1);
+	memcpy(rec + keyLength + 2, &valueLength, sizeof(valueLength));
+	if(length > 0){memcpy(rec + keyLength + 4, value, length);}
+	rec[keyLength + 4 + length] = '\0';
+	header.dataUsed += need;
+
+	_image->slots[slot].hash = hash;
+	_image->slots[slot].offset = offset;
+	_image->slots[slot].type = type;
+	_dirty = true;
+	return true;
+}
+
+
+/*
+squeeze out records that are no longer referenced by the index (replaced or removed values).
+Records only ever move towards the start so this works in place
+
+input: NA
+output: NA
+*/
+void ESPHelperKV::compact(){
+	kvHeader& header = _image->header;
+	uint16_t readPos = 0;
+	uint16_t writePos = 0;
+
+	while(readPos < header.dataUsed){
+		size_t size = recordSize(readPos);
+		const char* key = (const char*)&_image->data[readPos + 1];
+		int slot = findSlot(key, hashKey(key));
+
+		if(slot >= 0 && _image->slots[slot].offset == readPos){
+			if(writePos != readPos){
+				memmove(&_image->data[writePos], &_image->data[readPos], size);
+				_image->slots[slot].offset = writePos;
+			}
+			writePos += size;
+		}
+		readPos += size;
+	}
+
+	if(header.dataUsed != writePos){_dirty = true;}
+	header.dataUsed = writePos;
+}
+
+
+/*
+print the value of the record referenced by a slot as plain text
+
+input:
+	int slot index
+	Print reference to write to
+output:
+	size_t number of bytes printed
+*/
+size_t ESPHelperKV::printRecordValue(int slot, Print& out) const{
+	uint16_t offset = _image->slots[slot].offset;
+	uint8_t keyLength = _image->data[offset];
+	uint16_t valueLength;
+	memcpy(&valueLength, &_image->data[offset + keyLength + 2], sizeof(valueLength));
+	const uint8_t* value = &_image->data[offset + keyLength + 4];
+
+	switch(_image->slots[slot].type){
+		case KV_INT: {
+			int32_t v;
+			memcpy(&v, value, sizeof(v));
+			return out.print((long)v);
+		}
+		case KV_FLOAT: {
+			//not print(v, 6): the core prints "ovf" past 2^32, which isn't a number
+			float v;
+			memcpy(&v, value, sizeof(v));
+			char text[16];
+			snprintf(text, sizeof(text), "%.6g", (double)v);
+			return out.print(text);
+		}
+		case KV_BOOL:
+			return out.print(value[0] ? "true" : "false");
+		case KV_STRING:
+			return out.write(value, valueLength);
+		case KV_BLOB: {
+			size_t printed = 0;
+			for(uint16_t i = 0; i < valueLength; i++){
+				char hex[3];
+				snprintf(hex, sizeof(hex), "%02x", value[i]);
+				printed += out.print(hex);
+			}
+			return printed;
+		}
+		default:
+			return 0;
+	}
+}
+
+
+/*
+print a string as a quoted and escaped JSON string
+
+input:
+	char ptr to the string
+	size_t length of the string
+	Print reference to write to
+output:
+	size_t number of bytes printed
+*/
+size_t ESPHelperKV::printJsonString(const char* str, size_t length, Print& out){
+	size_t printed = out.print("\"");
+	for(size_t c = 0; c < length; c++){
+		char ch = str[c];
+		if(ch == '"' || ch == '\\'){printed += out.print("\\"); printed += out.write((uint8_t)ch);}
+		else if((uint8_t)ch < 0x20){
+			char escaped[7];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+			printed += out.print(escaped);
+		}
+		else{printed += out.write((uint8_t)ch);}
+	}
+	return printed + out.print("\"");
+}
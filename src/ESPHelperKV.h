@@ -0,0 +1,149 @@
+/*
+    ESPHelperKV.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef ESPHELPER_KV_H
+#define ESPHELPER_KV_H
+
+#include <Arduino.h>
+
+#include "ESPHelperConfigStore.h"
+
+
+#define DEFAULT_KV_PATH "/keys.bin"
+
+//number of hash index slots (must be a power of 2). Keep the number of keys below ~75% of this
+#ifndef KV_INDEX_SLOTS
+#define KV_INDEX_SLOTS 256
+#endif
+
+//bytes available for keys and values combined
+#ifndef KV_DATA_SIZE
+#define KV_DATA_SIZE 4096
+#endif
+
+#define KV_MAX_KEY_LENGTH 32
+
+//"EHKV"
+#define KV_MAGIC 0x564B4845
+#define KV_VERSION 1
+
+static_assert((KV_INDEX_SLOTS & (KV_INDEX_SLOTS - 1)) == 0, "KV_INDEX_SLOTS must be a power of 2");
+static_assert(KV_DATA_SIZE <= 0xFFFF, "KV_DATA_SIZE must fit the 16 bit record offsets");
+
+
+enum kvType {KV_NONE, KV_INT, KV_FLOAT, KV_BOOL, KV_STRING, KV_BLOB};
+
+
+/*
+Typed key/value store for application settings.
+
+The store is kept in RAM in exactly the layout it has on flash: a header, an open addressing hash
+index and a data area of [key length][key][value length][value] records. Loading is one read of the
+file and every get() is a hash + (usually) one probe, with no parsing. Changes are made in RAM and
+written back (atomically) with commit().
+*/
+class ESPHelperKV {
+
+public:
+	ESPHelperKV();
+	~ESPHelperKV();
+
+	ESPHelperKV(const ESPHelperKV& other) = delete;
+	ESPHelperKV& operator=(const ESPHelperKV& other) = delete;
+
+	bool begin(const char* path = DEFAULT_KV_PATH);
+	void end();
+
+	bool commit();
+	bool isDirty() const { return _dirty; }
+	void clear();
+
+	bool has(const char* key) const;
+	kvType getType(const char* key) const;
+	bool remove(const char* key);
+
+	bool setInt(const char* key, int32_t value);
+	bool setFloat(const char* key, float value);
+	bool setBool(const char* key, bool value);
+	bool setString(const char* key, const char* value);
+	bool setBlob(const char* key, const void* value, size_t length);
+
+	int32_t getInt(const char* key, int32_t defaultValue = 0) const;
+	float getFloat(const char* key, float defaultValue = 0) const;
+	bool getBool(const char* key, bool defaultValue = false) const;
+	const char* getString(const char* key, const char* defaultValue = "") const;
+	const uint8_t* getBlob(const char* key, size_t* length) const;
+
+	bool setFromString(const char* key, const char* value, kvType newType = KV_STRING);
+	bool checkFromString(const char* key, const char* value, kvType newType = KV_STRING, size_t* length = nullptr) const;
+	size_t printValue(const char* key, Print& out) const;
+	size_t printJson(Print& out) const;
+
+	size_t count() const;
+	size_t getFreeSpace() const;
+	bool fits(size_t newKeys, size_t recordBytes) const;
+	static size_t recordLength(const char* key, size_t valueLength);
+
+private:
+
+	struct kvHeader {
+		uint32_t magic;
+		uint16_t version;
+		uint16_t slots;
+		uint16_t dataUsed;
+		uint16_t reserved;
+		uint32_t crc;		//CRC32 of the index + data area
+	};
+
+	struct kvSlot {
+		uint32_t hash;		//0 = empty
+		uint16_t offset;	//start of the record in the data area
+		uint8_t type;		//kvType (KV_NONE = deleted)
+		uint8_t reserved;
+	};
+
+	struct kvImage {
+		kvHeader header;
+		kvSlot slots[KV_INDEX_SLOTS];
+		uint8_t data[KV_DATA_SIZE];
+	};
+
+	static uint32_t hashKey(const char* key);
+	static bool parseString(const char* value, kvType type, uint8_t* parsed, size_t* length);
+
+	int findSlot(const char* key, uint32_t hash) const;
+	int findFreeSlot(uint32_t hash) const;
+	bool recordKeyMatches(uint16_t offset, const char* key) const;
+	const uint8_t* getValue(const char* key, kvType type, size_t* length) const;
+	bool setValue(const char* key, kvType type, const void* value, size_t length);
+	void compact();
+	size_t recordSize(uint16_t offset) const;
+	size_t printRecordValue(int slot, Print& out) const;
+	static size_t printJsonString(const char* str, size_t length, Print& out);
+
+	kvImage* _image = nullptr;
+	char _path[32];
+	bool _dirty = false;
+};
+
+#endif
@@ -0,0 +1,376 @@
+/*
+    ESPHelperMqttOTA.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "ESPHelperMqttOTA.h"
+
+
+ESPHelperMqttOTA::~ESPHelperMqttOTA(){
+	abortUpdate();
+	release();
+}
+
+
+/*
+start listening for updates on <baseTopic>/begin and <baseTopic>/data
+
+input:
+	ESPHelper reference to receive and acknowledge with
+	char ptr to the base topic (ie "devices/kitchen/ota")
+output:
+	true on: topic handler registered
+	false on: topic too long or no free topic handlers
+*/
+bool ESPHelperMqttOTA::begin(ESPHelper& helper, const char* baseTopic){
+	if(strlen(baseTopic) + 6 >= sizeof(_baseTopic)){return false;}
+
+	_helper = &helper;
+	strcpy(_baseTopic, baseTopic);
+	snprintf(_ackTopic, sizeof(_ackTopic), "%s/ack", baseTopic);
+	_lastError[0] = '\0';
+
+	char filter[MAX_TOPIC_LENGTH];
+	snprintf(filter, sizeof(filter), "%s/+", baseTopic);
+	return helper.addTopicHandler(filter, [this](char* topic, uint8_t* payload, unsigned int length){
+		receive(topic, payload, length);
+	});
+}
+
+
+/*
+stop a running update and discard what was written
+
+input: NA
+output: NA
+*/
+void ESPHelperMqttOTA::cancel(){
+	if(_stats.state != MQTT_OTA_RECEIVING){return;}
+	abortUpdate();
+	release();
+	_stats.state = MQTT_OTA_IDLE;
+}
+
+
+/*
+start requested updates, write received chunks and send acks - call this from loop()
+
+input: NA
+output:
+	true on: an image was received, verified and committed (restart to boot it)
+	false on: otherwise
+*/
+bool ESPHelperMqttOTA::handle(){
+	if(_helper == nullptr){return false;}
+
+	if(_startPending){
+		_startPending = false;
+		if(start()){_ackPending = true;}
+	}
+
+	if(_stats.state == MQTT_OTA_RECEIVING){
+		if(flush()){_ackPending = true;}
+
+		if(_stats.state == MQTT_OTA_RECEIVING && millis() - _lastChunk > MQTT_OTA_TIMEOUT){
+			abortUpdate();
+			release();
+			fail("timeout");
+		}
+	}
+
+	//acks are rate limited (one covers any number of chunks) and repeated while waiting so lost chunks get resent
+	unsigned long now = millis();
+	bool idle = _stats.state == MQTT_OTA_RECEIVING && now - _lastAck >= MQTT_OTA_IDLE_ACK;
+	if(((_ackPending && now - _lastAck >= MQTT_OTA_ACK_INTERVAL) || idle) && _helper->getStatus() == FULL_CONNECTION){
+		publishAck(_stats.state == MQTT_OTA_DONE);
+	}
+
+	if(_stats.state == MQTT_OTA_DONE && !_doneReported && !_ackPending){
+		_doneReported = true;
+		return true;
+	}
+	return false;
+}
+
+
+/*
+topic handler for <base>/+ (runs inside the MQTT client loop)
+
+input:
+	char ptr to the topic
+	uint8_t ptr to the payload
+	unsigned int payload length
+output: NA
+*/
+void ESPHelperMqttOTA::receive(char* topic, uint8_t* payload, unsigned int length){
+	const char* suffix = topic + strlen(_baseTopic);
+	if(strcmp(suffix, "/data") == 0){receiveChunk(payload, length);}
+	else if(strcmp(suffix, "/begin") == 0){receiveBegin(payload, length);}
+}
+
+
+/*
+handle a begin message. The update itself is started from handle()
+
+input:
+	uint8_t ptr to the JSON payload
+	unsigned int payload length
+output: NA
+*/
+void ESPHelperMqttOTA::receiveBegin(uint8_t* payload, unsigned int length){
+	//a bad begin message doesn't disturb an update that is already running
+	JsonDocument doc;
+	if(deserializeJson(doc, payload, length)){
+		if(_stats.state != MQTT_OTA_RECEIVING){fail("parse");}
+		return;
+	}
+
+	uint32_t size = doc["size"].as<uint32_t>();
+	uint32_t chunk = doc["chunk"].as<uint32_t>();
+	uint32_t window = doc["window"].as<uint32_t>();
+	bool delta = doc["delta"].as<bool>();
+	uint8_t hash[SHA256_SIZE];
+	if(size == 0 || chunk == 0 || chunk > UINT16_MAX || !ESPHelperHash::parseHex(doc["sha256"].as<const char*>(), hash)){
+		if(_stats.state != MQTT_OTA_RECEIVING){fail("begin");}
+		return;
+	}
+
+	//a repeated begin for the update that is already running only needs an ack
+	if(_stats.state == MQTT_OTA_RECEIVING && size == _stats.totalBytes && chunk == _chunkSize && delta == _delta
+		&& memcmp(hash, _expected, SHA256_SIZE) == 0){
+		_ackPending = true;
+		return;
+	}
+
+	//the device decides how many chunks it can hold - the window in the acks is what the sender has to use
+	if(window == 0 || window > MQTT_OTA_MAX_WINDOW){window = MQTT_OTA_MAX_WINDOW;}
+	while(window > 1 && window * chunk > MQTT_OTA_MAX_BUFFER){window--;}
+
+	_pendingSize = size;
+	_pendingChunk = chunk;
+	_pendingWindow = window;
+	memcpy(_pendingHash, hash, SHA256_SIZE);
+	_pendingDelta = delta;
+	_startPending = true;
+}
+
+
+/*
+hold a chunk in its window slot (written to flash from handle() once the chunks before it are in)
+
+input:
+	uint8_t ptr to the payload (4 byte big endian index + data)
+	unsigned int payload length
+output: NA
+*/
+void ESPHelperMqttOTA::receiveChunk(uint8_t* payload, unsigned int length){
+	//the sender is still going because it missed the final ack - send it again
+	if(_stats.state == MQTT_OTA_DONE || _stats.state == MQTT_OTA_FAILED){
+		_ackPending = true;
+		return;
+	}
+	if(_stats.state != MQTT_OTA_RECEIVING || length < 4){return;}
+
+	uint32_t index = ((uint32_t)payload[0] << 24) | ((uint32_t)payload[1] << 16) | ((uint32_t)payload[2] << 8) | payload[3];
+	_lastChunk = millis();
+
+	//already written or held - the sender missed an ack
+	if(index < _next || (index - _next < _window && (_held & (1UL << (index - _next))))){
+		_stats.duplicates++;
+		_ackPending = true;
+		return;
+	}
+	if(index >= _chunkCount || index - _next >= _window){
+		_stats.outOfWindow++;
+		return;
+	}
+	if(length - 4 != chunkLength(index)){return;}
+
+	memcpy(_buffer + (index % _window) * _chunkSize, payload + 4, length - 4);
+	_held |= 1UL << (index - _next);
+	_stats.chunks++;
+}
+
+
+/*
+start the update requested by a begin message (any update in progress is discarded)
+
+input: NA
+output:
+	true on: update started
+	false on: not enough memory or flash for it
+*/
+bool ESPHelperMqttOTA::start(){
+	abortUpdate();
+	release();
+
+	_stats = mqttOtaStats();
+	_lastError[0] = '\0';
+	_doneReported = false;
+
+	//the whole chunk plus its topic has to fit in one MQTT packet
+	if(_pendingChunk + strlen(_baseTopic) + 16 > _helper->getMQTTClient()->getBufferSize()){
+		fail("buffer");
+		return false;
+	}
+
+	_buffer = (uint8_t*)malloc((size_t)_pendingChunk * _pendingWindow);
+	if(_buffer == nullptr){
+		fail("memory");
+		return false;
+	}
+	if(!_writer.begin(_pendingSize, _pendingDelta)){
+		release();
+		fail(_writer.getLastError());
+		return false;
+	}
+
+	_delta = _pendingDelta;
+	_chunkSize = _pendingChunk;
+	_window = _pendingWindow;
+	_chunkCount = (_pendingSize + _chunkSize - 1) / _chunkSize;
+	memcpy(_expected, _pendingHash, SHA256_SIZE);
+	_next = 0;
+	_held = 0;
+	_chunkUsed = 0;
+	_hash.begin();
+
+	_stats.totalBytes = _pendingSize;
+	_stats.state = MQTT_OTA_RECEIVING;
+	_startTime = millis();
+	_lastChunk = millis();
+	return true;
+}
+
+
+/*
+write every held chunk that continues the image, and finish the update after the last one
+
+input: NA
+output:
+	true on: at least one chunk was written (an ack is due)
+	false on: nothing to write
+*/
+bool ESPHelperMqttOTA::flush(){
+	bool wrote = false;
+
+	//a patch can keep the writer busy copying from the running image - held chunks wait for it
+	bool ready = _writer.handle();
+	while(ready && (_held & 1)){
+		uint32_t length = chunkLength(_next);
+		uint8_t* chunk = _buffer + (_next % _window) * _chunkSize;
+
+		_chunkUsed += _writer.write(chunk + _chunkUsed, length - _chunkUsed);
+		if(_chunkUsed < length){break;}
+		_hash.add(chunk, length);
+
+		_chunkUsed = 0;
+		_held >>= 1;
+		_next++;
+		_stats.bytesDone += length;
+		wrote = true;
+		ready = !_writer.isBusy();
+	}
+
+	if(_writer.hasError()){
+		abortUpdate();
+		release();
+		fail(_writer.getLastError());
+		return true;
+	}
+
+	if(wrote){
+		unsigned long elapsed = millis() - _startTime;
+		if(elapsed > 0){_stats.bytesPerSecond = (uint64_t)_stats.bytesDone * 1000 / elapsed;}
+	}
+
+	if(_next < _chunkCount || _writer.isBusy()){return wrote;}
+
+	//whole image written - check it before it is allowed to boot
+	uint8_t digest[SHA256_SIZE];
+	_hash.finish(digest);
+	if(memcmp(digest, _expected, SHA256_SIZE) != 0){
+		abortUpdate();
+		release();
+		fail("hash");
+		return true;
+	}
+
+	release();
+	if(!_writer.end()){
+		fail(_writer.getLastError());
+		return true;
+	}
+	_stats.state = MQTT_OTA_DONE;
+	return true;
+}
+
+
+/*
+publish the transfer state on <base>/ack
+
+input:
+	bool the image has been committed
+output: NA
+*/
+void ESPHelperMqttOTA::publishAck(bool done){
+	char ack[96];
+	if(_stats.state == MQTT_OTA_FAILED){snprintf(ack, sizeof(ack), "{\"error\":\"%s\"}", _lastError);}
+	else if(done){snprintf(ack, sizeof(ack), "{\"next\":%lu,\"done\":true}", (unsigned long)_next);}
+	else{snprintf(ack, sizeof(ack), "{\"next\":%lu,\"bitmap\":%lu,\"window\":%u}", (unsigned long)_next, (unsigned long)_held, _window);}
+
+	_helper->publish(_ackTopic, ack, false);
+	_ackPending = false;
+	_lastAck = millis();
+}
+
+
+void ESPHelperMqttOTA::fail(const char* error){
+	strncpy(_lastError, error, sizeof(_lastError) - 1);
+	_lastError[sizeof(_lastError) - 1] = '\0';
+	_stats.state = MQTT_OTA_FAILED;
+	_ackPending = true;
+}
+
+
+/*
+throw away a partly written image
+
+input: NA
+output: NA
+*/
+void ESPHelperMqttOTA::abortUpdate(){
+	_writer.abort();
+	_chunkUsed = 0;
+}
+
+
+void ESPHelperMqttOTA::release(){
+	free(_buffer);
+	_buffer = nullptr;
+	_held = 0;
+}
+
+
+uint32_t ESPHelperMqttOTA::chunkLength(uint32_t index) const {
+	if(index + 1 < _chunkCount){return _chunkSize;}
+	return _stats.totalBytes - (_chunkCount - 1) * _chunkSize;
+}
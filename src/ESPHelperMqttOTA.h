@@ -0,0 +1,139 @@
+/*
+    ESPHelperMqttOTA.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef ESPHELPER_MQTT_OTA_H
+#define ESPHELPER_MQTT_OTA_H
+
+#include "ESPHelper.h"
+#include "ESPHelperHash.h"
+#include "ESPHelperDeltaOTA.h"
+
+
+#define MQTT_OTA_MAX_WINDOW 32			//chunks in flight (the ack bitmap is 32 bits)
+#define MQTT_OTA_MAX_BUFFER 8192		//bytes of out of order chunks the device will hold (window * chunk size)
+#define MQTT_OTA_ACK_INTERVAL 50		//min time (ms) between acks
+#define MQTT_OTA_IDLE_ACK 1000			//ack repeated this often (ms) while waiting, so lost chunks get resent
+#define MQTT_OTA_TIMEOUT 60000			//no chunks for this long (ms) cancels the update
+
+enum mqttOtaState {
+	MQTT_OTA_IDLE,
+	MQTT_OTA_RECEIVING,
+	MQTT_OTA_DONE,
+	MQTT_OTA_FAILED
+};
+
+struct mqttOtaStats {
+	uint32_t totalBytes = 0;
+	uint32_t bytesDone = 0;			//bytes of the image (or patch) written
+	uint32_t chunks = 0;			//chunks accepted
+	uint32_t duplicates = 0;		//chunks received again (already written)
+	uint32_t outOfWindow = 0;		//chunks too far ahead to hold
+	uint32_t bytesPerSecond = 0;
+	mqttOtaState state = MQTT_OTA_IDLE;
+};
+
+
+/*
+Firmware update over MQTT, for devices the broker is the only route to (see mqtt_ota_sender.py).
+
+Topics (below the base topic given to begin()):
+	<base>/begin	{"size":412336,"chunk":1024,"window":8,"sha256":"9f86d0..."} starts an update
+					("delta":true sends a patch made by delta_gen.py - size and sha256 are the patch's)
+	<base>/data		4 byte big endian chunk index followed by the chunk
+	<base>/ack		published by the device: {"next":17,"bitmap":5,"window":8}
+
+Chunks are written in order. Chunks that arrive ahead of the next one are held (up to the
+window) and bit i of bitmap says chunk next+i is held, so the sender only resends the gaps and
+can keep a full window in flight. The image is hashed as it is written and only activated if it
+matches the SHA-256 from the begin message.
+
+The MQTT buffer has to fit a chunk plus the topic (ESPHelper::setMQTTBuffer()). The image goes
+to the OTA partition unless another ESPHelperOTAPartition is given to the constructor.
+*/
+class ESPHelperMqttOTA {
+
+public:
+	ESPHelperMqttOTA() {}
+	explicit ESPHelperMqttOTA(ESPHelperOTAPartition& partition) : _writer(partition) {}
+	~ESPHelperMqttOTA();
+
+	bool begin(ESPHelper& helper, const char* baseTopic);
+	void cancel();
+
+	bool handle();
+
+	mqttOtaState getState() const { return _stats.state; }
+	const mqttOtaStats& getStats() const { return _stats; }
+	const char* getLastError() const { return _lastError; }
+
+private:
+	void receive(char* topic, uint8_t* payload, unsigned int length);
+	void receiveBegin(uint8_t* payload, unsigned int length);
+	void receiveChunk(uint8_t* payload, unsigned int length);
+	bool start();
+	bool flush();
+	void publishAck(bool done);
+	void fail(const char* error);
+	void abortUpdate();
+	void release();
+
+	uint32_t chunkLength(uint32_t index) const;
+
+	ESPHelper* _helper = nullptr;
+	ESPHelperHash _hash;
+
+	char _baseTopic[MAX_TOPIC_LENGTH];
+	char _ackTopic[MAX_TOPIC_LENGTH];
+
+	//update requested by a begin message (started from handle())
+	bool _startPending = false;
+	uint32_t _pendingSize = 0;
+	uint16_t _pendingChunk = 0;
+	uint8_t _pendingWindow = 0;
+	uint8_t _pendingHash[SHA256_SIZE];
+	bool _pendingDelta = false;
+
+	//update in progress
+	uint8_t _expected[SHA256_SIZE];
+	uint16_t _chunkSize = 0;
+	uint8_t _window = 0;
+	uint32_t _chunkCount = 0;
+	uint32_t _next = 0;				//index of the next chunk to be written
+	uint32_t _held = 0;				//bit i: chunk _next + i is in the buffer
+	uint8_t* _buffer = nullptr;		//_window slots of _chunkSize (slot = index % _window)
+	uint32_t _chunkUsed = 0;		//bytes of chunk _next the writer has taken (a patch can make it wait part way)
+	bool _delta = false;
+	ESPHelperDeltaOTA _writer;
+
+	bool _ackPending = false;
+	unsigned long _lastAck = 0;
+	unsigned long _lastChunk = 0;
+	unsigned long _startTime = 0;
+	bool _doneReported = false;
+
+	mqttOtaStats _stats;
+	char _lastError[24];
+};
+
+#endif
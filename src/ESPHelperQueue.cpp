@@ -0,0 +1,242 @@
+/*
+    ESPHelperQueue.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "ESPHelperQueue.h"
+#include <new>
+
+
+MessageRing::MessageRing(){
+}
+
+MessageRing::~MessageRing(){
+	end();
+}
+
+
+/*
+allocate the ring buffer (the only allocation the queue ever makes)
+
+input:
+	size_t total size of the ring in bytes
+output:
+	true on: buffer allocated
+	false on: allocation failed
+*/
+bool MessageRing::begin(size_t size){
+	end();
+	_buf = new (std::nothrow) uint8_t[size];
+	if(_buf == nullptr){return false;}
+	_size = size;
+	_stats = queueStats();
+	clear();
+	return true;
+}
+
+
+/*
+release the ring buffer
+
+input: NA
+output: NA
+*/
+void MessageRing::end(){
+	if(_buf != nullptr){
+		delete[] _buf;
+		_buf = nullptr;
+	}
+	_size = 0;
+	clear();
+}
+
+
+/*
+drop all queued messages (counters other than the depth are kept)
+
+input: NA
+output: NA
+*/
+void MessageRing::clear(){
+	_head = 0;
+	_tail = 0;
+	_wrapAt = _size;
+	_wrapped = false;
+	_stats.depth = 0;
+	_stats.bytesUsed = 0;
+}
+
+
+/*
+number of bytes a record takes in the ring. Both the topic and the payload get a trailing null
+so that callbacks which terminate the payload in place (payload[length] = '\0') stay inside the record
+
+input:
+	size_t topic length
+	size_t payload length
+output:
+	size_t record size in bytes
+*/
+size_t MessageRing::recordSize(size_t topicLength, size_t payloadLength) const{
+	return sizeof(recordHeader) + topicLength + 1 + payloadLength + 1;
+}
+
+
+/*
+copy a message into the ring
+
+input:
+	char ptr to the topic
+	uint8_t ptr to the payload
+	unsigned int payload length
+	uint8_t MSG_* flags stored with the message
+output:
+	true on: message queued
+	false on: queue disabled or full (the overflow counter is incremented)
+*/
+bool MessageRing::push(const char* topic, const uint8_t* payload, unsigned int length, uint8_t flags){
+	if(_buf == nullptr){return false;}
+
+	size_t topicLength = strlen(topic);
+	size_t need = recordSize(topicLength, length);
+	if(topicLength > 0xFFFF || length > 0xFFFF || need > _size){
+		_stats.overflows++;
+		return false;
+	}
+
+	//start from the beginning of the buffer whenever the queue drains to get the most contiguous space
+	if(_stats.depth == 0){clear();}
+
+	size_t writePos;
+	if(!_wrapped){
+		//room left at the end of the buffer
+		if(_size - _head >= need){writePos = _head;}
+
+		//otherwise wrap around to the start as long as we dont run into the reader
+		else if(need <= _tail){
+			_wrapAt = _head;
+			_wrapped = true;
+			writePos = 0;
+		}
+		else{
+			_stats.overflows++;
+			return false;
+		}
+	}
+	else{
+		if(_tail - _head >= need){writePos = _head;}
+		else{
+			_stats.overflows++;
+			return false;
+		}
+	}
+
+	recordHeader header;
+	header.topicLength = topicLength;
+	header.payloadLength = length;
+	header.flags = flags;
+
+	uint8_t* rec = _buf + writePos;
+	memcpy(rec, &header, sizeof(header));
+	rec += sizeof(header);
+	memcpy(rec, topic, topicLength + 1);
+	rec += topicLength + 1;
+	if(length > 0){memcpy(rec, payload, length);}
+	rec[length] = '\0';
+
+	_head = writePos + need;
+	_stats.depth++;
+	_stats.bytesUsed += need;
+	if(_stats.depth > _stats.highWatermark){_stats.highWatermark = _stats.depth;}
+
+	return true;
+}
+
+
+/*
+get the oldest message in the ring without removing it. The returned pointers stay valid until pop() is called
+
+input:
+	char ptr reference filled with the topic
+	uint8_t ptr reference filled with the payload
+	unsigned int reference filled with the payload length
+output:
+	true on: message available
+	false on: queue empty
+*/
+bool MessageRing::peek(char*& topic, uint8_t*& payload, unsigned int& length){
+	uint8_t flags;
+	return peek(topic, payload, length, flags);
+}
+
+
+/*
+get the oldest message in the ring and the flags it was pushed with, without removing it
+
+input:
+	char ptr reference filled with the topic
+	uint8_t ptr reference filled with the payload
+	unsigned int reference filled with the payload length
+	uint8_t reference filled with the MSG_* flags
+output:
+	true on: message available
+	false on: queue empty
+*/
+bool MessageRing::peek(char*& topic, uint8_t*& payload, unsigned int& length, uint8_t& flags){
+	if(_buf == nullptr || _stats.depth == 0){return false;}
+
+	recordHeader header;
+	memcpy(&header, _buf + _tail, sizeof(header));
+
+	topic = (char*)(_buf + _tail + sizeof(header));
+	payload = (uint8_t*)(topic + header.topicLength + 1);
+	length = header.payloadLength;
+	flags = header.flags;
+	return true;
+}
+
+
+/*
+remove the oldest message from the ring
+
+input: NA
+output: NA
+*/
+void MessageRing::pop(){
+	if(_buf == nullptr || _stats.depth == 0){return;}
+
+	recordHeader header;
+	memcpy(&header, _buf + _tail, sizeof(header));
+	size_t size = recordSize(header.topicLength, header.payloadLength);
+
+	_tail += size;
+	_stats.depth--;
+	_stats.bytesUsed -= size;
+	_stats.dispatched++;
+
+	//once the reader reaches the point where the writer wrapped, follow it back to the start
+	if(_wrapped && _tail >= _wrapAt){
+		_tail = 0;
+		_wrapAt = _size;
+		_wrapped = false;
+	}
+
+	if(_stats.depth == 0){clear();}
+}
@@ -0,0 +1,99 @@
+/*
+    ESPHelperQueue.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef ESPHELPER_QUEUE_H
+#define ESPHELPER_QUEUE_H
+
+#include <Arduino.h>
+
+
+//default size (in bytes) of the inbound and outbound message rings
+#define DEFAULT_MSG_QUEUE_SIZE 2048
+
+//default amount of time (in microseconds) that loop() may spend dispatching queued messages
+#define DEFAULT_MSG_QUEUE_BUDGET_US 2000
+
+//flags stored with a queued message
+#define MSG_RETAIN 0x01		//publish with the retain flag set (outbound queue)
+
+
+struct queueStats {
+	uint16_t depth = 0;			//messages currently waiting in the queue
+	uint16_t highWatermark = 0;	//largest depth seen since the queue was enabled
+	size_t bytesUsed = 0;		//bytes currently used by queued messages
+	uint32_t overflows = 0;		//messages dropped because the queue was full
+	uint32_t dispatched = 0;	//messages handed off to the user callback
+};
+
+
+/*
+Fixed size ring of MQTT messages (topic + payload). Every message is stored as one contiguous
+record so that it can be handed out without copying it a second time. When a record does not fit
+at the end of the buffer it is placed back at the start and the leftover space is skipped.
+
+The buffer is allocated once in begin() so pushing and popping never touches the heap.
+*/
+class MessageRing {
+
+public:
+	MessageRing();
+	~MessageRing();
+
+	MessageRing(const MessageRing& other) = delete;
+	MessageRing& operator=(const MessageRing& other) = delete;
+
+	bool begin(size_t size);
+	void end();
+
+	bool push(const char* topic, const uint8_t* payload, unsigned int length, uint8_t flags = 0);
+	bool peek(char*& topic, uint8_t*& payload, unsigned int& length);
+	bool peek(char*& topic, uint8_t*& payload, unsigned int& length, uint8_t& flags);
+	void pop();
+	void clear();
+
+	bool isEnabled() const { return _buf != nullptr; }
+	bool isEmpty() const { return _stats.depth == 0; }
+
+	const queueStats& getStats() const { return _stats; }
+
+private:
+
+	struct recordHeader {
+		uint16_t topicLength;
+		uint16_t payloadLength;
+		uint8_t flags;
+	};
+
+	size_t recordSize(size_t topicLength, size_t payloadLength) const;
+
+	uint8_t* _buf = nullptr;
+	size_t _size = 0;
+	size_t _head = 0;		//next write position
+	size_t _tail = 0;		//next read position
+	size_t _wrapAt = 0;		//end of valid data when the writer has wrapped back to the start
+	bool _wrapped = false;	//true while the writer is behind the reader (has wrapped back to the start)
+
+	queueStats _stats;
+};
+
+#endif
@@ -0,0 +1,332 @@
+/*
+    ESPHelperRemoteConfig.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "ESPHelperRemoteConfig.h"
+
+
+ESPHelperRemoteConfig::ESPHelperRemoteConfig() : _stagingConf(), _staging(_stagingConf){
+	_configPath[0] = '\0';
+	_ackTopic[0] = '\0';
+	_lastError[0] = '\0';
+}
+
+
+/*
+start listening for remote config documents
+
+input:
+	ESPHelper reference (its NetInfo is the config that gets changed)
+	char ptr to the per device config topic
+	char ptr to the fleet wide config topic (nullptr for none)
+	char ptr to the path the config is saved to (see ESPHelperConfigStore)
+output:
+	true on: topics registered
+	false on: a topic or the path is too long or there are no free topic handlers
+*/
+bool ESPHelperRemoteConfig::begin(ESPHelper& helper, const char* deviceTopic, const char* fleetTopic, const char* configPath){
+	if(strlen(configPath) >= sizeof(_configPath) || strlen(deviceTopic) + 4 >= sizeof(_ackTopic)){return false;}
+
+	_helper = &helper;
+	strcpy(_configPath, configPath);
+	if(_ackTopic[0] == '\0'){snprintf(_ackTopic, sizeof(_ackTopic), "%s/ack", deviceTopic);}
+
+	//pick up the version of the config saved on flash so old retained documents are ignored
+	uint32_t revision = 0;
+	if(ESPHelperConfigStore::load(_staging, _configPath, &revision)){_version = revision;}
+
+	bool added = helper.addTopicHandler(deviceTopic, [this](char* topic, uint8_t* payload, unsigned int length){
+		receive(payload, length);
+	});
+	if(added && fleetTopic != nullptr){
+		added = helper.addTopicHandler(fleetTopic, [this](char* topic, uint8_t* payload, unsigned int length){
+			receive(payload, length);
+		});
+	}
+	return added;
+}
+
+
+/*
+merge the "keys" object of config documents into a key/value store
+
+input:
+	ESPHelperKV reference to an already started store
+output: NA
+*/
+void ESPHelperRemoteConfig::useKeyStore(ESPHelperKV& store){
+	_keyStore = &store;
+}
+
+
+/*
+set the topic acknowledgements are published on (default: <deviceTopic>/ack). Call before begin()
+
+input:
+	char ptr to the topic
+output: NA
+*/
+void ESPHelperRemoteConfig::setAckTopic(const char* topic){
+	strncpy(_ackTopic, topic, sizeof(_ackTopic) - 1);
+	_ackTopic[sizeof(_ackTopic) - 1] = '\0';
+}
+
+
+/*
+apply received config - call this from loop(). Applying restarts connections so it can't be
+done from inside the MQTT callback. The document's version only becomes the current one once
+everything it changed is saved - if a save fails the network settings are not applied, a failure
+is acknowledged and the same version can be sent again
+
+input: NA
+output:
+	true on: a new config was applied
+	false on: nothing to do or the config could not be saved
+*/
+bool ESPHelperRemoteConfig::handle(){
+	if(_helper == nullptr){return false;}
+
+	bool applied = false;
+	if(_applyPending){
+		_applyPending = false;
+
+		//save first so a restart caused by the new settings can't lose them
+		NetInfo* current = _helper->getNetInfo();
+		bool netChanged = !ESPHelperConfigFields::equal(*current, _staging);
+		if(_keyStore != nullptr && _keyStore->isDirty() && !_keyStore->commit()){fail("save");}
+		else if(!ESPHelperConfigStore::save(netChanged ? _staging : *current, _configPath, _stagedVersion)){fail("save");}
+		else{
+			if(netChanged){_helper->applyNetwork(&_staging);}
+			_version = _stagedVersion;
+			applied = true;
+		}
+	}
+
+	//the ack waits for the connection to come back if the new config restarted MQTT
+	if(_ackPending && _helper->getStatus() == FULL_CONNECTION){publishAck();}
+
+	return applied;
+}
+
+
+/*
+handle a config document (runs inside the MQTT client loop). The document is validated and
+merged into the staged config, the rest happens in handle()
+
+input:
+	uint8_t ptr to the payload (JSON if it starts with '{', MessagePack otherwise)
+	unsigned int payload length
+output: NA
+*/
+void ESPHelperRemoteConfig::receive(uint8_t* payload, unsigned int length){
+	//an empty payload clears a retained topic - nothing to apply
+	if(length == 0){return;}
+
+	JsonDocument doc;
+	DeserializationError error = payload[0] == '{' ? deserializeJson(doc, payload, length) : deserializeMsgPack(doc, payload, length);
+	if(error || !doc.is<JsonObjectConst>()){
+		_ackVersion = _version;
+		fail("parse");
+		return;
+	}
+	JsonObjectConst root = doc.as<JsonObjectConst>();
+
+	//old (or replayed retained) documents are ignored, including one that is still waiting to be applied
+	bool hasVersion = root["version"].is<uint32_t>();
+	uint32_t version = root["version"].as<uint32_t>();
+	uint32_t latest = _applyPending ? _stagedVersion : _version;
+	if(hasVersion && version <= latest){return;}
+
+	//start from the live config unless an earlier document is still waiting to be applied
+	if(!_applyPending){_staging.setConf(_helper->getNetInfo()->getConf());}
+
+	//a rejected document leaves the staged config as it was
+	ESPHelperConf backup;
+	memcpy(&backup, &_stagingConf, sizeof(ESPHelperConf));
+
+	//failures are acknowledged with the version of the rejected document
+	_ackVersion = hasVersion ? version : latest;
+
+	JsonVariantConst net = root["net"];
+	JsonVariantConst keys = root["keys"];
+	if(!net.isNull() && !net.is<JsonObjectConst>()){
+		fail("net");
+		return;
+	}
+	if(!keys.isNull() && !keys.is<JsonObjectConst>()){
+		fail("keys");
+		return;
+	}
+
+	if((!net.isNull() && !mergeNet(net.as<JsonObjectConst>())) || (!keys.isNull() && !mergeKeys(keys.as<JsonObjectConst>()))){
+		memcpy(&_stagingConf, &backup, sizeof(ESPHelperConf));
+		return;
+	}
+
+	bool changed = !ESPHelperConfigFields::equal(*_helper->getNetInfo(), _staging)
+		|| (_keyStore != nullptr && _keyStore->isDirty());
+
+	//unversioned documents that change nothing (ie a retained one arriving again) are not acknowledged
+	if(!hasVersion && !changed){return;}
+
+	_stagedVersion = hasVersion ? version : latest;
+	_ackVersion = _stagedVersion;
+	_applyPending = true;
+	_ackPending = true;
+	_ackOk = true;
+	_lastError[0] = '\0';
+}
+
+
+/*
+validate every field of a "net" object and only then merge them into the staged config
+
+input:
+	JsonObjectConst of field names and values
+output:
+	true on: all fields merged
+	false on: a field is unknown, has the wrong type, is out of range or doesn't fit (nothing is merged)
+*/
+bool ESPHelperRemoteConfig::mergeNet(JsonObjectConst net){
+	for(JsonPairConst field : net){
+		int id = ESPHelperConfigFields::find(field.key().c_str());
+		if(id < 0){
+			fail(field.key().c_str());
+			return false;
+		}
+
+		if(!ESPHelperConfigFields::validate((configFieldId)id, field.value())){
+			fail(ESPHelperConfigFields::get((configFieldId)id)->name);
+			return false;
+		}
+	}
+
+	//the values are valid, but together they may still not fit the config arena
+	for(JsonPairConst field : net){
+		configFieldId id = (configFieldId)ESPHelperConfigFields::find(field.key().c_str());
+		if(!ESPHelperConfigFields::set(_staging, id, field.value())){
+			fail("size");
+			return false;
+		}
+	}
+	return true;
+}
+
+
+/*
+merge a "keys" object into the key/value store. Numbers keep the type of an existing key, strings
+are parsed as the existing key's type and null removes the key. Every key is checked (including
+whether they all fit the store) before the first one is changed. The store is committed from handle()
+
+input:
+	JsonObjectConst of keys and values
+output:
+	true on: all keys merged
+	false on: no key store, an unsupported value, a value that doesn't match its key or not enough
+		room in the store (nothing is merged)
+*/
+bool ESPHelperRemoteConfig::mergeKeys(JsonObjectConst keys){
+	if(_keyStore == nullptr){
+		fail("keys");
+		return false;
+	}
+
+	size_t newKeys = 0;
+	size_t recordBytes = 0;
+	for(JsonPairConst pair : keys){
+		const char* key = pair.key().c_str();
+		JsonVariantConst value = pair.value();
+		size_t keyLength = strlen(key);
+
+		size_t length = 0;
+		bool valid = keyLength > 0 && keyLength <= KV_MAX_KEY_LENGTH;
+		if(valid && !value.isNull()){
+			if(value.is<bool>()){length = sizeof(uint8_t);}
+			else if(value.is<int32_t>() || value.is<float>()){length = sizeof(int32_t);}
+			else if(value.is<const char*>()){valid = _keyStore->checkFromString(key, value.as<const char*>(), KV_STRING, &length);}
+			else{valid = false;}
+		}
+
+		if(!valid){
+			fail(key);
+			return false;
+		}
+
+		//values that change size are appended, so count every one of them as a new record
+		if(!value.isNull()){
+			if(!_keyStore->has(key)){newKeys++;}
+			recordBytes += ESPHelperKV::recordLength(key, length);
+		}
+	}
+
+	if(!_keyStore->fits(newKeys, recordBytes)){
+		fail("size");
+		return false;
+	}
+
+	for(JsonPairConst pair : keys){
+		const char* key = pair.key().c_str();
+		JsonVariantConst value = pair.value();
+
+		if(value.isNull()){_keyStore->remove(key);}
+		else if(value.is<bool>()){_keyStore->setBool(key, value.as<bool>());}
+		else if(value.is<int32_t>() && _keyStore->getType(key) != KV_FLOAT){_keyStore->setInt(key, value.as<int32_t>());}
+		else if(value.is<float>()){_keyStore->setFloat(key, value.as<float>());}
+		else{_keyStore->setFromString(key, value.as<const char*>());}
+	}
+	return true;
+}
+
+
+/*
+publish {"version":N,"ok":true} (or "ok":false with the offending field) on the ack topic
+
+input: NA
+output: NA
+*/
+void ESPHelperRemoteConfig::publishAck(){
+	char ack[80];
+	if(_ackOk){snprintf(ack, sizeof(ack), "{\"version\":%lu,\"ok\":true}", (unsigned long)_ackVersion);}
+	else{snprintf(ack, sizeof(ack), "{\"version\":%lu,\"ok\":false,\"error\":\"%s\"}", (unsigned long)_ackVersion, _lastError);}
+
+	_helper->publish(_ackTopic, ack, true);
+	_ackPending = false;
+}
+
+
+/*
+record a rejected document and queue a failure ack
+
+input:
+	char ptr to the reason (field or key name, "parse", "size", "keys" or "save")
+output: NA
+*/
+void ESPHelperRemoteConfig::fail(const char* error){
+	//field and key names are plain identifiers, but keep the ack valid JSON whatever arrives
+	size_t i = 0;
+	for(; error[i] != '\0' && i < sizeof(_lastError) - 1; i++){
+		_lastError[i] = (error[i] == '"' || error[i] == '\\' || (uint8_t)error[i] < 0x20) ? '_' : error[i];
+	}
+	_lastError[i] = '\0';
+
+	_ackOk = false;
+	_ackPending = true;
+}
@@ -0,0 +1,92 @@
+/*
+    ESPHelperRemoteConfig.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef ESPHELPER_REMOTE_CONFIG_H
+#define ESPHELPER_REMOTE_CONFIG_H
+
+#include "ESPHelper.h"
+#include "ESPHelperConfigStore.h"
+#include "ESPHelperConfigFields.h"
+#include "ESPHelperKV.h"
+
+
+/*
+Remote configuration over MQTT.
+
+The device listens on its own (retained) config topic and optionally a fleet wide one. Each
+message is a partial JSON or MessagePack document:
+
+	{"version": 7, "net": {"mqttHost": "broker2.lan", "mqttPort": 8883}, "keys": {"interval": 30}}
+
+"net" uses the same names as the web config page, "keys" are merged into the key/value store
+(null removes a key). Everything in the document is validated before anything is changed, then the
+config is saved with its version, applied with ESPHelper::updateNetwork() (only the layers that
+changed restart) and {"version":7,"ok":true} is published (retained) on the ack topic. If the
+config or the keys can't be saved nothing is applied and "ok":false is published instead.
+Documents with a version at or below the last applied one are ignored, so the retained messages that
+arrive on every reconnect cost nothing. Documents without a version are applied if they change
+anything. The fleet and device topics share one version sequence.
+
+Config documents are usually larger than the default MQTT buffer - see ESPHelper::setMQTTBuffer().
+*/
+class ESPHelperRemoteConfig {
+
+public:
+	ESPHelperRemoteConfig();
+
+	bool begin(ESPHelper& helper, const char* deviceTopic, const char* fleetTopic = nullptr, const char* configPath = DEFAULT_CONFIG_PATH);
+	void useKeyStore(ESPHelperKV& store);
+	void setAckTopic(const char* topic);
+
+	bool handle();
+
+	uint32_t getVersion() const { return _version; }
+	const char* getLastError() const { return _lastError; }
+
+private:
+	void receive(uint8_t* payload, unsigned int length);
+	bool mergeNet(JsonObjectConst net);
+	bool mergeKeys(JsonObjectConst keys);
+	void publishAck();
+	void fail(const char* error);
+
+	ESPHelper* _helper = nullptr;
+	ESPHelperKV* _keyStore = nullptr;
+
+	//config waiting to be applied from handle() (messages arrive inside the MQTT client loop)
+	ESPHelperConf _stagingConf;
+	NetInfo _staging;
+
+	char _configPath[32];
+	char _ackTopic[MAX_TOPIC_LENGTH];
+	char _lastError[24];
+
+	uint32_t _version = 0;			//version of the config that was last saved and applied
+	uint32_t _stagedVersion = 0;	//version of the config waiting for handle()
+	uint32_t _ackVersion = 0;
+	bool _applyPending = false;
+	bool _ackPending = false;
+	bool _ackOk = true;
+};
+
+#endif
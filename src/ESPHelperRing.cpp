@@ -0,0 +1,253 @@
+/*
+    ESPHelperRing.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "ESPHelperRing.h"
+#include <new>
+
+
+LockFreeRing::LockFreeRing(){
+}
+
+LockFreeRing::~LockFreeRing(){
+	end();
+}
+
+
+/*
+allocate the ring buffer. Neither task may be using the ring while this runs
+
+input:
+	size_t size of the ring in bytes (rounded down to a power of two, at least 64)
+output:
+	true on: buffer allocated
+	false on: size too small or allocation failed
+*/
+bool LockFreeRing::begin(size_t size){
+	end();
+	if(size < 64){return false;}
+
+	uint32_t rounded = 64;
+	while(rounded * 2 <= size && rounded < 0x40000000){rounded *= 2;}
+
+	_buf = new (std::nothrow) uint8_t[rounded];
+	if(_buf == nullptr){return false;}
+	_mask = rounded - 1;
+
+	_head.store(0);
+	_tail.store(0);
+	_reserved = 0;
+	_pushed.store(0);
+	_popped.store(0);
+	_overflows.store(0);
+	_highWatermark.store(0);
+	return true;
+}
+
+
+/*
+release the ring buffer. Neither task may be using the ring while this runs
+
+input: NA
+output: NA
+*/
+void LockFreeRing::end(){
+	if(_buf != nullptr){
+		delete[] _buf;
+		_buf = nullptr;
+	}
+	_mask = 0;
+}
+
+
+/*
+copy a message into the ring (producer side)
+
+input:
+	char ptr to the topic
+	uint8_t ptr to the payload
+	unsigned int payload length
+	uint8_t MSG_* flags stored with the message
+output:
+	true on: message queued
+	false on: ring disabled or full (the overflow counter is incremented)
+*/
+bool LockFreeRing::push(const char* topic, const uint8_t* payload, unsigned int length, uint8_t flags){
+	uint8_t* dest = reserve(topic, length, flags);
+	if(dest == nullptr){return false;}
+
+	if(length > 0){memcpy(dest, payload, length);}
+	commit();
+	return true;
+}
+
+
+/*
+make room for a message and write its header and topic (producer side). The payload is written
+to the returned buffer and the message only becomes visible to the consumer on commit()
+
+input:
+	char ptr to the topic
+	unsigned int payload length
+	uint8_t MSG_* flags stored with the message
+output:
+	uint8_t ptr to length bytes for the payload (followed by one spare byte for a null)
+	nullptr if the ring is disabled, full or the message is over half the ring (the overflow counter is incremented)
+*/
+uint8_t* LockFreeRing::reserve(const char* topic, unsigned int length, uint8_t flags){
+	if(_buf == nullptr){return nullptr;}
+
+	size_t topicLength = strlen(topic);
+	uint32_t size = _mask + 1;
+	uint32_t need = (sizeof(recordHeader) + topicLength + 1 + length + 1 + 3) & ~3UL;
+	//anything up to half the ring fits once the consumer catches up, wherever the write position is
+	if(topicLength >= RING_SKIP || length > 0xFFFF || need > size / 2){
+		_overflows.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	uint32_t head = _head.load(std::memory_order_relaxed);
+	uint32_t tail = _tail.load(std::memory_order_acquire);
+
+	//records are never split - a record that doesn't fit before the end starts over at the beginning
+	uint32_t offset = head & _mask;
+	uint32_t skip = (size - offset < need) ? size - offset : 0;
+	if((head - tail) + skip + need > size){
+		_overflows.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	//records are 4 byte aligned so the gap is either big enough for a marker or skipped by both sides anyway
+	if(skip >= sizeof(recordHeader)){
+		recordHeader marker = {skip, RING_SKIP, 0, 0};
+		memcpy(_buf + offset, &marker, sizeof(marker));
+	}
+	head += skip;
+	offset = head & _mask;
+
+	recordHeader header = {need, (uint16_t)topicLength, (uint16_t)length, flags};
+	uint8_t* rec = _buf + offset;
+	memcpy(rec, &header, sizeof(header));
+	memcpy(rec + sizeof(header), topic, topicLength + 1);
+
+	uint8_t* payload = rec + sizeof(header) + topicLength + 1;
+	payload[length] = '\0';
+
+	_reserved = head + need;
+	return payload;
+}
+
+
+/*
+make the message written after reserve() visible to the consumer (producer side)
+
+input: NA
+output: NA
+*/
+void LockFreeRing::commit(){
+	if(_buf == nullptr){return;}
+
+	uint32_t head = _reserved;
+	_head.store(head, std::memory_order_release);
+
+	uint32_t depth = _pushed.fetch_add(1, std::memory_order_relaxed) + 1 - _popped.load(std::memory_order_relaxed);
+	if(depth > _highWatermark.load(std::memory_order_relaxed)){_highWatermark.store(min(depth, (uint32_t)0xFFFF), std::memory_order_relaxed);}
+}
+
+
+/*
+get the oldest message without removing it (consumer side). The pointers stay valid until pop()
+
+input:
+	char ptr reference filled with the topic
+	uint8_t ptr reference filled with the payload
+	unsigned int reference filled with the payload length
+	uint8_t reference filled with the MSG_* flags
+output:
+	true on: message available
+	false on: ring empty or disabled
+*/
+bool LockFreeRing::peek(char*& topic, uint8_t*& payload, unsigned int& length, uint8_t& flags){
+	if(_buf == nullptr){return false;}
+
+	uint32_t tail = _tail.load(std::memory_order_relaxed);
+	uint32_t head = _head.load(std::memory_order_acquire);
+
+	while(tail != head){
+		uint32_t offset = tail & _mask;
+		uint32_t left = _mask + 1 - offset;
+
+		//the writer skipped the end of the buffer (too small for a marker, or marked)
+		recordHeader header;
+		if(left >= sizeof(recordHeader)){memcpy(&header, _buf + offset, sizeof(header));}
+		if(left < sizeof(recordHeader) || header.topicLength == RING_SKIP){
+			tail += left;
+			_tail.store(tail, std::memory_order_release);
+			continue;
+		}
+
+		topic = (char*)(_buf + offset + sizeof(header));
+		payload = (uint8_t*)(topic + header.topicLength + 1);
+		length = header.payloadLength;
+		flags = header.flags;
+		return true;
+	}
+	return false;
+}
+
+
+/*
+remove the oldest message (consumer side). Only valid after peek() returned true
+
+input: NA
+output: NA
+*/
+void LockFreeRing::pop(){
+	if(_buf == nullptr){return;}
+
+	uint32_t tail = _tail.load(std::memory_order_relaxed);
+	if(tail == _head.load(std::memory_order_acquire)){return;}
+
+	recordHeader header;
+	memcpy(&header, _buf + (tail & _mask), sizeof(header));
+	_tail.store(tail + header.size, std::memory_order_release);
+	_popped.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+/*
+snapshot of the ring counters (safe to call from either task - the values may be a message apart)
+
+input: NA
+output:
+	queueStats with the depth, high-watermark, bytes used, overflows and messages popped
+*/
+queueStats LockFreeRing::getStats() const{
+	queueStats stats;
+	uint32_t popped = _popped.load(std::memory_order_relaxed);
+	stats.depth = _pushed.load(std::memory_order_relaxed) - popped;
+	stats.highWatermark = _highWatermark.load(std::memory_order_relaxed);
+	stats.bytesUsed = _head.load(std::memory_order_relaxed) - _tail.load(std::memory_order_relaxed);
+	stats.overflows = _overflows.load(std::memory_order_relaxed);
+	stats.dispatched = popped;
+	return stats;
+}
@@ -0,0 +1,97 @@
+/*
+    ESPHelperRing.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef ESPHELPER_RING_H
+#define ESPHELPER_RING_H
+
+#include <atomic>
+#include "ESPHelperQueue.h"
+
+
+/*
+Lock-free ring of MQTT messages passed between two tasks - one task pushes, the other pops
+(single producer, single consumer). Used to hand publishes to the ESP32 network task and received
+messages back to loop() without either side ever waiting on the other.
+
+Records are laid out like MessageRing (header, topic, payload, each null terminated) but the read and
+write positions are free running byte counters that only their owner writes, so the buffer size is
+rounded down to a power of two. A record that doesn't fit at the end of the buffer is preceded by a
+skip marker and written at the start. The producer publishes a record by storing the write counter
+(release) after the record is complete, and the consumer frees it the same way, so neither side
+ever sees a half written record.
+
+A message can take up to half the ring. reserve()/commit() let the producer write a payload straight into the ring (ie serialize JSON into it).
+*/
+class LockFreeRing {
+
+public:
+	LockFreeRing();
+	~LockFreeRing();
+
+	LockFreeRing(const LockFreeRing& other) = delete;
+	LockFreeRing& operator=(const LockFreeRing& other) = delete;
+
+	bool begin(size_t size);
+	void end();
+
+	//producer side
+	bool push(const char* topic, const uint8_t* payload, unsigned int length, uint8_t flags = 0);
+	uint8_t* reserve(const char* topic, unsigned int length, uint8_t flags = 0);
+	void commit();
+
+	//consumer side
+	bool peek(char*& topic, uint8_t*& payload, unsigned int& length, uint8_t& flags);
+	void pop();
+
+	bool isEnabled() const { return _buf != nullptr; }
+	bool isEmpty() const { return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire); }
+
+	queueStats getStats() const;
+
+private:
+
+	struct recordHeader {
+		uint32_t size;				//bytes to the next record (header included, 4 byte aligned)
+		uint16_t topicLength;		//RING_SKIP for the marker in front of a wrapped record
+		uint16_t payloadLength;
+		uint8_t flags;
+	};
+
+	static const uint16_t RING_SKIP = 0xFFFF;
+
+	uint8_t* _buf = nullptr;
+	uint32_t _mask = 0;
+
+	std::atomic<uint32_t> _head{0};		//bytes written (producer)
+	std::atomic<uint32_t> _tail{0};		//bytes read (consumer)
+	uint32_t _reserved = 0;				//write counter after the record waiting for commit() (producer)
+
+	//each counter is only written by one side
+	std::atomic<uint32_t> _pushed{0};
+	std::atomic<uint32_t> _popped{0};
+	std::atomic<uint32_t> _overflows{0};
+	std::atomic<uint16_t> _highWatermark{0};
+};
+
+#endif
@@ -0,0 +1,443 @@
+/*
+    ESPHelperScheduler.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "ESPHelperScheduler.h"
+
+
+/*
+run a task every intervalMs (the first run is one interval from now)
+
+input:
+	uint32_t interval in ms (must be > 0)
+	std::function<void()> to run
+	char ptr to a name for the stats (nullptr for none - not copied, so use a literal)
+	uint32_t budget in us (0 to use the interval as the budget)
+output:
+	int task id (TASK_INVALID when the interval is 0 or the table is full)
+*/
+int ESPHelperScheduler::every(uint32_t intervalMs, std::function<void()> callback, const char* name, uint32_t budgetUs){
+	if(intervalMs == 0){return TASK_INVALID;}
+	return add(intervalMs, intervalMs, callback, name, budgetUs);
+}
+
+
+/*
+run a task once after delayMs. The task is removed after it has run
+
+input:
+	uint32_t delay in ms (0 to run on the next loop)
+	std::function<void()> to run
+	char ptr to a name for the stats (nullptr for none - not copied, so use a literal)
+	uint32_t budget in us (0 for no budget)
+output:
+	int task id (TASK_INVALID when the table is full)
+*/
+int ESPHelperScheduler::after(uint32_t delayMs, std::function<void()> callback, const char* name, uint32_t budgetUs){
+	return add(delayMs, 0, callback, name, budgetUs);
+}
+
+
+/*
+remove a task. A task can cancel itself while it runs
+
+input:
+	int task id
+output:
+	true on: task removed
+	false on: no such task
+*/
+bool ESPHelperScheduler::cancel(int id){
+	if(!valid(id)){return false;}
+
+	//the running task is already off the heap - run() frees it once it returns
+	if(id == _running){
+		_runningCancelled = true;
+		return true;
+	}
+
+	remove(id);
+	_tasks[id].isUsed = false;
+	_tasks[id].callback = nullptr;
+	_count--;
+	return true;
+}
+
+
+/*
+change the interval of a periodic task. The next run moves to one new interval from now
+
+input:
+	int task id
+	uint32_t new interval in ms (must be > 0)
+output:
+	true on: interval changed
+	false on: no such task, the task is a one-shot or the interval is 0
+*/
+bool ESPHelperScheduler::setInterval(int id, uint32_t intervalMs){
+	if(!valid(id) || _tasks[id].interval == 0 || intervalMs == 0){return false;}
+
+	_tasks[id].interval = intervalMs;
+	if(id == _running){return true;}		//run() reschedules it from the new interval
+
+	bool queued = onHeap(id);
+	remove(id);
+	_tasks[id].due = millis() + intervalMs;
+	if(queued){push(id);}
+	return true;
+}
+
+
+/*
+make a task due now so it runs on the next call to run()
+
+input:
+	int task id
+output:
+	true on: task moved to the front
+	false on: no such task or the task is running
+*/
+bool ESPHelperScheduler::runNow(int id){
+	if(!valid(id) || id == _running){return false;}
+
+	bool queued = onHeap(id);
+	remove(id);
+	_tasks[id].due = millis();
+	if(queued){push(id);}
+	return true;
+}
+
+
+/*
+run every task that is due, soonest deadline first. Each task runs at most once per call so a
+task with a short interval can't keep the caller from returning. With a budget no task is started
+once it is spent (at least one due task runs per call so the tasks always make progress)
+
+input:
+	uint32_t time budget in microseconds (UINT32_MAX for no limit)
+output:
+	uint8_t number of tasks run
+*/
+uint8_t ESPHelperScheduler::run(uint32_t budgetUs){
+	if(_count == 0){return 0;}
+
+	uint32_t now = millis();
+	uint32_t runStart = micros();
+	uint8_t ran = 0;
+
+	//tasks rescheduled by this call go back on the heap once it is done
+	uint8_t deferred[MAX_SCHEDULED_TASKS];
+	uint8_t deferredCount = 0;
+
+	while(_heapSize > 0 && (int32_t)(now - _tasks[_heap[0]].due) >= 0){
+		if(ran > 0 && micros() - runStart >= budgetUs){break;}
+
+		uint8_t slot = _heap[0];
+		remove(slot);
+
+		task& current = _tasks[slot];
+		uint32_t late = now - current.due;
+		if(late > current.stats.maxLateMs){current.stats.maxLateMs = late;}
+
+		_running = slot;
+		_runningCancelled = false;
+		uint32_t start = micros();
+		current.callback();
+		uint32_t elapsed = micros() - start;
+		_running = TASK_INVALID;
+		ran++;
+
+		current.stats.runs++;
+		current.stats.lastUs = elapsed;
+		current.stats.totalUs += elapsed;
+		if(elapsed > current.stats.maxUs){current.stats.maxUs = elapsed;}
+
+		uint32_t budget = current.budgetUs;
+		if(budget == 0 && current.interval != 0){budget = current.interval * 1000UL;}
+		if(budget != 0 && elapsed > budget){current.stats.overruns++;}
+
+		//one-shots and tasks that cancelled themselves are done
+		if(current.interval == 0 || _runningCancelled){
+			current.isUsed = false;
+			current.callback = nullptr;
+			_count--;
+			continue;
+		}
+
+		//keep a fixed rate, but skip runs that are already a whole interval late
+		current.due += current.interval;
+		uint32_t finished = millis();
+		if((int32_t)(finished - current.due) >= 0){
+			uint32_t missed = (finished - current.due) / current.interval + 1;
+			current.stats.skipped += missed;
+			current.due += missed * current.interval;
+		}
+		deferred[deferredCount++] = slot;
+		now = finished;
+	}
+
+	//a deferred task may have been cancelled (and its slot even reused) by a later task
+	for(uint8_t i = 0; i < deferredCount; i++){
+		if(_tasks[deferred[i]].isUsed && !onHeap(deferred[i])){push(deferred[i]);}
+	}
+
+	return ran;
+}
+
+
+/*
+how long until the next task is due (ie how long the caller can sleep)
+
+input: NA
+output:
+	uint32_t ms until the next task (0 if one is due, UINT32_MAX if there are no tasks)
+*/
+uint32_t ESPHelperScheduler::nextDue() const{
+	if(_heapSize == 0){return UINT32_MAX;}
+
+	int32_t remaining = (int32_t)(_tasks[_heap[0]].due - millis());
+	return remaining > 0 ? remaining : 0;
+}
+
+
+/*
+execution stats of a task
+
+input:
+	int task id
+output:
+	taskStats ptr (nullptr if there is no such task)
+*/
+const taskStats* ESPHelperScheduler::getStats(int id) const{
+	if(!valid(id)){return nullptr;}
+	return &_tasks[id].stats;
+}
+
+
+/*
+name a task was added with
+
+input:
+	int task id
+output:
+	char ptr to the name ("" if it has none, nullptr if there is no such task)
+*/
+const char* ESPHelperScheduler::getName(int id) const{
+	if(!valid(id)){return nullptr;}
+	return _tasks[id].name != nullptr ? _tasks[id].name : "";
+}
+
+
+/*
+task that has spent the most time running
+
+input: NA
+output:
+	int task id (TASK_INVALID if there are no tasks)
+*/
+int ESPHelperScheduler::busiest() const{
+	int busiest = TASK_INVALID;
+	for(int i = 0; i < MAX_SCHEDULED_TASKS; i++){
+		if(!_tasks[i].isUsed){continue;}
+		if(busiest == TASK_INVALID || _tasks[i].stats.totalUs > _tasks[busiest].stats.totalUs){busiest = i;}
+	}
+	return busiest;
+}
+
+
+/*
+clear the stats of every task
+
+input: NA
+output: NA
+*/
+void ESPHelperScheduler::resetStats(){
+	for(int i = 0; i < MAX_SCHEDULED_TASKS; i++){_tasks[i].stats = taskStats();}
+}
+
+
+/*
+put a task in a free slot and on the heap
+
+input:
+	uint32_t ms until the first run
+	uint32_t interval in ms (0 for a one-shot)
+	std::function<void()> to run
+	char ptr to the name
+	uint32_t budget in us
+output:
+	int task id (TASK_INVALID when the table is full)
+*/
+int ESPHelperScheduler::add(uint32_t delayMs, uint32_t intervalMs, std::function<void()>& callback, const char* name, uint32_t budgetUs){
+	if(!callback){return TASK_INVALID;}
+
+	for(int i = 0; i < MAX_SCHEDULED_TASKS; i++){
+		if(_tasks[i].isUsed){continue;}
+
+		task& newTask = _tasks[i];
+		newTask.isUsed = true;
+		newTask.name = name;
+		newTask.callback = callback;
+		newTask.interval = intervalMs;
+		newTask.budgetUs = budgetUs;
+		newTask.due = millis() + delayMs;
+		newTask.stats = taskStats();
+
+		_count++;
+		push(i);
+		return i;
+	}
+	return TASK_INVALID;
+}
+
+
+/*
+is id a task that exists
+
+input:
+	int task id
+output:
+	true on: the task exists
+	false on: out of range or free slot
+*/
+bool ESPHelperScheduler::valid(int id) const{
+	return id >= 0 && id < MAX_SCHEDULED_TASKS && _tasks[id].isUsed;
+}
+
+
+/*
+heap order - is task a due before task b (millis() wrap safe)
+
+input:
+	uint8_t task slot a
+	uint8_t task slot b
+output:
+	true on: a is due first
+	false on: b is due first or they are due together
+*/
+bool ESPHelperScheduler::before(uint8_t a, uint8_t b) const{
+	return (int32_t)(_tasks[a].due - _tasks[b].due) < 0;
+}
+
+
+/*
+is a task waiting on the heap (tasks run() has taken off and not yet put back are not)
+
+input:
+	uint8_t task slot
+output:
+	true on: the task is on the heap
+	false on: the task is off the heap
+*/
+bool ESPHelperScheduler::onHeap(uint8_t slot) const{
+	uint8_t index = _tasks[slot].heapIndex;
+	return index < _heapSize && _heap[index] == slot;
+}
+
+
+/*
+add a task to the end of the heap and move it up to its place
+
+input:
+	uint8_t task slot
+output: NA
+*/
+void ESPHelperScheduler::push(uint8_t slot){
+	uint8_t index = _heapSize;
+	_heap[index] = slot;
+	_tasks[slot].heapIndex = index;
+	_heapSize++;
+	siftUp(index);
+}
+
+
+/*
+take a task off the heap if it is on it (the last entry fills its place and is moved to where it belongs)
+
+input:
+	uint8_t task slot
+output: NA
+*/
+void ESPHelperScheduler::remove(uint8_t slot){
+	if(!onHeap(slot)){return;}
+
+	uint8_t index = _tasks[slot].heapIndex;
+	uint8_t last = --_heapSize;
+	if(index == last){return;}
+
+	swap(index, last);
+	siftDown(index);
+	siftUp(index);
+}
+
+
+/*
+move a heap entry towards the top until its parent is due before it
+
+input:
+	uint8_t heap index
+output: NA
+*/
+void ESPHelperScheduler::siftUp(uint8_t index){
+	while(index > 0){
+		uint8_t parent = (index - 1) / 2;
+		if(!before(_heap[index], _heap[parent])){return;}
+		swap(index, parent);
+		index = parent;
+	}
+}
+
+
+/*
+move a heap entry towards the bottom until both children are due after it
+
+input:
+	uint8_t heap index
+output: NA
+*/
+void ESPHelperScheduler::siftDown(uint8_t index){
+	while(true){
+		uint8_t child = index * 2 + 1;
+		if(child >= _heapSize){return;}
+		if(child + 1 < _heapSize && before(_heap[child + 1], _heap[child])){child++;}
+		if(!before(_heap[child], _heap[index])){return;}
+		swap(index, child);
+		index = child;
+	}
+}
+
+
+/*
+swap two heap entries and keep their tasks' heap indexes in step
+
+input:
+	uint8_t heap index a
+	uint8_t heap index b
+output: NA
+*/
+void ESPHelperScheduler::swap(uint8_t a, uint8_t b){
+	uint8_t slot = _heap[a];
+	_heap[a] = _heap[b];
+	_heap[b] = slot;
+	_tasks[_heap[a]].heapIndex = a;
+	_tasks[_heap[b]].heapIndex = b;
+}
@@ -0,0 +1,112 @@
+/*
+    ESPHelperScheduler.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#ifndef ESPHELPER_SCHEDULER_H
+#define ESPHELPER_SCHEDULER_H
+
+#include <Arduino.h>
+#include <functional>
+
+
+//max number of tasks (the task table and heap are fixed size)
+#ifndef MAX_SCHEDULED_TASKS
+#define MAX_SCHEDULED_TASKS 16
+#endif
+
+//returned by every()/after() when the task table is full
+#define TASK_INVALID -1
+
+
+struct taskStats {
+	uint32_t runs = 0;			//times the task has run
+	uint32_t lastUs = 0;		//execution time of the last run
+	uint32_t maxUs = 0;			//longest run
+	uint64_t totalUs = 0;		//time spent in the task altogether
+	uint32_t overruns = 0;		//runs that took longer than the task budget
+	uint32_t maxLateMs = 0;		//longest a run started after it was due
+	uint32_t skipped = 0;		//periodic runs dropped because the task fell a whole interval behind
+};
+
+
+/*
+Cooperative scheduler for periodic and one-shot tasks, run from ESPHelper::loop() after the
+network work. Tasks wait in a min-heap ordered by their deadline, so working out whether
+anything is due is one look at the top of the heap however many tasks there are.
+
+Each task has a budget (by default its interval for periodic tasks, none for one-shots). Every run
+is timed and runs over budget are counted, so getStats() shows which task is eating the loop.
+Periodic tasks keep a fixed rate - a task that falls a whole interval behind skips the missed
+runs instead of running back to back.
+
+	int id = myESP.getScheduler().every(10000, readSensor, "sensor");
+*/
+class ESPHelperScheduler {
+
+public:
+	int every(uint32_t intervalMs, std::function<void()> callback, const char* name = nullptr, uint32_t budgetUs = 0);
+	int after(uint32_t delayMs, std::function<void()> callback, const char* name = nullptr, uint32_t budgetUs = 0);
+	bool cancel(int id);
+	bool setInterval(int id, uint32_t intervalMs);
+	bool runNow(int id);
+
+	uint8_t run(uint32_t budgetUs = UINT32_MAX);
+	uint32_t nextDue() const;
+
+	const taskStats* getStats(int id) const;
+	const char* getName(int id) const;
+	int busiest() const;
+	void resetStats();
+	uint8_t count() const { return _count; }
+
+private:
+	struct task {
+		bool isUsed = false;
+		const char* name = nullptr;
+		std::function<void()> callback;
+		uint32_t interval = 0;		//0 for one-shot tasks
+		uint32_t budgetUs = 0;		//0 for no budget
+		uint32_t due = 0;
+		uint8_t heapIndex = 0;
+		taskStats stats;
+	};
+
+	int add(uint32_t delayMs, uint32_t intervalMs, std::function<void()>& callback, const char* name, uint32_t budgetUs);
+	bool valid(int id) const;
+	bool before(uint8_t a, uint8_t b) const;
+	bool onHeap(uint8_t slot) const;
+	void push(uint8_t slot);
+	void remove(uint8_t slot);
+	void siftUp(uint8_t index);
+	void siftDown(uint8_t index);
+	void swap(uint8_t a, uint8_t b);
+
+	task _tasks[MAX_SCHEDULED_TASKS];
+	uint8_t _heap[MAX_SCHEDULED_TASKS];		//task slots, soonest deadline first
+	uint8_t _heapSize = 0;
+	uint8_t _count = 0;						//tasks in use (including ones run() has taken off the heap)
+	int _running = TASK_INVALID;			//slot of the task currently running
+	bool _runningCancelled = false;
+};
+
+#endif
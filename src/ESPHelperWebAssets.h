@@ -0,0 +1,48 @@
+/*
+    ESPHelperWebAssets.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef ESPHELPER_WEB_ASSETS_H
+#define ESPHELPER_WEB_ASSETS_H
+
+#include <Arduino.h>
+
+
+/*
+One entry of a web asset bundle. web_to_header.py turns a directory of html/css/js/images into a
+header with the file contents (in flash) and a constexpr table of these, which
+ESPHelperWebConfig::addAssets() registers as routes in one go.
+
+Files are stored gzipped when that saves space and are served with their ETag so browsers only
+download them again when they change. Pages are static - anything that changes per device (ie the
+config page's current values) is fetched from a JSON endpoint by the page itself.
+*/
+struct webAsset {
+	const char* path;					//URI the asset is served on (its path below the bundled directory)
+	const char* mimeType;
+	const uint8_t* data;				//PROGMEM
+	uint32_t length;					//bytes stored (compressed size when gzip is set)
+	bool gzip;							//data is gzip encoded
+	const char* etag;					//quoted content hash (nullptr to send none)
+};
+
+#endif
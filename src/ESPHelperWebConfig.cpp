@@ -42,6 +42,18 @@ ESPHelperWebConfig::ESPHelperWebConfig(AsyncWebServer *server, const char* URI){
 }
 
 ESPHelperWebConfig::~ESPHelperWebConfig(){
+  if(_admission != nullptr){
+    _server->removeMiddleware(_admission);
+    delete _admission;
+  }
+  if(_bodyLimit != nullptr){
+    _server->removeHandler(_bodyLimit);
+    delete _bodyLimit;
+  }
+  if(_events != nullptr){
+    _server->removeHandler(_events);
+    delete _events;
+  }
   if(_runningLocal){
     _server->end(); // Stop the server
     delete _server;
@@ -58,6 +70,11 @@ bool ESPHelperWebConfig::begin(const char* _hostname){
 bool ESPHelperWebConfig::begin(){
   createSafeStringFromCharArray(resetURI, _resetURI);
   createSafeStringFromCharArray(pageURI, _pageURI);
+
+  //<pageURI>/values (without doubling the slash when the page is on "/")
+  size_t pageLength = strlen(_pageURI);
+  if(pageLength > 0 && _pageURI[pageLength - 1] == '/'){pageLength--;}
+  snprintf(_valuesURI, sizeof(_valuesURI), "%.*s/values", (int)pageLength, _pageURI);
   // Serial.printf("[ESPHelperWebConfig] Starting web config server on %s\n", pageURI.c_str());
   
 
@@ -65,17 +82,48 @@ bool ESPHelperWebConfig::begin(){
   //these handler function definitions use lambdas to pass the funtion... more information can be found here:
   //https://stackoverflow.com/questions/39803135/c-unresolved-overloaded-function-type
 
-  _server->on(pageURI.c_str(), HTTP_GET, [this](AsyncWebServerRequest *request){ 
-    //send back the config page using the handleGet function as the template processor
-    request->send_P(200, "text/html", static_config_html, sizeof(static_config_html), [this](const String& var){
-      return handleGet(var);
+  //admission control for everything on the server, so a reloading browser or a scanner can't starve MQTT
+  if(_admission == nullptr){
+    _admission = new AsyncMiddlewareFunction([this](AsyncWebServerRequest *request, ArMiddlewareNext next){
+      this->admit(request, next);
     });
+    _server->addMiddleware(_admission);
+  }
+
+  //handlers are matched in the order they are added, so this goes in before any that takes a body
+  if(_bodyLimit == nullptr){
+    _bodyLimit = new ESPHelperBodyLimit(_limits);
+    _server->addHandler(_bodyLimit);
+  }
+
+  //the current settings for the config page. This has to be registered before the page itself
+  //because the page handler also matches anything below its URI
+  _server->on(_valuesURI, HTTP_GET, [this](AsyncWebServerRequest *request){
+    this->handleConfigGet(request);
+  });
+
+  //the config page is the bundled /config.html, also served on the page URI
+  _server->on(pageURI.c_str(), HTTP_GET, [this](AsyncWebServerRequest *request){ 
+    if(_configPage != nullptr){this->serveAsset(request, *_configPage);}
+    else{request->send(404);}
   });    
 
+  addAssets(web_assets, web_assets_count);
+
   _server->on(pageURI.c_str(), HTTP_POST, [this](AsyncWebServerRequest *request){ 
     this->handlePost(request); 
   }); 
 
+  //JSON API for provisioning tools - GET returns the config (without secrets), PATCH changes any subset of it
+  _server->on(CONFIG_API_URI, HTTP_GET, [this](AsyncWebServerRequest *request){
+    this->handleConfigGet(request);
+  });
+  _server->on(CONFIG_API_URI, HTTP_PATCH, [this](AsyncWebServerRequest *request){
+    this->handleConfigPatch(request);
+  }, nullptr, [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total){
+    this->handleConfigBody(request, data, len, index, total);
+  });
+
   if(_resetSet){
     // Serial.printf("[ESPHelperWebConfig] Starting reset on %s\n", resetURI.c_str());
     //if the reset URI has been set then add a handler for it
@@ -84,6 +132,16 @@ bool ESPHelperWebConfig::begin(){
     });
   }
 
+  if(_keyStore != nullptr){
+    //key/value store - GET returns every key as JSON, POST sets one
+    _server->on(_keysURI, HTTP_GET, [this](AsyncWebServerRequest *request){
+      this->handleKeysGet(request);
+    });
+    _server->on(_keysURI, HTTP_POST, [this](AsyncWebServerRequest *request){
+      this->handleKeysPost(request);
+    });
+  }
+
   if(_runningLocal){
     _server->begin(); // Actually start the server
   }
@@ -102,6 +160,22 @@ void ESPHelperWebConfig::fillConfig(bool preFill){
 
 bool ESPHelperWebConfig::handle(){
 	// _server->handleClient();
+
+  //carry out a config reset requested through the reset URI. Only the config record goes - the
+  //key store, journal and anything else the sketch keeps on the filesystem survive
+  if(_resetRequested && millis() - _resetRequestTime >= RESET_RESPONSE_DELAY){
+    ESPHelperConfigStore::erase(_resetPath);
+    ESP.restart();
+  }
+
+  //write key store changes made through the web server
+  if(_keysChanged){
+    _keysChanged = false;
+    _keyStore->commit();
+  }
+
+  if(_events != nullptr){streamStatus();}
+
 	return _configChanged;
 }
 
@@ -114,97 +188,207 @@ NetInfo& ESPHelperWebConfig::getConfig(){
 
 
 
-//main config page that allows user to enter in configuration info
-String ESPHelperWebConfig::handleGet(const String& var){
+//register every asset of a bundle generated by web_to_header.py on its path
+void ESPHelperWebConfig::addAssets(const webAsset* assets, size_t count){
+  for(size_t i = 0; i < count; i++){
+    const webAsset* asset = &assets[i];
+
+    if(strcmp(asset->path, "/config.html") == 0){_configPage = asset;}
+    _server->on(asset->path, HTTP_GET, [this, asset](AsyncWebServerRequest *request){
+      this->serveAsset(request, *asset);
+    });
+  }
+}
+
+//send a bundled asset. Browsers keep a copy and check back with If-None-Match, which is answered
+//with an empty 304 until the asset changes. Only the gzip copy of a compressed asset is in flash,
+//so a client that refuses gzip gets a 406 rather than bytes it can't decode
+void ESPHelperWebConfig::serveAsset(AsyncWebServerRequest *request, const webAsset& asset){
+  if(asset.gzip && request->hasHeader("Accept-Encoding") && !acceptsGzip(request->getHeader("Accept-Encoding")->value().c_str())){
+    request->send(406, "text/plain", "406: this resource is only available gzip encoded");
+    return;
+  }
 
-  if(var == "HELPER_PAGE_URI")
-    return _pageURI;
-  else if(var == "HELPER_HOSTNAME")
-    return _config.getHostname();
-  else if(var == "HELPER_SSID")
-    return _config.getSsid();
-  else if(var == "HELPER_MQTT_HOST")
-    return _config.getMqttHost();
-  else if(var == "HELPER_MQTT_USER")
-    return _config.getMqttUser();
-  else if(var == "HELPER_MQTT_PORT")
-    return String(_config.getMqttPort());
-  else if(var == "HELPER_MQTT_WILL_TOPIC")
-    return _config.getMqttWillTopic();
-  else if(var == "HELPER_MQTT_WILL_MESSAGE")
-    return _config.getMqttWillMessage();
-  else if(var == "HELPER_MQTT_WILL_QOS")
-    return String(_config.getMqttWillQoS());
-  else if(var == "HELPER_MQTT_WILL_RETAIN_0")
-    return _config.getMqttWillRetain() ? "" : "selected";
-  else if(var == "HELPER_MQTT_WILL_RETAIN_1")
-    return _config.getMqttWillRetain() ? "selected" : "";
+  if(asset.etag != nullptr && request->hasHeader("If-None-Match") && request->getHeader("If-None-Match")->value() == asset.etag){
+    AsyncWebServerResponse *response = request->beginResponse(304);
+    response->addHeader("ETag", asset.etag);
+    request->send(response);
+    return;
+  }
 
-  return String();
+  AsyncWebServerResponse *response = request->beginResponse(200, asset.mimeType, asset.data, asset.length);
+  if(asset.gzip){
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("Vary", "Accept-Encoding");
+  }
+  if(asset.etag != nullptr){
+    response->addHeader("ETag", asset.etag);
+    response->addHeader("Cache-Control", "no-cache");
+  }
+  request->send(response);
 }
 
-// If a POST request is made to URI /config
-void ESPHelperWebConfig::handlePost(AsyncWebServerRequest *request) {
+//check an Accept-Encoding header for gzip, ie "gzip, deflate, br" or "identity;q=1, *;q=0.5".
+//Codings are case insensitive, a q value of 0 means "not acceptable" and gzip itself takes
+//precedence over "*"
+bool ESPHelperWebConfig::acceptsGzip(const char* acceptEncoding){
+  int gzipAccepted = -1;
+  int anyAccepted = -1;
+  const char* pos = acceptEncoding;
+  while(*pos != '\0'){
+    while(*pos == ' ' || *pos == '\t' || *pos == ','){pos++;}
+    const char* coding = pos;
+    while(*pos != '\0' && *pos != ',' && *pos != ';' && *pos != ' ' && *pos != '\t'){pos++;}
+    size_t codingLength = pos - coding;
+
+    //parameters - only q matters
+    bool refused = false;
+    while(*pos != '\0' && *pos != ','){
+      if((*pos == 'q' || *pos == 'Q') && pos[1] == '='){
+        const char* value = pos + 2;
+        refused = value[0] == '0';
+        for(const char* c = value + 1; refused && *c != '\0' && *c != ',' && *c != ';' && *c != ' '; c++){
+          if(*c != '.' && *c != '0'){refused = false;}
+        }
+      }
+      pos++;
+    }
+
+    if((codingLength == 4 && strncasecmp(coding, "gzip", 4) == 0) || (codingLength == 6 && strncasecmp(coding, "x-gzip", 6) == 0)){
+      gzipAccepted = refused ? 0 : 1;
+    }
+    else if(codingLength == 1 && coding[0] == '*'){anyAccepted = refused ? 0 : 1;}
+  }
+  return gzipAccepted >= 0 ? gzipAccepted == 1 : anyAccepted == 1;
+}
 
-  //make sure that all the arguments exist and that at least an SSID and hostname have been entered
-  if( ! request->hasArg("ssid") || ! request->hasArg("netPass")
-      || ! request->hasArg("hostname") || ! request->hasArg("mqttHost")
-      || ! request->hasArg("mqttUser") || ! request->hasArg("mqttPass")
-      || ! request->hasArg("mqttPort") || ! request->hasArg("otaPassword")
-      || request->arg("ssid") == NULL || request->arg("hostname") == NULL){ // If the POST request doesn't have username and password data
+//the current config as JSON, using the form field names. Passwords are never sent back
+void ESPHelperWebConfig::handleConfigGet(AsyncWebServerRequest *request){
+  JsonDocument doc;
+  ESPHelperConfigFields::toJson(_config, doc.to<JsonObject>());
 
-    request->send(400, "text/plain", "400: Invalid Request - Did you make sure to specify an SSID and Hostname?");  // The request is invalid, so send HTTP status 400
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->addHeader("Cache-Control", "no-store");
+  serializeJson(doc, *response);
+  request->send(response);
+}
+
+//collect a PATCH body, which can arrive in several pieces. The buffer is freed along with the request
+void ESPHelperWebConfig::handleConfigBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total){
+  if(index == 0 && total <= CONFIG_API_MAX_BODY){request->_tempObject = malloc(total);}
+  if(request->_tempObject == nullptr || index + len > total){return;}
+  memcpy((uint8_t*)request->_tempObject + index, data, len);
+}
+
+//apply a partial JSON config, ie {"mqttHost":"broker2.lan","mqttPort":8883}. Either every field is
+//applied or none is - the response lists each rejected field: {"ok":false,"errors":{"mqttPort":"invalid"}}
+void ESPHelperWebConfig::handleConfigPatch(AsyncWebServerRequest *request){
+  if(request->_tempObject == nullptr){
+    request->send(request->contentLength() > CONFIG_API_MAX_BODY ? 413 : 400, "application/json", "{\"ok\":false,\"error\":\"body\"}");
     return;
   }
 
-  //if there is an mqtt user/pass/port entered then there better also be a host!
-  if((request->arg("mqttUser") != NULL || request->arg("mqttPass") != NULL ||
-   request->arg("mqttPort") != NULL) && request->arg("mqttHost") == NULL){
-
-   request->send(400, "text/html",
-   String("<center>\
-   <meta name=\"viewport\" content=\"width=device-width, initial-scale=1, user-scalable=no\"/>\
-   <p><strong>400: Invalid Request - MQTT info specified without host</strong></p>\
-   <hr />\
-   <p><a href=" + String("config") + ">Open configuration page</a></p>").c_str());
+  JsonDocument doc;
+  if(deserializeJson(doc, (const char*)request->_tempObject, request->contentLength()) || !doc.is<JsonObjectConst>()){
+    request->send(400, "application/json", "{\"ok\":false,\"error\":\"parse\"}");
     return;
   }
+  JsonObjectConst patch = doc.as<JsonObjectConst>();
 
-  //convert the Strings returned by request->arg to char arrays that can be entered into NetInfo
+  JsonDocument result;
+  JsonObject errors = result["errors"].to<JsonObject>();
 
-  if(request->arg("netPass").length() != 0 or _preFill == false){
-    _config.setPass(request->arg("netPass").c_str());
+  //check every field before changing anything
+  for(JsonPairConst field : patch){
+    int id = ESPHelperConfigFields::find(field.key().c_str());
+    if(id < 0){errors[field.key()] = "unknown";}
+    else if(!ESPHelperConfigFields::validate((configFieldId)id, field.value())){errors[field.key()] = "invalid";}
   }
-  if(request->arg("mqttPass").length() != 0 or _preFill == false){
-    _config.setMqttPass(request->arg("mqttPass").c_str());
+
+  //merge into a copy - valid values can still overflow the config arena together
+  NetInfo staging;
+  staging.setConf(_config.getConf());
+  if(errors.size() == 0){
+    for(JsonPairConst field : patch){
+      if(!ESPHelperConfigFields::set(staging, (configFieldId)ESPHelperConfigFields::find(field.key().c_str()), field.value())){
+        errors[field.key()] = "size";
+      }
+    }
   }
-  if(request->arg("otaPassword").length() != 0 or _preFill == false){
-    _config.setOtaPassword(request->arg("otaPassword").c_str());
+
+  //same rules as the form (ie MQTT credentials without a host are rejected)
+  int broken = errors.size() == 0 ? ESPHelperConfigFields::checkRules(staging) : -1;
+  if(broken >= 0){errors[ESPHelperConfigFields::get((configFieldId)broken)->name] = "required";}
+
+  bool ok = errors.size() == 0;
+  result["ok"] = ok;
+  if(ok){
+    result.remove("errors");
+    _config.setConf(staging.getConf());
+    _configChanged = true;
   }
 
-  _config.setSsid(request->arg("ssid").c_str());
-  _config.setHostname(request->arg("hostname").c_str());
-  _config.setMqttHost(request->arg("mqttHost").c_str());
-  _config.setMqttUser(request->arg("mqttUser").c_str());
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->setCode(ok ? 200 : 422);
+  serializeJson(result, *response);
+  request->send(response);
+}
 
-  //the port is special because it doesnt get stored as a string so we take care of that
-  if(request->arg("mqttPort") != NULL){_config.setMqttPort(request->arg("mqttPort").toInt());}
-  else{_config.setMqttPort(1883);}
+// If a POST request is made to URI /config
+void ESPHelperWebConfig::handlePost(AsyncWebServerRequest *request) {
+
+  //one pass over the posted fields into a copy of the config, which is only kept if all of it is valid
+  NetInfo staging;
+  staging.setConf(_config.getConf());
+  uint32_t seen = 0;
+  int invalid = -1;
+
+  for(size_t i = 0; i < request->params() && invalid < 0; i++){
+    const AsyncWebParameter* param = request->getParam(i);
+    if(param->isFile()){continue;}
+
+    int id = ESPHelperConfigFields::find(param->name().c_str(), param->name().length());
+    if(id < 0){continue;}
+    seen |= 1UL << id;
 
-  // MQTT Will fields
-  if (request->hasArg("mqttWillTopic")) {
-    _config.setMqttWillTopic(request->arg("mqttWillTopic").c_str());
+    const configField* field = ESPHelperConfigFields::get((configFieldId)id);
+    const char* value = param->value().c_str();
+    bool blank = param->value().length() == 0;
+
+    //blank passwords keep the stored ones when the form was pre-filled (they are never sent to the page)
+    if(blank && (field->flags & FIELD_KEEP_IF_BLANK) && _preFill){continue;}
+
+    bool stored;
+    if(blank && field->type != FIELD_TYPE_STRING){stored = ESPHelperConfigFields::set(staging, (configFieldId)id, field->blankValue);}
+    else{stored = ESPHelperConfigFields::validate((configFieldId)id, value) && ESPHelperConfigFields::set(staging, (configFieldId)id, value);}
+    if(!stored){invalid = id;}
   }
-  if (request->hasArg("mqttWillMessage")) {
-    _config.setMqttWillMessage(request->arg("mqttWillMessage").c_str());
+
+  //make sure that at least an SSID and hostname have been entered
+  uint32_t required = (1UL << FIELD_SSID) | (1UL << FIELD_HOSTNAME);
+  if((seen & required) != required || invalid == FIELD_SSID || invalid == FIELD_HOSTNAME){
+    request->send(400, "text/plain", "400: Invalid Request - Did you make sure to specify an SSID and Hostname?");  // The request is invalid, so send HTTP status 400
+    return;
   }
-  if (request->hasArg("mqttWillQos")) {
-    _config.setMqttWillQoS(request->arg("mqttWillQos").toInt());
+
+  if(invalid >= 0){
+    request->send(400, "text/plain", String("400: Invalid Request - bad value for ") + ESPHelperConfigFields::get((configFieldId)invalid)->name);
+    return;
   }
-  if (request->hasArg("mqttWillRetain")) {
-    _config.setMqttWillRetain(request->arg("mqttWillRetain").toInt() == 1);
+
+  //if there is an mqtt user/pass entered then there better also be a host!
+  if(ESPHelperConfigFields::checkRules(staging) == FIELD_MQTT_HOST){
+   request->send(400, "text/html",
+   String("<center>\
+   <meta name=\"viewport\" content=\"width=device-width, initial-scale=1, user-scalable=no\"/>\
+   <p><strong>400: Invalid Request - MQTT info specified without host</strong></p>\
+   <hr />\
+   <p><a href=" + String("config") + ">Open configuration page</a></p>").c_str());
+    return;
   }
 
+  _config.setConf(staging.getConf());
+
   //tell the user that the config is loaded in and the module is restarting
   request->send(200, "text/html",
     String("<center>\
@@ -223,22 +407,269 @@ void ESPHelperWebConfig::handlePost(AsyncWebServerRequest *request) {
   _configChanged = true;
 }
 
-void ESPHelperWebConfig::setFlashReset(const char* uri){
+void ESPHelperWebConfig::setFlashReset(const char* uri, const char* configPath){
   createSafeStringFromCharArray(resetURI, _resetURI);
   resetURI.clear();
   resetURI.print(uri);
+  snprintf(_resetPath, sizeof(_resetPath), "%s", configPath);
   _resetSet = true;
 }
 
 void ESPHelperWebConfig::handleReset(AsyncWebServerRequest *request){
-  //tell the user that the config is loaded in and the module is restarting
-  #warning "TODO: Implement flash reset from web config"
-  // _server->send(200, "text/plain", String("Resetting SPIFFS and restarting with default values"));
+  //tell the user that the config is being reset and the module is restarting
+  request->send(200, "text/plain", "Resetting config and restarting with default values");
+
+  //the actual reset and restart happen from handle() (in the main loop) once the response has had time to go out
+  _resetRequested = true;
+  _resetRequestTime = millis();
+}
+
+void ESPHelperWebConfig::useKeyStore(ESPHelperKV& store, const char* uri){
+  _keyStore = &store;
+  createSafeStringFromCharArray(keysURI, _keysURI);
+  keysURI.clear();
+  keysURI.print(uri);
+}
+
+void ESPHelperWebConfig::handleKeysGet(AsyncWebServerRequest *request){
+  //stream the store straight into the response instead of building a String
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  _keyStore->printJson(*response);
+  request->send(response);
+}
+
+void ESPHelperWebConfig::handleKeysPost(AsyncWebServerRequest *request){
+  //expects key and value, optionally type (int, float, bool, string or blob) for new keys
+  if(!request->hasArg("key") || !request->hasArg("value") || request->arg("key").length() == 0){
+    request->send(400, "text/plain", "400: Invalid Request - key and value are required");
+    return;
+  }
+
+  kvType type = KV_STRING;
+  const String& typeName = request->arg("type");
+  if(typeName == "int"){type = KV_INT;}
+  else if(typeName == "float"){type = KV_FLOAT;}
+  else if(typeName == "bool"){type = KV_BOOL;}
+  else if(typeName == "blob"){type = KV_BLOB;}
+
+  if(!_keyStore->setFromString(request->arg("key").c_str(), request->arg("value").c_str(), type)){
+    request->send(400, "text/plain", "400: Invalid Request - value does not match the key type or the store is full");
+    return;
+  }
 
-  // LittleFS.format();
-  // ESP.restart();
+  request->send(200, "text/plain", "OK");
+  _keysChanged = true;
+}
+
+bool ESPHelperWebConfig::enableStatusStream(ESPHelper& helper, const char* uri, uint32_t interval){
+  //push status changes to any number of browsers (new EventSource(uri)) instead of them reloading a page
+  if(_events != nullptr){return false;}
+
+  _statusHelper = &helper;
+  _statusMetro.interval(interval);
+  strncpy(_eventsURI, uri, sizeof(_eventsURI) - 1);
+  _eventsURI[sizeof(_eventsURI) - 1] = '\0';
+  _events = new AsyncEventSource(uri);
+  _events->onConnect([this](AsyncEventSourceClient *client){
+    _statusFull = true;
+  });
+  _server->addHandler(_events);
+  return true;
+}
+
+void ESPHelperWebConfig::setStatusInterval(uint32_t interval){
+  _statusMetro.interval(interval);
+}
+
+//send a "status" event with the fields that changed since the last one, ie {"rssi":-61,"heap":31240}.
+//Connection status changes go out straight away, everything else once per interval
+void ESPHelperWebConfig::streamStatus(){
+  int status = _statusHelper->getStatus();
+  if(status == _lastStatus.status && !_statusMetro.check()){return;}
+  _statusMetro.reset();
+
+  //nobody is watching - start from a full event when someone does
+  if(_events->count() == 0){
+    _lastStatus.status = status;
+    _statusFull = true;
+    return;
+  }
+
+  statusSnapshot now;
+  now.status = status;
+  now.rssi = status >= WIFI_ONLY ? WiFi.RSSI() : 0;
+  now.rtt = _statusHelper->getBrokerRtt();
+  now.queueDepth = _statusHelper->getInboundQueueStats().depth;
+  now.queueOverflows = _statusHelper->getInboundQueueStats().overflows;
+  now.freeHeap = ESP.getFreeHeap();
+  #ifdef ESP8266
+  now.largestBlock = ESP.getMaxFreeBlockSize();
+  #else
+  now.largestBlock = ESP.getMaxAllocHeap();
+  #endif
+
+  bool full = _statusFull;
+  _statusFull = false;
+
+  char event[160] = "{";
+  size_t length = 1;
+  auto addField = [&](const char* name, int32_t value, int32_t last){
+    if(!full && value == last){return;}
+    length += snprintf(event + length, sizeof(event) - length, "%s\"%s\":%ld", length > 1 ? "," : "", name, (long)value);
+  };
+  addField("status", now.status, _lastStatus.status);
+  addField("rssi", now.rssi, _lastStatus.rssi);
+  addField("rtt", now.rtt, _lastStatus.rtt);
+  addField("queue", now.queueDepth, _lastStatus.queueDepth);
+  addField("drops", now.queueOverflows, _lastStatus.queueOverflows);
+  addField("heap", now.freeHeap, _lastStatus.freeHeap);
+  addField("block", now.largestBlock, _lastStatus.largestBlock);
+  _lastStatus = now;
+
+  if(length == 1){return;}
+  snprintf(event + length, sizeof(event) - length, "}");
+  _events->send(event, "status", ++_statusEventId);
+}
+
+void ESPHelperWebConfig::setAdmissionLimits(const admissionLimits& limits){
+  _limits = limits;
+}
+
+const admissionStats& ESPHelperWebConfig::getAdmissionStats(){
+  return _admissionStats;
+}
+
+//decide whether a request gets handled. Cheapest checks first - a rejected request costs a status
+//code and no handler work. Runs in the web server's context
+void ESPHelperWebConfig::admit(AsyncWebServerRequest *request, ArMiddlewareNext next){
+  if(_limits.minFreeHeap > 0 && ESP.getFreeHeap() < _limits.minFreeHeap){
+    reject(request, 503, _admissionStats.rejectedHeap);
+    return;
+  }
+
+  //the body was skipped rather than buffered - see ESPHelperBodyLimit
+  if(_limits.maxBody > 0 && request->contentLength() > _limits.maxBody){
+    reject(request, 413, _admissionStats.rejectedBody);
+    return;
+  }
+
+  if(_limits.ratePerSecond > 0 && !takeToken(request->client()->remoteIP())){
+    reject(request, 429, _admissionStats.rejectedRate);
+    return;
+  }
+
+  //status stream viewers stay connected so they are not counted as requests in flight
+  if((_events == nullptr || request->url() != _eventsURI) && !trackRequest(request)){
+    reject(request, 503, _admissionStats.rejectedBusy);
+    return;
+  }
+
+  _admissionStats.served++;
+  next();
+}
+
+void ESPHelperWebConfig::reject(AsyncWebServerRequest *request, int code, uint32_t& counter){
+  counter++;
+  AsyncWebServerResponse *response = request->beginResponse(code);
+  if(code != 413){response->addHeader("Retry-After", "1");}
+  request->send(response);
+}
+
+//count a request as in flight until its client disconnects. The request only has one disconnect
+//callback, so a handler on a shared server that sets its own would stop this one from running -
+//requests are also dropped from the table after ADMISSION_REQUEST_TIMEOUT so a lost callback
+//can't keep a slot forever. Returns false when maxConcurrent requests are already in flight
+bool ESPHelperWebConfig::trackRequest(AsyncWebServerRequest *request){
+  expireRequests();
+
+  uint8_t limit = _limits.maxConcurrent > 0 && _limits.maxConcurrent < ADMISSION_MAX_IN_FLIGHT ? _limits.maxConcurrent : ADMISSION_MAX_IN_FLIGHT;
+  int slot = -1;
+  bool stale = false;
+  for(int i = 0; i < ADMISSION_MAX_IN_FLIGHT; i++){
+    //the same address again means the old request is gone and its callback never ran
+    if(_inFlight[i].request == request){
+      slot = i;
+      stale = true;
+      break;
+    }
+    if(_inFlight[i].request == nullptr && slot < 0){slot = i;}
+  }
+
+  if(!stale){
+    //without a limit the table is only there for the stats - a full one just isn't tracked
+    if(_admissionStats.inFlight >= limit){return _limits.maxConcurrent == 0;}
+    _admissionStats.inFlight++;
+  }
+
+  _inFlight[slot].request = request;
+  _inFlight[slot].since = millis();
+  request->onDisconnect([this, request](){
+    this->releaseRequest(request);
+  });
+  return true;
+}
+
+void ESPHelperWebConfig::releaseRequest(AsyncWebServerRequest *request){
+  for(int i = 0; i < ADMISSION_MAX_IN_FLIGHT; i++){
+    if(_inFlight[i].request == request){
+      _inFlight[i].request = nullptr;
+      _admissionStats.inFlight--;
+      return;
+    }
+  }
+}
+
+void ESPHelperWebConfig::expireRequests(){
+  unsigned long now = millis();
+  for(int i = 0; i < ADMISSION_MAX_IN_FLIGHT; i++){
+    if(_inFlight[i].request != nullptr && now - _inFlight[i].since >= ADMISSION_REQUEST_TIMEOUT){
+      _inFlight[i].request = nullptr;
+      _admissionStats.inFlight--;
+    }
+  }
+}
+
+//token bucket per client IP - refills at ratePerSecond up to burst, each request takes one token
+bool ESPHelperWebConfig::takeToken(uint32_t ip){
+  unsigned long now = millis();
+  clientBucket* bucket = nullptr;
+  clientBucket* oldest = &_buckets[0];
+  for(int i = 0; i < ADMISSION_CLIENTS; i++){
+    if(_buckets[i].ip == ip && _buckets[i].lastRefill != 0){
+      bucket = &_buckets[i];
+      break;
+    }
+    if(_buckets[i].lastRefill < oldest->lastRefill){oldest = &_buckets[i];}
+  }
+
+  uint32_t capacity = (uint32_t)_limits.burst * 1000;
+  if(bucket == nullptr){
+    bucket = oldest;
+    bucket->ip = ip;
+    bucket->tokens = capacity;
+  }
+  else{
+    //ms * requests/s = 1/1000 requests
+    uint64_t refilled = bucket->tokens + (uint64_t)(now - bucket->lastRefill) * _limits.ratePerSecond;
+    bucket->tokens = refilled > capacity ? capacity : (uint32_t)refilled;
+  }
+  bucket->lastRefill = now == 0 ? 1 : now;
+
+  if(bucket->tokens < 1000){return false;}
+  bucket->tokens -= 1000;
+  return true;
 }
 
 void ESPHelperWebConfig::handleNotFound(AsyncWebServerRequest *request){
   request->send(404, "text/plain", "404: Not found"); // Send HTTP status 404 (Not Found) when there's no handler for the URI in the request
 }
+
+
+bool ESPHelperBodyLimit::canHandle(AsyncWebServerRequest *request) const{
+  return _limits.maxBody > 0 && request->contentLength() > _limits.maxBody;
+}
+
+//only reached if the admission middleware was removed - admit() normally answers first
+void ESPHelperBodyLimit::handleRequest(AsyncWebServerRequest *request){
+  request->send(413);
+}
@@ -40,7 +40,66 @@ along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
 #include <WiFiClient.h>
 #include "SafeString.h"
 
-#include "config_html.h"
+#include "ESPHelperConfigStore.h"
+#include "ESPHelperConfigFields.h"
+#include "web_assets.h"
+
+
+//time (ms) given to the reset response to reach the browser before the config is removed and the device restarts
+#define RESET_RESPONSE_DELAY 500
+
+//JSON config API (GET/PATCH) and the largest PATCH body it accepts
+#define CONFIG_API_URI "/api/config"
+#define CONFIG_API_MAX_BODY 1024
+
+//status event stream (Server-Sent Events) defaults
+#define DEFAULT_STATUS_STREAM_URI "/events"
+#define DEFAULT_STATUS_STREAM_INTERVAL 1000
+
+//request admission defaults (0 disables a limit)
+#define DEFAULT_ADMISSION_MAX_CONCURRENT 4		//requests being handled at once (status stream viewers don't count)
+#define DEFAULT_ADMISSION_MAX_BODY 4096			//bytes
+#define DEFAULT_ADMISSION_RATE 5				//requests per second per client IP
+#define DEFAULT_ADMISSION_BURST 20				//requests a client IP can make back to back
+#define DEFAULT_ADMISSION_MIN_HEAP 8192			//free heap (bytes) below which requests are refused
+#define ADMISSION_CLIENTS 8						//client IPs tracked for rate limiting (least recently seen is replaced)
+#define ADMISSION_MAX_IN_FLIGHT 8				//requests tracked as in flight (caps maxConcurrent)
+#define ADMISSION_REQUEST_TIMEOUT 30000			//ms after which a request whose disconnect was never reported stops counting
+
+
+struct admissionLimits {
+	uint8_t maxConcurrent = DEFAULT_ADMISSION_MAX_CONCURRENT;	//at most ADMISSION_MAX_IN_FLIGHT
+	uint32_t maxBody = DEFAULT_ADMISSION_MAX_BODY;
+	uint16_t ratePerSecond = DEFAULT_ADMISSION_RATE;
+	uint16_t burst = DEFAULT_ADMISSION_BURST;
+	uint32_t minFreeHeap = DEFAULT_ADMISSION_MIN_HEAP;
+};
+
+struct admissionStats {
+	uint32_t served = 0;			//requests passed on to a handler
+	uint32_t rejectedHeap = 0;		//503 - free heap below minFreeHeap
+	uint32_t rejectedBody = 0;		//413 - body larger than maxBody
+	uint32_t rejectedRate = 0;		//429 - client IP out of tokens
+	uint32_t rejectedBusy = 0;		//503 - maxConcurrent requests already in flight
+	uint8_t inFlight = 0;			//requests currently being handled
+};
+
+
+/*
+Catches requests with a Content-Length over admissionLimits.maxBody as soon as their headers are in.
+It is a trivial handler (no request/body/upload callbacks), so the server skips the body of a
+request it catches instead of buffering or parsing it, and admit() then answers with a 413.
+*/
+class ESPHelperBodyLimit : public AsyncWebHandler {
+public:
+	explicit ESPHelperBodyLimit(const admissionLimits& limits) : _limits(limits) {}
+
+	bool canHandle(AsyncWebServerRequest *request) const override;
+	void handleRequest(AsyncWebServerRequest *request) override;
+
+private:
+	const admissionLimits& _limits;
+};
 
 
 
@@ -62,23 +121,92 @@ public:
 
     NetInfo& getConfig();
 
-    void setFlashReset(const char* uri);
+    void setFlashReset(const char* uri, const char* configPath = DEFAULT_CONFIG_PATH);
+
+    void useKeyStore(ESPHelperKV& store, const char* uri = "/keys");
+
+    void addAssets(const webAsset* assets, size_t count);
+
+    void setAdmissionLimits(const admissionLimits& limits);
+    const admissionStats& getAdmissionStats();
+
+    bool enableStatusStream(ESPHelper& helper, const char* uri = DEFAULT_STATUS_STREAM_URI, uint32_t interval = DEFAULT_STATUS_STREAM_INTERVAL);
+    void setStatusInterval(uint32_t interval);
 
 
 private:
-    String handleGet(const String& var);
+    void serveAsset(AsyncWebServerRequest *request, const webAsset& asset);
+    static bool acceptsGzip(const char* acceptEncoding);
+    void handleConfigGet(AsyncWebServerRequest *request);
+    void handleConfigBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total);
+    void handleConfigPatch(AsyncWebServerRequest *request);
     void handlePost(AsyncWebServerRequest *request);
     void handleNotFound(AsyncWebServerRequest *request);
     void handleReset(AsyncWebServerRequest *request);
+    void handleKeysGet(AsyncWebServerRequest *request);
+    void handleKeysPost(AsyncWebServerRequest *request);
+    void streamStatus();
+    void admit(AsyncWebServerRequest *request, ArMiddlewareNext next);
+    void reject(AsyncWebServerRequest *request, int code, uint32_t& counter);
+    bool trackRequest(AsyncWebServerRequest *request);
+    void releaseRequest(AsyncWebServerRequest *request);
+    void expireRequests();
+    bool takeToken(uint32_t ip);
 
     AsyncWebServer *_server;
     
     char _resetURI[64];
+    char _resetPath[64];  //config record removed by a reset (the rest of the filesystem is kept)
     char _pageURI[64];
+    char _valuesURI[72];
+    const webAsset* _configPage = nullptr;
 
     bool _preFill = false;
 
     bool _resetSet = false;
+    //set from the (async) web server context and acted on in handle()
+    volatile bool _resetRequested = false;
+    volatile unsigned long _resetRequestTime = 0;
+
+    //optional key/value store exposed on _keysURI (changes are committed from handle())
+    ESPHelperKV* _keyStore = nullptr;
+    char _keysURI[64];
+    volatile bool _keysChanged = false;
+
+    //optional status event stream - one delta event per tick is shared by every viewer
+    struct statusSnapshot {
+      int32_t status = -1;
+      int32_t rssi = 0;
+      int32_t rtt = 0;
+      int32_t queueDepth = 0;
+      int32_t queueOverflows = 0;
+      int32_t freeHeap = 0;
+      int32_t largestBlock = 0;
+    };
+    ESPHelper* _statusHelper = nullptr;
+    AsyncEventSource* _events = nullptr;
+    Metro _statusMetro = Metro(DEFAULT_STATUS_STREAM_INTERVAL);
+    statusSnapshot _lastStatus;
+    uint32_t _statusEventId = 0;
+    volatile bool _statusFull = true;    //set when a viewer connects so the next event has every field
+    char _eventsURI[64];
+
+    //admission control, run by the server before any handler (see admit())
+    struct clientBucket {
+      uint32_t ip = 0;
+      uint32_t tokens = 0;           //in 1/1000 requests
+      unsigned long lastRefill = 0;
+    };
+    struct inFlightRequest {
+      AsyncWebServerRequest* request = nullptr;
+      unsigned long since = 0;
+    };
+    AsyncMiddlewareFunction* _admission = nullptr;
+    ESPHelperBodyLimit* _bodyLimit = nullptr;
+    admissionLimits _limits;
+    admissionStats _admissionStats;
+    clientBucket _buckets[ADMISSION_CLIENTS];
+    inFlightRequest _inFlight[ADMISSION_MAX_IN_FLIGHT];
 
     NetInfo _config;
     bool _runningLocal = false;
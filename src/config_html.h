@@ -1,254 +0,0 @@
-#pragma once
-
-inline unsigned char static_config_html[] PROGMEM = {
-  0x3c, 0x21, 0x64, 0x6f, 0x63, 0x74, 0x79, 0x70, 0x65, 0x20, 0x68, 0x74,
-  0x6d, 0x6c, 0x3e, 0x3c, 0x68, 0x74, 0x6d, 0x6c, 0x20, 0x6c, 0x61, 0x6e,
-  0x67, 0x3d, 0x65, 0x6e, 0x3e, 0x3c, 0x6d, 0x65, 0x74, 0x61, 0x20, 0x63,
-  0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74, 0x3d, 0x22, 0x77, 0x69, 0x64, 0x74,
-  0x68, 0x3d, 0x64, 0x65, 0x76, 0x69, 0x63, 0x65, 0x2d, 0x77, 0x69, 0x64,
-  0x74, 0x68, 0x2c, 0x69, 0x6e, 0x69, 0x74, 0x69, 0x61, 0x6c, 0x2d, 0x73,
-  0x63, 0x61, 0x6c, 0x65, 0x3d, 0x31, 0x2c, 0x75, 0x73, 0x65, 0x72, 0x2d,
-  0x73, 0x63, 0x61, 0x6c, 0x61, 0x62, 0x6c, 0x65, 0x3d, 0x6e, 0x6f, 0x22,
-  0x20, 0x6e, 0x61, 0x6d, 0x65, 0x3d, 0x76, 0x69, 0x65, 0x77, 0x70, 0x6f,
-  0x72, 0x74, 0x3e, 0x3c, 0x74, 0x69, 0x74, 0x6c, 0x65, 0x3e, 0x53, 0x79,
-  0x73, 0x74, 0x65, 0x6d, 0x20, 0x43, 0x6f, 0x6e, 0x66, 0x69, 0x67, 0x75,
-  0x72, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x3c, 0x2f, 0x74, 0x69, 0x74, 0x6c,
-  0x65, 0x3e, 0x3c, 0x73, 0x74, 0x79, 0x6c, 0x65, 0x3e, 0x62, 0x6f, 0x64,
-  0x79, 0x20, 0x7b, 0x20, 0x62, 0x61, 0x63, 0x6b, 0x67, 0x72, 0x6f, 0x75,
-  0x6e, 0x64, 0x2d, 0x63, 0x6f, 0x6c, 0x6f, 0x72, 0x3a, 0x23, 0x30, 0x30,
-  0x64, 0x66, 0x66, 0x66, 0x3b, 0x20, 0x66, 0x6f, 0x6e, 0x74, 0x2d, 0x66,
-  0x61, 0x6d, 0x69, 0x6c, 0x79, 0x3a, 0x76, 0x65, 0x72, 0x64, 0x61, 0x6e,
-  0x61, 0x3b, 0x20, 0x6d, 0x61, 0x72, 0x67, 0x69, 0x6e, 0x3a, 0x30, 0x3b,
-  0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x2e,
-  0x63, 0x65, 0x6e, 0x74, 0x65, 0x72, 0x2d, 0x63, 0x6f, 0x6e, 0x74, 0x61,
-  0x69, 0x6e, 0x65, 0x72, 0x20, 0x7b, 0x20, 0x64, 0x69, 0x73, 0x70, 0x6c,
-  0x61, 0x79, 0x3a, 0x66, 0x6c, 0x65, 0x78, 0x3b, 0x20, 0x6a, 0x75, 0x73,
-  0x74, 0x69, 0x66, 0x79, 0x2d, 0x63, 0x6f, 0x6e, 0x74, 0x65, 0x6e, 0x74,
-  0x3a, 0x63, 0x65, 0x6e, 0x74, 0x65, 0x72, 0x3b, 0x20, 0x61, 0x6c, 0x69,
-  0x67, 0x6e, 0x2d, 0x69, 0x74, 0x65, 0x6d, 0x73, 0x3a, 0x63, 0x65, 0x6e,
-  0x74, 0x65, 0x72, 0x3b, 0x20, 0x6d, 0x69, 0x6e, 0x2d, 0x68, 0x65, 0x69,
-  0x67, 0x68, 0x74, 0x3a, 0x31, 0x30, 0x30, 0x76, 0x68, 0x3b, 0x20, 0x7d,
-  0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x2e, 0x63, 0x6f,
-  0x6e, 0x66, 0x69, 0x67, 0x2d, 0x62, 0x6f, 0x78, 0x20, 0x7b, 0x20, 0x62,
-  0x61, 0x63, 0x6b, 0x67, 0x72, 0x6f, 0x75, 0x6e, 0x64, 0x3a, 0x23, 0x66,
-  0x66, 0x66, 0x3b, 0x20, 0x70, 0x61, 0x64, 0x64, 0x69, 0x6e, 0x67, 0x3a,
-  0x33, 0x32, 0x70, 0x78, 0x20, 0x32, 0x34, 0x70, 0x78, 0x3b, 0x20, 0x62,
-  0x6f, 0x72, 0x64, 0x65, 0x72, 0x2d, 0x72, 0x61, 0x64, 0x69, 0x75, 0x73,
-  0x3a, 0x31, 0x32, 0x70, 0x78, 0x3b, 0x20, 0x62, 0x6f, 0x78, 0x2d, 0x73,
-  0x68, 0x61, 0x64, 0x6f, 0x77, 0x3a, 0x30, 0x20, 0x32, 0x70, 0x78, 0x20,
-  0x31, 0x32, 0x70, 0x78, 0x20, 0x72, 0x67, 0x62, 0x61, 0x28, 0x30, 0x2c,
-  0x30, 0x2c, 0x30, 0x2c, 0x30, 0x2e, 0x31, 0x35, 0x29, 0x3b, 0x20, 0x6d,
-  0x69, 0x6e, 0x2d, 0x77, 0x69, 0x64, 0x74, 0x68, 0x3a, 0x33, 0x32, 0x30,
-  0x70, 0x78, 0x3b, 0x20, 0x6d, 0x61, 0x78, 0x2d, 0x77, 0x69, 0x64, 0x74,
-  0x68, 0x3a, 0x34, 0x30, 0x30, 0x70, 0x78, 0x3b, 0x20, 0x74, 0x65, 0x78,
-  0x74, 0x2d, 0x61, 0x6c, 0x69, 0x67, 0x6e, 0x3a, 0x6c, 0x65, 0x66, 0x74,
-  0x3b, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x2e, 0x63, 0x6f, 0x6e, 0x66, 0x69, 0x67, 0x2d, 0x62, 0x6f, 0x78, 0x20,
-  0x68, 0x33, 0x2c, 0x20, 0x2e, 0x63, 0x6f, 0x6e, 0x66, 0x69, 0x67, 0x2d,
-  0x62, 0x6f, 0x78, 0x20, 0x68, 0x34, 0x20, 0x7b, 0x20, 0x74, 0x65, 0x78,
-  0x74, 0x2d, 0x61, 0x6c, 0x69, 0x67, 0x6e, 0x3a, 0x63, 0x65, 0x6e, 0x74,
-  0x65, 0x72, 0x3b, 0x20, 0x6d, 0x61, 0x72, 0x67, 0x69, 0x6e, 0x2d, 0x74,
-  0x6f, 0x70, 0x3a, 0x30, 0x3b, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x20, 0x20, 0x2e, 0x63, 0x6f, 0x6e, 0x66, 0x69, 0x67, 0x2d,
-  0x62, 0x6f, 0x78, 0x20, 0x68, 0x72, 0x20, 0x7b, 0x20, 0x6d, 0x61, 0x72,
-  0x67, 0x69, 0x6e, 0x3a, 0x31, 0x38, 0x70, 0x78, 0x20, 0x30, 0x3b, 0x20,
-  0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x2e, 0x63,
-  0x6f, 0x6e, 0x66, 0x69, 0x67, 0x2d, 0x62, 0x6f, 0x78, 0x20, 0x69, 0x6e,
-  0x70, 0x75, 0x74, 0x2c, 0x20, 0x2e, 0x63, 0x6f, 0x6e, 0x66, 0x69, 0x67,
-  0x2d, 0x62, 0x6f, 0x78, 0x20, 0x73, 0x65, 0x6c, 0x65, 0x63, 0x74, 0x20,
-  0x7b, 0x20, 0x77, 0x69, 0x64, 0x74, 0x68, 0x3a, 0x31, 0x30, 0x30, 0x25,
-  0x3b, 0x20, 0x6d, 0x61, 0x72, 0x67, 0x69, 0x6e, 0x2d, 0x62, 0x6f, 0x74,
-  0x74, 0x6f, 0x6d, 0x3a, 0x31, 0x30, 0x70, 0x78, 0x3b, 0x20, 0x70, 0x61,
-  0x64, 0x64, 0x69, 0x6e, 0x67, 0x3a, 0x36, 0x70, 0x78, 0x3b, 0x20, 0x62,
-  0x6f, 0x72, 0x64, 0x65, 0x72, 0x2d, 0x72, 0x61, 0x64, 0x69, 0x75, 0x73,
-  0x3a, 0x34, 0x70, 0x78, 0x3b, 0x20, 0x62, 0x6f, 0x72, 0x64, 0x65, 0x72,
-  0x3a, 0x31, 0x70, 0x78, 0x20, 0x73, 0x6f, 0x6c, 0x69, 0x64, 0x20, 0x23,
-  0x63, 0x63, 0x63, 0x3b, 0x20, 0x62, 0x6f, 0x78, 0x2d, 0x73, 0x69, 0x7a,
-  0x69, 0x6e, 0x67, 0x3a, 0x62, 0x6f, 0x72, 0x64, 0x65, 0x72, 0x2d, 0x62,
-  0x6f, 0x78, 0x3b, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
-  0x20, 0x20, 0x2e, 0x63, 0x6f, 0x6e, 0x66, 0x69, 0x67, 0x2d, 0x62, 0x6f,
-  0x78, 0x20, 0x69, 0x6e, 0x70, 0x75, 0x74, 0x5b, 0x74, 0x79, 0x70, 0x65,
-  0x3d, 0x73, 0x75, 0x62, 0x6d, 0x69, 0x74, 0x5d, 0x20, 0x7b, 0x20, 0x77,
-  0x69, 0x64, 0x74, 0x68, 0x3a, 0x61, 0x75, 0x74, 0x6f, 0x3b, 0x20, 0x62,
-  0x61, 0x63, 0x6b, 0x67, 0x72, 0x6f, 0x75, 0x6e, 0x64, 0x3a, 0x23, 0x30,
-  0x30, 0x64, 0x66, 0x66, 0x66, 0x3b, 0x20, 0x63, 0x6f, 0x6c, 0x6f, 0x72,
-  0x3a, 0x23, 0x66, 0x66, 0x66, 0x3b, 0x20, 0x62, 0x6f, 0x72, 0x64, 0x65,
-  0x72, 0x3a, 0x6e, 0x6f, 0x6e, 0x65, 0x3b, 0x20, 0x63, 0x75, 0x72, 0x73,
-  0x6f, 0x72, 0x3a, 0x70, 0x6f, 0x69, 0x6e, 0x74, 0x65, 0x72, 0x3b, 0x20,
-  0x70, 0x61, 0x64, 0x64, 0x69, 0x6e, 0x67, 0x3a, 0x38, 0x70, 0x78, 0x20,
-  0x31, 0x38, 0x70, 0x78, 0x3b, 0x20, 0x62, 0x6f, 0x72, 0x64, 0x65, 0x72,
-  0x2d, 0x72, 0x61, 0x64, 0x69, 0x75, 0x73, 0x3a, 0x34, 0x70, 0x78, 0x3b,
-  0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x2e,
-  0x63, 0x6f, 0x6e, 0x66, 0x69, 0x67, 0x2d, 0x62, 0x6f, 0x78, 0x20, 0x69,
-  0x6e, 0x70, 0x75, 0x74, 0x5b, 0x74, 0x79, 0x70, 0x65, 0x3d, 0x73, 0x75,
-  0x62, 0x6d, 0x69, 0x74, 0x5d, 0x3a, 0x68, 0x6f, 0x76, 0x65, 0x72, 0x20,
-  0x7b, 0x20, 0x62, 0x61, 0x63, 0x6b, 0x67, 0x72, 0x6f, 0x75, 0x6e, 0x64,
-  0x3a, 0x23, 0x30, 0x61, 0x34, 0x66, 0x37, 0x35, 0x3b, 0x20, 0x7d, 0x0a,
-  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x2e, 0x63, 0x6f, 0x6e,
-  0x66, 0x69, 0x67, 0x2d, 0x62, 0x6f, 0x78, 0x20, 0x70, 0x2c, 0x20, 0x2e,
-  0x63, 0x6f, 0x6e, 0x66, 0x69, 0x67, 0x2d, 0x62, 0x6f, 0x78, 0x20, 0x61,
-  0x20, 0x7b, 0x20, 0x74, 0x65, 0x78, 0x74, 0x2d, 0x61, 0x6c, 0x69, 0x67,
-  0x6e, 0x3a, 0x63, 0x65, 0x6e, 0x74, 0x65, 0x72, 0x3b, 0x20, 0x64, 0x69,
-  0x73, 0x70, 0x6c, 0x61, 0x79, 0x3a, 0x62, 0x6c, 0x6f, 0x63, 0x6b, 0x3b,
-  0x20, 0x6d, 0x61, 0x72, 0x67, 0x69, 0x6e, 0x3a, 0x31, 0x30, 0x70, 0x78,
-  0x20, 0x30, 0x20, 0x30, 0x20, 0x30, 0x3b, 0x20, 0x7d, 0x3c, 0x2f, 0x73,
-  0x74, 0x79, 0x6c, 0x65, 0x3e, 0x3c, 0x62, 0x6f, 0x64, 0x79, 0x3e, 0x3c,
-  0x64, 0x69, 0x76, 0x20, 0x63, 0x6c, 0x61, 0x73, 0x73, 0x3d, 0x63, 0x65,
-  0x6e, 0x74, 0x65, 0x72, 0x2d, 0x63, 0x6f, 0x6e, 0x74, 0x61, 0x69, 0x6e,
-  0x65, 0x72, 0x3e, 0x3c, 0x64, 0x69, 0x76, 0x20, 0x63, 0x6c, 0x61, 0x73,
-  0x73, 0x3d, 0x63, 0x6f, 0x6e, 0x66, 0x69, 0x67, 0x2d, 0x62, 0x6f, 0x78,
-  0x3e, 0x3c, 0x68, 0x33, 0x3e, 0x3c, 0x73, 0x70, 0x61, 0x6e, 0x20, 0x73,
-  0x74, 0x79, 0x6c, 0x65, 0x3d, 0x63, 0x6f, 0x6c, 0x6f, 0x72, 0x3a, 0x23,
-  0x30, 0x61, 0x34, 0x66, 0x37, 0x35, 0x3b, 0x3e, 0x3c, 0x73, 0x74, 0x72,
-  0x6f, 0x6e, 0x67, 0x3e, 0x45, 0x53, 0x50, 0x38, 0x32, 0x36, 0x36, 0x20,
-  0x53, 0x79, 0x73, 0x74, 0x65, 0x6d, 0x20, 0x43, 0x6f, 0x6e, 0x66, 0x69,
-  0x67, 0x75, 0x72, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x3c, 0x2f, 0x73, 0x74,
-  0x72, 0x6f, 0x6e, 0x67, 0x3e, 0x3c, 0x2f, 0x73, 0x70, 0x61, 0x6e, 0x3e,
-  0x3c, 0x2f, 0x68, 0x33, 0x3e, 0x3c, 0x68, 0x72, 0x3e, 0x3c, 0x66, 0x6f,
-  0x72, 0x6d, 0x20, 0x61, 0x63, 0x74, 0x69, 0x6f, 0x6e, 0x3d, 0x25, 0x48,
-  0x45, 0x4c, 0x50, 0x45, 0x52, 0x5f, 0x50, 0x41, 0x47, 0x45, 0x5f, 0x55,
-  0x52, 0x49, 0x25, 0x20, 0x6d, 0x65, 0x74, 0x68, 0x6f, 0x64, 0x3d, 0x50,
-  0x4f, 0x53, 0x54, 0x3e, 0x44, 0x65, 0x76, 0x69, 0x63, 0x65, 0x20, 0x4e,
-  0x61, 0x6d, 0x65, 0x3a, 0x3c, 0x62, 0x72, 0x3e, 0x3c, 0x69, 0x6e, 0x70,
-  0x75, 0x74, 0x20, 0x70, 0x6c, 0x61, 0x63, 0x65, 0x68, 0x6f, 0x6c, 0x64,
-  0x65, 0x72, 0x3d, 0x22, 0x44, 0x65, 0x76, 0x69, 0x63, 0x65, 0x20, 0x48,
-  0x6f, 0x73, 0x74, 0x6e, 0x61, 0x6d, 0x65, 0x20, 0x20, 0x28, 0x52, 0x65,
-  0x71, 0x75, 0x69, 0x72, 0x65, 0x64, 0x29, 0x22, 0x20, 0x6d, 0x61, 0x78,
-  0x6c, 0x65, 0x6e, 0x67, 0x74, 0x68, 0x3d, 0x33, 0x32, 0x20, 0x6e, 0x61,
-  0x6d, 0x65, 0x3d, 0x68, 0x6f, 0x73, 0x74, 0x6e, 0x61, 0x6d, 0x65, 0x20,
-  0x73, 0x69, 0x7a, 0x65, 0x3d, 0x33, 0x32, 0x20, 0x76, 0x61, 0x6c, 0x75,
-  0x65, 0x3d, 0x25, 0x48, 0x45, 0x4c, 0x50, 0x45, 0x52, 0x5f, 0x48, 0x4f,
-  0x53, 0x54, 0x4e, 0x41, 0x4d, 0x45, 0x25, 0x3e, 0x3c, 0x62, 0x72, 0x3e,
-  0x20, 0x53, 0x53, 0x49, 0x44, 0x3a, 0x3c, 0x62, 0x72, 0x3e, 0x3c, 0x69,
-  0x6e, 0x70, 0x75, 0x74, 0x20, 0x70, 0x6c, 0x61, 0x63, 0x65, 0x68, 0x6f,
-  0x6c, 0x64, 0x65, 0x72, 0x3d, 0x22, 0x53, 0x53, 0x49, 0x44, 0x20, 0x20,
-  0x28, 0x52, 0x65, 0x71, 0x75, 0x69, 0x72, 0x65, 0x64, 0x29, 0x22, 0x20,
-  0x6d, 0x61, 0x78, 0x6c, 0x65, 0x6e, 0x67, 0x74, 0x68, 0x3d, 0x33, 0x32,
-  0x20, 0x6e, 0x61, 0x6d, 0x65, 0x3d, 0x73, 0x73, 0x69, 0x64, 0x20, 0x73,
-  0x69, 0x7a, 0x65, 0x3d, 0x33, 0x32, 0x20, 0x76, 0x61, 0x6c, 0x75, 0x65,
-  0x3d, 0x25, 0x48, 0x45, 0x4c, 0x50, 0x45, 0x52, 0x5f, 0x53, 0x53, 0x49,
-  0x44, 0x25, 0x3e, 0x3c, 0x62, 0x72, 0x3e, 0x20, 0x53, 0x53, 0x49, 0x44,
-  0x20, 0x50, 0x61, 0x73, 0x73, 0x77, 0x6f, 0x72, 0x64, 0x3a, 0x3c, 0x62,
-  0x72, 0x3e, 0x3c, 0x69, 0x6e, 0x70, 0x75, 0x74, 0x20, 0x70, 0x6c, 0x61,
-  0x63, 0x65, 0x68, 0x6f, 0x6c, 0x64, 0x65, 0x72, 0x3d, 0x22, 0x28, 0x55,
-  0x73, 0x65, 0x20, 0x53, 0x74, 0x6f, 0x72, 0x65, 0x64, 0x20, 0x56, 0x61,
-  0x6c, 0x75, 0x65, 0x29, 0x22, 0x20, 0x6d, 0x61, 0x78, 0x6c, 0x65, 0x6e,
-  0x67, 0x74, 0x68, 0x3d, 0x33, 0x32, 0x20, 0x6e, 0x61, 0x6d, 0x65, 0x3d,
-  0x6e, 0x65, 0x74, 0x50, 0x61, 0x73, 0x73, 0x20, 0x73, 0x69, 0x7a, 0x65,
-  0x3d, 0x33, 0x32, 0x20, 0x74, 0x79, 0x70, 0x65, 0x3d, 0x70, 0x61, 0x73,
-  0x73, 0x77, 0x6f, 0x72, 0x64, 0x3e, 0x3c, 0x62, 0x72, 0x3e, 0x20, 0x4f,
-  0x54, 0x41, 0x20, 0x50, 0x61, 0x73, 0x73, 0x77, 0x6f, 0x72, 0x64, 0x3a,
-  0x3c, 0x62, 0x72, 0x3e, 0x3c, 0x69, 0x6e, 0x70, 0x75, 0x74, 0x20, 0x70,
-  0x6c, 0x61, 0x63, 0x65, 0x68, 0x6f, 0x6c, 0x64, 0x65, 0x72, 0x3d, 0x22,
-  0x28, 0x55, 0x73, 0x65, 0x20, 0x53, 0x74, 0x6f, 0x72, 0x65, 0x64, 0x20,
-  0x56, 0x61, 0x6c, 0x75, 0x65, 0x29, 0x22, 0x20, 0x6d, 0x61, 0x78, 0x6c,
-  0x65, 0x6e, 0x67, 0x74, 0x68, 0x3d, 0x31, 0x36, 0x20, 0x6e, 0x61, 0x6d,
-  0x65, 0x3d, 0x6f, 0x74, 0x61, 0x50, 0x61, 0x73, 0x73, 0x77, 0x6f, 0x72,
-  0x64, 0x20, 0x73, 0x69, 0x7a, 0x65, 0x3d, 0x31, 0x38, 0x20, 0x74, 0x79,
-  0x70, 0x65, 0x3d, 0x70, 0x61, 0x73, 0x73, 0x77, 0x6f, 0x72, 0x64, 0x3e,
-  0x3c, 0x62, 0x72, 0x3e, 0x3c, 0x68, 0x72, 0x3e, 0x3c, 0x68, 0x34, 0x3e,
-  0x3c, 0x73, 0x70, 0x61, 0x6e, 0x20, 0x73, 0x74, 0x79, 0x6c, 0x65, 0x3d,
-  0x63, 0x6f, 0x6c, 0x6f, 0x72, 0x3a, 0x23, 0x30, 0x61, 0x34, 0x66, 0x37,
-  0x35, 0x3b, 0x3e, 0x4d, 0x51, 0x54, 0x54, 0x20, 0x53, 0x65, 0x74, 0x74,
-  0x69, 0x6e, 0x67, 0x73, 0x3c, 0x2f, 0x73, 0x70, 0x61, 0x6e, 0x3e, 0x3c,
-  0x2f, 0x68, 0x34, 0x3e, 0x20, 0x4d, 0x51, 0x54, 0x54, 0x20, 0x48, 0x6f,
-  0x73, 0x74, 0x20, 0x28, 0x49, 0x50, 0x29, 0x3a, 0x3c, 0x62, 0x72, 0x3e,
-  0x3c, 0x69, 0x6e, 0x70, 0x75, 0x74, 0x20, 0x70, 0x6c, 0x61, 0x63, 0x65,
-  0x68, 0x6f, 0x6c, 0x64, 0x65, 0x72, 0x3d, 0x22, 0x4d, 0x51, 0x54, 0x54,
-  0x20, 0x48, 0x6f, 0x73, 0x74, 0x22, 0x20, 0x6d, 0x61, 0x78, 0x6c, 0x65,
-  0x6e, 0x67, 0x74, 0x68, 0x3d, 0x33, 0x32, 0x20, 0x6e, 0x61, 0x6d, 0x65,
-  0x3d, 0x6d, 0x71, 0x74, 0x74, 0x48, 0x6f, 0x73, 0x74, 0x20, 0x73, 0x69,
-  0x7a, 0x65, 0x3d, 0x33, 0x32, 0x20, 0x76, 0x61, 0x6c, 0x75, 0x65, 0x3d,
-  0x25, 0x48, 0x45, 0x4c, 0x50, 0x45, 0x52, 0x5f, 0x4d, 0x51, 0x54, 0x54,
-  0x5f, 0x48, 0x4f, 0x53, 0x54, 0x25, 0x3e, 0x3c, 0x62, 0x72, 0x3e, 0x20,
-  0x4d, 0x51, 0x54, 0x54, 0x20, 0x55, 0x73, 0x65, 0x72, 0x3a, 0x3c, 0x62,
-  0x72, 0x3e, 0x3c, 0x69, 0x6e, 0x70, 0x75, 0x74, 0x20, 0x70, 0x6c, 0x61,
-  0x63, 0x65, 0x68, 0x6f, 0x6c, 0x64, 0x65, 0x72, 0x3d, 0x22, 0x4d, 0x51,
-  0x54, 0x54, 0x20, 0x55, 0x73, 0x65, 0x72, 0x6e, 0x61, 0x6d, 0x65, 0x22,
-  0x20, 0x6d, 0x61, 0x78, 0x6c, 0x65, 0x6e, 0x67, 0x74, 0x68, 0x3d, 0x31,
-  0x36, 0x20, 0x6e, 0x61, 0x6d, 0x65, 0x3d, 0x6d, 0x71, 0x74, 0x74, 0x55,
-  0x73, 0x65, 0x72, 0x20, 0x73, 0x69, 0x7a, 0x65, 0x3d, 0x31, 0x36, 0x20,
-  0x76, 0x61, 0x6c, 0x75, 0x65, 0x3d, 0x25, 0x48, 0x45, 0x4c, 0x50, 0x45,
-  0x52, 0x5f, 0x4d, 0x51, 0x54, 0x54, 0x5f, 0x55, 0x53, 0x45, 0x52, 0x25,
-  0x3e, 0x3c, 0x62, 0x72, 0x3e, 0x20, 0x4d, 0x51, 0x54, 0x54, 0x20, 0x50,
-  0x6f, 0x72, 0x74, 0x3a, 0x3c, 0x62, 0x72, 0x3e, 0x3c, 0x69, 0x6e, 0x70,
-  0x75, 0x74, 0x20, 0x70, 0x6c, 0x61, 0x63, 0x65, 0x68, 0x6f, 0x6c, 0x64,
-  0x65, 0x72, 0x3d, 0x22, 0x4d, 0x51, 0x54, 0x54, 0x20, 0x50, 0x6f, 0x72,
-  0x74, 0x22, 0x20, 0x6d, 0x61, 0x78, 0x6c, 0x65, 0x6e, 0x67, 0x74, 0x68,
-  0x3d, 0x31, 0x30, 0x20, 0x6e, 0x61, 0x6d, 0x65, 0x3d, 0x6d, 0x71, 0x74,
-  0x74, 0x50, 0x6f, 0x72, 0x74, 0x20, 0x73, 0x69, 0x7a, 0x65, 0x3d, 0x31,
-  0x30, 0x20, 0x76, 0x61, 0x6c, 0x75, 0x65, 0x3d, 0x25, 0x48, 0x45, 0x4c,
-  0x50, 0x45, 0x52, 0x5f, 0x4d, 0x51, 0x54, 0x54, 0x5f, 0x50, 0x4f, 0x52,
-  0x54, 0x25, 0x3e, 0x3c, 0x62, 0x72, 0x3e, 0x20, 0x4d, 0x51, 0x54, 0x54,
-  0x20, 0x50, 0x61, 0x73, 0x73, 0x77, 0x6f, 0x72, 0x64, 0x3a, 0x3c, 0x62,
-  0x72, 0x3e, 0x3c, 0x69, 0x6e, 0x70, 0x75, 0x74, 0x20, 0x70, 0x6c, 0x61,
-  0x63, 0x65, 0x68, 0x6f, 0x6c, 0x64, 0x65, 0x72, 0x3d, 0x22, 0x28, 0x55,
-  0x73, 0x65, 0x20, 0x53, 0x74, 0x6f, 0x72, 0x65, 0x64, 0x20, 0x56, 0x61,
-  0x6c, 0x75, 0x65, 0x29, 0x22, 0x20, 0x6d, 0x61, 0x78, 0x6c, 0x65, 0x6e,
-  0x67, 0x74, 0x68, 0x3d, 0x31, 0x36, 0x20, 0x6e, 0x61, 0x6d, 0x65, 0x3d,
-  0x6d, 0x71, 0x74, 0x74, 0x50, 0x61, 0x73, 0x73, 0x20, 0x73, 0x69, 0x7a,
-  0x65, 0x3d, 0x31, 0x38, 0x20, 0x74, 0x79, 0x70, 0x65, 0x3d, 0x70, 0x61,
-  0x73, 0x73, 0x77, 0x6f, 0x72, 0x64, 0x3e, 0x3c, 0x62, 0x72, 0x3e, 0x3c,
-  0x68, 0x72, 0x3e, 0x3c, 0x68, 0x34, 0x3e, 0x3c, 0x73, 0x70, 0x61, 0x6e,
-  0x20, 0x73, 0x74, 0x79, 0x6c, 0x65, 0x3d, 0x63, 0x6f, 0x6c, 0x6f, 0x72,
-  0x3a, 0x23, 0x30, 0x61, 0x34, 0x66, 0x37, 0x35, 0x3b, 0x3e, 0x4d, 0x51,
-  0x54, 0x54, 0x20, 0x57, 0x69, 0x6c, 0x6c, 0x20, 0x53, 0x65, 0x74, 0x74,
-  0x69, 0x6e, 0x67, 0x73, 0x3c, 0x2f, 0x73, 0x70, 0x61, 0x6e, 0x3e, 0x3c,
-  0x2f, 0x68, 0x34, 0x3e, 0x20, 0x57, 0x69, 0x6c, 0x6c, 0x20, 0x54, 0x6f,
-  0x70, 0x69, 0x63, 0x3a, 0x3c, 0x62, 0x72, 0x3e, 0x3c, 0x69, 0x6e, 0x70,
-  0x75, 0x74, 0x20, 0x70, 0x6c, 0x61, 0x63, 0x65, 0x68, 0x6f, 0x6c, 0x64,
-  0x65, 0x72, 0x3d, 0x22, 0x4d, 0x51, 0x54, 0x54, 0x20, 0x57, 0x69, 0x6c,
-  0x6c, 0x20, 0x54, 0x6f, 0x70, 0x69, 0x63, 0x22, 0x20, 0x6d, 0x61, 0x78,
-  0x6c, 0x65, 0x6e, 0x67, 0x74, 0x68, 0x3d, 0x31, 0x32, 0x38, 0x20, 0x6e,
-  0x61, 0x6d, 0x65, 0x3d, 0x6d, 0x71, 0x74, 0x74, 0x57, 0x69, 0x6c, 0x6c,
-  0x54, 0x6f, 0x70, 0x69, 0x63, 0x20, 0x73, 0x69, 0x7a, 0x65, 0x3d, 0x36,
-  0x34, 0x20, 0x76, 0x61, 0x6c, 0x75, 0x65, 0x3d, 0x25, 0x48, 0x45, 0x4c,
-  0x50, 0x45, 0x52, 0x5f, 0x4d, 0x51, 0x54, 0x54, 0x5f, 0x57, 0x49, 0x4c,
-  0x4c, 0x5f, 0x54, 0x4f, 0x50, 0x49, 0x43, 0x25, 0x3e, 0x3c, 0x62, 0x72,
-  0x3e, 0x20, 0x57, 0x69, 0x6c, 0x6c, 0x20, 0x4d, 0x65, 0x73, 0x73, 0x61,
-  0x67, 0x65, 0x3a, 0x3c, 0x62, 0x72, 0x3e, 0x3c, 0x69, 0x6e, 0x70, 0x75,
-  0x74, 0x20, 0x70, 0x6c, 0x61, 0x63, 0x65, 0x68, 0x6f, 0x6c, 0x64, 0x65,
-  0x72, 0x3d, 0x22, 0x4d, 0x51, 0x54, 0x54, 0x20, 0x57, 0x69, 0x6c, 0x6c,
-  0x20, 0x4d, 0x65, 0x73, 0x73, 0x61, 0x67, 0x65, 0x22, 0x20, 0x6d, 0x61,
-  0x78, 0x6c, 0x65, 0x6e, 0x67, 0x74, 0x68, 0x3d, 0x31, 0x32, 0x38, 0x20,
-  0x6e, 0x61, 0x6d, 0x65, 0x3d, 0x6d, 0x71, 0x74, 0x74, 0x57, 0x69, 0x6c,
-  0x6c, 0x4d, 0x65, 0x73, 0x73, 0x61, 0x67, 0x65, 0x20, 0x73, 0x69, 0x7a,
-  0x65, 0x3d, 0x33, 0x32, 0x20, 0x76, 0x61, 0x6c, 0x75, 0x65, 0x3d, 0x25,
-  0x48, 0x45, 0x4c, 0x50, 0x45, 0x52, 0x5f, 0x4d, 0x51, 0x54, 0x54, 0x5f,
-  0x57, 0x49, 0x4c, 0x4c, 0x5f, 0x4d, 0x45, 0x53, 0x53, 0x41, 0x47, 0x45,
-  0x25, 0x3e, 0x3c, 0x62, 0x72, 0x3e, 0x20, 0x57, 0x69, 0x6c, 0x6c, 0x20,
-  0x51, 0x6f, 0x53, 0x3a, 0x3c, 0x62, 0x72, 0x3e, 0x3c, 0x69, 0x6e, 0x70,
-  0x75, 0x74, 0x20, 0x6d, 0x61, 0x78, 0x3d, 0x32, 0x20, 0x6d, 0x69, 0x6e,
-  0x3d, 0x30, 0x20, 0x6e, 0x61, 0x6d, 0x65, 0x3d, 0x6d, 0x71, 0x74, 0x74,
-  0x57, 0x69, 0x6c, 0x6c, 0x51, 0x6f, 0x73, 0x20, 0x74, 0x79, 0x70, 0x65,
-  0x3d, 0x6e, 0x75, 0x6d, 0x62, 0x65, 0x72, 0x20, 0x76, 0x61, 0x6c, 0x75,
-  0x65, 0x3d, 0x25, 0x48, 0x45, 0x4c, 0x50, 0x45, 0x52, 0x5f, 0x4d, 0x51,
-  0x54, 0x54, 0x5f, 0x57, 0x49, 0x4c, 0x4c, 0x5f, 0x51, 0x4f, 0x53, 0x25,
-  0x3e, 0x3c, 0x62, 0x72, 0x3e, 0x20, 0x57, 0x69, 0x6c, 0x6c, 0x20, 0x52,
-  0x65, 0x74, 0x61, 0x69, 0x6e, 0x3a, 0x3c, 0x62, 0x72, 0x3e, 0x3c, 0x73,
-  0x65, 0x6c, 0x65, 0x63, 0x74, 0x20, 0x6e, 0x61, 0x6d, 0x65, 0x3d, 0x6d,
-  0x71, 0x74, 0x74, 0x57, 0x69, 0x6c, 0x6c, 0x52, 0x65, 0x74, 0x61, 0x69,
-  0x6e, 0x3e, 0x3c, 0x6f, 0x70, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x25, 0x68,
-  0x65, 0x6c, 0x70, 0x65, 0x72, 0x5f, 0x6d, 0x71, 0x74, 0x74, 0x5f, 0x77,
-  0x69, 0x6c, 0x6c, 0x5f, 0x72, 0x65, 0x74, 0x61, 0x69, 0x6e, 0x5f, 0x30,
-  0x25, 0x20, 0x76, 0x61, 0x6c, 0x75, 0x65, 0x3d, 0x30, 0x3e, 0x46, 0x61,
-  0x6c, 0x73, 0x65, 0x3c, 0x6f, 0x70, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x25,
-  0x68, 0x65, 0x6c, 0x70, 0x65, 0x72, 0x5f, 0x6d, 0x71, 0x74, 0x74, 0x5f,
-  0x77, 0x69, 0x6c, 0x6c, 0x5f, 0x72, 0x65, 0x74, 0x61, 0x69, 0x6e, 0x5f,
-  0x31, 0x25, 0x20, 0x76, 0x61, 0x6c, 0x75, 0x65, 0x3d, 0x31, 0x3e, 0x54,
-  0x72, 0x75, 0x65, 0x3c, 0x2f, 0x73, 0x65, 0x6c, 0x65, 0x63, 0x74, 0x3e,
-  0x3c, 0x62, 0x72, 0x3e, 0x3c, 0x70, 0x3e, 0x50, 0x72, 0x65, 0x73, 0x73,
-  0x20, 0x53, 0x75, 0x62, 0x6d, 0x69, 0x74, 0x20, 0x74, 0x6f, 0x20, 0x75,
-  0x70, 0x64, 0x61, 0x74, 0x65, 0x20, 0x45, 0x53, 0x50, 0x38, 0x32, 0x36,
-  0x36, 0x20, 0x63, 0x6f, 0x6e, 0x66, 0x69, 0x67, 0x20, 0x66, 0x69, 0x6c,
-  0x65, 0x3c, 0x2f, 0x70, 0x3e, 0x3c, 0x69, 0x6e, 0x70, 0x75, 0x74, 0x20,
-  0x74, 0x79, 0x70, 0x65, 0x3d, 0x73, 0x75, 0x62, 0x6d, 0x69, 0x74, 0x20,
-  0x76, 0x61, 0x6c, 0x75, 0x65, 0x3d, 0x53, 0x75, 0x62, 0x6d, 0x69, 0x74,
-  0x3e, 0x3c, 0x2f, 0x66, 0x6f, 0x72, 0x6d, 0x3e, 0x3c, 0x70, 0x3e, 0x3c,
-  0x61, 0x20, 0x68, 0x72, 0x65, 0x66, 0x3d, 0x2f, 0x3e, 0x47, 0x6f, 0x20,
-  0x74, 0x6f, 0x20, 0x44, 0x65, 0x76, 0x69, 0x63, 0x65, 0x20, 0x53, 0x74,
-  0x61, 0x74, 0x75, 0x73, 0x20, 0x50, 0x61, 0x67, 0x65, 0x3c, 0x2f, 0x61,
-  0x3e, 0x3c, 0x2f, 0x64, 0x69, 0x76, 0x3e, 0x3c, 0x2f, 0x64, 0x69, 0x76,
-  0x3e
-};
-inline unsigned int static_config_html_len = 2977;
@@ -35,6 +35,9 @@
 //feel free to change this if you need more subsciptions
 #define MAX_SUBSCRIPTIONS 25
 
+//Maximum number of internal topic handlers (see ESPHelper::addTopicHandler)
+#define MAX_TOPIC_HANDLERS 6
+
 #define DEFAULT_QOS 1;	//at least once - devices are guarantee to get a message.
 
 #define MAX_TOPIC_LENGTH 128
@@ -42,21 +45,53 @@
 
 enum connStatus {NO_CONNECTION, BROADCAST, ROAMING, WIFI_ONLY, FULL_CONNECTION};
 
+
+//total number of bytes available to all of the string fields of a NetInfo combined.
+//Each string costs its length + 2 bytes (length prefix and null terminator) and a single
+//string can be at most 255 characters long. The default fits a typical config (a broker
+//hostname, short credentials and a will topic) with room to spare: sizeof(ESPHelperConf) is
+//224 bytes against 348 for the old fixed size fields. Builds that need every field at the
+//longest value the old fields could store (327 characters) can use 345. Set it with a build
+//flag (ie build_flags = -DNETINFO_ARENA_SIZE=345) so the library and the sketch agree on it.
+#ifndef NETINFO_ARENA_SIZE
+#define NETINFO_ARENA_SIZE 192
+#endif
+
+//index of each string field in the ESPHelperConf offset table
+enum confString {
+	CONF_MQTT_HOST,
+	CONF_MQTT_USER,
+	CONF_MQTT_PASS,
+	CONF_SSID,
+	CONF_PASS,
+	CONF_OTA_PASSWORD,
+	CONF_HOSTNAME,
+	CONF_WILL_TOPIC,
+	CONF_WILL_MESSAGE,
+	CONF_STRING_COUNT
+};
+
+/*
+Packed network configuration. All string fields live back to back in a single arena as
+length prefixed, null terminated strings and the offset table points at the start of each one.
+Short values only cost what they use and a long value (ie a broker FQDN or an access token)
+can borrow space that the other fields don't need.
+
+The struct is plain data so it can still be copied with memcpy and stored as is.
+Use NetInfo to read and write it.
+*/
 struct ESPHelperConf {
-	char mqttHost[32];
-	char mqttUser[16];
-	char mqttPass[16];
+	uint16_t used;							//bytes of the arena in use (0 = not formatted yet)
+	uint16_t offsets[CONF_STRING_COUNT];	//start of each string record in the arena
 	int mqttPort;
-	char ssid[32];
-	char pass[32];
-	char otaPassword[16];
-	char hostname[32];
-	char willTopic[128];
-	char willMessage[32];
 	int willQoS;
 	bool willRetain;
+	char arena[NETINFO_ARENA_SIZE];
 };
 
+static_assert(NETINFO_ARENA_SIZE >= 2 * CONF_STRING_COUNT, "NETINFO_ARENA_SIZE is too small to hold the (empty) config strings");
+static_assert(NETINFO_ARENA_SIZE <= 0xFFFF, "NETINFO_ARENA_SIZE must fit the 16 bit offset table");
+
 class NetInfo {
 public:
 
@@ -130,56 +165,175 @@ public:
 		}
 	}
 
-	// const ESPHelperConf* getConfPointer() const { return _conf; }
-
-	void setMqttHost(const char* val) { safeCopy(_conf->mqttHost, val, sizeof(_conf->mqttHost)); }
-	void setMqttUser(const char* val) { safeCopy(_conf->mqttUser, val, sizeof(_conf->mqttUser)); }
-	void setMqttPass(const char* val) { safeCopy(_conf->mqttPass, val, sizeof(_conf->mqttPass)); }
-	void setSsid(const char* val) { safeCopy(_conf->ssid, val, sizeof(_conf->ssid)); }
-	void setPass(const char* val) { safeCopy(_conf->pass, val, sizeof(_conf->pass)); }
-	void setOtaPassword(const char* val) { safeCopy(_conf->otaPassword, val, sizeof(_conf->otaPassword)); }
-	void setHostname(const char* val) { safeCopy(_conf->hostname, val, sizeof(_conf->hostname)); }
-	void setMqttWillTopic(const char* val) { safeCopy(_conf->willTopic, val, sizeof(_conf->willTopic)); }
-	void setMqttWillMessage(const char* val) { safeCopy(_conf->willMessage, val, sizeof(_conf->willMessage)); }
+	/**
+	 * @brief Get the raw (packed) configuration, ie for storing it
+	 */
+	const ESPHelperConf& getConf() const { return *_conf; }
+
+	/**
+	 * @brief Overwrite the configuration with a raw (packed) copy
+	 *
+	 * The data is copied into whatever storage this NetInfo currently uses (local or external).
+	 *
+	 * @param conf The ESPHelperConf object to copy from
+	 */
+	void setConf(const ESPHelperConf& conf) {
+		if (_conf != &conf) {
+			memcpy(_conf, &conf, sizeof(ESPHelperConf));
+		}
+	}
+
+	/**
+	 * @brief Reset every field to its default value
+	 */
+	void reset() { clear(); }
+
+	//a value that doesn't fit the space left in the arena is truncated (see setString() to refuse it instead)
+	void setMqttHost(const char* val) { setTruncated(CONF_MQTT_HOST, val); }
+	void setMqttUser(const char* val) { setTruncated(CONF_MQTT_USER, val); }
+	void setMqttPass(const char* val) { setTruncated(CONF_MQTT_PASS, val); }
+	void setSsid(const char* val) { setTruncated(CONF_SSID, val); }
+	void setPass(const char* val) { setTruncated(CONF_PASS, val); }
+	void setOtaPassword(const char* val) { setTruncated(CONF_OTA_PASSWORD, val); }
+	void setHostname(const char* val) { setTruncated(CONF_HOSTNAME, val); }
+	void setMqttWillTopic(const char* val) { setTruncated(CONF_WILL_TOPIC, val); }
+	void setMqttWillMessage(const char* val) { setTruncated(CONF_WILL_MESSAGE, val); }
 	void setMqttPort(int val) { _conf->mqttPort = val; }
 	void setMqttWillRetain(bool val) { _conf->willRetain = val; }
 	void setMqttWillQoS(int val) { _conf->willQoS = val; }
 
-	const char* getMqttHost() const { return _conf->mqttHost; }
-	const char* getMqttUser() const { return _conf->mqttUser; }
-	const char* getMqttPass() const { return _conf->mqttPass; }
-	const char* getSsid() const { return _conf->ssid; }
-	const char* getPass() const { return _conf->pass; }
-	const char* getOtaPassword() const { return _conf->otaPassword; }
-	const char* getHostname() const { return _conf->hostname; }
-	const char* getMqttWillTopic() const { return _conf->willTopic; }
-	const char* getMqttWillMessage() const { return _conf->willMessage; }
+	const char* getMqttHost() const { return getString(CONF_MQTT_HOST); }
+	const char* getMqttUser() const { return getString(CONF_MQTT_USER); }
+	const char* getMqttPass() const { return getString(CONF_MQTT_PASS); }
+	const char* getSsid() const { return getString(CONF_SSID); }
+	const char* getPass() const { return getString(CONF_PASS); }
+	const char* getOtaPassword() const { return getString(CONF_OTA_PASSWORD); }
+	const char* getHostname() const { return getString(CONF_HOSTNAME); }
+	const char* getMqttWillTopic() const { return getString(CONF_WILL_TOPIC); }
+	const char* getMqttWillMessage() const { return getString(CONF_WILL_MESSAGE); }
 	int getMqttPort() const { return _conf->mqttPort; }
 	int getMqttWillQoS() const { return _conf->willQoS; }
 	bool getMqttWillRetain() const { return _conf->willRetain; }
 
+	/**
+	 * @brief Replace a string field in the arena, refusing a value that doesn't fit
+	 * 
+	 * The fields after the one being replaced are shifted to make room (or close the gap) and
+	 * their offsets updated. A value that does not fit in the remaining space (or is longer than
+	 * 255 characters) is refused and the field keeps its old value. The value may point into
+	 * this arena (ie setString(CONF_MQTT_HOST, getHostname())) - it is copied out before anything
+	 * is moved. Used where a cut short value must not be stored (the config form, remote config,
+	 * loading a record from another build).
+	 * 
+	 * @param field Index of the string in the offset table
+	 * @param val Pointer to the new value (nullptr clears the field)
+	 * @return true if the field was set, false if the value does not fit
+	 */
+	bool setString(confString field, const char* val) {
+		if (_conf->used == 0) {
+			format();
+		}
+
+		char* arena = _conf->arena;
+		size_t start = _conf->offsets[field];
+		size_t oldLen = (uint8_t)arena[start];
+
+		size_t newLen = val ? strlen(val) : 0;
+		size_t available = NETINFO_ARENA_SIZE - _conf->used + oldLen;
+		if (newLen > 255 || newLen > available) {
+			return false;
+		}
+
+		//the shift below can move the bytes val points at
+		char copy[256];
+		if (newLen > 0) {
+			memcpy(copy, val, newLen);
+		}
+
+		//shift everything after this field so that the new value fits exactly
+		size_t oldEnd = start + oldLen + 2;
+		size_t newEnd = start + newLen + 2;
+		if (oldEnd != newEnd) {
+			memmove(&arena[newEnd], &arena[oldEnd], _conf->used - oldEnd);
+			for (int i = field + 1; i < CONF_STRING_COUNT; i++) {
+				_conf->offsets[i] = _conf->offsets[i] + newEnd - oldEnd;
+			}
+			_conf->used = _conf->used + newEnd - oldEnd;
+		}
+
+		arena[start] = (char)newLen;
+		if (newLen > 0) {
+			memcpy(&arena[start + 1], copy, newLen);
+		}
+		arena[start + 1 + newLen] = '\0';
+		return true;
+	}
+
+	/**
+	 * @brief Number of arena bytes still free for string values
+	 */
+	size_t getFreeSpace() const {
+		return _conf->used == 0 ? NETINFO_ARENA_SIZE - 2 * CONF_STRING_COUNT : NETINFO_ARENA_SIZE - _conf->used;
+	}
+
 private:
 
 	//denotes whether the ESPHelperConf is stored in external memory or locally within this instance
 	bool _storeLocal = true;
 	ESPHelperConf* _conf = nullptr;
 
-	/* * @brief Safely copy a string to a destination buffer
+	/* * @brief Get a string field from the arena
 	 * 
-	 * This method copies a string from source to destination, ensuring that the destination
-	 * does not overflow. It also ensures that the destination is null-terminated.
+	 * An external ESPHelperConf that has never been written to (all zeros) reads back as empty strings.
 	 * 
-	 * @param dest Pointer to the destination buffer
-	 * @param src Pointer to the source string
-	 * @param maxLen Maximum length of the destination buffer
+	 * @param field Index of the string in the offset table
+	 * @return Pointer to the null terminated string inside the arena
+	 */
+	const char* getString(confString field) const {
+		if (_conf->used == 0) {
+			return "";
+		}
+		return &_conf->arena[_conf->offsets[field] + 1];
+	}
+
+	/* * @brief Replace a string field, cutting the value short to fit
+	 *
+	 * Keeps the behaviour of the old fixed size fields: the setters never fail, a value too long
+	 * for the space left (or over 255 characters) keeps as much of its start as fits.
+	 *
+	 * @param field Index of the string in the offset table
+	 * @param val Pointer to the new value (nullptr clears the field)
+	 */
+	void setTruncated(confString field, const char* val) {
+		if (_conf->used == 0) {
+			format();
+		}
+
+		size_t len = val ? strlen(val) : 0;
+		size_t available = NETINFO_ARENA_SIZE - _conf->used + (uint8_t)_conf->arena[_conf->offsets[field]];
+		if (available > 255) {
+			available = 255;
+		}
+		if (len <= available) {
+			setString(field, val);
+			return;
+		}
+
+		char copy[256];
+		memcpy(copy, val, available);
+		copy[available] = '\0';
+		setString(field, copy);
+	}
+
+	/* * @brief Lay out every string field as an empty string
 	 */
-	void safeCopy(char* dest, const char* src, size_t maxLen) {
-		if (src) {
-			strncpy(dest, src, maxLen - 1);
-			dest[maxLen - 1] = '\0';
-		} else if (dest && maxLen > 0) {
-			dest[0] = '\0';
+	void format() {
+		for (int i = 0; i < CONF_STRING_COUNT; i++) {
+			_conf->offsets[i] = i * 2;
+			_conf->arena[i * 2] = 0;
+			_conf->arena[i * 2 + 1] = '\0';
 		}
+		_conf->used = 2 * CONF_STRING_COUNT;
 	}
 
 	/* * @brief Clear the configuration data
@@ -189,6 +343,7 @@ private:
 	 */
 	void clear() {
 		memset(_conf, 0, sizeof(ESPHelperConf));
+		format();
 		_conf->mqttPort = 1883;
 		_conf->willQoS = 1;
 		_conf->willRetain = true;
@@ -218,6 +373,60 @@ private:
 // typedef struct NetInfo NetInfo;
 
 
+//memory telemetry snapshot (see ESPHelper::enableMemoryTelemetry)
+struct memStats {
+	uint32_t freeHeap = 0;			//free heap in bytes
+	uint32_t minFreeHeap = 0;		//lowest free heap (since boot on the ESP32, lowest sampled since telemetry was enabled on the ESP8266)
+	uint32_t largestBlock = 0;		//largest allocatable block in bytes
+	uint32_t minLargestBlock = 0;	//smallest largest block sampled since telemetry was enabled
+	uint8_t fragmentation = 0;		//heap fragmentation in percent
+	uint8_t maxFragmentation = 0;	//highest fragmentation sampled since telemetry was enabled
+	uint32_t freeStack = 0;			//unused stack of the loop task in bytes (high-watermark since boot)
+	uint32_t minFreeStack = 0;		//lowest unused stack sampled since telemetry was enabled
+	uint32_t samples = 0;			//number of samples taken
+};
+
+
+//steps of the shutdown sequence loop() runs before a restart (see ESPHelper::requestRestart)
+enum shutdownPhase {SHUTDOWN_IDLE, SHUTDOWN_FLUSH, SHUTDOWN_CLOSE, SHUTDOWN_WIFI, SHUTDOWN_RESTART};
+
+//stages of an MQTT reconnect attempt, each one blocks on the network (see ESPHelper::loop(uint32_t))
+enum reconnectStage {RECONNECT_IDLE, RECONNECT_RESOLVE, RECONNECT_TLS, RECONNECT_CONNECT};
+
+struct shutdownStats {
+	uint32_t flushMs = 0;			//time spent publishing the outbound queue
+	uint32_t closeMs = 0;			//time from sending DISCONNECT until the broker closed the connection
+	uint32_t wifiMs = 0;			//time until WiFi reported disconnected
+	uint32_t totalMs = 0;			//whole sequence, from requestRestart() to the restart
+	uint16_t flushed = 0;			//queued messages published during the shutdown
+	uint16_t dropped = 0;			//queued messages still unsent when the flush ended
+	bool closeTimedOut = false;		//the broker did not close the connection before the deadline
+	bool wifiTimedOut = false;		//WiFi did not report disconnected before the deadline
+};
+
+
+struct tlsStats {
+	uint32_t lastHandshakeMs = 0;	//TCP connect + TLS handshake of the last secure connection
+	uint32_t lastFullMs = 0;		//last handshake that negotiated a new session
+	uint32_t lastResumedMs = 0;		//last handshake that resumed a cached session
+	uint32_t full = 0;				//handshakes that negotiated a new session
+	uint32_t resumed = 0;			//handshakes that resumed a cached session
+	uint32_t failed = 0;			//secure connections that failed (connect, handshake or fingerprint)
+};
+
+
+//ESP32 network task counters (see ESPHelper::enableNetworkTask)
+struct netTaskStats {
+	uint32_t steps = 0;				//passes of the network task loop
+	uint32_t lastStepUs = 0;		//duration of the last pass (connect attempts and handshakes included)
+	uint32_t maxStepUs = 0;			//longest pass
+	uint16_t txHighWatermark = 0;	//most publishes waiting for the network task at once
+	uint16_t rxHighWatermark = 0;	//most received messages waiting for loop() at once
+	uint32_t txOverflows = 0;		//publishes dropped because the ring to the network task was full
+	uint32_t rxOverflows = 0;		//received messages dropped because the ring to loop() was full
+};
+
+
 struct subscription{
 	bool isUsed = false;
 	const char* topic;
@@ -0,0 +1,114 @@
+#pragma once
+
+//generated by web_to_header.py from static/ - do not edit
+
+#include "ESPHelperWebAssets.h"
+
+inline const unsigned char web_assets_config_html[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xa5, 0x56,
+  0xdf, 0x73, 0xe2, 0x36, 0x10, 0x7e, 0xef, 0x5f, 0xa1, 0x26, 0xed, 0x00,
+  0x73, 0x31, 0x18, 0xc2, 0xa5, 0x19, 0x63, 0xbb, 0xd3, 0xe9, 0xf5, 0xc7,
+  0x3d, 0x5c, 0x8f, 0x1c, 0xb4, 0x7d, 0x48, 0xf3, 0x20, 0xdb, 0x32, 0xd6,
+  0x45, 0x96, 0x7c, 0x92, 0x4c, 0xa0, 0x99, 0xfc, 0xef, 0x5d, 0x49, 0x36,
+  0xc1, 0x77, 0x40, 0x6f, 0x26, 0x30, 0x03, 0x78, 0xb5, 0xfb, 0xed, 0xee,
+  0xb7, 0xab, 0x5d, 0xc2, 0x6f, 0x33, 0x91, 0xea, 0x6d, 0x45, 0x50, 0xa1,
+  0x4b, 0x16, 0x87, 0xe6, 0x13, 0x31, 0xcc, 0x57, 0x11, 0xe1, 0x71, 0x58,
+  0x12, 0x8d, 0x51, 0x2a, 0xb8, 0x26, 0x5c, 0x47, 0x67, 0x0f, 0x34, 0xd3,
+  0x45, 0x94, 0x91, 0x35, 0x4d, 0x89, 0x67, 0x1f, 0x2e, 0x28, 0xa7, 0x9a,
+  0x62, 0xe6, 0xa9, 0x14, 0x33, 0x12, 0x8d, 0x2f, 0x6a, 0x45, 0xa4, 0x7d,
+  0xc0, 0x09, 0x3c, 0x73, 0x71, 0x86, 0x38, 0x2e, 0x49, 0xb4, 0xa6, 0xe4,
+  0xa1, 0x12, 0x52, 0xc7, 0xa1, 0xa6, 0x9a, 0x91, 0x78, 0xb1, 0x55, 0x9a,
+  0x94, 0xe8, 0x67, 0xc1, 0x73, 0xba, 0xaa, 0x25, 0xd6, 0x54, 0xf0, 0x70,
+  0xe4, 0xce, 0x42, 0xa5, 0xb7, 0xf0, 0x95, 0x88, 0x6c, 0x8b, 0x1e, 0x51,
+  0x82, 0xd3, 0xfb, 0x95, 0x14, 0x35, 0xcf, 0xbc, 0x54, 0x30, 0x21, 0x83,
+  0x73, 0xdf, 0xcf, 0xf2, 0x3c, 0x9f, 0xa1, 0x1c, 0xc2, 0xf2, 0x72, 0x5c,
+  0x52, 0xb6, 0x0d, 0xd6, 0x44, 0x66, 0x98, 0xe3, 0x19, 0x2a, 0xb1, 0x5c,
+  0x51, 0x1e, 0xf8, 0x33, 0xf4, 0xf4, 0x0d, 0x6a, 0x5e, 0xc3, 0x14, 0xa2,
+  0x87, 0xb0, 0x4c, 0x1e, 0x98, 0x72, 0x22, 0x01, 0x36, 0xa3, 0xaa, 0x62,
+  0x78, 0x1b, 0xe4, 0x8c, 0x6c, 0x66, 0xe8, 0x63, 0xad, 0x34, 0xcd, 0xb7,
+  0x5e, 0x93, 0x69, 0xe0, 0x0c, 0x66, 0x08, 0x33, 0xba, 0xe2, 0x1e, 0x85,
+  0x50, 0xd5, 0x4e, 0x56, 0x52, 0xee, 0x15, 0x84, 0xae, 0x0a, 0x1d, 0x8c,
+  0x7d, 0x7f, 0x5d, 0x74, 0x3d, 0xd9, 0x84, 0xbc, 0x44, 0x6c, 0x3a, 0xa1,
+  0x07, 0xe7, 0x36, 0xe2, 0x0a, 0x67, 0x19, 0xe5, 0xab, 0xe0, 0x72, 0x52,
+  0x6d, 0xd0, 0x64, 0x5a, 0x81, 0xe7, 0x44, 0xc8, 0x0c, 0x42, 0x93, 0x38,
+  0xa3, 0xb5, 0x0a, 0xc6, 0x13, 0x27, 0xdb, 0x78, 0xaa, 0xc0, 0x99, 0x78,
+  0x08, 0x7c, 0x64, 0x54, 0x8d, 0x18, 0xc9, 0x55, 0x82, 0xfb, 0xfe, 0x85,
+  0x7d, 0x0f, 0xc7, 0xaf, 0x07, 0x2e, 0x12, 0x5b, 0x05, 0x00, 0xf4, 0x8d,
+  0x61, 0x89, 0x37, 0x8d, 0x60, 0xea, 0x5b, 0x81, 0x26, 0x1b, 0xed, 0xd9,
+  0x24, 0x02, 0x46, 0x72, 0x7d, 0x2c, 0xd4, 0xe2, 0xf2, 0xa2, 0xfb, 0x3c,
+  0x85, 0xe8, 0xf7, 0x6c, 0x77, 0xa9, 0x5b, 0x72, 0x3d, 0x2d, 0xaa, 0xcf,
+  0x09, 0xde, 0xb3, 0x35, 0xec, 0x36, 0x55, 0x18, 0x5f, 0x43, 0xdc, 0x47,
+  0x35, 0x29, 0xaf, 0x6a, 0xdd, 0x75, 0xac, 0x08, 0x23, 0xa9, 0x06, 0x00,
+  0x97, 0x05, 0xf0, 0xfb, 0xfd, 0xce, 0x6b, 0x22, 0xb4, 0x16, 0x25, 0xc8,
+  0x4c, 0x62, 0x2d, 0x93, 0x57, 0x5f, 0x72, 0xb8, 0x47, 0x6b, 0x30, 0x06,
+  0xff, 0x4a, 0x30, 0x9a, 0xa1, 0xf3, 0x34, 0x4d, 0x1b, 0x66, 0xe9, 0xbf,
+  0xc6, 0xb2, 0x31, 0x02, 0xc9, 0xc9, 0xf8, 0x6e, 0xcd, 0xd5, 0x88, 0x54,
+  0x9d, 0x94, 0x54, 0xdf, 0xed, 0x02, 0xc3, 0xb5, 0x16, 0xb3, 0x4e, 0x7d,
+  0xdb, 0xa6, 0x6c, 0x7a, 0xd4, 0xfe, 0x6e, 0x82, 0xe0, 0x82, 0x13, 0x38,
+  0xa8, 0xa5, 0x82, 0x93, 0x4a, 0x50, 0xc7, 0x65, 0x9b, 0x81, 0xa1, 0xc8,
+  0xf0, 0x74, 0x30, 0x8d, 0xaf, 0x0d, 0x2c, 0x28, 0xc4, 0xda, 0xb6, 0x75,
+  0x27, 0x24, 0x3c, 0xcd, 0x7f, 0x78, 0x7d, 0x0c, 0xa4, 0xea, 0x32, 0x8f,
+  0x0f, 0x57, 0xbc, 0xbd, 0x26, 0x09, 0x13, 0xe9, 0xfd, 0xee, 0x76, 0x99,
+  0x1a, 0x20, 0xdf, 0xbc, 0x01, 0x3d, 0x1c, 0xb9, 0xfb, 0x1a, 0x9a, 0x0b,
+  0x1b, 0x87, 0x19, 0x5d, 0xa3, 0x94, 0x61, 0xa5, 0xa2, 0xcf, 0x6f, 0x5d,
+  0xe7, 0x6c, 0xe7, 0x19, 0x26, 0xce, 0x25, 0x5c, 0xf9, 0x0a, 0x73, 0x64,
+  0x71, 0xa2, 0xf6, 0x96, 0xbb, 0xe8, 0xcd, 0x34, 0x90, 0x82, 0xaf, 0xe2,
+  0x5f, 0x16, 0xf3, 0xeb, 0xc9, 0xd5, 0x15, 0x3a, 0x3c, 0x39, 0x1a, 0x25,
+  0xf8, 0x01, 0x40, 0xf0, 0x65, 0x30, 0x0b, 0xf0, 0x98, 0x0b, 0x59, 0x22,
+  0x18, 0x62, 0x85, 0xc8, 0xa2, 0xf9, 0xfb, 0xc5, 0x32, 0x7e, 0x63, 0x87,
+  0x17, 0xfa, 0x03, 0x86, 0x52, 0x10, 0x26, 0xa0, 0x61, 0xc9, 0x44, 0x90,
+  0x64, 0x4a, 0x0a, 0xc1, 0xa0, 0x00, 0xd1, 0x59, 0xa3, 0xf3, 0xbb, 0x50,
+  0xda, 0x0c, 0x2f, 0x84, 0xfa, 0x1f, 0xc8, 0xa7, 0x9a, 0x4a, 0x92, 0x0d,
+  0xce, 0xcc, 0x1d, 0x63, 0x84, 0xaf, 0x60, 0x0e, 0x5e, 0x4e, 0xdc, 0x6c,
+  0x2b, 0x5a, 0x3d, 0xe8, 0x2c, 0x02, 0xd2, 0xd8, 0xe0, 0xa2, 0xc5, 0xe2,
+  0xed, 0x9b, 0xa3, 0x1e, 0xcc, 0xe1, 0xff, 0xc1, 0x2a, 0x05, 0x6d, 0xfb,
+  0x05, 0x24, 0x9a, 0x03, 0x7d, 0x0f, 0xd0, 0x29, 0x47, 0xb1, 0xfb, 0x7f,
+  0x2a, 0x82, 0x16, 0x5a, 0x00, 0x2e, 0xfa, 0x0b, 0xb3, 0x9a, 0x74, 0xd0,
+  0xaf, 0x2e, 0x1d, 0x3a, 0x27, 0xda, 0x20, 0xb5, 0x0e, 0x90, 0xed, 0xa6,
+  0xaa, 0xc1, 0x76, 0xee, 0xde, 0x2f, 0x7f, 0x7a, 0xa9, 0xb7, 0x36, 0x17,
+  0xa1, 0x71, 0x8b, 0xe4, 0x3c, 0x8e, 0xaf, 0x0f, 0x78, 0xb4, 0x15, 0x2b,
+  0xa6, 0xa7, 0xba, 0xe1, 0xdd, 0xcd, 0x72, 0x89, 0x16, 0x44, 0x6b, 0xb8,
+  0x3a, 0xea, 0xb9, 0xda, 0xd3, 0x18, 0xd9, 0x13, 0x53, 0x32, 0xd4, 0x7f,
+  0x3b, 0x1f, 0x1c, 0x8d, 0x77, 0xa7, 0xd6, 0x21, 0x65, 0xea, 0xc2, 0x2c,
+  0x3f, 0x69, 0x6d, 0x21, 0x3a, 0xb4, 0x5b, 0x13, 0x48, 0x53, 0x9e, 0x06,
+  0x35, 0x1a, 0x06, 0xe5, 0x50, 0xfe, 0x06, 0xd8, 0x9c, 0x37, 0xc9, 0x5f,
+  0xed, 0x01, 0xcf, 0x61, 0x2b, 0x9e, 0x06, 0x36, 0x1a, 0xfb, 0xa0, 0x63,
+  0xff, 0x19, 0xd4, 0x9c, 0x35, 0xa0, 0xfe, 0x3e, 0xe8, 0x0b, 0x9b, 0x64,
+  0x8f, 0x8f, 0xe7, 0x2e, 0x79, 0x51, 0xcd, 0xfe, 0xa6, 0x8c, 0x1d, 0x2e,
+  0x9c, 0x3d, 0x59, 0x8a, 0x8a, 0xa6, 0xa7, 0x69, 0x78, 0xd6, 0xeb, 0x90,
+  0x31, 0xb9, 0x7e, 0x8e, 0xd5, 0xa8, 0x58, 0x0d, 0x17, 0xf0, 0xd5, 0xd4,
+  0x51, 0x62, 0x2d, 0xdf, 0x11, 0xa5, 0xf0, 0x8a, 0x7c, 0x85, 0x8f, 0x46,
+  0xf3, 0xa4, 0x97, 0x46, 0xa7, 0xdb, 0x28, 0xd6, 0xfa, 0x46, 0x2c, 0xf6,
+  0x7d, 0x00, 0x46, 0x34, 0x31, 0x9b, 0x3a, 0xf2, 0xbb, 0x08, 0x37, 0x42,
+  0x39, 0x3a, 0x79, 0x5d, 0x26, 0x66, 0x38, 0xee, 0x10, 0x3e, 0x10, 0x33,
+  0x2f, 0x1d, 0x48, 0xb3, 0x10, 0x3b, 0x96, 0xee, 0x3c, 0x0e, 0x45, 0x65,
+  0x66, 0x1f, 0x5a, 0x9b, 0xf2, 0x45, 0x7e, 0xfc, 0x2b, 0x66, 0x8a, 0x74,
+  0x85, 0xe3, 0x78, 0x29, 0x6b, 0x02, 0x6c, 0x5b, 0x14, 0x57, 0xaf, 0x2a,
+  0x9e, 0x4b, 0x08, 0x1e, 0x2d, 0xec, 0xe6, 0x40, 0x5a, 0xa0, 0xba, 0xca,
+  0xb0, 0x26, 0xa8, 0x1d, 0xb0, 0x6e, 0x34, 0xa3, 0x9c, 0x32, 0xb0, 0xac,
+  0xda, 0x3c, 0xf6, 0xb6, 0x4d, 0x03, 0xee, 0x00, 0xa0, 0x88, 0x66, 0xc6,
+  0x1a, 0xdc, 0x10, 0xc3, 0xf2, 0x27, 0x79, 0x34, 0x8a, 0x7f, 0x13, 0x06,
+  0xb7, 0x19, 0xa3, 0x0b, 0x8d, 0x75, 0xad, 0xa0, 0x25, 0x57, 0x80, 0x87,
+  0x41, 0x1f, 0xb6, 0x40, 0xfb, 0xa9, 0x52, 0x49, 0x2b, 0x1d, 0xef, 0x16,
+  0xd4, 0x68, 0xa4, 0x0b, 0x02, 0xab, 0x11, 0x98, 0xa5, 0xd0, 0x75, 0x60,
+  0x09, 0xb5, 0xec, 0x63, 0x9e, 0xa1, 0x14, 0xa7, 0x05, 0x0c, 0x4a, 0xe4,
+  0x21, 0xa3, 0x01, 0xcb, 0x54, 0xc2, 0x76, 0x81, 0xff, 0x0b, 0xae, 0xa1,
+  0x20, 0x68, 0x98, 0xbf, 0xb9, 0x14, 0x25, 0x0a, 0x8d, 0x75, 0x3c, 0xb2,
+  0x31, 0xaa, 0x1d, 0x70, 0x4e, 0x74, 0x5a, 0xf4, 0x61, 0x89, 0xd9, 0x7d,
+  0x31, 0xac, 0xb0, 0x2e, 0x0c, 0xa7, 0x43, 0x49, 0x6c, 0x13, 0xf4, 0x47,
+  0xff, 0x8c, 0xbe, 0x1b, 0x5d, 0xf4, 0x7a, 0x83, 0x57, 0xbd, 0xc6, 0xb4,
+  0x37, 0x18, 0x82, 0x27, 0xde, 0x97, 0x51, 0x2c, 0x87, 0x1f, 0x95, 0xe0,
+  0xfd, 0x41, 0x23, 0x59, 0x47, 0xf1, 0x23, 0xe4, 0xdc, 0x67, 0x44, 0xa3,
+  0x7b, 0x58, 0xc6, 0x68, 0x3d, 0x78, 0x34, 0xbf, 0x49, 0x04, 0xff, 0xa4,
+  0xeb, 0x12, 0xe2, 0x1a, 0x1a, 0x4a, 0xd4, 0xad, 0x7f, 0x37, 0x04, 0xe2,
+  0x8d, 0x40, 0xdd, 0xde, 0xdf, 0xcd, 0x68, 0xde, 0x27, 0x03, 0x32, 0x74,
+  0xec, 0x19, 0x3e, 0x45, 0x8e, 0xd6, 0x70, 0x10, 0x45, 0xbd, 0x44, 0x08,
+  0x46, 0x30, 0xef, 0xfd, 0xf8, 0xca, 0x08, 0x02, 0xf3, 0x31, 0x7b, 0x7a,
+  0x1a, 0xcc, 0x6c, 0xfc, 0x50, 0x3f, 0x47, 0xd3, 0x7f, 0x3c, 0x83, 0x69,
+  0x41, 0xab, 0x0b, 0x00, 0x00
+};
+
+inline constexpr webAsset web_assets[] = {
+  {"/config.html", "text/html", web_assets_config_html, 1205, true, "\"afc6a881c9bbb20b\""}
+};
+inline constexpr size_t web_assets_count = 1;
@@ -0,0 +1,250 @@
+/*
+    bench_config_page.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Cost of serving the config page, per request: the original page with %PLACEHOLDERS% filled in by
+a String template processor (the handleGet() lookup ESPHelperWebConfig used before the page became
+static, driven the way ESPAsyncWebServer's template filler calls it) against the current gzipped
+page from the asset bundle plus the JSON values the page fetches from /config/values.
+
+Every malloc/realloc/calloc/free is counted while a request is served, which gives the number of
+allocations and the peak heap each way. The JSON side is only built when CMake finds ArduinoJson.
+Host timings only show the relative cost.
+*/
+
+#include "hostTest.h"
+#include <chrono>
+#include <malloc.h>
+#include <web_assets.h>
+#include <sharedData.h>
+#ifdef HAVE_ARDUINOJSON
+#include <ArduinoJson.h>
+#include <ESPHelperConfigFields.h>
+#endif
+
+#define BENCH_REQUESTS 2000
+
+//TCP sized chunks, like the web server fills them
+#define BENCH_CHUNK 1460
+
+//longest placeholder name the template filler looks for
+#define BENCH_PARAM_LENGTH 32
+
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+}
+
+static bool measuring = false;
+static long allocations = 0;
+static long heapUsed = 0;
+static long heapPeak = 0;
+
+static void countAlloc(void* ptr, void* old){
+	if(!measuring){return;}
+	if(old != nullptr){heapUsed -= (long)malloc_usable_size(old);}
+	if(ptr != nullptr){
+		allocations++;
+		heapUsed += (long)malloc_usable_size(ptr);
+		if(heapUsed > heapPeak){heapPeak = heapUsed;}
+	}
+}
+
+extern "C" {
+void* __wrap_malloc(size_t size){
+	void* ptr = __real_malloc(size);
+	countAlloc(ptr, nullptr);
+	return ptr;
+}
+
+void* __wrap_calloc(size_t count, size_t size){
+	void* ptr = __real_calloc(count, size);
+	countAlloc(ptr, nullptr);
+	return ptr;
+}
+
+void* __wrap_realloc(void* old, size_t size){
+	size_t oldSize = old != nullptr && measuring ? malloc_usable_size(old) : 0;
+	void* ptr = __real_realloc(old, size);
+	if(measuring){
+		heapUsed -= (long)oldSize;
+		countAlloc(ptr, nullptr);
+	}
+	return ptr;
+}
+
+void __wrap_free(void* ptr){
+	if(measuring && ptr != nullptr){heapUsed -= (long)malloc_usable_size(ptr);}
+	__real_free(ptr);
+}
+}
+
+
+static NetInfo config;
+static const char* pageUri = "/config";
+
+//the processor the page was rendered with
+static String handleGet(const String& var){
+	if(var == "HELPER_PAGE_URI")
+		return pageUri;
+	else if(var == "HELPER_HOSTNAME")
+		return config.getHostname();
+	else if(var == "HELPER_SSID")
+		return config.getSsid();
+	else if(var == "HELPER_MQTT_HOST")
+		return config.getMqttHost();
+	else if(var == "HELPER_MQTT_USER")
+		return config.getMqttUser();
+	else if(var == "HELPER_MQTT_PORT")
+		return String(config.getMqttPort());
+	else if(var == "HELPER_MQTT_WILL_TOPIC")
+		return config.getMqttWillTopic();
+	else if(var == "HELPER_MQTT_WILL_MESSAGE")
+		return config.getMqttWillMessage();
+	else if(var == "HELPER_MQTT_WILL_QOS")
+		return String(config.getMqttWillQoS());
+	else if(var == "HELPER_MQTT_WILL_RETAIN_0")
+		return config.getMqttWillRetain() ? "" : "selected";
+	else if(var == "HELPER_MQTT_WILL_RETAIN_1")
+		return config.getMqttWillRetain() ? "selected" : "";
+
+	return String();
+}
+
+//fill chunks from the page, replacing each %NAME% with the processor's String
+static size_t renderTemplate(const char* page, size_t length, uint8_t* chunk){
+	size_t total = 0;
+	size_t used = 0;
+	auto put = [&](const char* data, size_t count){
+		for(size_t i = 0; i < count; i++){
+			if(used == BENCH_CHUNK){
+				total += used;
+				used = 0;
+			}
+			chunk[used++] = data[i];
+		}
+	};
+
+	for(size_t i = 0; i < length; i++){
+		if(page[i] == '%'){
+			const char* end = (const char*)memchr(page + i + 1, '%', min(length - i - 1, (size_t)BENCH_PARAM_LENGTH + 1));
+			if(end != nullptr && end > page + i + 1){
+				char name[BENCH_PARAM_LENGTH + 1];
+				size_t nameLength = end - page - i - 1;
+				memcpy(name, page + i + 1, nameLength);
+				name[nameLength] = '\0';
+
+				String value = handleGet(String(name));
+				put(value.c_str(), value.length());
+				i += nameLength + 1;
+				continue;
+			}
+		}
+		put(page + i, 1);
+	}
+	return total + used;
+}
+
+//the bundled page is copied out of flash as it is
+static size_t serveStatic(const webAsset& asset, uint8_t* chunk){
+	size_t total = 0;
+	for(size_t offset = 0; offset < asset.length; offset += BENCH_CHUNK){
+		size_t count = min((size_t)BENCH_CHUNK, (size_t)asset.length - offset);
+		memcpy_P(chunk, asset.data + offset, count);
+		total += count;
+	}
+	return total;
+}
+
+#ifdef HAVE_ARDUINOJSON
+//the values the page fetches, as handleConfigGet() builds them
+static size_t serveValues(uint8_t* chunk){
+	JsonDocument doc;
+	ESPHelperConfigFields::toJson(config, doc.to<JsonObject>());
+	return serializeJson(doc, chunk, BENCH_CHUNK);
+}
+#endif
+
+struct requestCost {
+	long allocations;
+	long peakHeap;
+	double us;
+};
+
+//serve one request with the counters on, then time a batch of them
+template<typename Fn>
+static requestCost measure(const char* name, Fn request){
+	allocations = 0;
+	heapUsed = 0;
+	heapPeak = 0;
+	measuring = true;
+	size_t bytes = request();
+	measuring = false;
+	requestCost cost = {allocations, heapPeak, 0};
+
+	auto start = std::chrono::steady_clock::now();
+	for(int i = 0; i < BENCH_REQUESTS; i++){bytes = request();}
+	cost.us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / BENCH_REQUESTS;
+
+	printf("%-24s %6zu bytes sent  %8.2f us  %3ld allocations  %5ld bytes peak heap\n", name, bytes, cost.us, cost.allocations, cost.peakHeap);
+	return cost;
+}
+
+
+int main(){
+	config.setHostname("bench-device");
+	config.setSsid("a-fairly-typical-ssid");
+	config.setMqttHost("broker.example.com");
+	config.setMqttUser("device-user");
+	config.setMqttWillTopic("home/bench-device/status");
+	config.setMqttWillMessage("offline");
+	config.setMqttPort(1883);
+
+	FILE* file = fopen(BENCH_TEMPLATE_PAGE, "rb");
+	CHECK(file != nullptr);
+	if(file == nullptr){return TEST_RESULT();}
+	static char page[8192];
+	size_t pageLength = fread(page, 1, sizeof(page), file);
+	fclose(file);
+
+	static uint8_t chunk[BENCH_CHUNK];
+
+	//two Strings per placeholder the old way, none for the page itself now
+	requestCost before = measure("template (String)", [&]{ return renderTemplate(page, pageLength, chunk); });
+	requestCost now = measure("static gzip page", [&]{ return serveStatic(web_assets[0], chunk); });
+	CHECK(before.allocations > 0);
+	CHECK_EQ(now.allocations, 0);
+#ifdef HAVE_ARDUINOJSON
+	//a page load is now two requests - the page and its values
+	requestCost values = measure("values JSON", [&]{ return serveValues(chunk); });
+	printf("%-24s %6s             %8.2f us  %3ld allocations  %5ld bytes peak heap (%.2fx the template time)\n", "page + values", "",
+		now.us + values.us, now.allocations + values.allocations, max(now.peakHeap, values.peakHeap), (now.us + values.us) / before.us);
+#else
+	printf("values JSON              (ArduinoJson not found or fetched - not measured)\n");
+#endif
+
+	return TEST_RESULT();
+}
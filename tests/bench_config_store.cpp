@@ -0,0 +1,144 @@
+/*
+    bench_config_store.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Load time of the binary config record against the same config stored as JSON and parsed with
+ArduinoJson (the way sketches stored it before ESPHelperConfigStore). Both go through the host
+filesystem so the difference is the parsing and the NetInfo setters.
+
+The JSON side is only built when CMake finds ArduinoJson (set ARDUINOJSON_ROOT to its folder).
+Host timings only show the relative cost - on the ESP8266 both are dominated by the flash reads.
+*/
+
+#include "hostTest.h"
+#include <chrono>
+#include <ESPHelperConfigStore.h>
+#ifdef HAVE_ARDUINOJSON
+#include <ArduinoJson.h>
+#endif
+
+#define BENCH_LOADS 5000
+
+
+static void fillConfig(NetInfo& config){
+	config.setHostname("bench-device");
+	config.setSsid("a-fairly-typical-ssid");
+	config.setPass("and-its-wifi-password");
+	config.setMqttHost("broker.example.com");
+	config.setMqttUser("device-user");
+	config.setMqttPass("device-pass");
+	config.setOtaPassword("ota-pass");
+	config.setMqttWillTopic("home/bench-device/status");
+	config.setMqttWillMessage("offline");
+	config.setMqttPort(1883);
+}
+
+static double elapsedUs(std::chrono::steady_clock::time_point start, int count){
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / count;
+}
+
+
+#ifdef HAVE_ARDUINOJSON
+static bool saveJson(const NetInfo& config, const char* path){
+	JsonDocument doc;
+	doc["hostname"] = config.getHostname();
+	doc["ssid"] = config.getSsid();
+	doc["netPass"] = config.getPass();
+	doc["mqttHost"] = config.getMqttHost();
+	doc["mqttUser"] = config.getMqttUser();
+	doc["mqttPass"] = config.getMqttPass();
+	doc["otaPass"] = config.getOtaPassword();
+	doc["willTopic"] = config.getMqttWillTopic();
+	doc["willMessage"] = config.getMqttWillMessage();
+	doc["mqttPort"] = config.getMqttPort();
+	doc["willQoS"] = config.getMqttWillQoS();
+	doc["willRetain"] = config.getMqttWillRetain();
+
+	char buf[512];
+	size_t length = serializeJson(doc, buf, sizeof(buf));
+	File file = LittleFS.open(path, "w");
+	bool written = file && file.write((const uint8_t*)buf, length) == length;
+	file.close();
+	return written;
+}
+
+static bool loadJson(NetInfo& config, const char* path){
+	File file = LittleFS.open(path, "r");
+	if(!file){return false;}
+	char buf[512];
+	size_t length = file.read((uint8_t*)buf, sizeof(buf));
+	file.close();
+
+	JsonDocument doc;
+	if(deserializeJson(doc, buf, length)){return false;}
+	config.setHostname(doc["hostname"] | "");
+	config.setSsid(doc["ssid"] | "");
+	config.setPass(doc["netPass"] | "");
+	config.setMqttHost(doc["mqttHost"] | "");
+	config.setMqttUser(doc["mqttUser"] | "");
+	config.setMqttPass(doc["mqttPass"] | "");
+	config.setOtaPassword(doc["otaPass"] | "");
+	config.setMqttWillTopic(doc["willTopic"] | "");
+	config.setMqttWillMessage(doc["willMessage"] | "");
+	config.setMqttPort(doc["mqttPort"] | 1883);
+	config.setMqttWillQoS(doc["willQoS"] | 1);
+	config.setMqttWillRetain(doc["willRetain"] | true);
+	return true;
+}
+#endif
+
+
+int main(){
+	CHECK(ESPHelperConfigStore::begin());
+
+	NetInfo config;
+	fillConfig(config);
+	CHECK(ESPHelperConfigStore::save(config, "/bench.bin"));
+
+	NetInfo loaded;
+	bool ok = true;
+	auto start = std::chrono::steady_clock::now();
+	for(int i = 0; i < BENCH_LOADS; i++){ok &= ESPHelperConfigStore::load(loaded, "/bench.bin");}
+	double binaryUs = elapsedUs(start, BENCH_LOADS);
+	CHECK(ok);
+	CHECK(strcmp(loaded.getMqttWillTopic(), config.getMqttWillTopic()) == 0);
+	printf("binary record: %u bytes, %.2f us per load\n", (unsigned)(sizeof(configRecordHeader) + sizeof(ESPHelperConf)), binaryUs);
+
+	#ifdef HAVE_ARDUINOJSON
+	CHECK(saveJson(config, "/bench.json"));
+	NetInfo parsed;
+	ok = true;
+	start = std::chrono::steady_clock::now();
+	for(int i = 0; i < BENCH_LOADS; i++){ok &= loadJson(parsed, "/bench.json");}
+	double jsonUs = elapsedUs(start, BENCH_LOADS);
+	CHECK(ok);
+	CHECK(strcmp(parsed.getMqttWillTopic(), config.getMqttWillTopic()) == 0);
+	File json = LittleFS.open("/bench.json", "r");
+	printf("ArduinoJson:   %u bytes, %.2f us per load (%.1fx the binary record)\n", (unsigned)json.size(), jsonUs, jsonUs / binaryUs);
+	json.close();
+	#else
+	printf("ArduinoJson not found - JSON comparison skipped (configure with -DARDUINOJSON_ROOT=<path>)\n");
+	#endif
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,126 @@
+/*
+    bench_mqtt_ota.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Whole MQTT OTA updates over hostOtaLink (the sender logic of mqtt_ota_sender.py and a broker with
+latency, jitter and loss) for a few windows. Transfer times are on the simulated clock, so they
+show what the window and the acks are worth on a link with that round trip - the device side
+costs nothing here. The host time per chunk is the device side work (copy, hash, write, acks)
+plus the simulation around it.
+
+Each case is the mean of BENCH_SEEDS runs with different loss patterns
+*/
+
+#include "hostTest.h"
+#include "hostPartition.h"
+#include "hostOtaLink.h"
+#include <chrono>
+
+
+#define BENCH_IMAGE_SIZE (256 * 1024)
+#define BENCH_CHUNK 1024
+#define BENCH_SEEDS 5
+#define BENCH_RUNNING "bench_mqtt_ota_running.bin"
+#define BENCH_UPDATE "bench_mqtt_ota_update.bin"
+
+
+static std::vector<uint8_t> readFile(const char* path){
+	std::vector<uint8_t> data;
+	FILE* file = fopen(path, "rb");
+	if(file == nullptr){return data;}
+	uint8_t buffer[4096];
+	size_t length;
+	while((length = fread(buffer, 1, sizeof(buffer), file)) > 0){data.insert(data.end(), buffer, buffer + length);}
+	fclose(file);
+	return data;
+}
+
+int main(){
+	LittleFS.begin();
+
+	NetInfo config;
+	config.setHostname("mqtt-ota-bench");
+	config.setSsid("host");
+	config.setPass("secret");
+	config.setMqttHost("10.0.0.1");
+
+	hostFilePartition partition(BENCH_RUNNING, BENCH_UPDATE);
+	ESPHelperMqttOTA update(partition);
+	ESPHelper device(&config);
+	CHECK(update.begin(device, "bench/ota"));
+	CHECK(device.setMQTTBuffer(BENCH_CHUNK + 128));
+	CHECK(device.begin());
+	for(int i = 0; i < 100 && device.getStatus() != FULL_CONNECTION; i++){
+		device.loop();
+		hostAdvanceMillis(10);
+	}
+	CHECK_EQ(device.getStatus(), FULL_CONNECTION);
+
+	std::vector<uint8_t> image(BENCH_IMAGE_SIZE);
+	for(size_t i = 0; i < image.size(); i++){image[i] = (uint8_t)(i * 7 + (i >> 9));}
+	const uint32_t chunks = (BENCH_IMAGE_SIZE + BENCH_CHUNK - 1) / BENCH_CHUNK;
+
+	struct benchCase {
+		uint8_t window;
+		uint32_t latencyMs;
+		uint8_t lossPercent;
+	};
+	const benchCase cases[] = {
+		{1, 20, 0}, {4, 20, 0}, {8, 20, 0},
+		{1, 20, 2}, {4, 20, 2}, {8, 20, 2},
+		{1, 20, 5}, {8, 20, 5},
+		{1, 100, 0}, {8, 100, 0},
+	};
+
+	printf("%u KiB image, %u byte chunks, jitter 5ms, %d runs per case\n", BENCH_IMAGE_SIZE / 1024, BENCH_CHUNK, BENCH_SEEDS);
+	printf("window  one way  loss   transfer   KiB/s   sent/chunks  host us/chunk\n");
+	for(const benchCase& c : cases){
+		double seconds = 0;
+		double sent = 0;
+		double hostUs = 0;
+		for(int seed = 1; seed <= BENCH_SEEDS; seed++){
+			hostOtaLinkOptions options;
+			options.latencyMs = c.latencyMs;
+			options.jitterMs = 5;
+			options.lossPercent = c.lossPercent;
+			options.ackLossPercent = c.lossPercent;
+			options.seed = seed;
+			hostOtaLink link(device, update, "bench/ota", image, BENCH_CHUNK, c.window, options);
+
+			auto start = std::chrono::steady_clock::now();
+			bool done = link.run(3600000);
+			hostUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / chunks;
+			CHECK(done);
+			CHECK(readFile(BENCH_UPDATE) == image);
+
+			seconds += link.elapsedMs / 1000.0;
+			sent += (double)link.chunksSent / chunks;
+		}
+		seconds /= BENCH_SEEDS;
+		printf("%6u  %5ums  %3u%%  %7.2f s  %6.1f  %11.3f  %13.1f\n", c.window, c.latencyMs, c.lossPercent,
+			seconds, BENCH_IMAGE_SIZE / 1024.0 / seconds, sent / BENCH_SEEDS, hostUs / BENCH_SEEDS);
+	}
+
+	remove(BENCH_UPDATE);
+	return TEST_RESULT();
+}
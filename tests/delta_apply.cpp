@@ -0,0 +1,83 @@
+/*
+    delta_apply.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Applies a patch from delta_gen.py with the real ESPHelperDeltaOTA - the running partition and the
+update partition are files (hostPartition.h). Used by delta_gen.py --check:
+
+	delta_apply <running image> <patch> <output image>
+
+The patch is fed in uneven pieces with handle() driven between them, like a download would
+*/
+
+#include "hostPartition.h"
+#include <vector>
+
+
+int main(int argc, char** argv){
+	if(argc != 4){
+		printf("usage: delta_apply <running image> <patch> <output image>\n");
+		return 2;
+	}
+
+	FILE* file = fopen(argv[2], "rb");
+	if(file == nullptr){
+		printf("can't open %s\n", argv[2]);
+		return 2;
+	}
+	std::vector<uint8_t> patch;
+	uint8_t buffer[4096];
+	size_t length;
+	while((length = fread(buffer, 1, sizeof(buffer), file)) > 0){patch.insert(patch.end(), buffer, buffer + length);}
+	fclose(file);
+
+	hostFilePartition partition(argv[1], argv[3]);
+	ESPHelperDeltaOTA writer(partition);
+	if(!writer.begin(patch.size(), true)){
+		printf("begin failed: %s\n", writer.getLastError());
+		return 1;
+	}
+
+	static const size_t pieces[] = {1, 7, 300, 1460, 5000};
+	size_t pos = 0;
+	size_t piece = 0;
+	while(pos < patch.size() || writer.isBusy()){
+		if(!writer.handle()){
+			if(writer.hasError()){break;}
+			continue;
+		}
+		size_t count = std::min(pieces[piece++ % 5], patch.size() - pos);
+		pos += writer.write(patch.data() + pos, count);
+		if(writer.hasError()){break;}
+	}
+
+	if(writer.hasError() || !writer.end()){
+		printf("failed: %s\n", writer.getLastError());
+		return 1;
+	}
+
+	const deltaStats& stats = writer.getStats();
+	printf("%lu bytes written: %lu copied from the running image, %lu from the patch, %lu operations\n",
+		(unsigned long)stats.written, (unsigned long)stats.copied, (unsigned long)stats.literal, (unsigned long)stats.ops);
+	return 0;
+}
@@ -0,0 +1,191 @@
+/*
+    Arduino.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "Arduino.h"
+
+#include <chrono>
+
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static uint64_t hostClockUs = 0;
+static uint32_t rtcMemory[128];
+
+
+//both wrap at 32 bits like on the device (unsigned long is 64 bits here)
+unsigned long millis(){
+	return (uint32_t)(hostClockUs / 1000);
+}
+
+unsigned long micros(){
+	return (uint32_t)hostClockUs;
+}
+
+void delay(unsigned long ms){
+	hostClockUs += (uint64_t)ms * 1000;
+}
+
+void yield(){
+}
+
+void hostAdvanceMicros(uint32_t us){
+	hostClockUs += us;
+}
+
+void hostAdvanceMillis(uint32_t ms){
+	hostClockUs += (uint64_t)ms * 1000;
+}
+
+long random(long howBig){
+	return howBig <= 0 ? 0 : rand() % howBig;
+}
+
+long random(long howSmall, long howBig){
+	return howBig <= howSmall ? howSmall : howSmall + random(howBig - howSmall);
+}
+
+
+size_t Print::write(const uint8_t* buffer, size_t size){
+	size_t written = 0;
+	while(written < size && write(buffer[written]) == 1){written++;}
+	return written;
+}
+
+size_t Print::printf(const char* format, ...){
+	char buf[256];
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+	if(len <= 0){return 0;}
+	return write((const uint8_t*)buf, min((size_t)len, sizeof(buf) - 1));
+}
+
+size_t Print::print(const String& str){
+	return write((const uint8_t*)str.c_str(), str.length());
+}
+
+
+size_t Stream::readBytes(uint8_t* buffer, size_t length){
+	size_t count = 0;
+	while(count < length){
+		int c = read();
+		if(c < 0){break;}
+		buffer[count++] = (uint8_t)c;
+	}
+	return count;
+}
+
+
+void String::assign(const char* str, size_t len){
+	if(len == 0){
+		free(_buf);
+		_buf = nullptr;
+		_len = 0;
+		return;
+	}
+	char* buf = (char*)malloc(len + 1);
+	memcpy(buf, str, len);
+	buf[len] = '\0';
+	free(_buf);
+	_buf = buf;
+	_len = len;
+}
+
+String& String::append(const char* str, size_t len){
+	if(len == 0){return *this;}
+	char* buf = (char*)realloc(_buf, _len + len + 1);
+	memcpy(buf + _len, str, len);
+	_len += len;
+	buf[_len] = '\0';
+	_buf = buf;
+	return *this;
+}
+
+String::String(int value){ char buf[16]; snprintf(buf, sizeof(buf), "%d", value); *this = buf; }
+String::String(unsigned int value){ char buf[16]; snprintf(buf, sizeof(buf), "%u", value); *this = buf; }
+String::String(long value){ char buf[24]; snprintf(buf, sizeof(buf), "%ld", value); *this = buf; }
+String::String(unsigned long value){ char buf[24]; snprintf(buf, sizeof(buf), "%lu", value); *this = buf; }
+String::String(double value, int decimals){ char buf[32]; snprintf(buf, sizeof(buf), "%.*f", decimals, value); *this = buf; }
+
+String operator+(const char* lhs, const String& rhs){
+	String result(lhs);
+	result += rhs;
+	return result;
+}
+
+
+size_t HardwareSerial::write(uint8_t c){
+	return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size){
+	//quiet unless asked for - the library's debug output would drown the test results
+	if(getenv("HOST_SERIAL") != nullptr){fwrite(buffer, 1, size, stdout);}
+	return size;
+}
+
+
+bool IPAddress::fromString(const char* str){
+	unsigned a, b, c, d;
+	char tail;
+	if(str == nullptr || sscanf(str, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4){return false;}
+	if(a > 255 || b > 255 || c > 255 || d > 255){return false;}
+	*this = IPAddress(a, b, c, d);
+	return true;
+}
+
+String IPAddress::toString() const{
+	char buf[16];
+	snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+	return String(buf);
+}
+
+
+void EspClass::getHeapStats(uint32_t* free, uint32_t* maxBlock, uint8_t* fragmentation){
+	if(free){*free = getFreeHeap();}
+	if(maxBlock){*maxBlock = getMaxFreeBlockSize();}
+	if(fragmentation){*fragmentation = getHeapFragmentation();}
+}
+
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size){
+	if(offset * 4 + size > sizeof(rtcMemory)){return false;}
+	memcpy(data, (uint8_t*)rtcMemory + offset * 4, size);
+	return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size){
+	if(offset * 4 + size > sizeof(rtcMemory)){return false;}
+	memcpy((uint8_t*)rtcMemory + offset * 4, data, size);
+	return true;
+}
+
+//there is no flash on the host - code that reads the running image is given a hostFilePartition
+bool EspClass::flashRead(uint32_t address, uint32_t* data, size_t size){
+	return false;
+}
+
+bool EspClass::flashRead(uint32_t address, uint8_t* data, size_t size){
+	return false;
+}
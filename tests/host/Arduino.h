@@ -0,0 +1,233 @@
+/*
+    Arduino.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Host stand-in for the Arduino core - just enough of it to build and run the ESPHelper sources on
+Linux. Time only moves when the test (or a delay() call) moves it so runs are repeatable.
+*/
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <limits.h>
+#include <functional>
+#include <algorithm>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define PROGMEM
+#define F(x) (x)
+#define PSTR(x) (x)
+#define FPSTR(x) (x)
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define snprintf_P snprintf
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+
+using std::min;
+using std::max;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+long random(long howBig);
+long random(long howSmall, long howBig);
+
+//test control of the clock
+void hostAdvanceMicros(uint32_t us);
+void hostAdvanceMillis(uint32_t ms);
+
+
+class Print {
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t* buffer, size_t size);
+	virtual void flush() {}
+
+	size_t write(const char* str) { return str == nullptr ? 0 : write((const uint8_t*)str, strlen(str)); }
+	size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+
+	size_t printf(const char* format, ...);
+	size_t print(const char* str) { return write(str); }
+	size_t print(char c) { return write((uint8_t)c); }
+	size_t print(int n) { return printf("%d", n); }
+	size_t print(unsigned int n) { return printf("%u", n); }
+	size_t print(long n) { return printf("%ld", n); }
+	size_t print(unsigned long n) { return printf("%lu", n); }
+	//same limits as the core's printFloat()
+	size_t print(double n, int digits = 2) {
+		if (isnan(n)) { return print("nan"); }
+		if (isinf(n)) { return print("inf"); }
+		if (n > 4294967040.0 || n < -4294967040.0) { return print("ovf"); }
+		return printf("%.*f", digits, n);
+	}
+	size_t print(const class String& str);
+	size_t println() { return write("\r\n"); }
+	template<typename T> size_t println(T value) { return print(value) + println(); }
+};
+
+
+class Stream : public Print {
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+
+	size_t readBytes(uint8_t* buffer, size_t length);
+	size_t readBytes(char* buffer, size_t length) { return readBytes((uint8_t*)buffer, length); }
+	void setTimeout(unsigned long timeout) { _timeout = timeout; }
+
+protected:
+	unsigned long _timeout = 1000;
+};
+
+
+//heap backed like the Arduino String so the allocation guard sees it
+class String {
+public:
+	String() {}
+	String(const char* str) { assign(str, str ? strlen(str) : 0); }
+	String(const String& other) { assign(other._buf, other._len); }
+	String(int value);
+	String(unsigned int value);
+	String(long value);
+	String(unsigned long value);
+	String(double value, int decimals = 2);
+	~String() { free(_buf); }
+
+	String& operator=(const String& other) { if (this != &other) { assign(other._buf, other._len); } return *this; }
+	String& operator=(const char* str) { assign(str, str ? strlen(str) : 0); return *this; }
+	String& operator+=(const String& other) { return append(other._buf, other._len); }
+	String& operator+=(const char* str) { return append(str, str ? strlen(str) : 0); }
+	String& operator+=(char c) { return append(&c, 1); }
+	String operator+(const String& other) const { String r(*this); r += other; return r; }
+	String operator+(const char* str) const { String r(*this); r += str; return r; }
+
+	bool operator==(const String& other) const { return strcmp(c_str(), other.c_str()) == 0; }
+	bool operator==(const char* str) const { return strcmp(c_str(), str ? str : "") == 0; }
+	bool operator!=(const char* str) const { return !(*this == str); }
+	bool equals(const char* str) const { return *this == str; }
+	bool startsWith(const char* prefix) const { return strncmp(c_str(), prefix, strlen(prefix)) == 0; }
+	bool isEmpty() const { return _len == 0; }
+
+	const char* c_str() const { return _buf ? _buf : ""; }
+	size_t length() const { return _len; }
+	int indexOf(const char* str) const { const char* at = strstr(c_str(), str); return at ? (int)(at - c_str()) : -1; }
+	long toInt() const { return atol(c_str()); }
+	float toFloat() const { return (float)atof(c_str()); }
+
+private:
+	void assign(const char* str, size_t len);
+	String& append(const char* str, size_t len);
+
+	char* _buf = nullptr;
+	size_t _len = 0;
+};
+
+String operator+(const char* lhs, const String& rhs);
+
+
+class HardwareSerial : public Stream {
+public:
+	void begin(unsigned long) {}
+	size_t write(uint8_t c) override;
+	size_t write(const uint8_t* buffer, size_t size) override;
+	int available() override { return 0; }
+	int read() override { return -1; }
+	int peek() override { return -1; }
+	using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+
+class IPAddress : public Print {
+public:
+	IPAddress() {}
+	IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _addr((uint32_t)a | (uint32_t)b << 8 | (uint32_t)c << 16 | (uint32_t)d << 24) {}
+	IPAddress(uint32_t addr) : _addr(addr) {}
+
+	operator uint32_t() const { return _addr; }
+	uint8_t operator[](int index) const { return (_addr >> (index * 8)) & 0xFF; }
+	bool operator==(const IPAddress& other) const { return _addr == other._addr; }
+	bool isSet() const { return _addr != 0; }
+	bool fromString(const char* str);
+	String toString() const;
+
+	size_t write(uint8_t) override { return 1; }
+
+private:
+	uint32_t _addr = 0;
+};
+
+
+class Client : public Stream {
+public:
+	virtual int connect(IPAddress ip, uint16_t port) = 0;
+	virtual int connect(const char* host, uint16_t port) = 0;
+	virtual uint8_t connected() = 0;
+	virtual void stop() = 0;
+	virtual int read(uint8_t* buffer, size_t size) = 0;
+	operator bool() { return connected(); }
+	using Stream::read;
+};
+
+
+class EspClass {
+public:
+	uint32_t getFreeHeap() { return 40000; }
+	uint32_t getMaxFreeBlockSize() { return 30000; }
+	uint8_t getHeapFragmentation() { return 10; }
+	uint32_t getFreeContStack() { return 3000; }
+	void getHeapStats(uint32_t* free, uint32_t* maxBlock, uint8_t* fragmentation);
+	void restart() { restarts++; }
+	void reset() { restarts++; }
+	uint32_t getChipId() { return 0x00C0FFEE; }
+	uint32_t getFreeSketchSpace() { return 1024 * 1024; }
+	uint32_t getSketchSize() { return 512 * 1024; }
+	bool rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size);
+	bool rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size);
+	bool flashRead(uint32_t address, uint32_t* data, size_t size);
+	bool flashRead(uint32_t address, uint8_t* data, size_t size);
+
+	uint32_t restarts = 0;
+};
+
+extern EspClass ESP;
+
+#endif
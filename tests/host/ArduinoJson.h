@@ -0,0 +1,152 @@
+/*
+    ArduinoJson.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Host stand-in for the small part of ArduinoJson that ESPHelper.cpp and ESPHelperMqttOTA.cpp use.
+A document is just pre-serialized text - the tests only care how it reaches the MQTT client.
+deserializeJson() takes a flat object of numbers, bools and strings without escapes, which is
+all an OTA begin message holds
+*/
+
+#ifndef HOST_ARDUINOJSON_H
+#define HOST_ARDUINOJSON_H
+
+#include <Arduino.h>
+
+#define HOST_JSON_MAX_MEMBERS 8
+
+class JsonVariantConst {
+public:
+	JsonVariantConst(const char* value = nullptr, bool isString = false) : _value(value), _isString(isString) {}
+
+	template<typename T> T as() const {
+		if (_value == nullptr || _isString) { return T(); }
+		if (strcmp(_value, "true") == 0) { return (T)1; }
+		return (T)strtoull(_value, nullptr, 10);
+	}
+	bool isNull() const { return _value == nullptr; }
+
+private:
+	const char* _value;
+	bool _isString;
+};
+
+template<> inline const char* JsonVariantConst::as<const char*>() const { return _isString ? _value : nullptr; }
+
+class JsonDocument {
+public:
+	void set(const char* json) { snprintf(_text, sizeof(_text), "%s", json); }
+	const char* text() const { return _text; }
+
+	JsonVariantConst operator[](const char* key) const {
+		for (uint8_t i = 0; i < _memberCount; i++) {
+			if (strcmp(_members[i].key, key) == 0) { return JsonVariantConst(_members[i].value, _members[i].isString); }
+		}
+		return JsonVariantConst();
+	}
+
+	bool parse(const char* json, size_t length);
+
+private:
+	struct member {
+		char key[24];
+		char value[96];
+		bool isString;
+	};
+
+	char _text[256] = "null";
+	member _members[HOST_JSON_MAX_MEMBERS];
+	uint8_t _memberCount = 0;
+};
+
+//reads "text" or a bare value (number, true, false, null) up to the next , or }
+inline bool hostJsonToken(const char*& pos, const char* end, char* out, size_t size, bool& isString) {
+	while (pos < end && *pos == ' ') { pos++; }
+	isString = pos < end && *pos == '"';
+	if (isString) { pos++; }
+	size_t length = 0;
+	while (pos < end && (isString ? *pos != '"' : (*pos != ',' && *pos != '}' && *pos != ':' && *pos != ' '))) {
+		if (*pos == '\\' || length + 1 >= size) { return false; }
+		out[length++] = *pos++;
+	}
+	out[length] = '\0';
+	if (isString) {
+		if (pos == end) { return false; }
+		pos++;
+	}
+	while (pos < end && *pos == ' ') { pos++; }
+	return isString || length > 0;
+}
+
+inline bool JsonDocument::parse(const char* json, size_t length) {
+	const char* pos = json;
+	const char* end = json + length;
+	_memberCount = 0;
+	while (pos < end && *pos == ' ') { pos++; }
+	if (pos == end || *pos++ != '{') { return false; }
+	while (pos < end && *pos == ' ') { pos++; }
+	if (pos < end && *pos == '}') { return true; }
+
+	while (pos < end) {
+		if (_memberCount == HOST_JSON_MAX_MEMBERS) { return false; }
+		member& m = _members[_memberCount];
+		bool keyIsString;
+		if (!hostJsonToken(pos, end, m.key, sizeof(m.key), keyIsString) || !keyIsString) { return false; }
+		if (pos == end || *pos++ != ':') { return false; }
+		if (!hostJsonToken(pos, end, m.value, sizeof(m.value), m.isString)) { return false; }
+		if (m.isString || strcmp(m.value, "null") != 0) { _memberCount++; }
+		if (pos < end && *pos == '}') { return true; }
+		if (pos == end || *pos++ != ',') { return false; }
+	}
+	return false;
+}
+
+class DeserializationError {
+public:
+	explicit DeserializationError(bool failed) : _failed(failed) {}
+	explicit operator bool() const { return _failed; }
+	const char* c_str() const { return _failed ? "InvalidInput" : "Ok"; }
+
+private:
+	bool _failed;
+};
+
+inline DeserializationError deserializeJson(JsonDocument& doc, const uint8_t* json, size_t length) {
+	return DeserializationError(!doc.parse((const char*)json, length));
+}
+
+inline DeserializationError deserializeJson(JsonDocument& doc, const char* json) {
+	return DeserializationError(!doc.parse(json, strlen(json)));
+}
+
+inline size_t measureJsonPretty(const JsonDocument& doc) { return strlen(doc.text()); }
+
+inline size_t serializeJsonPretty(const JsonDocument& doc, Print& out) { return out.write(doc.text()); }
+
+inline size_t serializeJsonPretty(const JsonDocument& doc, char* buf, size_t size) {
+	if (size == 0) { return 0; }
+	snprintf(buf, size, "%s", doc.text());
+	return min(strlen(doc.text()), size - 1);
+}
+
+#endif
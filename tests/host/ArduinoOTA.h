@@ -0,0 +1,54 @@
+/*
+    ArduinoOTA.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Host stand-in for ArduinoOTA - handle() is counted so tests can see that loop() ran it
+*/
+
+#ifndef HOST_ARDUINOOTA_H
+#define HOST_ARDUINOOTA_H
+
+#include <Arduino.h>
+
+typedef int ota_error_t;
+
+class ArduinoOTAClass {
+public:
+	void onStart(std::function<void()>) {}
+	void onEnd(std::function<void()>) {}
+	void onProgress(std::function<void(unsigned int, unsigned int)>) {}
+	void onError(std::function<void(ota_error_t)>) {}
+	void setHostname(const char*) {}
+	void setPassword(const char*) {}
+	void setRebootOnSuccess(bool) {}
+	void begin(bool = true) { running = true; }
+	void end() { running = false; }
+	void handle() { handled++; }
+
+	bool running = false;
+	uint32_t handled = 0;
+};
+
+extern ArduinoOTAClass ArduinoOTA;
+
+#endif
@@ -0,0 +1,53 @@
+/*
+    ESP8266HTTPClient.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Host stand-in for the ESP8266 HTTPClient - like WiFiClient it never reaches a server. The host
+tests download through a socket ESPHelperOTASource instead
+*/
+
+#ifndef HOST_ESP8266HTTPCLIENT_H
+#define HOST_ESP8266HTTPCLIENT_H
+
+#include <ESP8266WiFi.h>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTP_CODE_OK 200
+#define HTTP_CODE_PARTIAL_CONTENT 206
+
+class HTTPClient {
+public:
+	bool begin(WiFiClient& client, const String& url) { return url.startsWith("http"); }
+	void end() {}
+	void setTimeout(uint16_t) {}
+	void setReuse(bool) {}
+	void collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {}
+	void addHeader(const String& name, const String& value) {}
+	int GET() { return HTTPC_ERROR_CONNECTION_REFUSED; }
+	int getSize() { return -1; }
+	bool connected() { return false; }
+	String header(const char* name) { return String(); }
+	WiFiClient* getStreamPtr() { return nullptr; }
+};
+
+#endif
@@ -0,0 +1,88 @@
+/*
+    ESP8266WiFi.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Host stand-in for the ESP8266 WiFi library. The station "connects" as soon as begin() is called
+unless a test takes the network down with hostSetWiFi(false)
+*/
+
+#ifndef HOST_ESP8266WIFI_H
+#define HOST_ESP8266WIFI_H
+
+#include <Arduino.h>
+
+typedef enum {WL_IDLE_STATUS = 0, WL_NO_SSID_AVAIL = 1, WL_CONNECTED = 3, WL_CONNECT_FAILED = 4, WL_DISCONNECTED = 6} wl_status_t;
+typedef enum {WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3} WiFiMode_t;
+
+
+class WiFiClass {
+public:
+	void mode(WiFiMode_t mode) { _mode = mode; }
+	int begin(const char* ssid, const char* pass = nullptr) { _begun = true; return status(); }
+	bool reconnect() { _begun = true; return true; }
+	bool disconnect(bool wifiOff = false) { _begun = false; return true; }
+	wl_status_t status() { return _begun && _available ? WL_CONNECTED : WL_DISCONNECTED; }
+	void setAutoReconnect(bool) {}
+	void setSleep(bool) {}
+	uint8_t* macAddress(uint8_t* mac) { static const uint8_t fake[6] = {0x02, 0, 0, 0x12, 0x34, 0x56}; memcpy(mac, fake, 6); return mac; }
+	IPAddress localIP() { return status() == WL_CONNECTED ? IPAddress(10, 0, 0, 2) : IPAddress(); }
+	int32_t RSSI() { return -60; }
+	String SSID() { return String("host"); }
+	bool softAPConfig(IPAddress, IPAddress, IPAddress) { return true; }
+	bool softAP(const char*, const char* = nullptr) { return true; }
+	bool softAPdisconnect(bool = false) { return true; }
+	int hostByName(const char* host, IPAddress& result) { return result.fromString(host) ? 1 : 0; }
+
+	//test controls
+	void hostSetAvailable(bool available) { _available = available; }
+
+private:
+	WiFiMode_t _mode = WIFI_OFF;
+	bool _begun = false;
+	bool _available = true;
+};
+
+extern WiFiClass WiFi;
+
+
+//TCP client that never carries any data - PubSubClient is faked above it
+class WiFiClient : public Client {
+public:
+	int connect(IPAddress, uint16_t) override { _connected = true; return 1; }
+	int connect(const char*, uint16_t) override { _connected = true; return 1; }
+	uint8_t connected() override { return _connected; }
+	void stop() override { _connected = false; }
+	int available() override { return 0; }
+	int read() override { return -1; }
+	int read(uint8_t*, size_t) override { return -1; }
+	int peek() override { return -1; }
+	size_t write(uint8_t) override { return 1; }
+	size_t write(const uint8_t*, size_t size) override { return size; }
+	void setNoDelay(bool) {}
+	using Print::write;
+
+protected:
+	bool _connected = false;
+};
+
+#endif
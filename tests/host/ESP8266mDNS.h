@@ -0,0 +1,46 @@
+/*
+    ESP8266mDNS.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Host stand-in for the ESP8266 mDNS responder (no services are ever found)
+*/
+
+#ifndef HOST_ESP8266MDNS_H
+#define HOST_ESP8266MDNS_H
+
+#include <Arduino.h>
+
+class MDNSResponder {
+public:
+	bool begin(const char*) { return true; }
+	void update() {}
+	int queryService(const char*, const char*) { return 0; }
+	IPAddress IP(int) { return IPAddress(); }
+	uint16_t port(int) { return 0; }
+	bool hasTxt(int, const char*) { return false; }
+	String txt(int, const char*) { return String(); }
+};
+
+extern MDNSResponder MDNS;
+
+#endif
@@ -0,0 +1,283 @@
+/*
+    LittleFS.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "LittleFS.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+fs::FS LittleFS;
+
+namespace fs {
+
+class FileImpl {
+public:
+	FILE* fp = nullptr;
+	char name[128] = "";
+	int refs = 1;
+	bool appendOnly = false;
+	bool dirty = false;				//written since it was opened or last synced
+	bool tailCopied = false;		//the partly filled last block was already moved to a fresh block
+};
+
+
+File::File(FileImpl* impl) : _impl(impl) {}
+
+File::File(const File& other) : _impl(other._impl){
+	if(_impl){_impl->refs++;}
+}
+
+File& File::operator=(const File& other){
+	if(this != &other){
+		close();
+		_impl = other._impl;
+		if(_impl){_impl->refs++;}
+	}
+	return *this;
+}
+
+File::~File(){
+	close();
+}
+
+size_t File::write(const uint8_t* buffer, size_t size){
+	if(_impl == nullptr){return 0;}
+	if(_impl->appendOnly){fseek(_impl->fp, 0, SEEK_END);}
+
+	size_t allowed = size;
+	if(!LittleFS.hostTakeWrite(allowed)){size = allowed;}
+	if(size == 0){return 0;}
+
+	hostFsStats& stats = LittleFS.hostMutableStats();
+	size_t pos = position();
+
+	//copy on write: the first write into a block that already holds data moves that data to a fresh block
+	size_t blockOffset = pos % HOST_FS_BLOCK_SIZE;
+	if(!_impl->tailCopied && blockOffset > 0){
+		stats.bytesProgrammed += blockOffset;
+		stats.blocksErased++;
+	}
+	_impl->tailCopied = true;
+
+	//every other block the data runs into is a fresh one
+	size_t touched = (blockOffset + size - 1) / HOST_FS_BLOCK_SIZE + 1;
+	stats.blocksErased += touched - (blockOffset > 0 ? 1 : 0);
+	stats.bytesWritten += size;
+	stats.bytesProgrammed += size;
+
+	size_t written = fwrite(buffer, 1, size, _impl->fp);
+	_impl->dirty = true;
+	return written;
+}
+
+int File::available(){
+	if(_impl == nullptr){return 0;}
+	return (int)(size() - position());
+}
+
+int File::read(){
+	uint8_t c;
+	return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek(){
+	if(_impl == nullptr){return -1;}
+	int c = fgetc(_impl->fp);
+	if(c != EOF){ungetc(c, _impl->fp);}
+	return c == EOF ? -1 : c;
+}
+
+size_t File::read(uint8_t* buffer, size_t size){
+	if(_impl == nullptr){return 0;}
+	return fread(buffer, 1, size, _impl->fp);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode){
+	if(_impl == nullptr){return false;}
+	return fseek(_impl->fp, pos, mode == SeekSet ? SEEK_SET : mode == SeekCur ? SEEK_CUR : SEEK_END) == 0;
+}
+
+size_t File::position() const{
+	if(_impl == nullptr){return 0;}
+	long pos = ftell(_impl->fp);
+	return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t File::size() const{
+	if(_impl == nullptr){return 0;}
+	fflush(_impl->fp);
+	struct stat st;
+	if(fstat(fileno(_impl->fp), &st) != 0){return 0;}
+	return (size_t)st.st_size;
+}
+
+bool File::truncate(uint32_t size){
+	if(_impl == nullptr){return false;}
+	fflush(_impl->fp);
+	_impl->dirty = true;
+	return ftruncate(fileno(_impl->fp), size) == 0;
+}
+
+void File::flush(){
+	if(_impl == nullptr){return;}
+	fflush(_impl->fp);
+	if(_impl->dirty){
+		hostFsStats& stats = LittleFS.hostMutableStats();
+		stats.bytesProgrammed += HOST_FS_METADATA_COMMIT;
+		stats.commits++;
+		_impl->dirty = false;
+	}
+}
+
+void File::close(){
+	if(_impl == nullptr){return;}
+	if(--_impl->refs == 0){
+		flush();
+		fclose(_impl->fp);
+		delete _impl;
+	}
+	_impl = nullptr;
+}
+
+const char* File::name() const{
+	return _impl ? _impl->name : "";
+}
+
+
+bool FS::begin(){
+	hostRoot();
+	return true;
+}
+
+bool FS::format(){
+	DIR* dir = opendir(hostRoot());
+	if(dir == nullptr){return false;}
+	struct dirent* entry;
+	char path[512];
+	while((entry = readdir(dir)) != nullptr){
+		if(entry->d_name[0] == '.'){continue;}
+		snprintf(path, sizeof(path), "%s/%s", _root, entry->d_name);
+		unlink(path);
+	}
+	closedir(dir);
+	return true;
+}
+
+File FS::open(const char* path, const char* mode){
+	char full[512];
+	if(!hostPath(path, full, sizeof(full))){return File();}
+
+	FILE* fp = fopen(full, mode[0] == 'a' ? (mode[1] == '+' ? "a+" : "a") : mode);
+	if(fp == nullptr){return File();}
+	if(mode[0] == 'w'){
+		_stats.bytesProgrammed += HOST_FS_METADATA_COMMIT;
+		_stats.commits++;
+	}
+
+	FileImpl* impl = new FileImpl();
+	impl->fp = fp;
+	impl->appendOnly = mode[0] == 'a';
+	snprintf(impl->name, sizeof(impl->name), "%s", path);
+	if(impl->appendOnly){fseek(fp, 0, SEEK_END);}
+	return File(impl);
+}
+
+bool FS::exists(const char* path){
+	char full[512];
+	struct stat st;
+	return hostPath(path, full, sizeof(full)) && stat(full, &st) == 0;
+}
+
+bool FS::remove(const char* path){
+	char full[512];
+	if(!hostPath(path, full, sizeof(full)) || unlink(full) != 0){return false;}
+	_stats.bytesProgrammed += HOST_FS_METADATA_COMMIT;
+	_stats.commits++;
+	return true;
+}
+
+bool FS::rename(const char* from, const char* to){
+	char fullFrom[512];
+	char fullTo[512];
+	if(!hostPath(from, fullFrom, sizeof(fullFrom)) || !hostPath(to, fullTo, sizeof(fullTo))){return false;}
+	if(::rename(fullFrom, fullTo) != 0){return false;}
+	_stats.bytesProgrammed += HOST_FS_METADATA_COMMIT;
+	_stats.commits++;
+	return true;
+}
+
+bool FS::info(FSInfo& info){
+	info.totalBytes = 1024 * 1024;
+	info.usedBytes = 0;
+	info.blockSize = HOST_FS_BLOCK_SIZE;
+	info.pageSize = HOST_FS_PAGE_SIZE;
+	info.maxOpenFiles = 5;
+	info.maxPathLength = 32;
+	return true;
+}
+
+void FS::hostSetRoot(const char* dir){
+	snprintf(_root, sizeof(_root), "%s", dir);
+	mkdir(_root, 0755);
+}
+
+//the temporary directory is removed again when the test exits
+static void removeTempRoot(){
+	LittleFS.format();
+	rmdir(LittleFS.hostRoot());
+}
+
+const char* FS::hostRoot(){
+	if(_root[0] == '\0'){
+		char tmpl[] = "/tmp/espHelperFsXXXXXX";
+		if(mkdtemp(tmpl) != nullptr){
+			snprintf(_root, sizeof(_root), "%s", tmpl);
+			atexit(removeTempRoot);
+		}
+	}
+	return _root;
+}
+
+bool FS::hostTakeWrite(size_t& length){
+	if(_failAfter < 0){return true;}
+	if((long)length <= _failAfter){
+		_failAfter -= length;
+		return true;
+	}
+	length = _failAfter;
+	_failAfter = 0;
+	return false;
+}
+
+bool FS::hostPath(const char* path, char* out, size_t outLength){
+	if(path == nullptr || path[0] != '/'){return false;}
+	//flat namespace - nested paths are stored with their slashes flattened
+	int len = snprintf(out, outLength, "%s/", hostRoot());
+	for(const char* c = path + 1; *c && (size_t)len < outLength - 1; c++){out[len++] = *c == '/' ? '_' : *c;}
+	out[len] = '\0';
+	return true;
+}
+
+}
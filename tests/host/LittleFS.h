@@ -0,0 +1,135 @@
+/*
+    LittleFS.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Host stand-in for LittleFS backed by a directory on the host (hostSetRoot(), a fresh temporary
+directory by default).
+
+It also keeps a rough count of what littlefs would program to flash for the calls made: file
+data is stored copy-on-write in blocks of HOST_FS_BLOCK_SIZE, so the first write after a file
+is reopened copies the partly filled last block, and each close/sync of a written file commits
+its metadata. This is what makes appending to a log in small pieces expensive on a real device.
+*/
+
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include <Arduino.h>
+
+#define HOST_FS_BLOCK_SIZE 4096
+#define HOST_FS_PAGE_SIZE 256
+#define HOST_FS_METADATA_COMMIT HOST_FS_PAGE_SIZE		//bytes programmed to record a file update in its metadata pair
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct FSInfo {
+	size_t totalBytes;
+	size_t usedBytes;
+	size_t blockSize;
+	size_t pageSize;
+	size_t maxOpenFiles;
+	size_t maxPathLength;
+};
+
+struct hostFsStats {
+	uint64_t bytesWritten = 0;		//bytes handed to File::write
+	uint64_t bytesProgrammed = 0;	//bytes the filesystem would program (data, copied tails, metadata)
+	uint64_t blocksErased = 0;		//fresh blocks taken for data
+	uint32_t commits = 0;			//metadata commits
+};
+
+class FileImpl;
+
+class File : public Stream {
+public:
+	File() {}
+	explicit File(FileImpl* impl);
+	File(const File& other);
+	File& operator=(const File& other);
+	~File();
+
+	size_t write(uint8_t c) override { return write(&c, 1); }
+	size_t write(const uint8_t* buffer, size_t size) override;
+	int available() override;
+	int read() override;
+	int peek() override;
+	size_t read(uint8_t* buffer, size_t size);
+	bool seek(uint32_t pos, SeekMode mode = SeekSet);
+	size_t position() const;
+	size_t size() const;
+	bool truncate(uint32_t size);
+	void flush() override;
+	void close();
+	const char* name() const;
+	operator bool() const { return _impl != nullptr; }
+	using Print::write;
+
+private:
+	FileImpl* _impl = nullptr;
+};
+
+class FS {
+public:
+	bool begin();
+	void end() {}
+	bool format();
+	File open(const char* path, const char* mode = "r");
+	bool exists(const char* path);
+	bool remove(const char* path);
+	bool rename(const char* from, const char* to);
+	bool info(FSInfo& info);
+
+	//test controls
+	void hostSetRoot(const char* dir);
+	const char* hostRoot();
+	void hostResetStats() { _stats = hostFsStats(); }
+	const hostFsStats& hostStats() const { return _stats; }
+	hostFsStats& hostMutableStats() { return _stats; }
+
+	//fail every write after this many more bytes (simulates a power cut mid write), -1 to disable
+	void hostFailWritesAfter(long bytes) { _failAfter = bytes; }
+	bool hostTakeWrite(size_t& length);
+
+private:
+	bool hostPath(const char* path, char* out, size_t outLength);
+
+	char _root[256] = "";
+	hostFsStats _stats;
+	long _failAfter = -1;
+};
+
+}
+
+using fs::File;
+using fs::FS;
+using fs::FSInfo;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+extern fs::FS LittleFS;
+
+#endif
@@ -0,0 +1,52 @@
+/*
+    Metro.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Host stand-in for the Metro interval timer
+*/
+
+#ifndef HOST_METRO_H
+#define HOST_METRO_H
+
+#include <Arduino.h>
+
+class Metro {
+public:
+	Metro(unsigned long interval) : _interval(interval), _previous(millis()) {}
+
+	bool check() {
+		if (millis() - _previous >= _interval) {
+			_previous = millis();
+			return true;
+		}
+		return false;
+	}
+	void reset() { _previous = millis(); }
+	void interval(unsigned long interval) { _interval = interval; }
+
+private:
+	unsigned long _interval;
+	unsigned long _previous;
+};
+
+#endif
@@ -0,0 +1,151 @@
+/*
+    PubSubClient.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "PubSubClient.h"
+
+
+PubSubClient::PubSubClient(){
+	setBufferSize(MQTT_MAX_PACKET_SIZE);
+}
+
+PubSubClient::~PubSubClient(){
+	free(_buffer);
+}
+
+boolean PubSubClient::setBufferSize(uint16_t size){
+	if(size == 0){return false;}
+	uint8_t* buffer = (uint8_t*)realloc(_buffer, size);
+	if(buffer == nullptr){return false;}
+	_buffer = buffer;
+	_bufferSize = size;
+	return true;
+}
+
+boolean PubSubClient::connect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage, boolean cleanSession){
+	if(!_allowConnect){return false;}
+	if(_client != nullptr && !_client->connected()){_client->connect("broker", 1883);}
+	_connected = true;
+	connects++;
+	return true;
+}
+
+//hands one queued message to the callback per call, like the real client reads one packet
+boolean PubSubClient::loop(){
+	loops++;
+	if(!_connected){return false;}
+	if(_pendingCount == 0 || !_callback){return true;}
+
+	pendingMessage& msg = _pending[0];
+	size_t topicLength = strlen(msg.topic);
+	if(MQTT_MAX_HEADER_SIZE + topicLength + 1 + msg.length > _bufferSize){return true;}
+
+	//same layout as the real client: the topic is null terminated in place inside the buffer
+	char* topic = (char*)_buffer + MQTT_MAX_HEADER_SIZE;
+	memcpy(topic, msg.topic, topicLength + 1);
+	uint8_t* payload = (uint8_t*)topic + topicLength + 1;
+	memcpy(payload, msg.payload, msg.length);
+	unsigned int length = msg.length;
+
+	_pendingCount--;
+	memmove(&_pending[0], &_pending[1], _pendingCount * sizeof(pendingMessage));
+
+	_callback(topic, payload, length);
+	return true;
+}
+
+boolean PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int length, boolean retained){
+	if(!_connected){return false;}
+	size_t topicLength = strlen(topic);
+	if(MQTT_MAX_HEADER_SIZE + 2 + topicLength + length > _bufferSize){return false;}
+
+	//the outgoing topic is written over whatever the buffer held (ie a received topic)
+	memmove(_buffer + MQTT_MAX_HEADER_SIZE + 2, topic, topicLength);
+	return record(topic, payload, length, retained);
+}
+
+boolean PubSubClient::beginPublish(const char* topic, unsigned int length, boolean retained){
+	if(!_connected || _streaming){return false;}
+	size_t topicLength = strlen(topic);
+	if(MQTT_MAX_HEADER_SIZE + 2 + topicLength > _bufferSize || topicLength >= sizeof(sent[0].topic)){return false;}
+	if(sentCount == HOST_MQTT_MAX_SENT){return false;}
+
+	sentMessage& msg = sent[sentCount];
+	memcpy(msg.topic, topic, topicLength + 1);
+
+	//the header goes through the client buffer first
+	memmove(_buffer + MQTT_MAX_HEADER_SIZE + 2, topic, topicLength);
+
+	_streaming = true;
+	_streamExpected = length;
+	_streamLength = 0;
+	_streamRetained = retained;
+	return true;
+}
+
+size_t PubSubClient::write(const uint8_t* buffer, size_t size){
+	if(!_streaming){return 0;}
+	sentMessage& msg = sent[sentCount];
+	size_t room = sizeof(msg.payload) - min((size_t)_streamLength, sizeof(msg.payload));
+	memcpy(msg.payload + _streamLength, buffer, min(size, room));
+	_streamLength += size;
+	return size;
+}
+
+int PubSubClient::endPublish(){
+	if(!_streaming){return 0;}
+	_streaming = false;
+
+	//a publish whose length disagrees with beginPublish() is a malformed packet
+	if(_streamLength != _streamExpected || _streamLength > sizeof(sent[0].payload)){return 0;}
+
+	sentMessage& msg = sent[sentCount++];
+	msg.length = _streamLength;
+	msg.retained = _streamRetained;
+	return 1;
+}
+
+bool PubSubClient::record(const char* topic, const uint8_t* payload, unsigned int length, bool retained){
+	if(sentCount == HOST_MQTT_MAX_SENT || strlen(topic) >= sizeof(sent[0].topic) || length > sizeof(sent[0].payload)){return false;}
+	sentMessage& msg = sent[sentCount++];
+	snprintf(msg.topic, sizeof(msg.topic), "%s", topic);
+	memcpy(msg.payload, payload, length);
+	msg.length = length;
+	msg.retained = retained;
+	return true;
+}
+
+bool PubSubClient::hostDeliver(const char* topic, const uint8_t* payload, unsigned int length){
+	if(_pendingCount == HOST_MQTT_MAX_PENDING || strlen(topic) >= sizeof(_pending[0].topic) || length > sizeof(_pending[0].payload)){return false;}
+	pendingMessage& msg = _pending[_pendingCount++];
+	snprintf(msg.topic, sizeof(msg.topic), "%s", topic);
+	memcpy(msg.payload, payload, length);
+	msg.length = length;
+	return true;
+}
+
+const PubSubClient::sentMessage* PubSubClient::hostFindSent(const char* topic) const{
+	for(size_t i = sentCount; i > 0; i--){
+		if(strcmp(sent[i - 1].topic, topic) == 0){return &sent[i - 1];}
+	}
+	return nullptr;
+}
@@ -0,0 +1,134 @@
+/*
+    PubSubClient.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Host stand-in for PubSubClient 2.8. There is no broker - connect() succeeds while the test allows
+it, published messages are kept for the test to inspect and hostDeliver() queues a message that
+the next loop() hands to the callback.
+
+Like the real client, the topic and payload handed to the callback live in the client's buffer,
+and beginPublish()/publish() write the outgoing topic into that same buffer.
+*/
+
+#ifndef HOST_PUBSUBCLIENT_H
+#define HOST_PUBSUBCLIENT_H
+
+#include <Arduino.h>
+
+#define MQTT_MAX_PACKET_SIZE 256
+#define MQTT_MAX_HEADER_SIZE 5
+#define MQTT_CONNECTED 0
+#define MQTT_DISCONNECTED -1
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+#define HOST_MQTT_MAX_PENDING 8
+#define HOST_MQTT_MAX_SENT 32
+#define HOST_MQTT_MAX_PAYLOAD 2048		//payload kept per message (the client buffer still limits what gets through)
+
+
+class PubSubClient : public Print {
+public:
+	struct sentMessage {
+		char topic[128];
+		uint8_t payload[HOST_MQTT_MAX_PAYLOAD];
+		unsigned int length;
+		bool retained;
+	};
+
+	PubSubClient();
+	~PubSubClient();
+
+	PubSubClient& setServer(IPAddress ip, uint16_t port) { return *this; }
+	PubSubClient& setServer(const char* host, uint16_t port) { return *this; }
+	PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE) { _callback = callback; return *this; }
+	PubSubClient& setClient(Client& client) { _client = &client; return *this; }
+	PubSubClient& setKeepAlive(uint16_t) { return *this; }
+	PubSubClient& setSocketTimeout(uint16_t) { return *this; }
+	boolean setBufferSize(uint16_t size);
+	uint16_t getBufferSize() { return _bufferSize; }
+
+	boolean connect(const char* id) { return connect(id, nullptr, nullptr, nullptr, 0, false, nullptr, true); }
+	boolean connect(const char* id, const char* user, const char* pass) { return connect(id, user, pass, nullptr, 0, false, nullptr, true); }
+	boolean connect(const char* id, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage) { return connect(id, nullptr, nullptr, willTopic, willQos, willRetain, willMessage, true); }
+	boolean connect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage) { return connect(id, user, pass, willTopic, willQos, willRetain, willMessage, true); }
+	boolean connect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage, boolean cleanSession);
+	void disconnect() { _connected = false; }
+	boolean connected() { return _connected; }
+	int state() { return _connected ? MQTT_CONNECTED : MQTT_DISCONNECTED; }
+	boolean loop();
+
+	boolean publish(const char* topic, const char* payload) { return publish(topic, (const uint8_t*)payload, strlen(payload), false); }
+	boolean publish(const char* topic, const char* payload, boolean retained) { return publish(topic, (const uint8_t*)payload, strlen(payload), retained); }
+	boolean publish(const char* topic, const uint8_t* payload, unsigned int length) { return publish(topic, payload, length, false); }
+	boolean publish(const char* topic, const uint8_t* payload, unsigned int length, boolean retained);
+	boolean beginPublish(const char* topic, unsigned int length, boolean retained);
+	size_t write(uint8_t c) override { return write(&c, 1); }
+	size_t write(const uint8_t* buffer, size_t size) override;
+	int endPublish();
+
+	boolean subscribe(const char* topic) { return subscribe(topic, 0); }
+	boolean subscribe(const char* topic, uint8_t qos) { if (_connected) { subscribes++; } return _connected; }
+	boolean unsubscribe(const char* topic) { return _connected; }
+
+	//test controls
+	void hostAllowConnect(bool allow) { _allowConnect = allow; }
+	bool hostDeliver(const char* topic, const uint8_t* payload, unsigned int length);
+	bool hostDeliver(const char* topic, const char* payload) { return hostDeliver(topic, (const uint8_t*)payload, strlen(payload)); }
+	const sentMessage* hostFindSent(const char* topic) const;
+	void hostClearSent() { sentCount = 0; }
+	size_t hostPendingCount() const { return _pendingCount; }
+
+	uint32_t connects = 0;
+	uint32_t subscribes = 0;
+	uint32_t loops = 0;
+	size_t sentCount = 0;
+	sentMessage sent[HOST_MQTT_MAX_SENT];
+
+private:
+	bool record(const char* topic, const uint8_t* payload, unsigned int length, bool retained);
+
+	Client* _client = nullptr;
+	std::function<void(char*, uint8_t*, unsigned int)> _callback;
+	bool _connected = false;
+	bool _allowConnect = true;
+
+	uint8_t* _buffer = nullptr;
+	uint16_t _bufferSize = 0;
+
+	//streamed publish in progress
+	bool _streaming = false;
+	unsigned int _streamExpected = 0;
+	unsigned int _streamLength = 0;
+	bool _streamRetained = false;
+
+	struct pendingMessage {
+		char topic[128];
+		uint8_t payload[HOST_MQTT_MAX_PAYLOAD];
+		unsigned int length;
+	};
+	pendingMessage _pending[HOST_MQTT_MAX_PENDING];
+	size_t _pendingCount = 0;
+};
+
+#endif
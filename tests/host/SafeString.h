@@ -0,0 +1,65 @@
+/*
+    SafeString.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Host stand-in for the parts of SafeString the library uses - a fixed buffer that truncates
+*/
+
+#ifndef HOST_SAFESTRING_H
+#define HOST_SAFESTRING_H
+
+#include <Arduino.h>
+
+class SafeString : public Print {
+public:
+	SafeString(size_t size, char* buf, const char* init) : _buf(buf), _size(size) {
+		if (init != buf) { *this = init; }
+	}
+
+	SafeString& operator=(const char* str) {
+		snprintf(_buf, _size, "%s", str ? str : "");
+		return *this;
+	}
+	size_t write(uint8_t c) override {
+		size_t len = strlen(_buf);
+		if (len + 1 >= _size) { return 0; }
+		_buf[len] = (char)c;
+		_buf[len + 1] = '\0';
+		return 1;
+	}
+	void clear() { _buf[0] = '\0'; }
+	const char* c_str() const { return _buf; }
+	size_t length() const { return strlen(_buf); }
+	bool equals(const char* str) const { return strcmp(_buf, str ? str : "") == 0; }
+	bool equals(const SafeString& other) const { return equals(other.c_str()); }
+	using Print::write;
+
+private:
+	char* _buf;
+	size_t _size;
+};
+
+#define createSafeString(name, size) char name##_SAFEBUFFER[(size) + 1] = ""; SafeString name(sizeof(name##_SAFEBUFFER), name##_SAFEBUFFER, "")
+#define createSafeStringFromCharArray(name, arr) SafeString name(sizeof(arr), arr, arr)
+
+#endif
@@ -0,0 +1,46 @@
+/*
+    Updater.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Host stand-in for the ESP8266 Updater. There is no update partition on the host - begin() fails,
+the tests hand ESPHelperDeltaOTA/ESPHelperHttpOTA a hostFilePartition (hostPartition.h) instead
+*/
+
+#ifndef HOST_UPDATER_H
+#define HOST_UPDATER_H
+
+#include <Arduino.h>
+
+#define U_FLASH 0
+
+class UpdateClass {
+public:
+	bool begin(size_t size, int command = U_FLASH) { return false; }
+	size_t write(uint8_t* data, size_t length) { return 0; }
+	bool end(bool evenIfRemaining = false) { return false; }
+	bool hasError() { return true; }
+};
+
+extern UpdateClass Update;
+
+#endif
@@ -0,0 +1,63 @@
+/*
+    WiFiClientSecure.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Host stand-in for the ESP8266 BearSSL client
+*/
+
+#ifndef HOST_WIFICLIENTSECURE_H
+#define HOST_WIFICLIENTSECURE_H
+
+#include <ESP8266WiFi.h>
+
+struct br_ssl_session_parameters {
+	uint8_t session_id[32];
+	uint8_t session_id_len;
+	uint16_t version;
+	uint16_t cipher_suite;
+	uint8_t master_secret[48];
+};
+
+namespace BearSSL {
+
+class Session {
+public:
+	br_ssl_session_parameters* getSession() { return &_params; }
+
+private:
+	br_ssl_session_parameters _params = {};
+};
+
+class WiFiClientSecure : public WiFiClient {
+public:
+	void setSession(Session*) {}
+	void setFingerprint(const char*) {}
+	void setInsecure() {}
+	bool verify(const char*, const char*) { return true; }
+};
+
+}
+
+using BearSSL::WiFiClientSecure;
+
+#endif
@@ -0,0 +1,44 @@
+/*
+    bearssl_hash.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Host stand-in for the part of BearSSL ESPHelperHash uses - a plain SHA-256 (host/BearSSL.cpp)
+*/
+
+#ifndef HOST_BEARSSL_HASH_H
+#define HOST_BEARSSL_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+	uint32_t state[8];
+	uint64_t count;
+	uint8_t buffer[64];
+} br_sha256_context;
+
+void br_sha256_init(br_sha256_context* ctx);
+void br_sha256_update(br_sha256_context* ctx, const void* data, size_t len);
+void br_sha256_out(const br_sha256_context* ctx, void* out);
+
+#endif
@@ -0,0 +1,276 @@
+/*
+    hostOtaLink.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+mqtt_ota_sender.py and the broker between it and an ESPHelperMqttOTA, on the host clock. The
+sender follows the script: it sends the begin message until the device acks, then on every ack
+sends the chunks of the window the device doesn't hold yet, resending a gap once later chunks are
+held (GAP_RESEND) or a chunk that was never acked (RESEND_TIMEOUT).
+
+The link delays every message by latencyMs and can drop, duplicate and reorder chunks (jitterMs
+of random extra delay) and drop acks. Each step() is 1ms: messages that have arrived go to the
+device, which runs loop() and handle() until it has taken them all
+*/
+
+#ifndef HOST_OTA_LINK_H
+#define HOST_OTA_LINK_H
+
+#include <ESPHelperMqttOTA.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+#define HOST_OTA_BEGIN_RETRY 2000
+#define HOST_OTA_RESEND_TIMEOUT 2000
+#define HOST_OTA_GAP_RESEND 200
+
+struct hostOtaLinkOptions {
+	uint32_t latencyMs = 5;			//one way, both directions
+	uint32_t jitterMs = 0;			//random extra delay per chunk (reorders them)
+	uint8_t lossPercent = 0;		//chunks dropped
+	uint8_t duplicatePercent = 0;	//chunks delivered twice
+	uint8_t ackLossPercent = 0;		//acks dropped
+	uint32_t seed = 1;
+};
+
+class hostOtaLink {
+public:
+	hostOtaLink(ESPHelper& helper, ESPHelperMqttOTA& ota, const char* baseTopic, const std::vector<uint8_t>& image, uint16_t chunk, uint8_t window, hostOtaLinkOptions options = hostOtaLinkOptions())
+		: _helper(helper), _ota(ota), _base(baseTopic), _image(image), _chunk(chunk), _window(window), _options(options), _random(options.seed) {
+		_count = (image.size() + chunk - 1) / chunk;
+		_sent.assign(_count, 0);
+		_wasSent.assign(_count, false);
+		uint8_t digest[SHA256_SIZE];
+		ESPHelperHash hash;
+		hash.begin();
+		hash.add(image.data(), image.size());
+		hash.finish(digest);
+		ESPHelperHash::toHex(digest, _sha256);
+		_helper.getMQTTClient()->hostClearSent();
+	}
+
+	//run until the device reports done or an error, or maxMs passes
+	bool run(uint32_t maxMs){
+		for(uint32_t i = 0; i < maxMs && !finished(); i++){step();}
+		return done;
+	}
+
+	void step(){
+		hostAdvanceMillis(1);
+		_now++;
+		deliverToDevice();
+		collectAcks();
+		sender();
+	}
+
+	bool finished() const { return done || !error.empty(); }
+
+	//the sender's view
+	bool done = false;
+	std::string error;
+	std::string lastAck;
+	uint32_t elapsedMs = 0;			//first ack to done, like the script reports
+	uint32_t chunksSent = 0;
+	uint32_t resends = 0;
+	uint32_t acks = 0;
+
+	//test hooks: drop the n-th send of a chunk, or change the begin message
+	std::function<bool(uint32_t index, uint32_t sendCount)> dropChunk;
+	std::string sha256Override;
+
+private:
+	struct message {
+		uint32_t arrival;
+		bool isChunk;
+		std::vector<uint8_t> payload;
+	};
+
+	bool chance(uint8_t percent){
+		_random = _random * 1103515245 + 12345;
+		return percent > 0 && (_random >> 16) % 100 < percent;
+	}
+
+	uint32_t jitter(){
+		if(_options.jitterMs == 0){return 0;}
+		_random = _random * 1103515245 + 12345;
+		return (_random >> 16) % (_options.jitterMs + 1);
+	}
+
+	void queueToDevice(bool isChunk, const std::vector<uint8_t>& payload, uint32_t delay){
+		message msg = {_now + _options.latencyMs + delay, isChunk, payload};
+		size_t pos = _toDevice.size();
+		while(pos > 0 && _toDevice[pos - 1].arrival > msg.arrival){pos--;}
+		_toDevice.insert(_toDevice.begin() + pos, msg);
+	}
+
+	void deliverToDevice(){
+		PubSubClient* client = _helper.getMQTTClient();
+		std::string dataTopic = _base + "/data";
+		std::string beginTopic = _base + "/begin";
+		do{
+			while(!_toDevice.empty() && _toDevice.front().arrival <= _now && client->hostPendingCount() < HOST_MQTT_MAX_PENDING){
+				message& msg = _toDevice.front();
+				client->hostDeliver(msg.isChunk ? dataTopic.c_str() : beginTopic.c_str(), msg.payload.data(), msg.payload.size());
+				_toDevice.erase(_toDevice.begin());
+			}
+			_helper.loop();
+			_ota.handle();
+		}while(client->hostPendingCount() > 0);
+	}
+
+	void collectAcks(){
+		PubSubClient* client = _helper.getMQTTClient();
+		std::string ackTopic = _base + "/ack";
+		for(size_t i = 0; i < client->sentCount; i++){
+			if(ackTopic != client->sent[i].topic || chance(_options.ackLossPercent)){continue;}
+			_toSender.push_back({_now + _options.latencyMs, false, std::vector<uint8_t>(client->sent[i].payload, client->sent[i].payload + client->sent[i].length)});
+		}
+		client->hostClearSent();
+	}
+
+	//latest ack that has arrived (the script only keeps the newest one)
+	bool takeAck(std::string& ack){
+		bool found = false;
+		while(!_toSender.empty() && _toSender.front().arrival <= _now){
+			ack.assign(_toSender.front().payload.begin(), _toSender.front().payload.end());
+			_toSender.erase(_toSender.begin());
+			found = true;
+		}
+		return found;
+	}
+
+	static long field(const std::string& ack, const char* name, long fallback){
+		std::string key = std::string("\"") + name + "\":";
+		size_t pos = ack.find(key);
+		return pos == std::string::npos ? fallback : strtol(ack.c_str() + pos + key.size(), nullptr, 10);
+	}
+
+	void sendBegin(){
+		char begin[192];
+		snprintf(begin, sizeof(begin), "{\"size\":%u,\"chunk\":%u,\"window\":%u,\"sha256\":\"%s\"%s}",
+			(unsigned)_image.size(), _chunk, _window, sha256Override.empty() ? _sha256 : sha256Override.c_str(),
+			_image.size() >= 4 && memcmp(_image.data(), DELTA_MAGIC, 4) == 0 ? ",\"delta\":true" : "");
+		queueToDevice(false, std::vector<uint8_t>(begin, begin + strlen(begin)), 0);
+		_lastBegin = _now;
+	}
+
+	void sendChunk(uint32_t index){
+		uint32_t sendCount = _sendCounts.size() > index ? _sendCounts[index] : 0;
+		if(_sendCounts.size() <= index){_sendCounts.resize(index + 1, 0);}
+		_sendCounts[index]++;
+		if(_wasSent[index]){resends++;}
+		_wasSent[index] = true;
+		_sent[index] = _now;
+		chunksSent++;
+
+		if((dropChunk && dropChunk(index, sendCount)) || chance(_options.lossPercent)){return;}
+		size_t start = (size_t)index * _chunk;
+		size_t length = std::min((size_t)_chunk, _image.size() - start);
+		std::vector<uint8_t> payload = {(uint8_t)(index >> 24), (uint8_t)(index >> 16), (uint8_t)(index >> 8), (uint8_t)index};
+		payload.insert(payload.end(), _image.begin() + start, _image.begin() + start + length);
+		queueToDevice(true, payload, jitter());
+		if(chance(_options.duplicatePercent)){queueToDevice(true, payload, jitter());}
+	}
+
+	void sender(){
+		std::string ack;
+		bool fresh = takeAck(ack);
+		if(fresh){
+			acks++;
+			lastAck = ack;
+			_lastAckAt = _now;
+		}
+
+		if(!_started){
+			if(fresh && ack.find("\"next\"") != std::string::npos){
+				_started = true;
+				_startAt = _now;
+			}
+			else if(fresh && ack.find("\"error\"") != std::string::npos){
+				error = ack;
+				return;
+			}
+			else{
+				if(_lastBegin == UINT32_MAX || _now - _lastBegin >= HOST_OTA_BEGIN_RETRY){sendBegin();}
+				return;
+			}
+		}
+
+		//the script acts on every ack, and on the last one again when none came for RESEND_TIMEOUT
+		if(!fresh && _now - _lastAckAt < HOST_OTA_RESEND_TIMEOUT){return;}
+		if(!fresh){
+			_lastAckAt = _now;
+			ack = lastAck;
+		}
+
+		if(ack.find("\"error\"") != std::string::npos){
+			error = ack;
+			return;
+		}
+		if(ack.find("\"done\":true") != std::string::npos){
+			done = true;
+			elapsedMs = _now - _startAt;
+			return;
+		}
+
+		long next = field(ack, "next", 0);
+		unsigned long bitmap = (unsigned long)field(ack, "bitmap", 0);
+		long window = field(ack, "window", _window);
+		int highestHeld = -1;
+		for(int i = 0; i < 32; i++){
+			if(bitmap & (1UL << i)){highestHeld = i;}
+		}
+		for(long offset = 0; offset < window; offset++){
+			uint32_t index = next + offset;
+			if(index >= _count){break;}
+			if(bitmap & (1UL << offset)){continue;}
+			bool lost = offset < highestHeld && _now - _sent[index] > HOST_OTA_GAP_RESEND;
+			if(!_wasSent[index] || lost || _now - _sent[index] > HOST_OTA_RESEND_TIMEOUT){sendChunk(index);}
+		}
+	}
+
+	ESPHelper& _helper;
+	ESPHelperMqttOTA& _ota;
+	std::string _base;
+	const std::vector<uint8_t>& _image;
+	uint16_t _chunk;
+	uint8_t _window;
+	hostOtaLinkOptions _options;
+	uint32_t _random;
+	uint32_t _count;
+	char _sha256[SHA256_SIZE * 2 + 1];
+
+	uint32_t _now = 0;
+	bool _started = false;
+	uint32_t _startAt = 0;
+	uint32_t _lastBegin = UINT32_MAX;
+	uint32_t _lastAckAt = 0;
+	std::vector<uint32_t> _sent;
+	std::vector<bool> _wasSent;
+	std::vector<uint32_t> _sendCounts;
+	std::vector<message> _toDevice;
+	std::vector<message> _toSender;
+};
+
+#endif
@@ -0,0 +1,103 @@
+/*
+    hostPartition.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+File backed stand-in for the flash an update goes through: the running image is read from one
+file and the update is written to "<path>.part", which only replaces <path> when it is committed
+complete. Counts what happened so tests can check an aborted update never got committed
+*/
+
+#ifndef HOST_PARTITION_H
+#define HOST_PARTITION_H
+
+#include <stdio.h>
+#include <string>
+#include <ESPHelperDeltaOTA.h>
+
+class hostFilePartition : public ESPHelperOTAPartition {
+public:
+	hostFilePartition(const char* runningPath, const char* updatePath) : _running(runningPath), _update(updatePath), _part(_update + ".part") {}
+	~hostFilePartition() { abort(); }
+
+	bool begin(uint32_t size) override {
+		abort();
+		if(size > capacity){return false;}
+		_file = fopen(_part.c_str(), "wb");
+		_size = size;
+		_written = 0;
+		begins++;
+		return _file != nullptr;
+	}
+
+	size_t write(uint8_t* data, size_t length) override {
+		if(_file == nullptr || _written + length > _size){return 0;}
+		size_t count = fwrite(data, 1, length, _file);
+		_written += count;
+		return count;
+	}
+
+	bool end() override {
+		if(_file == nullptr){return false;}
+		fclose(_file);
+		_file = nullptr;
+		if(_written != _size || rename(_part.c_str(), _update.c_str()) != 0){
+			remove(_part.c_str());
+			return false;
+		}
+		commits++;
+		return true;
+	}
+
+	void abort() override {
+		if(_file == nullptr){return;}
+		fclose(_file);
+		_file = nullptr;
+		remove(_part.c_str());
+		aborts++;
+	}
+
+	bool readRunning(uint32_t offset, uint8_t* data, size_t length) override {
+		FILE* file = fopen(_running.c_str(), "rb");
+		if(file == nullptr){return false;}
+		bool ok = fseek(file, offset, SEEK_SET) == 0 && fread(data, 1, length, file) == length;
+		fclose(file);
+		if(ok){bytesRead += length;}
+		return ok;
+	}
+
+	uint32_t capacity = 1024 * 1024;
+	uint32_t begins = 0;
+	uint32_t commits = 0;
+	uint32_t aborts = 0;
+	uint32_t bytesRead = 0;
+
+private:
+	std::string _running;
+	std::string _update;
+	std::string _part;
+	FILE* _file = nullptr;
+	uint32_t _size = 0;
+	uint32_t _written = 0;
+};
+
+#endif
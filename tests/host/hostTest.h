@@ -0,0 +1,54 @@
+/*
+    hostTest.h
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Minimal checks for the host tests - each test is a plain executable that returns non zero when
+a check failed, which is all ctest needs
+*/
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+
+static int hostTestFailures = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+		hostTestFailures++; \
+	} \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+	long long checkA = (long long)(a); \
+	long long checkB = (long long)(b); \
+	if (checkA != checkB) { \
+		printf("%s:%d: CHECK_EQ failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, checkA, checkB); \
+		hostTestFailures++; \
+	} \
+} while (0)
+
+#define TEST_RESULT() (printf("%s\n", hostTestFailures == 0 ? "PASS" : "FAIL"), hostTestFailures == 0 ? 0 : 1)
+
+#endif
@@ -0,0 +1,255 @@
+/*
+    sim_journal_endurance.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Endurance simulation for ESPHelperJournal. Runs a day of typical state changes (a counter, a few
+relays and a sensor reading) through the journal on the host filesystem and prints what reached
+flash, then checks that:
+	- the journal's own write estimate matches what the host filesystem counted
+	- the coalescing window cuts what is programmed compared to writing every change
+	- a power cut at any point recovers every key to a value it held at or after its last flush,
+	  and deleted keys stay deleted (including deletes made while a compaction is running)
+*/
+
+#include "hostTest.h"
+#include <ESPHelperJournal.h>
+
+
+#define SIM_HOURS 24
+#define SIM_STEP_MS 50
+#define SIM_KEYS 8
+
+//littlefs on an ESP8266 with a 1MB filesystem, rated for 100k erase cycles per block
+#define SIM_FS_BLOCKS 256
+#define SIM_ERASE_CYCLES 100000.0
+
+
+static uint32_t rngState = 12345;
+static uint32_t rng(uint32_t range){
+	rngState = rngState * 1103515245 + 12345;
+	return (rngState >> 8) % range;
+}
+
+static void keyName(int key, char* buf, size_t len){
+	snprintf(buf, len, "key%d", key);
+}
+
+
+//copy both logs as they are right now, which is what a device sees after a power cut
+static void powerCut(const char* from, const char* to){
+	LittleFS.hostFailWritesAfter(-1);
+	char fromPath[32];
+	char toPath[32];
+	for(int log = 0; log < 2; log++){
+		snprintf(fromPath, sizeof(fromPath), "%s.%d", from, log);
+		snprintf(toPath, sizeof(toPath), "%s.%d", to, log);
+		LittleFS.remove(toPath);
+		if(!LittleFS.exists(fromPath)){continue;}
+
+		File in = LittleFS.open(fromPath, "r");
+		File out = LittleFS.open(toPath, "w");
+		uint8_t buf[256];
+		size_t read;
+		while((read = in.read(buf, sizeof(buf))) > 0){out.write(buf, read);}
+	}
+}
+
+
+struct simResult {
+	journalStats stats;
+	fs::hostFsStats fs;
+};
+
+//a day of changes: the counter ticks every second, relays flip now and then and the sensor
+//reading changes every few seconds
+static simResult runDay(uint32_t window){
+	LittleFS.format();
+	rngState = 12345;
+
+	ESPHelperJournal journal;
+	CHECK(journal.begin("/sim", window));
+	LittleFS.hostResetStats();
+
+	int32_t counter = 0;
+	for(uint32_t now = 0; now < SIM_HOURS * 3600UL * 1000UL; now += SIM_STEP_MS){
+		if(now % 1000 == 0){journal.setInt("counter", counter++);}
+		if(rng(600) == 0){
+			char key[JOURNAL_KEY_LENGTH];
+			keyName(rng(4), key, sizeof(key));
+			journal.setBool(key, !journal.getBool(key));
+		}
+		if(rng(60) == 0){journal.setFloat("temp", 20.0f + rng(100) / 10.0f);}
+
+		journal.handle();
+		hostAdvanceMillis(SIM_STEP_MS);
+	}
+	journal.flush();
+
+	simResult result;
+	result.stats = journal.getStats();
+	result.fs = LittleFS.hostStats();
+
+	//everything survives a restart
+	ESPHelperJournal reloaded;
+	CHECK(reloaded.begin("/sim", window));
+	CHECK_EQ(reloaded.getInt("counter", -1), counter - 1);
+	CHECK(reloaded.getFloat("temp") == journal.getFloat("temp"));
+	for(int i = 0; i < 4; i++){
+		char key[JOURNAL_KEY_LENGTH];
+		keyName(i, key, sizeof(key));
+		CHECK_EQ(reloaded.getBool(key), journal.getBool(key));
+	}
+	return result;
+}
+
+static void printResult(const char* name, const simResult& result){
+	double erasesPerDay = (double)result.fs.blocksErased * 24 / SIM_HOURS;
+	printf("%s: requested %u B, appended %u B, programmed %u B (fs counted %llu B, %llu erases), "
+		"amplification %.1f, %u flushes, %u compactions, wear limit reached in %.0f years\n",
+		name, result.stats.bytesRequested, result.stats.bytesWritten, result.stats.bytesProgrammed,
+		(unsigned long long)result.fs.bytesProgrammed, (unsigned long long)result.fs.blocksErased,
+		(double)result.stats.bytesProgrammed / result.stats.bytesRequested, result.stats.flushes,
+		result.stats.compactions, SIM_FS_BLOCKS * SIM_ERASE_CYCLES / erasesPerDay / 365);
+}
+
+static void endurance(){
+	simResult direct = runDay(0);
+	simResult coalesced = runDay(DEFAULT_JOURNAL_WINDOW);
+	printResult("every change", direct);
+	printResult("coalesced", coalesced);
+
+	CHECK(coalesced.stats.compactions > 0);
+	CHECK(coalesced.stats.bytesProgrammed < direct.stats.bytesProgrammed);
+
+	//the estimate tracks what the filesystem counted (within 5%)
+	const simResult* results[] = {&direct, &coalesced};
+	for(const simResult* result : results){
+		double estimate = result->stats.bytesProgrammed;
+		double counted = (double)result->fs.bytesProgrammed;
+		CHECK(estimate > counted * 0.95 && estimate < counted * 1.05);
+		CHECK(result->stats.bytesProgrammed > result->stats.bytesWritten);
+	}
+}
+
+
+//a key deleted while a compaction is copying keys out of the old log must not come back if the
+//power goes before the old log is removed
+static void deleteDuringCompaction(){
+	LittleFS.format();
+	ESPHelperJournal journal;
+	CHECK(journal.begin("/del", 60000, 0));
+
+	char key[JOURNAL_KEY_LENGTH];
+	for(int i = 0; i < 20; i++){
+		keyName(i, key, sizeof(key));
+		journal.setInt(key, i);
+	}
+	CHECK(journal.flush());
+
+	//keep changing one key until the log fills and the journal switches logs
+	int32_t value = 0;
+	while(!journal.isCompacting()){
+		journal.setInt("key0", value++);
+		CHECK(journal.flush());
+	}
+
+	CHECK(journal.remove("key1"));
+	journal.handle();
+	CHECK(journal.isCompacting());
+
+	powerCut("/del", "/delcut");
+	ESPHelperJournal recovered;
+	CHECK(recovered.begin("/delcut"));
+	CHECK(!recovered.has("key1"));
+	CHECK_EQ(recovered.getInt("key0", -1), value - 1);
+	CHECK_EQ(recovered.getInt("key2", -1), 2);
+}
+
+
+//random changes and deletes with a power cut part way through a write. Each key has to come back
+//as one of the states it had from its last completed flush onwards
+static void randomPowerCuts(){
+	const int32_t deleted = -1;
+
+	for(int trial = 0; trial < 200; trial++){
+		LittleFS.format();
+		rngState = 1000 + trial;
+
+		ESPHelperJournal journal;
+		CHECK(journal.begin("/cut", 200, 0));
+
+		int32_t history[SIM_KEYS][256];
+		int historyLength[SIM_KEYS];
+		int durable[SIM_KEYS];
+		for(int k = 0; k < SIM_KEYS; k++){
+			history[k][0] = deleted;
+			historyLength[k] = 1;
+			durable[k] = 0;
+		}
+
+		uint32_t cutAt = 100 + rng(400);
+		for(uint32_t step = 0; step < cutAt + 20; step++){
+			if(step == cutAt){LittleFS.hostFailWritesAfter(rng(60));}
+
+			int k = rng(SIM_KEYS);
+			char key[JOURNAL_KEY_LENGTH];
+			keyName(k, key, sizeof(key));
+			int32_t state = rng(4) == 0 ? deleted : (int32_t)rng(1000);
+			bool changed = state == deleted ? journal.remove(key) : journal.setInt(key, state);
+			if(changed && historyLength[k] < 256){history[k][historyLength[k]++] = state;}
+
+			journal.handle();
+			hostAdvanceMillis(20 + rng(100));
+
+			//everything changed so far is on flash once nothing is pending
+			if(step < cutAt && !journal.isPending()){
+				for(int i = 0; i < SIM_KEYS; i++){durable[i] = historyLength[i] - 1;}
+			}
+		}
+
+		powerCut("/cut", "/cutrec");
+		ESPHelperJournal recovered;
+		CHECK(recovered.begin("/cutrec"));
+		for(int k = 0; k < SIM_KEYS; k++){
+			char key[JOURNAL_KEY_LENGTH];
+			keyName(k, key, sizeof(key));
+			int32_t state = recovered.has(key) ? recovered.getInt(key) : deleted;
+
+			bool found = false;
+			for(int i = durable[k]; i < historyLength[k]; i++){found = found || history[k][i] == state;}
+			if(!found){printf("trial %d: %s recovered as %d\n", trial, key, (int)state);}
+			CHECK(found);
+		}
+	}
+}
+
+
+int main(){
+	CHECK(LittleFS.begin());
+
+	endurance();
+	deleteDuringCompaction();
+	randomPowerCuts();
+
+	return TEST_RESULT();
+}
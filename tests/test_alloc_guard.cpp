@@ -0,0 +1,114 @@
+/*
+    test_alloc_guard.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+Runs a connected ESPHelper through loop() with ESPHELPER_ALLOC_GUARD built in and heap
+allocations counted through the malloc wrappers (see CMakeLists.txt for the link flags).
+
+The steady state - receiving, dispatching, publishing, resubscribing and running scheduled
+tasks - must not touch the heap. A task that does allocate is then added to make sure the guard
+really sees the steps that run at the end of loop().
+*/
+
+#include "hostTest.h"
+#include <ESPHelper.h>
+
+
+static uint32_t received = 0;
+
+static void callback(char* topic, uint8_t* payload, unsigned int length){
+	received++;
+}
+
+
+//run loop() calls with the clock moving 1ms per call
+static void runLoops(ESPHelper& helper, int count, bool budgeted){
+	for(int i = 0; i < count; i++){
+		if(budgeted){helper.loop((uint32_t)2000);}
+		else{helper.loop();}
+		hostAdvanceMillis(1);
+	}
+}
+
+
+int main(){
+	LittleFS.begin();
+
+	NetInfo config;
+	config.setHostname("alloc-guard");
+	config.setSsid("host");
+	config.setPass("secret");
+	config.setMqttHost("10.0.0.1");
+
+	ESPHelper helper(&config);
+	helper.enableInboundQueue();
+	helper.enableOutboundQueue();
+	helper.addSubscription("guard/in");
+	helper.addSubscription("guard/other/#");
+	helper.setCallback(callback);
+	CHECK(helper.begin());
+
+	for(int i = 0; i < 100 && helper.getStatus() != FULL_CONNECTION; i++){
+		helper.loop();
+		hostAdvanceMillis(10);
+	}
+	CHECK_EQ(helper.getStatus(), FULL_CONNECTION);
+
+	//the app publishes from a task every 10ms
+	int publisher = helper.getScheduler().every(10, [&helper](){
+		helper.publish("guard/out", "steady");
+	});
+	CHECK(publisher != TASK_INVALID);
+
+	PubSubClient* client = helper.getMQTTClient();
+
+	//a few warm up calls, then the steady state
+	runLoops(helper, 10, false);
+	uint32_t violationsBefore = helper.getAllocGuardViolations();
+	for(int round = 0; round < 50; round++){
+		client->hostDeliver("guard/in", "hello");
+		client->hostDeliver("guard/other/x", "world");
+		client->hostClearSent();
+		runLoops(helper, 20, round % 2 == 1);
+	}
+	CHECK(received >= 100);
+	CHECK(client->hostFindSent("guard/out") != nullptr);
+	CHECK_EQ(helper.getAllocGuardViolations() - violationsBefore, 0);
+
+	//a dropped connection: the reconnect and resubscribe steps run as well
+	client->disconnect();
+	runLoops(helper, 1000, false);
+	CHECK_EQ(helper.getStatus(), FULL_CONNECTION);
+	CHECK_EQ(helper.getAllocGuardViolations() - violationsBefore, 0);
+
+	//a scheduled task that allocates - the guard has to notice it even though tasks run last
+	int allocator = helper.getScheduler().every(10, [](){
+		void* volatile block = malloc(32);
+		free(block);
+	});
+	CHECK(allocator != TASK_INVALID);
+	runLoops(helper, 100, false);
+	CHECK(helper.getAllocGuardViolations() - violationsBefore > 0);
+
+	return TEST_RESULT();
+}
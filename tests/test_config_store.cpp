@@ -0,0 +1,187 @@
+/*
+    test_config_store.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+ESPHelperConfigStore on the host filesystem: round trips, the temp file fallback, records from
+a build with a different NETINFO_ARENA_SIZE, and records with a good CRC but a bad layout
+*/
+
+#include "hostTest.h"
+#include <stddef.h>
+#include <ESPHelperConfigStore.h>
+
+
+static void fillConfig(NetInfo& config){
+	config.setHostname("store-test");
+	config.setSsid("network");
+	config.setPass("password");
+	config.setMqttHost("broker.local");
+	config.setMqttUser("user");
+	config.setMqttPass("pass");
+	config.setOtaPassword("ota");
+	config.setMqttWillTopic("store-test/status");
+	config.setMqttWillMessage("offline");
+	config.setMqttPort(8883);
+	config.setMqttWillQoS(2);
+	config.setMqttWillRetain(false);
+}
+
+static bool sameConfig(NetInfo& a, NetInfo& b){
+	return strcmp(a.getHostname(), b.getHostname()) == 0
+		&& strcmp(a.getSsid(), b.getSsid()) == 0
+		&& strcmp(a.getPass(), b.getPass()) == 0
+		&& strcmp(a.getMqttHost(), b.getMqttHost()) == 0
+		&& strcmp(a.getMqttUser(), b.getMqttUser()) == 0
+		&& strcmp(a.getMqttPass(), b.getMqttPass()) == 0
+		&& strcmp(a.getOtaPassword(), b.getOtaPassword()) == 0
+		&& strcmp(a.getMqttWillTopic(), b.getMqttWillTopic()) == 0
+		&& strcmp(a.getMqttWillMessage(), b.getMqttWillMessage()) == 0
+		&& a.getMqttPort() == b.getMqttPort()
+		&& a.getMqttWillQoS() == b.getMqttWillQoS()
+		&& a.getMqttWillRetain() == b.getMqttWillRetain();
+}
+
+//write a record by hand (ie one this build would never write itself)
+static void writeRecord(const char* path, uint16_t version, const void* payload, size_t length){
+	configRecordHeader header;
+	header.magic = CONFIG_RECORD_MAGIC;
+	header.version = version;
+	header.length = length;
+	header.revision = 7;
+	header.crc = ESPHelperConfigStore::crc32(payload, length);
+	CHECK(ESPHelperConfigStore::writeAtomic(path, &header, sizeof(header), payload, length));
+}
+
+
+int main(){
+	CHECK(ESPHelperConfigStore::begin());
+
+	NetInfo saved;
+	fillConfig(saved);
+
+	//round trip with a revision
+	CHECK(ESPHelperConfigStore::save(saved, "/cfg.bin", 42));
+	NetInfo loaded;
+	uint32_t revision = 0;
+	CHECK(ESPHelperConfigStore::load(loaded, "/cfg.bin", &revision));
+	CHECK(sameConfig(saved, loaded));
+	CHECK_EQ(revision, 42);
+
+	//a save interrupted before the rename leaves the temp file - load() falls back to it
+	CHECK(LittleFS.rename("/cfg.bin", "/cfg.bin.tmp"));
+	NetInfo fallback;
+	CHECK(ESPHelperConfigStore::load(fallback, "/cfg.bin"));
+	CHECK(sameConfig(saved, fallback));
+	CHECK(ESPHelperConfigStore::erase("/cfg.bin"));
+	CHECK(!LittleFS.exists("/cfg.bin.tmp"));
+	CHECK(!ESPHelperConfigStore::load(fallback, "/cfg.bin"));
+
+	//a record from a build with a smaller arena is migrated
+	const ESPHelperConf& conf = saved.getConf();
+	size_t smallLength = offsetof(ESPHelperConf, arena) + conf.used;
+	writeRecord("/small.bin", CONFIG_RECORD_VERSION, &conf, smallLength);
+	NetInfo migrated;
+	revision = 0;
+	CHECK(ESPHelperConfigStore::load(migrated, "/small.bin", &revision));
+	CHECK(sameConfig(saved, migrated));
+	CHECK_EQ(revision, 7);
+
+	//a record from a build with a bigger arena whose strings don't fit this one is refused
+	//(the NetInfo is left alone)
+	uint8_t big[sizeof(ESPHelperConf) + 600];
+	memset(big, 0, sizeof(big));
+	{
+		ESPHelperConf* wide = (ESPHelperConf*)big;
+		uint16_t pos = 0;
+		for(int i = 0; i < CONF_STRING_COUNT; i++){
+			uint8_t len = i == CONF_WILL_TOPIC ? 250 : (i == CONF_WILL_MESSAGE ? 250 : 10);
+			wide->offsets[i] = pos;
+			wide->arena[pos] = (char)len;
+			memset(&wide->arena[pos + 1], 'a' + i, len);
+			wide->arena[pos + 1 + len] = '\0';
+			pos += len + 2;
+		}
+		wide->used = pos;
+		CHECK(pos > NETINFO_ARENA_SIZE);
+		writeRecord("/big.bin", CONFIG_RECORD_VERSION, big, offsetof(ESPHelperConf, arena) + pos);
+	}
+	NetInfo untouched;
+	fillConfig(untouched);
+	CHECK(!ESPHelperConfigStore::load(untouched, "/big.bin"));
+	CHECK(sameConfig(saved, untouched));
+
+	//good CRC, bad layout: every kind of broken offset/length is refused
+	for(int broken = 0; broken < 5; broken++){
+		ESPHelperConf bad;
+		memcpy(&bad, &conf, sizeof(bad));
+		switch(broken){
+			case 0: bad.used = NETINFO_ARENA_SIZE + 1; break;					//used past the arena
+			case 1: bad.offsets[CONF_SSID] = 0xFFF0; break;						//offset far outside the arena
+			case 2: bad.arena[bad.offsets[CONF_HOSTNAME]] = (char)200; break;	//length runs past used
+			case 3: bad.arena[bad.offsets[CONF_PASS] + 2] = '\0'; break;		//terminator before the length says
+			case 4: bad.offsets[CONF_MQTT_USER] += 1; break;						//strings overlap
+		}
+		writeRecord("/bad.bin", CONFIG_RECORD_VERSION, &bad, sizeof(bad));
+		NetInfo rejected;
+		if(ESPHelperConfigStore::load(rejected, "/bad.bin")){
+			printf("broken record %d was loaded\n", broken);
+			hostTestFailures++;
+		}
+
+		//the same damage through the migration path
+		writeRecord("/bad.bin", CONFIG_RECORD_VERSION, &bad, offsetof(ESPHelperConf, arena) + conf.used);
+		if(ESPHelperConfigStore::load(rejected, "/bad.bin")){
+			printf("broken record %d was migrated\n", broken);
+			hostTestFailures++;
+		}
+	}
+
+	//a damaged record fails the CRC
+	CHECK(ESPHelperConfigStore::save(saved, "/cfg.bin"));
+	File file = LittleFS.open("/cfg.bin", "r+");
+	file.seek(sizeof(configRecordHeader) + 4);
+	file.write((uint8_t)0x55);
+	file.close();
+	NetInfo corrupt;
+	CHECK(!ESPHelperConfigStore::load(corrupt, "/cfg.bin"));
+
+	//the plain setters cut a value down to the space left, setString() refuses it and keeps the old one
+	char longValue[300];
+	memset(longValue, 'x', sizeof(longValue) - 1);
+	longValue[sizeof(longValue) - 1] = '\0';
+	NetInfo limits;
+	fillConfig(limits);
+	CHECK(!limits.setString(CONF_WILL_TOPIC, longValue));
+	CHECK(strcmp(limits.getMqttWillTopic(), "store-test/status") == 0);
+	CHECK(sameConfig(saved, limits));
+	limits.setMqttWillTopic(longValue);
+	size_t kept = strlen(limits.getMqttWillTopic());
+	CHECK(kept > 0 && kept < strlen(longValue));
+	CHECK(strncmp(limits.getMqttWillTopic(), longValue, kept) == 0);
+	CHECK_EQ(limits.getConf().used, NETINFO_ARENA_SIZE);
+	CHECK(strcmp(limits.getHostname(), "store-test") == 0);
+	CHECK(limits.setString(CONF_WILL_TOPIC, "short"));
+	CHECK(strcmp(limits.getMqttWillTopic(), "short") == 0);
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,233 @@
+/*
+    test_delta_ota.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+ESPHelperDeltaOTA on the host with file backed partitions: patches fed in pieces of every size,
+and patches that must be refused - against a different running image, with a wrong target hash,
+cut short, with trailing bytes, a bad opcode or a copy past the end of the running image.
+
+Also writes delta_source.bin and delta_target.bin for the delta_gen_check test, which makes a
+patch from them with delta_gen.py and applies it with delta_apply
+*/
+
+#include "hostTest.h"
+#include "hostPartition.h"
+#include <vector>
+
+
+#define TEST_RUNNING "delta_source.bin"
+#define TEST_TARGET "delta_target.bin"
+#define TEST_UPDATE "test_delta_ota_update.bin"
+#define TEST_IMAGE_SIZE 65536
+
+
+struct patchOp {
+	uint8_t op;
+	uint32_t offset;	//source offset (COPY) or target offset (DATA)
+	uint32_t length;
+};
+
+
+static void writeFile(const char* path, const std::vector<uint8_t>& data){
+	FILE* file = fopen(path, "wb");
+	fwrite(data.data(), 1, data.size(), file);
+	fclose(file);
+}
+
+static std::vector<uint8_t> readFile(const char* path){
+	std::vector<uint8_t> data;
+	FILE* file = fopen(path, "rb");
+	if(file == nullptr){return data;}
+	uint8_t buffer[4096];
+	size_t length;
+	while((length = fread(buffer, 1, sizeof(buffer), file)) > 0){data.insert(data.end(), buffer, buffer + length);}
+	fclose(file);
+	return data;
+}
+
+static void putLE(std::vector<uint8_t>& data, uint32_t value){
+	for(int i = 0; i < 4; i++){data.push_back(value >> (i * 8));}
+}
+
+static void sha256(const std::vector<uint8_t>& data, uint8_t digest[SHA256_SIZE]){
+	ESPHelperHash hash;
+	hash.begin();
+	hash.add(data.data(), data.size());
+	hash.finish(digest);
+}
+
+//the layout delta_gen.py writes (see ESPHelperDeltaOTA.h)
+static std::vector<uint8_t> makePatch(const std::vector<uint8_t>& source, const std::vector<uint8_t>& target, const std::vector<patchOp>& ops){
+	std::vector<uint8_t> patch = {'E', 'H', 'D', 'P', DELTA_VERSION, 0, 0, 0};
+	putLE(patch, source.size());
+	putLE(patch, target.size());
+	uint8_t digest[SHA256_SIZE];
+	sha256(source, digest);
+	patch.insert(patch.end(), digest, digest + SHA256_SIZE);
+	sha256(target, digest);
+	patch.insert(patch.end(), digest, digest + SHA256_SIZE);
+
+	for(const patchOp& op : ops){
+		patch.push_back(op.op);
+		if(op.op == DELTA_OP_COPY){
+			putLE(patch, op.offset);
+			putLE(patch, op.length);
+		}
+		else{
+			putLE(patch, op.length);
+			patch.insert(patch.end(), target.begin() + op.offset, target.begin() + op.offset + op.length);
+		}
+	}
+	return patch;
+}
+
+//feed the patch piece by piece, running handle() whenever the writer is busy
+static bool apply(ESPHelperDeltaOTA& writer, const std::vector<uint8_t>& patch, size_t piece, bool delta = true){
+	if(!writer.begin(patch.size(), delta)){return false;}
+	size_t pos = 0;
+	while(pos < patch.size() || writer.isBusy()){
+		if(!writer.handle()){
+			if(writer.hasError()){return false;}
+			continue;
+		}
+		pos += writer.write((uint8_t*)patch.data() + pos, std::min(piece, patch.size() - pos));
+		if(writer.hasError()){return false;}
+	}
+	return writer.end();
+}
+
+static bool failsWith(const std::vector<uint8_t>& patch, const char* error, uint32_t* begins = nullptr){
+	hostFilePartition partition(TEST_RUNNING, TEST_UPDATE);
+	ESPHelperDeltaOTA writer(partition);
+	bool applied = apply(writer, patch, 1000);
+	if(begins != nullptr){*begins = partition.begins;}
+	if(applied || strcmp(writer.getLastError(), error) != 0){
+		printf("expected \"%s\", got \"%s\"\n", error, applied ? "success" : writer.getLastError());
+		return false;
+	}
+	return partition.commits == 0 && readFile(TEST_UPDATE).empty();
+}
+
+
+int main(){
+	//running image, and a target with an insert, a changed run and a moved block
+	std::vector<uint8_t> source(TEST_IMAGE_SIZE);
+	srand(7);
+	for(uint8_t& byte : source){byte = rand();}
+	std::vector<uint8_t> target(source.begin(), source.begin() + 10000);
+	for(int i = 0; i < 300; i++){target.push_back(rand());}
+	target.insert(target.end(), source.begin() + 10000, source.begin() + 30000);
+	target.insert(target.end(), source.begin() + 50000, source.end());
+	for(int i = 0; i < 200; i++){target[target.size() - 5000 + i] ^= 0x5a;}
+	target.insert(target.end(), source.begin() + 30000, source.begin() + 50000);
+	writeFile(TEST_RUNNING, source);
+	writeFile(TEST_TARGET, target);
+
+	std::vector<patchOp> ops = {
+		{DELTA_OP_COPY, 0, 10000},
+		{DELTA_OP_DATA, 10000, 300},
+		{DELTA_OP_COPY, 10000, 20000},
+		{DELTA_OP_COPY, 50000, TEST_IMAGE_SIZE - 50000 - 5000},
+		{DELTA_OP_DATA, (uint32_t)(30300 + TEST_IMAGE_SIZE - 50000 - 5000), 200},
+		{DELTA_OP_COPY, TEST_IMAGE_SIZE - 5000 + 200, 4800},
+		{DELTA_OP_COPY, 30000, 20000},
+	};
+	std::vector<uint8_t> patch = makePatch(source, target, ops);
+
+	//any piece size builds the same image
+	static const size_t pieces[] = {1, 9, 81, 1460, 100000};
+	for(size_t piece : pieces){
+		remove(TEST_UPDATE);
+		hostFilePartition partition(TEST_RUNNING, TEST_UPDATE);
+		ESPHelperDeltaOTA writer(partition);
+		CHECK(apply(writer, patch, piece));
+		CHECK(readFile(TEST_UPDATE) == target);
+		CHECK_EQ(partition.commits, 1);
+		CHECK_EQ(writer.getStats().written, target.size());
+		CHECK_EQ(writer.getStats().literal, 500);
+		CHECK_EQ(writer.getStats().copied, target.size() - 500);
+		CHECK_EQ(writer.getStats().ops, ops.size());
+		//the running image is read once to check it, then once more for the copies
+		CHECK_EQ(partition.bytesRead, source.size() + target.size() - 500);
+	}
+	remove(TEST_UPDATE);
+
+	//a plain image passes straight through (its hash is the caller's job)
+	{
+		hostFilePartition partition(TEST_RUNNING, TEST_UPDATE);
+		ESPHelperDeltaOTA writer(partition);
+		CHECK(apply(writer, target, 1460, false));
+		CHECK(readFile(TEST_UPDATE) == target);
+		CHECK_EQ(partition.bytesRead, 0);
+		remove(TEST_UPDATE);
+	}
+
+	//made against a different build - refused before the update partition is touched
+	{
+		std::vector<uint8_t> other = source;
+		other[TEST_IMAGE_SIZE / 2] ^= 1;
+		uint32_t begins = 1;
+		CHECK(failsWith(makePatch(other, target, ops), "source", &begins));
+		CHECK_EQ(begins, 0);
+	}
+
+	//the result doesn't match the target hash
+	{
+		std::vector<uint8_t> other = target;
+		other[100] ^= 1;
+		CHECK(failsWith(makePatch(source, other, ops), "hash"));
+	}
+
+	//cut short, or with bytes after the last operation
+	{
+		std::vector<uint8_t> cut(patch.begin(), patch.end() - 1);
+		CHECK(failsWith(cut, "incomplete"));
+		std::vector<uint8_t> longer = patch;
+		longer.push_back(DELTA_OP_DATA);
+		CHECK(failsWith(longer, "trailing"));
+	}
+
+	//bad opcode, copies outside the running image, operations past the end of the target
+	{
+		std::vector<uint8_t> bad = patch;
+		bad[DELTA_HEADER_SIZE] = 0x7f;
+		CHECK(failsWith(bad, "opcode"));
+		std::vector<patchOp> outside = ops;
+		outside[0] = {DELTA_OP_COPY, TEST_IMAGE_SIZE - 100, 10000};
+		CHECK(failsWith(makePatch(source, target, outside), "offset"));
+		std::vector<patchOp> tooLong = ops;
+		tooLong.back().length++;
+		CHECK(failsWith(makePatch(source, target, tooLong), "length"));
+	}
+
+	//no room for the image
+	{
+		hostFilePartition partition(TEST_RUNNING, TEST_UPDATE);
+		partition.capacity = target.size() - 1;
+		ESPHelperDeltaOTA writer(partition);
+		CHECK(!apply(writer, patch, 1460));
+		CHECK(strcmp(writer.getLastError(), "space") == 0);
+	}
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,417 @@
+/*
+    test_http_ota.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+ESPHelperHttpOTA against a real HTTP server on 127.0.0.1 (a thread in this test), downloading
+into a hostFilePartition: a plain download, a dropped connection resumed with a Range request,
+a server that ignores Range, a bad hash, an HTTP error and a server that is not there
+*/
+
+#include "hostTest.h"
+#include "hostPartition.h"
+#include <ESPHelperHttpOTA.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+#define TEST_IMAGE_SIZE 100000
+#define TEST_RUNNING "test_http_ota_running.bin"
+#define TEST_UPDATE "test_http_ota_update.bin"
+
+
+/*
+Serves one image at every path but /missing (404), one connection at a time. Honours
+"Range: bytes=<n>-" unless ignoreRange is set, and closes the next response after dropAfter bytes
+of body when dropAfter is set
+*/
+class hostHttpServer {
+public:
+	explicit hostHttpServer(const std::vector<uint8_t>& image) : _image(image) {
+		_listen = socket(AF_INET, SOCK_STREAM, 0);
+		int on = 1;
+		setsockopt(_listen, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+		sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		bind(_listen, (sockaddr*)&addr, sizeof(addr));
+		listen(_listen, 4);
+		socklen_t length = sizeof(addr);
+		getsockname(_listen, (sockaddr*)&addr, &length);
+		port = ntohs(addr.sin_port);
+		_thread = std::thread([this]{ serve(); });
+	}
+
+	~hostHttpServer() {
+		_stop = true;
+		shutdown(_listen, SHUT_RDWR);
+		_thread.join();
+		close(_listen);
+	}
+
+	uint16_t port = 0;
+	std::atomic<int> dropAfter{-1};
+	std::atomic<bool> ignoreRange{false};
+	std::atomic<int> requests{0};
+	std::atomic<int> rangeRequests{0};
+
+private:
+	void serve() {
+		while(!_stop){
+			int fd = accept(_listen, nullptr, nullptr);
+			if(fd < 0){continue;}
+			respond(fd);
+			close(fd);
+		}
+	}
+
+	void respond(int fd) {
+		std::string head;
+		char buffer[512];
+		while(head.find("\r\n\r\n") == std::string::npos){
+			ssize_t got = recv(fd, buffer, sizeof(buffer), 0);
+			if(got <= 0){return;}
+			head.append(buffer, got);
+		}
+		requests++;
+
+		char path[64] = "";
+		sscanf(head.c_str(), "GET %63s", path);
+		if(strcmp(path, "/missing") == 0){
+			const char* notFound = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+			send(fd, notFound, strlen(notFound), MSG_NOSIGNAL);
+			return;
+		}
+
+		unsigned long start = 0;
+		size_t range = head.find("Range: bytes=");
+		if(range != std::string::npos){
+			rangeRequests++;
+			if(!ignoreRange){start = strtoul(head.c_str() + range + 13, nullptr, 10);}
+		}
+
+		char response[256];
+		if(start > 0){
+			snprintf(response, sizeof(response), "HTTP/1.1 206 Partial Content\r\nContent-Length: %lu\r\nContent-Range: bytes %lu-%lu/%lu\r\nConnection: close\r\n\r\n",
+				(unsigned long)_image.size() - start, start, (unsigned long)_image.size() - 1, (unsigned long)_image.size());
+		}
+		else{
+			snprintf(response, sizeof(response), "HTTP/1.1 200 OK\r\nContent-Length: %lu\r\nConnection: close\r\n\r\n", (unsigned long)_image.size());
+		}
+		send(fd, response, strlen(response), MSG_NOSIGNAL);
+
+		size_t end = _image.size();
+		int drop = dropAfter.exchange(-1);
+		if(drop >= 0 && start + drop < end){end = start + drop;}
+		while(start < end){
+			ssize_t sent = send(fd, _image.data() + start, std::min(end - start, (size_t)1460), MSG_NOSIGNAL);
+			if(sent <= 0){return;}
+			start += sent;
+		}
+	}
+
+	const std::vector<uint8_t>& _image;
+	int _listen;
+	std::atomic<bool> _stop{false};
+	std::thread _thread;
+};
+
+
+/*
+Downloads over a plain socket - only understands http://127.0.0.1:<port>/<path>. Like HTTPClient
+the request blocks until the headers are in, reading the body doesn't
+*/
+class hostSocketSource : public ESPHelperOTASource {
+public:
+	~hostSocketSource() { stop(); }
+
+	int request(const char* url, uint32_t offset) override {
+		stop();
+		unsigned port;
+		char path[64];
+		if(sscanf(url, "http://127.0.0.1:%u%63s", &port, path) != 2){return HTTP_OTA_ERROR_URL;}
+
+		_fd = socket(AF_INET, SOCK_STREAM, 0);
+		timeval timeout = {HTTP_OTA_TIMEOUT / 1000, 0};
+		setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(port);
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if(connect(_fd, (sockaddr*)&addr, sizeof(addr)) != 0){
+			stop();
+			return HTTPC_ERROR_CONNECTION_REFUSED;
+		}
+
+		char request[160];
+		int length = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n", path);
+		if(offset > 0){length += snprintf(request + length, sizeof(request) - length, "Range: bytes=%lu-\r\n", (unsigned long)offset);}
+		length += snprintf(request + length, sizeof(request) - length, "\r\n");
+		send(_fd, request, length, MSG_NOSIGNAL);
+
+		//read the headers - body bytes that came with them are kept for read()
+		std::string head;
+		char buffer[512];
+		size_t end;
+		while((end = head.find("\r\n\r\n")) == std::string::npos){
+			ssize_t got = recv(_fd, buffer, sizeof(buffer), 0);
+			if(got <= 0){
+				stop();
+				return HTTPC_ERROR_CONNECTION_REFUSED;
+			}
+			head.append(buffer, got);
+		}
+		_pending = head.substr(end + 4);
+		_pendingPos = 0;
+		head.resize(end + 2);
+
+		int code = 0;
+		sscanf(head.c_str(), "HTTP/1.1 %d", &code);
+		std::string value = header(head, "Content-Length");
+		_size = value.empty() ? -1 : atol(value.c_str());
+		_range = header(head, "Content-Range");
+		return code;
+	}
+
+	int32_t size() override { return _size; }
+	String contentRange() override { return String(_range.c_str()); }
+
+	int available() override {
+		if(_fd < 0){return 0;}
+		int queued = 0;
+		ioctl(_fd, FIONREAD, &queued);
+		return (int)(_pending.size() - _pendingPos) + queued;
+	}
+
+	size_t read(uint8_t* data, size_t length) override {
+		if(_fd < 0){return 0;}
+		if(_pendingPos < _pending.size()){
+			size_t count = std::min(length, _pending.size() - _pendingPos);
+			memcpy(data, _pending.data() + _pendingPos, count);
+			_pendingPos += count;
+			return count;
+		}
+		ssize_t got = recv(_fd, data, length, MSG_DONTWAIT);
+		return got > 0 ? got : 0;
+	}
+
+	bool connected() override {
+		if(_fd < 0){return false;}
+		if(available() > 0){return true;}
+		char peek;
+		ssize_t got = recv(_fd, &peek, 1, MSG_PEEK | MSG_DONTWAIT);
+		return got > 0 || (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+	}
+
+	void stop() override {
+		if(_fd >= 0){close(_fd);}
+		_fd = -1;
+	}
+
+private:
+	static std::string header(const std::string& head, const char* name) {
+		std::string key = std::string("\r\n") + name + ": ";
+		size_t start = head.find(key);
+		if(start == std::string::npos){return "";}
+		start += key.size();
+		return head.substr(start, head.find("\r\n", start) - start);
+	}
+
+	int _fd = -1;
+	std::string _pending;
+	size_t _pendingPos = 0;
+	int32_t _size = -1;
+	std::string _range;
+};
+
+
+static void run(ESPHelperHttpOTA& ota){
+	for(int i = 0; i < 100000 && ota.getState() != HTTP_OTA_DONE && ota.getState() != HTTP_OTA_FAILED; i++){
+		ota.handle();
+		hostAdvanceMillis(1);
+		usleep(20);
+	}
+}
+
+static bool updateMatches(const std::vector<uint8_t>& image){
+	FILE* file = fopen(TEST_UPDATE, "rb");
+	if(file == nullptr){return false;}
+	std::vector<uint8_t> written(image.size() + 1);
+	size_t length = fread(written.data(), 1, written.size(), file);
+	fclose(file);
+	return length == image.size() && memcmp(written.data(), image.data(), length) == 0;
+}
+
+
+int main(){
+	std::vector<uint8_t> image(TEST_IMAGE_SIZE);
+	srand(42);
+	for(uint8_t& byte : image){byte = rand();}
+
+	ESPHelperHash hash;
+	hash.begin();
+	hash.add(image.data(), image.size());
+	uint8_t digest[SHA256_SIZE];
+	hash.finish(digest);
+	char sha[SHA256_SIZE * 2 + 1];
+	ESPHelperHash::toHex(digest, sha);
+
+	hostHttpServer server(image);
+	char url[64];
+	snprintf(url, sizeof(url), "http://127.0.0.1:%u/firmware.bin", server.port);
+
+	//plain download
+	{
+		remove(TEST_UPDATE);
+		hostFilePartition partition(TEST_RUNNING, TEST_UPDATE);
+		hostSocketSource source;
+		ESPHelperHttpOTA ota(source, partition);
+		CHECK(ota.begin(url, sha));
+		run(ota);
+		CHECK_EQ(ota.getState(), HTTP_OTA_DONE);
+		CHECK_EQ(ota.getStats().bytesDone, TEST_IMAGE_SIZE);
+		CHECK_EQ(ota.getStats().totalBytes, TEST_IMAGE_SIZE);
+		CHECK_EQ(ota.getStats().resumes, 0);
+		CHECK_EQ(partition.commits, 1);
+		CHECK(updateMatches(image));
+	}
+
+	//the connection drops part way - the rest is fetched with a Range request
+	{
+		remove(TEST_UPDATE);
+		server.requests = 0;
+		server.rangeRequests = 0;
+		server.dropAfter = 30000;
+		hostFilePartition partition(TEST_RUNNING, TEST_UPDATE);
+		hostSocketSource source;
+		ESPHelperHttpOTA ota(source, partition);
+		CHECK(ota.begin(url, sha));
+		run(ota);
+		CHECK_EQ(ota.getState(), HTTP_OTA_DONE);
+		CHECK_EQ(ota.getStats().resumes, 1);
+		CHECK_EQ(server.requests, 2);
+		CHECK_EQ(server.rangeRequests, 1);
+		CHECK_EQ(partition.begins, 1);
+		CHECK_EQ(partition.commits, 1);
+		CHECK(updateMatches(image));
+	}
+
+	//a server that ignores Range answers the resume with the whole image - start over
+	{
+		remove(TEST_UPDATE);
+		server.requests = 0;
+		server.dropAfter = 30000;
+		server.ignoreRange = true;
+		hostFilePartition partition(TEST_RUNNING, TEST_UPDATE);
+		hostSocketSource source;
+		ESPHelperHttpOTA ota(source, partition);
+		CHECK(ota.begin(url, sha));
+		run(ota);
+		server.ignoreRange = false;
+		CHECK_EQ(ota.getState(), HTTP_OTA_DONE);
+		CHECK_EQ(ota.getStats().resumes, 0);
+		CHECK_EQ(server.requests, 2);
+		CHECK_EQ(partition.begins, 2);
+		CHECK_EQ(partition.aborts, 1);
+		CHECK_EQ(partition.commits, 1);
+		CHECK(updateMatches(image));
+	}
+
+	//an image that doesn't match the expected hash is never committed
+	{
+		remove(TEST_UPDATE);
+		char wrong[SHA256_SIZE * 2 + 1];
+		strcpy(wrong, sha);
+		wrong[0] = wrong[0] == '0' ? '1' : '0';
+		hostFilePartition partition(TEST_RUNNING, TEST_UPDATE);
+		hostSocketSource source;
+		ESPHelperHttpOTA ota(source, partition);
+		CHECK(ota.begin(url, wrong));
+		run(ota);
+		CHECK_EQ(ota.getState(), HTTP_OTA_FAILED);
+		CHECK(strcmp(ota.getLastError(), "hash") == 0);
+		CHECK_EQ(partition.commits, 0);
+		CHECK_EQ(partition.aborts, 1);
+		CHECK(fopen(TEST_UPDATE, "rb") == nullptr);
+	}
+
+	//client errors are final
+	{
+		char missing[64];
+		snprintf(missing, sizeof(missing), "http://127.0.0.1:%u/missing", server.port);
+		hostFilePartition partition(TEST_RUNNING, TEST_UPDATE);
+		hostSocketSource source;
+		ESPHelperHttpOTA ota(source, partition);
+		CHECK(ota.begin(missing, sha));
+		run(ota);
+		CHECK_EQ(ota.getState(), HTTP_OTA_FAILED);
+		CHECK(strcmp(ota.getLastError(), "http 404") == 0);
+		CHECK_EQ(partition.begins, 0);
+	}
+
+	//nothing listening - retried with backoff, then given up
+	{
+		int fd = socket(AF_INET, SOCK_STREAM, 0);
+		sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		bind(fd, (sockaddr*)&addr, sizeof(addr));
+		socklen_t length = sizeof(addr);
+		getsockname(fd, (sockaddr*)&addr, &length);
+		char closed[64];
+		snprintf(closed, sizeof(closed), "http://127.0.0.1:%u/firmware.bin", ntohs(addr.sin_port));
+
+		hostFilePartition partition(TEST_RUNNING, TEST_UPDATE);
+		hostSocketSource source;
+		ESPHelperHttpOTA ota(source, partition);
+		CHECK(ota.begin(closed, sha));
+		unsigned long start = millis();
+		run(ota);
+		close(fd);
+		CHECK_EQ(ota.getState(), HTTP_OTA_FAILED);
+		CHECK(strcmp(ota.getLastError(), "connect") == 0);
+		CHECK(millis() - start >= HTTP_OTA_RETRY_DELAY * ((1 << HTTP_OTA_MAX_RETRIES) - 1));
+	}
+
+	//a URL the source can't use fails straight away
+	{
+		hostFilePartition partition(TEST_RUNNING, TEST_UPDATE);
+		hostSocketSource source;
+		ESPHelperHttpOTA ota(source, partition);
+		CHECK(ota.begin("ftp://example/firmware.bin"));
+		ota.handle();
+		CHECK_EQ(ota.getState(), HTTP_OTA_FAILED);
+		CHECK(strcmp(ota.getLastError(), "url") == 0);
+	}
+
+	remove(TEST_UPDATE);
+	return TEST_RESULT();
+}
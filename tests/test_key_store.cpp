@@ -0,0 +1,153 @@
+/*
+    test_key_store.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+ESPHelperKV on its own and exposed over MQTT through ESPHelper::useKeyStore()
+*/
+
+#include "hostTest.h"
+#include <ESPHelper.h>
+
+
+//Print that keeps what it is given
+class capture : public Print {
+public:
+	size_t write(uint8_t c) override {
+		if (length < sizeof(text) - 1) { text[length++] = (char)c; text[length] = '\0'; }
+		return 1;
+	}
+	using Print::write;
+
+	char text[512] = "";
+	size_t length = 0;
+};
+
+
+static const PubSubClient::sentMessage* lastSent(PubSubClient* client, const char* topic){
+	return client->hostFindSent(topic);
+}
+
+static bool payloadIs(const PubSubClient::sentMessage* msg, const char* text){
+	return msg != nullptr && msg->length == strlen(text) && memcmp(msg->payload, text, msg->length) == 0;
+}
+
+
+int main(){
+	CHECK(LittleFS.begin());
+
+	ESPHelperKV store;
+	CHECK(store.begin("/kv.bin"));
+
+	//JSON dump: keys are escaped like strings, NaN/Inf have no JSON form and print as null
+	CHECK(store.setString("quote\"key", "a\\b"));
+	CHECK(store.setFloat("nan", NAN));
+	CHECK(store.setFloat("inf", INFINITY));
+	CHECK(store.setInt("int", -5));
+	CHECK(store.setFloat("big", 1e10f));
+	CHECK(store.setFloat("small", -0.25f));
+	capture json;
+	store.printJson(json);
+	CHECK(strstr(json.text, "\"quote\\\"key\":\"a\\\\b\"") != nullptr);
+	CHECK(strstr(json.text, "\"nan\":null") != nullptr);
+	CHECK(strstr(json.text, "\"inf\":null") != nullptr);
+	CHECK(strstr(json.text, "\"int\":-5") != nullptr);
+	CHECK(strstr(json.text, "\"big\":1e+10") != nullptr);
+	CHECK(strstr(json.text, "\"small\":-0.25") != nullptr);
+	CHECK(strstr(json.text, "nan,") == nullptr && strstr(json.text, ":inf") == nullptr);
+	CHECK(strstr(json.text, "ovf") == nullptr);
+	capture big;
+	store.printValue("big", big);
+	CHECK(strcmp(big.text, "1e+10") == 0);
+	store.clear();
+
+	//checking a value from its text form changes nothing
+	CHECK(store.setInt("count", 3));
+	CHECK(store.setBlob("mac", "\x01\x02", 2));
+	size_t length = 0;
+	CHECK(store.checkFromString("count", "17", KV_STRING, &length));
+	CHECK_EQ(length, sizeof(int32_t));
+	CHECK(!store.checkFromString("count", "seventeen"));
+	CHECK(store.checkFromString("mac", "0a0b0c", KV_STRING, &length));
+	CHECK_EQ(length, 3);
+	CHECK(!store.checkFromString("mac", "0a0"));
+	CHECK(store.checkFromString("new", "text", KV_STRING, &length));
+	CHECK_EQ(length, 4);
+	CHECK(!store.checkFromString("", "1"));
+	CHECK_EQ(store.getInt("count"), 3);
+	CHECK(!store.has("new"));
+
+	//fits() counts the space a compaction would get back
+	CHECK(store.fits(1, KV_DATA_SIZE / 2));
+	for(int i = 0; i < 20; i++){CHECK(store.setString("grow", i % 2 ? "a" : "bb"));}
+	CHECK(store.fits(1, KV_DATA_SIZE - ESPHelperKV::recordLength("count", 4) - ESPHelperKV::recordLength("mac", 2) - ESPHelperKV::recordLength("grow", 1)));
+	CHECK(!store.fits(1, KV_DATA_SIZE - ESPHelperKV::recordLength("count", 4) - ESPHelperKV::recordLength("mac", 2) - ESPHelperKV::recordLength("grow", 1) + 1));
+	CHECK(!store.fits(1, KV_DATA_SIZE));
+	CHECK(!store.fits(KV_INDEX_SLOTS, 0));
+	store.clear();
+
+	//over MQTT
+	NetInfo config;
+	config.setHostname("kv");
+	config.setSsid("host");
+	config.setMqttHost("10.0.0.1");
+	ESPHelper helper(&config);
+	CHECK(helper.useKeyStore(store, "dev/kv"));
+	CHECK(helper.begin());
+	for(int i = 0; i < 100 && helper.getStatus() != FULL_CONNECTION; i++){
+		helper.loop();
+		hostAdvanceMillis(10);
+	}
+	CHECK_EQ(helper.getStatus(), FULL_CONNECTION);
+	PubSubClient* client = helper.getMQTTClient();
+
+	//the reply is published while the key still points into the received topic in the client
+	//buffer - it has to come out intact and with the length announced in beginPublish()
+	client->hostDeliver("dev/kv/set/threshold", "42");
+	helper.loop();
+	CHECK(store.has("threshold"));
+	CHECK(payloadIs(lastSent(client, "dev/kv/value/threshold"), "42"));
+
+	client->hostDeliver("dev/kv/get/threshold", "");
+	client->hostClearSent();
+	helper.loop();
+	CHECK(payloadIs(lastSent(client, "dev/kv/value/threshold"), "42"));
+
+	//unknown keys are answered with an empty payload
+	client->hostDeliver("dev/kv/get/missing", "");
+	helper.loop();
+	CHECK(payloadIs(lastSent(client, "dev/kv/value/missing"), ""));
+
+	//the whole store
+	client->hostDeliver("dev/kv/get", "");
+	helper.loop();
+	CHECK(payloadIs(lastSent(client, "dev/kv/value"), "{\"threshold\":\"42\"}"));
+
+	//the set is written to flash from loop(), not from the receive handler
+	helper.loop();
+	CHECK(!store.isDirty());
+	ESPHelperKV reloaded;
+	CHECK(reloaded.begin("/kv.bin"));
+	CHECK(strcmp(reloaded.getString("threshold"), "42") == 0);
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,124 @@
+/*
+    test_loop_budget.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+loop(budgetUs) with the budget already spent. The host clock only moves when a test moves it, so
+loop(0) runs every call with no time left. Every step that loop() reports as pending must still
+make progress on the next call - the reconnect, the resubscribe batches, the outbound and inbound
+queues, the key store write, OTA and the scheduled tasks - and the pending work must run out
+*/
+
+#include "hostTest.h"
+#include <ESPHelper.h>
+
+
+static uint32_t received = 0;
+
+static void callback(char* topic, uint8_t* payload, unsigned int length){
+	received++;
+}
+
+
+int main(){
+	LittleFS.begin();
+
+	NetInfo config;
+	config.setHostname("loop-budget");
+	config.setSsid("host");
+	config.setPass("secret");
+	config.setMqttHost("10.0.0.1");
+
+	ESPHelperKV store;
+	CHECK(store.begin("/loop-kv.bin"));
+
+	ESPHelper helper(&config);
+	helper.enableInboundQueue();
+	helper.enableOutboundQueue();
+	for(int i = 0; i < 6; i++){
+		char topic[32];
+		snprintf(topic, sizeof(topic), "loop/sub/%d", i);
+		CHECK(helper.addSubscription(topic));
+	}
+	helper.setCallback(callback);
+	CHECK(helper.useKeyStore(store, "loop/keys"));
+	helper.OTA_enable();
+	CHECK(helper.begin());
+
+	for(int i = 0; i < 100 && helper.getStatus() != FULL_CONNECTION; i++){
+		helper.loop();
+		hostAdvanceMillis(10);
+	}
+	CHECK_EQ(helper.getStatus(), FULL_CONNECTION);
+
+	uint32_t taskRuns = 0;
+	CHECK(helper.getScheduler().every(5, [&taskRuns](){ taskRuns++; }) != TASK_INVALID);
+
+	//the broker goes away with publishes made meanwhile and messages waiting for the reconnect
+	PubSubClient* client = helper.getMQTTClient();
+	client->disconnect();
+	for(int i = 0; i < 4; i++){helper.publish("loop/out", "queued");}
+	CHECK(helper.getOutboundQueueStats().depth > 0);
+	for(int i = 0; i < 4; i++){client->hostDeliver("loop/sub/1", "hello");}
+	client->hostDeliver("loop/keys/set/count", "5");
+
+	uint8_t pending = helper.loop((uint32_t)0);
+	int calls = 1;
+	bool connectedOnce = false;
+	while(calls < 500 && (pending != 0 || !client->connected())){
+		uint32_t subscribes = client->subscribes;
+		uint16_t outbound = helper.getOutboundQueueStats().depth;
+		uint32_t inbound = helper.getInboundQueueStats().dispatched;
+		bool dirty = store.isDirty();
+		uint32_t runs = taskRuns;
+		uint32_t otaHandled = ArduinoOTA.handled;
+		bool wasConnected = client->connected();
+
+		hostAdvanceMillis(10);
+		uint8_t next = helper.loop((uint32_t)0);
+		calls++;
+
+		if(pending & LOOP_PENDING_SUBSCRIBE){CHECK(client->subscribes > subscribes);}
+		if(pending & LOOP_PENDING_OUTBOUND){CHECK(helper.getOutboundQueueStats().depth < outbound);}
+		if(pending & LOOP_PENDING_INBOUND){CHECK(helper.getInboundQueueStats().dispatched > inbound);}
+		if(pending & LOOP_PENDING_STORE){CHECK(dirty && !store.isDirty());}
+		if(pending & LOOP_PENDING_TASKS){CHECK(taskRuns > runs);}
+		if(wasConnected){
+			CHECK(ArduinoOTA.handled > otaHandled);
+			connectedOnce = true;
+		}
+		pending = next;
+	}
+
+	CHECK(connectedOnce);
+	CHECK_EQ(pending, 0);
+	CHECK_EQ(helper.getStatus(), FULL_CONNECTION);
+	CHECK_EQ(helper.getOutboundQueueStats().depth, 0);
+	CHECK_EQ(received, 4);
+	CHECK(!store.isDirty());
+	CHECK(client->hostFindSent("loop/out") != nullptr);
+	CHECK(client->hostFindSent("loop/keys/value/count") != nullptr);
+	CHECK(taskRuns > 0);
+	printf("pending work done in %d loop(0) calls\n", calls);
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,311 @@
+/*
+    test_mqtt_ota.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+ESPHelperMqttOTA through the PubSubClient stand-in into a hostFilePartition. Chunks are handed in
+by hand to check the acks for held, duplicate, out of window and misfit chunks, then whole updates
+go through hostOtaLink with chunks lost, duplicated and reordered on the way. Also a patch whose
+copies make the writer stop part way through a chunk, a hash mismatch and a sender that goes away
+*/
+
+#include "hostTest.h"
+#include "hostPartition.h"
+#include "hostOtaLink.h"
+#include <ESPHelperMqttOTA.h>
+
+
+#define TEST_RUNNING "test_mqtt_ota_running.bin"
+#define TEST_UPDATE "test_mqtt_ota_update.bin"
+#define TEST_BASE "ota/dev"
+#define TEST_CHUNK 128
+
+
+static ESPHelper* helper;
+static ESPHelperMqttOTA* ota;
+
+
+static std::vector<uint8_t> randomImage(size_t size, uint32_t seed){
+	std::vector<uint8_t> image(size);
+	for(size_t i = 0; i < size; i++){
+		seed = seed * 1103515245 + 12345;
+		image[i] = seed >> 16;
+	}
+	return image;
+}
+
+static void writeFile(const char* path, const std::vector<uint8_t>& data){
+	FILE* file = fopen(path, "wb");
+	fwrite(data.data(), 1, data.size(), file);
+	fclose(file);
+}
+
+static std::vector<uint8_t> readFile(const char* path){
+	std::vector<uint8_t> data;
+	FILE* file = fopen(path, "rb");
+	if(file == nullptr){return data;}
+	uint8_t buffer[4096];
+	size_t length;
+	while((length = fread(buffer, 1, sizeof(buffer), file)) > 0){data.insert(data.end(), buffer, buffer + length);}
+	fclose(file);
+	return data;
+}
+
+static void sha256Hex(const std::vector<uint8_t>& data, char hex[SHA256_SIZE * 2 + 1]){
+	uint8_t digest[SHA256_SIZE];
+	ESPHelperHash hash;
+	hash.begin();
+	hash.add(data.data(), data.size());
+	hash.finish(digest);
+	ESPHelperHash::toHex(digest, hex);
+}
+
+static void putLE(std::vector<uint8_t>& data, uint32_t value){
+	for(int i = 0; i < 4; i++){data.push_back(value >> (i * 8));}
+}
+
+//the layout delta_gen.py writes: new data, a long copy from the running image, new data
+static std::vector<uint8_t> makePatch(const std::vector<uint8_t>& source, const std::vector<uint8_t>& target, uint32_t head, uint32_t copy){
+	std::vector<uint8_t> patch = {'E', 'H', 'D', 'P', DELTA_VERSION, 0, 0, 0};
+	putLE(patch, source.size());
+	putLE(patch, target.size());
+	ESPHelperHash hash;
+	uint8_t digest[SHA256_SIZE];
+	hash.begin();
+	hash.add(source.data(), source.size());
+	hash.finish(digest);
+	patch.insert(patch.end(), digest, digest + SHA256_SIZE);
+	hash.begin();
+	hash.add(target.data(), target.size());
+	hash.finish(digest);
+	patch.insert(patch.end(), digest, digest + SHA256_SIZE);
+
+	patch.push_back(DELTA_OP_DATA);
+	putLE(patch, head);
+	patch.insert(patch.end(), target.begin(), target.begin() + head);
+	patch.push_back(DELTA_OP_COPY);
+	putLE(patch, 0);
+	putLE(patch, copy);
+	patch.push_back(DELTA_OP_DATA);
+	putLE(patch, target.size() - head - copy);
+	patch.insert(patch.end(), target.begin() + head + copy, target.end());
+	return patch;
+}
+
+//hand messages to the device and let it take them (one per loop(), like the real client)
+static void pump(){
+	PubSubClient* client = helper->getMQTTClient();
+	do{
+		helper->loop();
+		ota->handle();
+	}while(client->hostPendingCount() > 0);
+}
+
+static void sendChunk(const std::vector<uint8_t>& image, uint32_t index, size_t length = 0){
+	size_t start = std::min((size_t)index * TEST_CHUNK, image.size());
+	if(length == 0){length = std::min((size_t)TEST_CHUNK, image.size() - start);}
+	std::vector<uint8_t> payload = {(uint8_t)(index >> 24), (uint8_t)(index >> 16), (uint8_t)(index >> 8), (uint8_t)index};
+	payload.insert(payload.end(), image.begin() + start, image.begin() + start + length);
+	helper->getMQTTClient()->hostDeliver(TEST_BASE "/data", payload.data(), payload.size());
+	pump();
+}
+
+//latest ack sent since the last call, once the rate limit has let any pending one out ("" for none)
+static std::string nextAck(){
+	PubSubClient* client = helper->getMQTTClient();
+	hostAdvanceMillis(MQTT_OTA_ACK_INTERVAL);
+	pump();
+	const PubSubClient::sentMessage* ack = client->hostFindSent(TEST_BASE "/ack");
+	std::string text = ack == nullptr ? "" : std::string((const char*)ack->payload, ack->length);
+	client->hostClearSent();
+	return text;
+}
+
+
+int main(){
+	LittleFS.begin();
+
+	NetInfo config;
+	config.setHostname("mqtt-ota");
+	config.setSsid("host");
+	config.setPass("secret");
+	config.setMqttHost("10.0.0.1");
+
+	hostFilePartition partition(TEST_RUNNING, TEST_UPDATE);
+	ESPHelperMqttOTA update(partition);
+	ESPHelper device(&config);
+	helper = &device;
+	ota = &update;
+	CHECK(update.begin(device, TEST_BASE));
+	CHECK(device.begin());
+	for(int i = 0; i < 100 && device.getStatus() != FULL_CONNECTION; i++){
+		device.loop();
+		hostAdvanceMillis(10);
+	}
+	CHECK_EQ(device.getStatus(), FULL_CONNECTION);
+
+	std::vector<uint8_t> image = randomImage(TEST_CHUNK * 20 + 37, 1);
+	const uint32_t chunks = 21;
+	char hex[SHA256_SIZE * 2 + 1];
+	sha256Hex(image, hex);
+
+	//chunks by hand: held ones show in the bitmap, duplicates and misfits change nothing
+	{
+		device.getMQTTClient()->hostClearSent();
+		char begin[192];
+		snprintf(begin, sizeof(begin), "{\"size\":%u,\"chunk\":%u,\"window\":4,\"sha256\":\"%s\"}", (unsigned)image.size(), TEST_CHUNK, hex);
+		device.getMQTTClient()->hostDeliver(TEST_BASE "/begin", begin);
+		pump();
+		CHECK_EQ(update.getState(), MQTT_OTA_RECEIVING);
+		CHECK(nextAck() == "{\"next\":0,\"bitmap\":0,\"window\":4}");
+
+		//held chunks don't need an ack of their own - the idle ack shows them
+		sendChunk(image, 2);
+		sendChunk(image, 1);
+		CHECK(nextAck() == "");
+		hostAdvanceMillis(MQTT_OTA_IDLE_ACK);
+		CHECK(nextAck() == "{\"next\":0,\"bitmap\":6,\"window\":4}");
+		sendChunk(image, 2);									//held already - acked again at once
+		CHECK_EQ(update.getStats().duplicates, 1);
+		CHECK(nextAck() == "{\"next\":0,\"bitmap\":6,\"window\":4}");
+		sendChunk(image, 4);									//next + window
+		sendChunk(image, chunks);								//past the last chunk
+		CHECK_EQ(update.getStats().outOfWindow, 2);
+		sendChunk(image, 3, 10);								//wrong length
+		CHECK_EQ(update.getStats().chunks, 2);
+		CHECK(nextAck() == "");									//none of those needs an ack
+
+		sendChunk(image, 0);									//fills the gap - 0, 1 and 2 are written
+		CHECK(nextAck() == "{\"next\":3,\"bitmap\":0,\"window\":4}");
+		CHECK_EQ(update.getStats().bytesDone, 3 * TEST_CHUNK);
+		sendChunk(image, 1);									//written already
+		CHECK_EQ(update.getStats().duplicates, 2);
+
+		//the rest a window at a time, each window backwards
+		for(uint32_t first = 3; first < chunks; first += 4){
+			for(uint32_t index = std::min(first + 3, chunks - 1) + 1; index > first; index--){sendChunk(image, index - 1);}
+		}
+		CHECK_EQ(update.getState(), MQTT_OTA_DONE);
+		CHECK_EQ(update.getStats().bytesDone, image.size());
+		std::string last = nextAck();
+		CHECK(last == "{\"next\":21,\"done\":true}");
+		CHECK(!update.handle());								//reported once
+		sendChunk(image, 20);									//the sender missed the done ack
+		CHECK(nextAck() == "{\"next\":21,\"done\":true}");
+		CHECK(!update.handle());
+		CHECK_EQ(partition.commits, 1);
+		CHECK(readFile(TEST_UPDATE) == image);
+	}
+
+	//chunks lost, duplicated and reordered on the way, acks lost
+	{
+		std::vector<uint8_t> bigger = randomImage(TEST_CHUNK * 150 + 5, 2);
+		hostOtaLinkOptions options;
+		options.latencyMs = 10;
+		options.jitterMs = 15;
+		options.lossPercent = 10;
+		options.duplicatePercent = 10;
+		options.ackLossPercent = 5;
+		hostOtaLink link(device, update, TEST_BASE, bigger, TEST_CHUNK, 8, options);
+		link.dropChunk = [](uint32_t index, uint32_t sendCount){return index == 5 && sendCount < 3;};
+		CHECK(link.run(600000));
+		CHECK(link.error.empty());
+		CHECK_EQ(update.getState(), MQTT_OTA_DONE);
+		CHECK(link.resends > 3);
+		CHECK(update.getStats().duplicates > 0);
+		CHECK_EQ(update.getStats().bytesDone, bigger.size());
+		CHECK_EQ(partition.commits, 2);
+		CHECK(readFile(TEST_UPDATE) == bigger);
+		printf("lossy link: %u chunks sent for %u, %u resent, %u duplicates seen, %u ms\n", link.chunksSent,
+			(unsigned)((bigger.size() + TEST_CHUNK - 1) / TEST_CHUNK), link.resends, update.getStats().duplicates, link.elapsedMs);
+	}
+
+	//a patch: the writer stops part way through a chunk while it copies from the running image
+	//and the held chunks wait for it
+	{
+		std::vector<uint8_t> source = randomImage(30000, 3);
+		std::vector<uint8_t> target = randomImage(23100, 4);
+		std::copy(source.begin(), source.begin() + 20000, target.begin() + 100);
+		writeFile(TEST_RUNNING, source);
+		std::vector<uint8_t> patch = makePatch(source, target, 100, 20000);
+
+		uint32_t read = partition.bytesRead;
+		hostOtaLink link(device, update, TEST_BASE, patch, TEST_CHUNK, 8);
+		CHECK(link.run(60000));
+		CHECK_EQ(update.getState(), MQTT_OTA_DONE);
+		CHECK_EQ(partition.commits, 3);
+		CHECK(readFile(TEST_UPDATE) == target);
+		CHECK(partition.bytesRead - read >= 30000 + 20000);		//source checked, then copied from
+	}
+
+	//an image that doesn't match the hash in the begin message is never committed
+	{
+		std::vector<uint8_t> wrong = randomImage(TEST_CHUNK * 10, 5);
+		std::vector<uint8_t> previous = readFile(TEST_UPDATE);
+		uint32_t aborts = partition.aborts;
+		hostOtaLink link(device, update, TEST_BASE, wrong, TEST_CHUNK, 8);
+		link.sha256Override = hex;
+		CHECK(!link.run(60000));
+		CHECK(link.error == "{\"error\":\"hash\"}");
+		CHECK_EQ(update.getState(), MQTT_OTA_FAILED);
+		CHECK(strcmp(update.getLastError(), "hash") == 0);
+		CHECK_EQ(partition.commits, 3);
+		CHECK_EQ(partition.aborts, aborts + 1);
+		CHECK(readFile(TEST_UPDATE) == previous);
+	}
+
+	//the sender goes away part way through
+	{
+		uint32_t aborts = partition.aborts;
+		hostOtaLink link(device, update, TEST_BASE, image, TEST_CHUNK, 8);
+		link.dropChunk = [](uint32_t index, uint32_t sendCount){return index >= 4;};
+		for(int i = 0; i < 500; i++){link.step();}
+		CHECK_EQ(update.getState(), MQTT_OTA_RECEIVING);
+		CHECK_EQ(update.getStats().bytesDone, 4 * TEST_CHUNK);
+
+		//nothing arrives from here on: idle acks keep going until the update is given up
+		PubSubClient* client = device.getMQTTClient();
+		uint32_t idleAcks = 0;
+		for(int i = 0; i < MQTT_OTA_TIMEOUT / 1000 + 2 && update.getState() == MQTT_OTA_RECEIVING; i++){
+			client->hostClearSent();
+			hostAdvanceMillis(1000);
+			pump();
+			if(client->hostFindSent(TEST_BASE "/ack") != nullptr){idleAcks++;}
+		}
+		CHECK(idleAcks >= MQTT_OTA_TIMEOUT / 1000 - 1);
+		CHECK_EQ(update.getState(), MQTT_OTA_FAILED);
+		CHECK(strcmp(update.getLastError(), "timeout") == 0);
+		CHECK_EQ(partition.aborts, aborts + 1);
+		const PubSubClient::sentMessage* ack = client->hostFindSent(TEST_BASE "/ack");
+		CHECK(ack != nullptr && std::string((const char*)ack->payload, ack->length) == "{\"error\":\"timeout\"}");
+		CHECK_EQ(partition.commits, 3);
+
+		//a chunk that turns up late gets the error again
+		nextAck();
+		sendChunk(image, 4);
+		CHECK(nextAck() == "{\"error\":\"timeout\"}");
+	}
+
+	remove(TEST_RUNNING);
+	remove(TEST_UPDATE);
+	return TEST_RESULT();
+}
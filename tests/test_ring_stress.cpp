@@ -0,0 +1,102 @@
+/*
+    test_ring_stress.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+LockFreeRing with a real producer and consumer thread. The producer alternates push() and
+reserve()/commit() and retries while the ring is full, the consumer checks every message arrives
+once, in order and intact (topic, length, flags, payload and the null after it). Runs at ring
+sizes from the 64 byte minimum to 4096, with payloads up to what each size can take
+*/
+
+#include "hostTest.h"
+#include <ESPHelperRing.h>
+#include <thread>
+
+
+#define STRESS_MESSAGES 200000
+
+
+static uint8_t payloadByte(uint32_t message, uint32_t i){
+	return (uint8_t)(message * 31 + i);
+}
+
+static bool stress(size_t size){
+	LockFreeRing ring;
+	if(!ring.begin(size)){return false;}
+
+	//the largest payload a record of this ring can carry with the topics below
+	unsigned int maxLength = size >= 256 ? std::min(size, (size_t)512) / 2 - 40 : 5;
+
+	std::thread producer([&]{
+		char topic[16];
+		uint8_t payload[512];
+		for(uint32_t message = 0; message < STRESS_MESSAGES; message++){
+			snprintf(topic, sizeof(topic), "t/%u", message % 100000);
+			unsigned int length = (message * 7) % maxLength;
+			uint8_t flags = message & 0xFF;
+
+			if(message % 2 == 0){
+				for(uint32_t i = 0; i < length; i++){payload[i] = payloadByte(message, i);}
+				while(!ring.push(topic, payload, length, flags)){std::this_thread::yield();}
+			}
+			else{
+				uint8_t* dest;
+				while((dest = ring.reserve(topic, length, flags)) == nullptr){std::this_thread::yield();}
+				for(uint32_t i = 0; i < length; i++){dest[i] = payloadByte(message, i);}
+				ring.commit();
+			}
+		}
+	});
+
+	uint32_t errors = 0;
+	char expected[16];
+	for(uint32_t message = 0; message < STRESS_MESSAGES; message++){
+		char* topic;
+		uint8_t* payload;
+		unsigned int length;
+		uint8_t flags;
+		while(!ring.peek(topic, payload, length, flags)){std::this_thread::yield();}
+
+		snprintf(expected, sizeof(expected), "t/%u", message % 100000);
+		bool intact = strcmp(topic, expected) == 0 && length == (message * 7) % maxLength && flags == (message & 0xFF) && payload[length] == '\0';
+		for(uint32_t i = 0; intact && i < length; i++){intact = payload[i] == payloadByte(message, i);}
+		if(!intact && errors++ < 5){printf("ring %u: message %u arrived as \"%s\" (%u bytes, flags %u)\n", (unsigned)size, message, topic, length, flags);}
+		ring.pop();
+	}
+	producer.join();
+
+	queueStats stats = ring.getStats();
+	CHECK(ring.isEmpty());
+	CHECK_EQ(stats.depth, 0);
+	CHECK_EQ(stats.dispatched, STRESS_MESSAGES);
+	CHECK_EQ(stats.bytesUsed, 0);
+	printf("ring %u: %u messages, %u times full, high watermark %u\n", (unsigned)size, STRESS_MESSAGES, stats.overflows, stats.highWatermark);
+	return errors == 0;
+}
+
+
+int main(){
+	static const size_t sizes[] = {64, 256, 1000, 4096};
+	for(size_t size : sizes){CHECK(stress(size));}
+	return TEST_RESULT();
+}
@@ -0,0 +1,300 @@
+/*
+    test_scheduler.cpp
+    Copyright (c) 2019 ItKindaWorks Inc All right reserved.
+    github.com/ItKindaWorks
+
+    This file is part of ESPHelper
+
+    ESPHelper is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    ESPHelper is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with ESPHelper.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/*
+ESPHelperScheduler on its own: deadline order, one-shots, tasks that cancel or reschedule
+themselves and each other from inside run(), the overrun and skipped counters and millis() wrapping.
+The host clock only moves when the test (or a task) moves it
+*/
+
+#include "hostTest.h"
+#include <ESPHelperScheduler.h>
+
+
+//names of the tasks in the order they ran
+static char order[64];
+
+static void ran(const char* name){
+	strncat(order, name, sizeof(order) - strlen(order) - 1);
+}
+
+//move the clock to a millis() value (32 bit, as on the device)
+static void setMillis(uint32_t target){
+	hostAdvanceMillis(target - (uint32_t)millis());
+}
+
+
+int main(){
+	//bad arguments and a full table
+	{
+		ESPHelperScheduler scheduler;
+		CHECK_EQ(scheduler.every(0, []{}), TASK_INVALID);
+		CHECK_EQ(scheduler.after(10, nullptr), TASK_INVALID);
+		CHECK_EQ(scheduler.run(), 0);
+		CHECK_EQ(scheduler.nextDue(), UINT32_MAX);
+		for(int i = 0; i < MAX_SCHEDULED_TASKS; i++){CHECK(scheduler.every(100, []{}) != TASK_INVALID);}
+		CHECK_EQ(scheduler.after(10, []{}), TASK_INVALID);
+		CHECK_EQ(scheduler.count(), MAX_SCHEDULED_TASKS);
+		CHECK(!scheduler.cancel(-1) && !scheduler.cancel(MAX_SCHEDULED_TASKS));
+	}
+
+	//due tasks run soonest deadline first whatever order they were added in, one-shots are freed
+	{
+		setMillis(1000);
+		ESPHelperScheduler scheduler;
+		order[0] = '\0';
+		int c = scheduler.after(30, []{ran("c");}, "c");
+		int a = scheduler.after(10, []{ran("a");}, "a");
+		int b = scheduler.every(20, []{ran("b");}, "b");
+		int later = scheduler.after(500, []{ran("x");});
+		CHECK_EQ(scheduler.nextDue(), 10);
+		CHECK_EQ(scheduler.run(), 0);
+
+		hostAdvanceMillis(30);
+		CHECK_EQ(scheduler.run(), 3);
+		CHECK(strcmp(order, "abc") == 0);
+		CHECK(scheduler.getStats(a) == nullptr && scheduler.getStats(c) == nullptr);
+		CHECK_EQ(scheduler.count(), 2);
+		CHECK_EQ(scheduler.getStats(b)->runs, 1);
+		CHECK_EQ(scheduler.getStats(b)->maxLateMs, 10);
+		CHECK_EQ(scheduler.nextDue(), 10);		//b keeps its rate: due at 40, not 30 + 20
+
+		//a freed slot is handed out again
+		int reused = scheduler.after(5, []{ran("r");});
+		CHECK(reused == a || reused == c);
+		CHECK(strcmp(scheduler.getName(b), "b") == 0);
+		CHECK(strcmp(scheduler.getName(reused), "") == 0);
+		CHECK(scheduler.getName(a == reused ? c : a) == nullptr);
+		CHECK(scheduler.cancel(later));
+		CHECK(!scheduler.cancel(later));
+	}
+
+	//a task that cancels itself and another task in the same run
+	{
+		ESPHelperScheduler scheduler;
+		order[0] = '\0';
+		int self = TASK_INVALID;
+		int other = TASK_INVALID;
+		self = scheduler.every(10, [&]{
+			ran("s");
+			CHECK(scheduler.cancel(self));
+			CHECK(scheduler.cancel(other));
+			CHECK(scheduler.getStats(self) != nullptr);		//freed once it returns
+		});
+		other = scheduler.every(15, []{ran("o");});
+		hostAdvanceMillis(20);
+		CHECK_EQ(scheduler.run(), 1);
+		CHECK(strcmp(order, "s") == 0);
+		CHECK_EQ(scheduler.count(), 0);
+		CHECK(scheduler.getStats(self) == nullptr && scheduler.getStats(other) == nullptr);
+		CHECK_EQ(scheduler.nextDue(), UINT32_MAX);
+		hostAdvanceMillis(100);
+		CHECK_EQ(scheduler.run(), 0);
+	}
+
+	//cancelling a task that already ran in this call (so isn't back on the heap yet)
+	{
+		ESPHelperScheduler scheduler;
+		order[0] = '\0';
+		int first = scheduler.every(10, []{ran("f");});
+		scheduler.every(12, [&]{
+			ran("s");
+			scheduler.cancel(first);
+		});
+		hostAdvanceMillis(12);
+		CHECK_EQ(scheduler.run(), 2);
+		CHECK_EQ(scheduler.count(), 1);
+		hostAdvanceMillis(20);
+		CHECK_EQ(scheduler.run(), 1);
+		CHECK(strcmp(order, "fss") == 0);
+	}
+
+	//the same, reusing its slot before run() returns
+	{
+		ESPHelperScheduler scheduler;
+		order[0] = '\0';
+		int first = scheduler.every(10, []{ran("f");});
+		int added = TASK_INVALID;
+		int second = scheduler.every(12, [&]{
+			ran("s");
+			if(added != TASK_INVALID){return;}
+			CHECK(scheduler.cancel(first));
+			added = scheduler.after(50, []{ran("n");});
+		});
+		hostAdvanceMillis(12);
+		CHECK_EQ(scheduler.run(), 2);
+		CHECK(strcmp(order, "fs") == 0);
+		CHECK_EQ(added, first);
+		CHECK_EQ(scheduler.count(), 2);
+
+		//the new task in the old slot is on the heap once and runs at its own time, the
+		//cancelled one never comes back
+		order[0] = '\0';
+		for(int i = 0; i < 70; i++){
+			hostAdvanceMillis(1);
+			scheduler.run();
+		}
+		CHECK(strcmp(order, "ssssns") == 0);				//s at 24, 36, 48, 60 and 72, n at 62
+		CHECK_EQ(scheduler.count(), 1);
+		CHECK(scheduler.getStats(second) != nullptr);
+		CHECK(scheduler.cancel(second));
+	}
+
+	//setInterval() and runNow() from inside a callback
+	{
+		ESPHelperScheduler scheduler;
+		int self = TASK_INVALID;
+		int self2 = TASK_INVALID;
+		uint32_t selfRuns[4] = {0};
+		uint8_t selfCount = 0;
+		self = scheduler.every(10, [&]{
+			if(selfCount < 4){selfRuns[selfCount++] = (uint32_t)millis();}
+			if(selfCount == 1){CHECK(scheduler.setInterval(self, 50));}
+			CHECK(!scheduler.runNow(self));
+		});
+		uint32_t start = (uint32_t)millis();
+
+		//a task that reschedules one that already ran this call (it is due 1ms after the other)
+		uint32_t otherRuns = 0;
+		int other = scheduler.every(10, [&]{otherRuns++;});
+		hostAdvanceMillis(1);
+		self2 = scheduler.every(10, [&]{
+			CHECK(scheduler.setInterval(other, 40));
+			CHECK(scheduler.runNow(other));
+		});
+		CHECK(self2 != TASK_INVALID);
+
+		hostAdvanceMillis(10);
+		CHECK_EQ(scheduler.run(), 3);
+		CHECK_EQ(otherRuns, 1);
+		CHECK_EQ(scheduler.nextDue(), 0);		//runNow: due on the next call, not again in this one
+		CHECK(scheduler.setInterval(self2, 1000));
+		CHECK_EQ(scheduler.run(), 1);
+		CHECK_EQ(otherRuns, 2);
+		CHECK_EQ(scheduler.getStats(other)->runs, 2);
+
+		for(int i = 0; i < 200; i++){
+			hostAdvanceMillis(1);
+			scheduler.run();
+		}
+		CHECK_EQ(selfCount, 4);
+		CHECK_EQ(selfRuns[0] - start, 11);
+		CHECK_EQ(selfRuns[1] - start, 60);		//the running task moves to the new interval from its deadline
+		CHECK_EQ(selfRuns[2] - start, 110);
+		CHECK_EQ(selfRuns[3] - start, 160);
+		CHECK_EQ(otherRuns, 2 + 5);				//every 40ms from the runNow() run: 51, 91, 131, 171 and 211
+		CHECK(!scheduler.setInterval(self, 0));
+		int once = scheduler.after(10, []{});
+		CHECK(!scheduler.setInterval(once, 10));
+	}
+
+	//overruns against the task budget (the interval when there is none) and skipped runs
+	{
+		ESPHelperScheduler scheduler;
+		int budgeted = scheduler.every(5, []{hostAdvanceMicros(1500);}, "budgeted", 1000);
+		int interval = scheduler.every(5, []{hostAdvanceMicros(6000);}, "interval");
+		int within = scheduler.every(5, []{hostAdvanceMicros(100);}, "within");
+		hostAdvanceMillis(5);
+		CHECK_EQ(scheduler.run(), 3);
+		CHECK_EQ(scheduler.getStats(budgeted)->overruns, 1);
+		CHECK_EQ(scheduler.getStats(interval)->overruns, 1);
+		CHECK_EQ(scheduler.getStats(interval)->lastUs, 6000);
+		CHECK_EQ(scheduler.getStats(within)->overruns, 0);
+		CHECK_EQ(scheduler.busiest(), interval);
+		scheduler.resetStats();
+		CHECK_EQ(scheduler.getStats(interval)->runs, 0);
+		scheduler.cancel(budgeted);
+		scheduler.cancel(interval);
+		scheduler.cancel(within);
+
+		//a run that takes 3.5 intervals: the runs it sat on are skipped, the rate is kept
+		uint32_t start = (uint32_t)millis();
+		uint32_t runs[3];
+		uint8_t runCount = 0;
+		int slow = scheduler.every(10, [&]{
+			if(runCount < 3){runs[runCount] = (uint32_t)millis();}
+			if(runCount++ == 0){hostAdvanceMillis(35);}
+		});
+		hostAdvanceMillis(10);
+		CHECK_EQ(scheduler.run(), 1);
+		CHECK_EQ(scheduler.getStats(slow)->skipped, 3);			//20, 30 and 40
+		CHECK_EQ(scheduler.getStats(slow)->overruns, 1);
+		CHECK_EQ(scheduler.nextDue(), 5);						//back on 50
+		for(int i = 0; i < 20; i++){
+			hostAdvanceMillis(1);
+			scheduler.run();
+		}
+		CHECK_EQ(runCount, 3);
+		CHECK_EQ(runs[1] - start, 50);
+		CHECK_EQ(runs[2] - start, 60);
+		CHECK_EQ(scheduler.getStats(slow)->skipped, 3);
+
+		//a task late by less than an interval catches up without skipping
+		hostAdvanceMillis(8);
+		CHECK_EQ(scheduler.run(), 1);
+		CHECK_EQ(scheduler.getStats(slow)->skipped, 3);
+		CHECK_EQ(scheduler.getStats(slow)->maxLateMs, 3);
+		CHECK_EQ(scheduler.nextDue(), 7);
+	}
+
+	//run(budgetUs) stops starting tasks once the budget is spent, but always runs one
+	{
+		ESPHelperScheduler scheduler;
+		for(int i = 0; i < 4; i++){scheduler.after(1 + i, []{hostAdvanceMicros(400);});}
+		hostAdvanceMillis(10);
+		CHECK_EQ(scheduler.run(500), 2);
+		CHECK_EQ(scheduler.run(0), 1);
+		CHECK_EQ(scheduler.run(), 1);
+		CHECK_EQ(scheduler.count(), 0);
+	}
+
+	//millis() wrapping: deadlines on either side of zero keep their order and their rate
+	{
+		setMillis(UINT32_MAX - 25);
+		ESPHelperScheduler scheduler;
+		order[0] = '\0';
+		uint32_t runs[6];
+		uint8_t runCount = 0;
+		int periodic = scheduler.every(10, [&]{
+			if(runCount < 6){runs[runCount++] = (uint32_t)millis();}
+		});
+		scheduler.after(40, []{ran("w");});		//due after the wrap
+		scheduler.after(20, []{ran("b");});		//due before it
+		CHECK_EQ(scheduler.nextDue(), 10);
+		for(int i = 0; i < 60; i++){
+			hostAdvanceMillis(1);
+			scheduler.run();
+		}
+		CHECK(strcmp(order, "bw") == 0);
+		CHECK_EQ(runCount, 6);
+		CHECK_EQ(runs[0], UINT32_MAX - 15);
+		CHECK_EQ(runs[1], UINT32_MAX - 5);
+		CHECK_EQ(runs[2], 4);
+		CHECK_EQ(runs[3], 14);
+		CHECK_EQ(scheduler.getStats(periodic)->skipped, 0);
+		CHECK_EQ(scheduler.getStats(periodic)->maxLateMs, 0);
+		CHECK_EQ(scheduler.nextDue(), 10 - (uint32_t)(millis() - runs[5]));
+	}
+
+	return TEST_RESULT();
+}
@@ -1,68 +1,104 @@
 import os
-import subprocess
-import shutil
+import re
+import sys
+import gzip
+import hashlib
 import minify_html
 
 
-    
+
 STATIC_DIR = "static"
-OUTPUT_DIR = "src"
+OUTPUT_FILE = os.path.join("src", "web_assets.h")
+BUNDLE_NAME = "web_assets"
+
+MIME_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".jpg": "image/jpeg",
+    ".ico": "image/x-icon",
+    ".woff2": "font/woff2",
+    ".txt": "text/plain",
+}
+
+# only keep the gzip copy if it is at least this much smaller (images and fonts are already compressed)
+GZIP_MIN_SAVING = 0.1
+
 
-def convert_file(source_path, dest_path):
+def read_asset(source_path):
+    # returns the bytes that get embedded (html is minified first)
     if source_path.endswith(".html"):
-        print(f"\t[HTML->H] Minifying {source_path} to {dest_path}")
-        temp_path = source_path + ".tmp"  
-        shutil.move(source_path, temp_path)  
-        
-
-        with open(temp_path, "r") as temp_file:
-            content = temp_file.read()
-            minified = minify_html.minify(content, minify_js=False, remove_processing_instructions=True)
-
-            with open(source_path, "w") as minified_file:
-                minified_file.write(minified)
-
-        with open(dest_path, "w") as out_file:
-            subprocess.run(["xxd", "-i", source_path], stdout=out_file)
-        
-        os.remove(source_path)  # Clean up the temporary file
-        shutil.move(temp_path, source_path) # Restore the original file name
-
-
-    else:
-        with open(dest_path, "w") as out_file:
-            subprocess.run(["xxd", "-i", source_path], stdout=out_file)
-            
-    
-        
-def post_process_file(file_path):
-    # Post-process to add PROGMEM to the array declaration
-    with open(file_path, "r") as file:
-        lines = file.readlines()
-    
-    lines = ["#pragma once\n\n"] + lines  # Add pragma once at the top
-
-    with open(file_path, "w") as file:
-        for line in lines:
-            if "[] =" in line:
-                line = line.replace("[] =", "[] PROGMEM =")
-            if "unsigned" in line:
-                line = line.replace("unsigned", "inline unsigned")
-            file.write(line)
+        print(f"\t[HTML->H] Minifying {source_path}")
+        with open(source_path, "r") as source_file:
+            minified = minify_html.minify(source_file.read(), minify_js=False, remove_processing_instructions=True)
+        return minified.encode()
+
+    with open(source_path, "rb") as source_file:
+        return source_file.read()
+
+
+def c_array(array_name, data):
+    # same layout as `xxd -i`, placed in flash
+    lines = [f"inline const unsigned char {array_name}[] PROGMEM = {{\n"]
+    for i in range(0, len(data), 12):
+        chunk = ", ".join(f"0x{b:02x}" for b in data[i:i + 12])
+        lines.append(f"  {chunk}" + (",\n" if i + 12 < len(data) else "\n"))
+    lines.append("};\n")
+    return lines
+
+
+def build(static_dir, output_file, bundle_name):
+    # one header with every file under static_dir plus a manifest/route table (see ESPHelperWebAssets.h)
+    arrays = []
+    routes = []
+    for root, dirs, files in os.walk(static_dir):
+        dirs.sort()
+        for filename in sorted(files):
+            extension = os.path.splitext(filename)[1].lower()
+            if extension not in MIME_TYPES:
+                continue
+
+            source_path = os.path.join(root, filename)
+            route = "/" + os.path.relpath(source_path, static_dir).replace(os.sep, "/")
+            array_name = bundle_name + "_" + re.sub(r"[^0-9A-Za-z]", "_", route[1:])
+            data = read_asset(source_path)
+
+            # mtime=0 keeps the output (and so the header) identical between runs of the script
+            compressed = gzip.compress(data, compresslevel=9, mtime=0)
+            use_gzip = len(compressed) <= len(data) * (1 - GZIP_MIN_SAVING)
+            stored = compressed if use_gzip else data
+            etag = hashlib.sha256(data).hexdigest()[:16]
+
+            arrays += c_array(array_name, stored) + ["\n"]
+            routes.append(f"  {{\"{route}\", \"{MIME_TYPES[extension]}\", {array_name}, {len(stored)}, {'true' if use_gzip else 'false'}, \"\\\"{etag}\\\"\"}}")
+            print(f"[HTML->H] {route}: {len(data)} -> {len(stored)} bytes{' (gzip)' if use_gzip else ''}, ETag {etag}")
+
+    lines = ["#pragma once\n\n", f"//generated by web_to_header.py from {static_dir}/ - do not edit\n\n", "#include \"ESPHelperWebAssets.h\"\n\n"]
+    lines += arrays
+    lines.append(f"inline constexpr webAsset {bundle_name}[] = {{\n")
+    lines.append(",\n".join(routes) + "\n")
+    lines.append("};\n")
+    lines.append(f"inline constexpr size_t {bundle_name}_count = {len(routes)};\n")
+
+    with open(output_file, "w") as out_file:
+        out_file.write("".join(lines))
+    print(f"[HTML->H] Wrote {len(routes)} assets to {output_file}")
 
 
 def main():
+    # usage: web_to_header.py [static dir] [output header] [bundle name]
+    # (apps can bundle their own assets and register them with ESPHelperWebConfig::addAssets)
+    static_dir = sys.argv[1] if len(sys.argv) > 1 else STATIC_DIR
+    output_file = sys.argv[2] if len(sys.argv) > 2 else OUTPUT_FILE
+    bundle_name = sys.argv[3] if len(sys.argv) > 3 else BUNDLE_NAME
 
-    # print("[HTML->H] Converting HTML/CSS/JS files to C header files...")
-    if not os.path.exists(OUTPUT_DIR):
-        os.makedirs(OUTPUT_DIR)
-    for filename in os.listdir(STATIC_DIR):
-        if filename.endswith(".html") or filename.endswith(".css") or filename.endswith(".js"):
-            input_file = os.path.join(STATIC_DIR, filename)
-            output_file = os.path.join(OUTPUT_DIR, filename.replace('.', '_') + ".h")
-            print(f"[HTML->H] Converting {input_file} -> {output_file}")
-            convert_file(input_file, output_file)
-            post_process_file(output_file)
+    output_dir = os.path.dirname(output_file)
+    if output_dir and not os.path.exists(output_dir):
+        os.makedirs(output_dir)
+    build(static_dir, output_file, bundle_name)
 
 if __name__ == "__main__":
     main()